@@ -12,6 +12,11 @@ macx-clang {
     ICON = mac.icns
 }
 
+# ZipWriter needs zlib, which only the Windows and Mac builds of QtCore carry
+!win32:!macx {
+    LIBS += -lz
+}
+
 SOURCES += main.cpp\
         startwindow.cpp \
     help.cpp \
@@ -34,7 +39,28 @@ SOURCES += main.cpp\
     dataentry.cpp \
     organism.cpp \
     processnewimages.cpp \
-    advancedoptions.cpp
+    advancedoptions.cpp \
+    previewloader.cpp \
+    tiledimagelabel.cpp \
+    taxonindex.cpp \
+    itisconverter.cpp \
+    offlinegeocoder.cpp \
+    geocodecache.cpp \
+    geocodescheduler.cpp \
+    updatedownloader.cpp \
+    deltaupdate.cpp \
+    zipwriter.cpp \
+    exportlog.cpp \
+    imageidentifiers.cpp \
+    idallocator.cpp \
+    hotfolderwatcher.cpp \
+    imagehashes.cpp \
+    contenthashes.cpp \
+    directoryindex.cpp \
+    imageview.cpp \
+    databaseconnections.cpp \
+    preparedquery.cpp \
+    pagedtablemodel.cpp
 
 HEADERS  += startwindow.h \
     help.h \
@@ -57,7 +83,29 @@ HEADERS  += startwindow.h \
     dataentry.h \
     organism.h \
     processnewimages.h \
-    advancedoptions.h
+    advancedoptions.h \
+    previewloader.h \
+    tiledimagelabel.h \
+    taxonindex.h \
+    itisconverter.h \
+    offlinegeocoder.h \
+    geocodecache.h \
+    geocodescheduler.h \
+    updatedownloader.h \
+    deltaupdate.h \
+    zipwriter.h \
+    exportlog.h \
+    imageidentifiers.h \
+    idallocator.h \
+    hotfolderwatcher.h \
+    imagehashes.h \
+    contenthashes.h \
+    directoryindex.h \
+    imageview.h \
+    databaseconnections.h \
+    preparedquery.h \
+    tableschema.h \
+    pagedtablemodel.h
 
 FORMS    += startwindow.ui \
     help.ui \
@@ -27,13 +27,17 @@
 
 #include "startwindow.h"
 #include "advancedoptions.h"
+#include "itisconverter.h"
 #include "ui_advancedoptions.h"
+#include "databaseconnections.h"
+#include "exportlog.h"
 
 AdvancedOptions::AdvancedOptions(QWidget *parent) :
     QWidget(parent),
     ui(new Ui::AdvancedOptions)
 {
     ui->setupUi(this);
+    itisConverter = 0;
     move(QApplication::desktop()->screen()->rect().center() - rect().center());
 
 #ifdef Q_OS_MAC
@@ -426,6 +430,7 @@ void AdvancedOptions::on_resetButton_clicked()
 
     QSqlDatabase db = QSqlDatabase::database();
     db.transaction();
+    ExportLog::suspend(modTables);
     for (auto t : modTables)
     {
         QSqlQuery dropQry;
@@ -444,6 +449,7 @@ void AdvancedOptions::on_resetButton_clicked()
         renameQry.prepare("INSERT INTO " + t + " SELECT * FROM " + pub + t);
         renameQry.exec();
     }
+    ExportLog::resume();
 
     if (!db.commit())
     {
@@ -452,8 +458,7 @@ void AdvancedOptions::on_resetButton_clicked()
     }
     else
     {
-        db.close();
-        db.open();
+        DatabaseConnections::reopen();
         QSqlQuery query;
         query.exec("VACUUM");
     }
@@ -491,299 +496,46 @@ void AdvancedOptions::on_convertITISButton_clicked()
 
 void AdvancedOptions::convertITIS(const QString dbpath)
 {
-    QSqlDatabase dbhier = QSqlDatabase::addDatabase("QSQLITE","ITISConnection");
-    dbhier.setDatabaseName(dbpath);
-    if (!dbhier.open()) {
-        QMessageBox::critical(0, tr("Cannot open database"),
-            "Unable to open database at: " + dbpath, QMessageBox::Cancel);
+    if (itisConverter)
         return;
-    }
-
-    QPointer<QMessageBox> importingMsg = new QMessageBox;
-    importingMsg->setAttribute(Qt::WA_DeleteOnClose);
-    for (auto child : importingMsg->findChildren<QDialogButtonBox *>())
-        child->hide();
-    importingMsg->setText("Please wait while the ITIS database is being converted. This may\n\n"
-                          "take several minutes as over 500,000 records are being processed.");
-    importingMsg->setModal(true);
-    importingMsg->show();
-    QCoreApplication::processEvents();
-    QCoreApplication::processEvents();
-
-    struct Hierarchy
-    {
-        QString tsnID;
-        QString hierarchyString;
-        QString className = "";
-        QString orderName = "";
-        QString familyName = "";
-    };
-    QList<Hierarchy> hierarchies;
-
-    dbhier.transaction();
-
-    QSqlQuery del0(dbhier);
-    del0.prepare("DELETE FROM taxonomic_units WHERE name_usage != 'valid' AND name_usage != 'accepted';");
-    del0.exec();
-
-
-    QSqlQuery createQry(dbhier);
-    createQry.prepare("CREATE TABLE `taxa` ("
-                      "`ubioID`	TEXT, `dcterms_identifier`	TEXT,"
-                      "`dwc_kingdom`	TEXT, `dwc_class`	TEXT,"
-                      "`dwc_order`	TEXT, `dwc_family`	TEXT,"
-                      "`dwc_genus`	TEXT, `dwc_specificEpithet`	TEXT,"
-                      "`dwc_infraspecificEpithet`	TEXT, `dwc_taxonRank`	TEXT, "
-                      "`dwc_scientificNameAuthorship`	TEXT,"
-                      "`dwc_vernacularName`	TEXT, `dcterms_modified`	TEXT,"
-                      "PRIMARY KEY(`dcterms_identifier`) );");
-    createQry.exec();
-
-    QSqlQuery rankIndex(dbhier);
-    rankIndex.prepare("CREATE INDEX `rank_id_index` ON `taxonomic_units` (`tsn` ,`rank_id` )");
-    rankIndex.exec();
-
-    if (!dbhier.commit())
-    {
-        qDebug() << __LINE__ << "Problem with database transaction.";
-        dbhier.rollback();
-    }
-
-    QSqlQuery insertQry(dbhier);
-    insertQry.prepare("INSERT INTO taxa SELECT '', taxonomic_units.tsn, kingdoms.kingdom_name, "
-                      "'', '', '', '', '', '', '', '', '', '2016-12-22T00:00:00-06:00' FROM taxonomic_units "
-                      "INNER JOIN kingdoms ON taxonomic_units.kingdom_id  = kingdoms.kingdom_id;");
-    insertQry.exec();
-
-    dbhier.transaction();
-
-    QSqlQuery up1(dbhier);
-    up1.prepare("UPDATE taxa SET dwc_taxonRank = (SELECT taxon_unit_types.rank_name FROM "
-                "taxonomic_units INNER JOIN taxon_unit_types ON taxonomic_units.rank_id = "
-                "taxon_unit_types.rank_id AND taxonomic_units.kingdom_id = "
-                "taxon_unit_types.kingdom_id WHERE taxonomic_units.tsn = taxa.dcterms_identifier);");
-    up1.exec();
-
-    QSqlQuery up2(dbhier);
-    up2.prepare("UPDATE taxa SET dwc_scientificNameAuthorship = (SELECT taxon_authors_lkp.taxon_author "
-                "FROM taxonomic_units INNER JOIN taxon_authors_lkp ON taxonomic_units.taxon_author_id = "
-                "taxon_authors_lkp.taxon_author_id WHERE taxonomic_units.tsn = taxa.dcterms_identifier);");
-    up2.exec();
-
-    QSqlQuery up3(dbhier);
-    up3.prepare("UPDATE taxa SET dwc_vernacularName = (SELECT vernaculars.vernacular_name FROM vernaculars "
-                "WHERE vernaculars.tsn = taxa.dcterms_identifier AND (vernaculars.language = 'English' OR "
-                "vernaculars.language = 'unspecified'));");
-    up3.exec();
-
-    QSqlQuery up4(dbhier);
-    up4.prepare("UPDATE taxa SET dwc_genus = (SELECT taxonomic_units.unit_name1 FROM taxonomic_units WHERE "
-                "taxonomic_units.tsn = taxa.dcterms_identifier AND (taxa.dwc_taxonRank = 'Genus' OR "
-                "taxa.dwc_taxonRank = 'Species' OR taxa.dwc_taxonRank = 'Subspecies' OR taxa.dwc_taxonRank = 'Variety'));");
-    up4.exec();
-
-    QSqlQuery up5(dbhier);
-    up5.prepare("UPDATE taxa SET dwc_specificEpithet = (SELECT taxonomic_units.unit_name2 FROM taxonomic_units WHERE "
-                "taxonomic_units.tsn = taxa.dcterms_identifier AND (taxa.dwc_taxonRank = 'Species' OR "
-                "taxa.dwc_taxonRank = 'Subspecies' OR taxa.dwc_taxonRank = 'Variety'));");
-    up5.exec();
-
-    QSqlQuery up6(dbhier);
-    up6.prepare("UPDATE taxa SET dwc_infraspecificEpithet = (SELECT taxonomic_units.unit_name3 FROM taxonomic_units WHERE "
-                "taxonomic_units.tsn = taxa.dcterms_identifier AND (taxa.dwc_taxonRank = 'Subspecies' OR "
-                "taxa.dwc_taxonRank = 'Variety'));");
-    up6.exec();
-
-    QSqlQuery up7(dbhier);
-    up7.prepare("UPDATE taxa SET dwc_infraspecificEpithet = (SELECT taxonomic_units.unit_name3 FROM taxonomic_units WHERE "
-                "taxonomic_units.tsn = taxa.dcterms_identifier AND taxonomic_units.unit_ind3 IS NULL AND "
-                "(taxa.dwc_taxonRank = 'Subspecies' OR taxa.dwc_taxonRank = 'Variety'));");
-    up7.exec();
-
-    if (!dbhier.commit())
-    {
-        qDebug() << __LINE__ << "Problem with database transaction.";
-        dbhier.rollback();
-    }
-    dbhier.transaction();
-
-    QSqlQuery up8(dbhier);
-    up8.prepare("UPDATE taxa SET dwc_taxonRank = '' WHERE dwc_taxonRank IS NULL;");
-    up8.exec();
-
-    QSqlQuery up9(dbhier);
-    up9.prepare("UPDATE taxa SET dwc_scientificNameAuthorship = '' WHERE dwc_scientificNameAuthorship IS NULL;");
-    up9.exec();
-
-    QSqlQuery up10(dbhier);
-    up10.prepare("UPDATE taxa SET dwc_vernacularName = '' WHERE dwc_vernacularName IS NULL;");
-    up10.exec();
-
-    QSqlQuery up11(dbhier);
-    up11.prepare("UPDATE taxa SET dwc_genus = '' WHERE dwc_genus IS NULL;");
-    up11.exec();
-
-    QSqlQuery up12(dbhier);
-    up12.prepare("UPDATE taxa SET dwc_specificEpithet = '' WHERE dwc_specificEpithet IS NULL;");
-    up12.exec();
-
-    QSqlQuery up13(dbhier);
-    up13.prepare("UPDATE taxa SET dwc_infraspecificEpithet = '' WHERE dwc_infraspecificEpithet IS NULL;");
-    up13.exec();
-
-    if (!dbhier.commit())
-    {
-        qDebug() << __LINE__ << "Problem with database transaction.";
-        dbhier.rollback();
-    }
-
-    QSqlQuery del1(dbhier);
-    del1.prepare("delete from taxa where dwc_taxonRank = "
-                 "'Subkingdom' OR 'Phylum' OR 'Subphylum' OR 'Superclass' OR "
-                 "'Subclass' OR 'Infraclass' OR 'Superorder' OR 'Suborder' OR "
-                 "'Infraorder' OR 'Superfamily' OR 'Subfamily' OR 'Tribe' OR "
-                 "'Subtribe' OR 'Subgenus' OR 'Infrakingdom' OR 'Parvphylum' OR "
-                 "'Variety' OR 'Superdivision' OR 'Division' OR 'Subdivision' OR "
-                 "'Infradivision' OR 'Section' OR 'Subsection' OR 'Subvariety' OR "
-                 "'Form' OR 'Subform' OR 'Race' OR 'Stirp' OR 'Morph' OR "
-                 "'Aberration' OR 'Unspecified'");
-    del1.exec();
-
-    dbhier.transaction();
-
-    QSqlQuery hierarchyQry(dbhier);
-    hierarchyQry.prepare("SELECT TSN, hierarchy_string FROM hierarchy");
-    hierarchyQry.exec();
-    while (hierarchyQry.next())
-    {
-        Hierarchy h;
-        h.tsnID = hierarchyQry.value(0).toString();
-        h.hierarchyString = hierarchyQry.value(1).toString();
-        hierarchies.append(h);
-    }
-
-    if (!dbhier.commit())
-    {
-        qDebug() << __LINE__ << "Problem with database transaction.";
-        dbhier.rollback();
-    }
-
-    QCoreApplication::processEvents();
 
-    // add an index on taxonomic_units.rank_id to speed up queries
-
-    QHash<QString,QString> classes;
-    QHash<QString,QString> orders;
-    QHash<QString,QString> families;
-
-    dbhier.transaction();
-    QSqlQuery findClasses(dbhier);
-    findClasses.prepare("SELECT tsn,unit_name1 from taxonomic_units WHERE rank_id = '60'");
-    findClasses.exec();
-    while (findClasses.next())
-    {
-        QString id = findClasses.value(0).toString();
-        QString unitName = findClasses.value(1).toString();
-        classes.insert(id,unitName);
-    }
-    QSqlQuery findOrders(dbhier);
-    findOrders.prepare("SELECT tsn,unit_name1 from taxonomic_units WHERE rank_id = '100'");
-    findOrders.exec();
-    while (findOrders.next())
-    {
-        QString id = findOrders.value(0).toString();
-        QString unitName = findOrders.value(1).toString();
-        orders.insert(id,unitName);
-    }
-    QSqlQuery findFamilies(dbhier);
-    findFamilies.prepare("SELECT tsn,unit_name1 from taxonomic_units WHERE rank_id = '140'");
-    findFamilies.exec();
-    while (findFamilies.next())
-    {
-        QString id = findFamilies.value(0).toString();
-        QString unitName = findFamilies.value(1).toString();
-        families.insert(id,unitName);
-    }
-    if (!dbhier.commit())
-    {
-        qDebug() << __LINE__ << "Problem with database transaction.";
-        dbhier.rollback();
-    }
-
-    for (int i = 0; i < hierarchies.size(); ++i)
-    {
-        // skip over hierarchies that only contain a kingdom
-        if (!hierarchies.at(i).hierarchyString.contains("-"))
-            continue;
-        // remove the first ID since it's always kingdom
-        hierarchies[i].hierarchyString = hierarchies.at(i).hierarchyString + "-";
-        QString firstID = hierarchies.at(i).hierarchyString.split("-").first();
-        hierarchies[i].hierarchyString = hierarchies[i].hierarchyString.remove(0, firstID.length() + 1);
-        // loop over the tsnIDs in the hierarchy searching for class, order, and family
-        bool foundClass = false;
-        bool foundOrder = false;
-        bool foundFamily = false;
-        for (int hLength = hierarchies.at(i).hierarchyString.count("-"); hLength > 0; hLength--)
-        {
-            QString hstring = hierarchies.at(i).hierarchyString.split("-").first();
-            hierarchies[i].hierarchyString = hierarchies[i].hierarchyString.remove(0, hstring.length() + 1);
-
-            if (!foundClass)
-            {
-                if (classes.contains(hstring))
-                {
-                    hierarchies[i].className = classes.value(hstring);
-                    foundClass = true;
-                }
-            }
-            else if (!foundOrder)
-            {
-                if (orders.contains(hstring))
-                {
-                    hierarchies[i].orderName = orders.value(hstring);
-                    foundOrder = true;
-                }
-            }
-            else if (!foundFamily)
-            {
-                if (families.contains(hstring))
-                {
-                    hierarchies[i].familyName = families.value(hstring);
-                    foundFamily = true;
-                }
-            }
-        }
-    }
-
-    dbhier.transaction();
-
-    QCoreApplication::processEvents();
-
-    foreach (Hierarchy h, hierarchies) {
-        QSqlQuery updateQry(dbhier);
-        updateQry.prepare("UPDATE taxa SET dwc_class = (?), dwc_order = (?), dwc_family = (?) WHERE dcterms_identifier = (?)");
-        updateQry.addBindValue(h.className);
-        updateQry.addBindValue(h.orderName);
-        updateQry.addBindValue(h.familyName);
-        updateQry.addBindValue(h.tsnID);
-        updateQry.exec();
-    }
+    ui->convertITISButton->setEnabled(false);
+
+    itisProgress = new QProgressDialog("Please wait while the ITIS database is being converted.", "Cancel", 0, 100, this);
+    itisProgress->setAttribute(Qt::WA_DeleteOnClose);
+    itisProgress->setWindowModality(Qt::WindowModal);
+    itisProgress->setAutoClose(false);
+    itisProgress->setAutoReset(false);
+    itisProgress->setMinimumDuration(0);
+    itisProgress->setValue(0);
+
+    itisConverter = new ITISConverter(dbpath, this);
+    connect(itisConverter, SIGNAL(progressChanged(int,QString)), this, SLOT(itisProgressChanged(int,QString)));
+    connect(itisConverter, SIGNAL(finished(bool,QString)), this, SLOT(itisConversionFinished(bool,QString)));
+    connect(itisProgress, SIGNAL(canceled()), itisConverter, SLOT(cancel()));
+    itisConverter->start();
+}
 
-    if (!dbhier.commit())
-    {
-        qDebug() << __LINE__ << "Problem with database transaction.";
-        dbhier.rollback();
-    }
+void AdvancedOptions::itisProgressChanged(int percent, const QString &label)
+{
+    if (!itisProgress)
+        return;
+    if (!label.isEmpty())
+        itisProgress->setLabelText(label);
+    itisProgress->setValue(percent);
+}
 
-    dbhier.close();
-    dbhier.open();
-    QSqlQuery query(dbhier);
-    query.exec("VACUUM");
-    dbhier.close();
+void AdvancedOptions::itisConversionFinished(bool completed, const QString &message)
+{
+    if (itisProgress)
+        itisProgress->close();
+    itisConverter->deleteLater();
+    itisConverter = 0;
+    ui->convertITISButton->setEnabled(true);
 
-    importingMsg->close();
-    importingMsg->deleteLater();
     QMessageBox mbox;
-    mbox.setText("Hierarchy extraction complete.");
+    if (!completed)
+        mbox.setIcon(QMessageBox::Warning);
+    mbox.setText(message);
     mbox.exec();
 }
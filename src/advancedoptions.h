@@ -25,6 +25,7 @@
 
 #include <QWidget>
 #include <QProgressDialog>
+#include <QPointer>
 
 #include "agent.h"
 #include "determination.h"
@@ -32,6 +33,8 @@
 #include "organism.h"
 #include "sensu.h"
 
+class ITISConverter;
+
 namespace Ui {
 class AdvancedOptions;
 }
@@ -57,6 +60,8 @@ private slots:
     void on_resetButton_clicked();
 
     void on_convertITISButton_clicked();
+    void itisProgressChanged(int percent, const QString &label);
+    void itisConversionFinished(bool completed, const QString &message);
 
 private:
     Ui::AdvancedOptions *ui;
@@ -75,6 +80,8 @@ private:
     QString photoFolder;
     QStringList imagesToResize;
     void convertITIS(const QString dbpath);
+    ITISConverter *itisConverter;
+    QPointer<QProgressDialog> itisProgress;
 };
 
 #endif // ADVANCEDOPTIONS_H
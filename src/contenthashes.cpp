@@ -0,0 +1,259 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QCryptographicHash>
+#include <QDirIterator>
+#include <QtConcurrent>
+
+#include "contenthashes.h"
+#include "databaseconnections.h"
+
+void ContentHashes::prepareTable()
+{
+    QSqlDatabase db = QSqlDatabase::database();
+    db.transaction();
+
+    QStringList statements;
+    statements << "CREATE TABLE IF NOT EXISTS image_content (dcterms_identifier TEXT PRIMARY KEY, "
+                  "contentHash TEXT, fileSize INTEGER)";
+    statements << "CREATE INDEX IF NOT EXISTS image_content_hash ON image_content (contentHash)";
+    statements << "CREATE TRIGGER IF NOT EXISTS images_content_update AFTER UPDATE OF dcterms_identifier ON images BEGIN "
+                  "UPDATE image_content SET dcterms_identifier = NEW.dcterms_identifier "
+                  "WHERE dcterms_identifier = OLD.dcterms_identifier; END";
+
+    // merges and resets delete every image and insert it again, so digests aren't dropped with
+    // the row; ones whose image is really gone are ignored by lookups and pruned here
+    statements << "DROP TRIGGER IF EXISTS images_content_delete";
+    statements << "DELETE FROM image_content WHERE NOT EXISTS "
+                  "(SELECT 1 FROM images i WHERE i.dcterms_identifier = image_content.dcterms_identifier)";
+
+    for (auto statement : statements)
+    {
+        QSqlQuery qry;
+        if (!qry.exec(statement))
+            qDebug() << "Problem preparing image_content: " + qry.lastError().text();
+    }
+
+    if (!db.commit())
+    {
+        qDebug() << __LINE__ << "Problem with database transaction";
+        db.rollback();
+    }
+}
+
+QString ContentHashes::hashFile(const QString &path)
+{
+    // MD5 of the whole file, read through a memory mapping when the platform allows it;
+    // an empty string if the file can't be read
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return "";
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    qint64 size = file.size();
+    uchar *bytes = size > 0 ? file.map(0, size) : 0;
+    if (bytes != 0)
+    {
+        // addData takes an int length, so feed large files in slices
+        const qint64 slice = 1 << 30;
+        for (qint64 offset = 0; offset < size; offset += slice)
+            hash.addData(reinterpret_cast<const char*>(bytes + offset), int(qMin(slice, size - offset)));
+        file.unmap(bytes);
+    }
+    else if (!hash.addData(&file))
+        return "";
+
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+QPair<QString, QString> ContentHashes::hashPair(const QString &path)
+{
+    return qMakePair(path, hashFile(path));
+}
+
+QHash<QString, QString> ContentHashes::hashFiles(const QStringList &paths)
+{
+    // path -> digest, one file per pool thread; unreadable files are left out
+    QList<QPair<QString, QString>> pairs =
+            QtConcurrent::blockingMapped<QList<QPair<QString, QString>>>(paths, &ContentHashes::hashPair);
+    QHash<QString, QString> hashes;
+    for (auto pair : pairs)
+    {
+        if (!pair.second.isEmpty())
+            hashes.insert(pair.first, pair.second);
+    }
+    return hashes;
+}
+
+void ContentHashes::store(const QString &identifier, const QString &path, const QString &hash)
+{
+    QSqlQuery qry;
+    qry.prepare("INSERT OR REPLACE INTO image_content (dcterms_identifier, contentHash, fileSize) VALUES (?, ?, ?)");
+    qry.addBindValue(identifier);
+    qry.addBindValue(hash);
+    qry.addBindValue(QFileInfo(path).size());
+    if (!qry.exec())
+        qDebug() << __LINE__ << "Problem storing content hash: " + qry.lastError().text();
+}
+
+QHash<QString, QString> ContentHashes::catalogued(const QStringList &hashes)
+{
+    // digest -> identifier of an image already stored with that content
+    QHash<QString, QString> found;
+    if (hashes.isEmpty())
+        return found;
+
+    QSqlDatabase db = QSqlDatabase::database();
+    db.transaction();
+
+    QSqlQuery qry;
+    qry.exec("CREATE TEMP TABLE IF NOT EXISTS selected_hashes (contentHash TEXT PRIMARY KEY)");
+    qry.exec("DELETE FROM selected_hashes");
+
+    QSqlQuery insertQry;
+    insertQry.prepare("INSERT OR IGNORE INTO selected_hashes (contentHash) VALUES (?)");
+    QVariantList values;
+    for (auto h : hashes)
+        values << h;
+    insertQry.addBindValue(values);
+    if (!insertQry.execBatch())
+        qDebug() << "Problem storing the selected content hashes: " + insertQry.lastError().text();
+
+    QSqlQuery joinQry;
+    joinQry.exec("SELECT s.contentHash, c.dcterms_identifier FROM selected_hashes s "
+                 "JOIN image_content c ON c.contentHash = s.contentHash "
+                 "JOIN images i ON i.dcterms_identifier = c.dcterms_identifier");
+    while (joinQry.next())
+        found.insert(joinQry.value(0).toString(), joinQry.value(1).toString());
+
+    qry.exec("DELETE FROM selected_hashes");
+    if (!db.commit())
+    {
+        qDebug() << __LINE__ << "Problem with database transaction";
+        db.rollback();
+    }
+    return found;
+}
+
+QHash<QString, QString> ContentHashes::relocate(const QString &root, const QStringList &identifiers)
+{
+    // identifier -> path of a file under root with the image's stored content. Only files
+    // whose size matches one of the missing images are hashed. Walking the tree takes a
+    // while, so this runs off the GUI thread and reads on that thread's connection.
+    QHash<QString, QString> identifierForHash;
+    QSet<qint64> sizes;
+    QSqlDatabase db = DatabaseConnections::connection();
+    if (!db.isOpen())
+    {
+        qDebug() << __LINE__ << "Could not open the database to find moved images";
+        return identifierForHash;
+    }
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+    qry.prepare("SELECT contentHash, fileSize FROM image_content WHERE dcterms_identifier = (?)");
+    for (auto identifier : identifiers)
+    {
+        qry.addBindValue(identifier);
+        qry.exec();
+        if (qry.next())
+        {
+            identifierForHash.insert(qry.value(0).toString(), identifier);
+            sizes.insert(qry.value(1).toLongLong());
+        }
+    }
+
+    QHash<QString, QString> found;
+    if (identifierForHash.isEmpty())
+        return found;
+
+    QStringList candidates;
+    QStringList filters;
+    filters << "*.jpg" << "*.jpeg";
+    QDirIterator it(root, filters, QDir::Files | QDir::Readable, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        it.next();
+        if (sizes.contains(it.fileInfo().size()))
+            candidates.append(it.filePath());
+    }
+
+    QHashIterator<QString, QString> hashIt(hashFiles(candidates));
+    while (hashIt.hasNext())
+    {
+        hashIt.next();
+        QString identifier = identifierForHash.value(hashIt.value());
+        if (!identifier.isEmpty() && !found.contains(identifier))
+            found.insert(identifier, hashIt.key());
+    }
+    return found;
+}
+
+void ContentHashes::backfill(const QHash<QString, QString> &paths)
+{
+    // hashes the files (identifier -> path) of images that have no digest yet; runs off the
+    // GUI thread, reading on that thread's connection and storing through the queued writer
+    QSqlDatabase db = DatabaseConnections::connection();
+    if (!db.isOpen())
+    {
+        qDebug() << __LINE__ << "Could not open the database to store content hashes";
+        return;
+    }
+
+    QSet<QString> hashed;
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+    qry.exec("SELECT dcterms_identifier FROM image_content");
+    while (qry.next())
+        hashed.insert(qry.value(0).toString());
+
+    QHash<QString, QString> identifierForPath;
+    QHashIterator<QString, QString> it(paths);
+    while (it.hasNext())
+    {
+        it.next();
+        if (!hashed.contains(it.key()))
+            identifierForPath.insert(it.value(), it.key());
+    }
+
+    QHash<QString, QString> hashes = hashFiles(identifierForPath.keys());
+    if (hashes.isEmpty())
+        return;
+
+    QVariantList identifiers;
+    QVariantList digests;
+    QVariantList sizes;
+    QHashIterator<QString, QString> hashIt(hashes);
+    while (hashIt.hasNext())
+    {
+        hashIt.next();
+        identifiers << identifierForPath.value(hashIt.key());
+        digests << hashIt.value();
+        sizes << QFileInfo(hashIt.key()).size();
+    }
+
+    QList<QVariantList> columns;
+    columns << identifiers << digests << sizes;
+    DatabaseConnections::write("INSERT OR REPLACE INTO image_content (dcterms_identifier, contentHash, fileSize) VALUES (?, ?, ?)", columns);
+}
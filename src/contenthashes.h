@@ -0,0 +1,50 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CONTENTHASHES_H
+#define CONTENTHASHES_H
+
+#include <QtCore>
+
+// Content digests of image files, kept in the image_content side table with
+// each file's size and an index on the digest. They let ingest recognise a
+// file that is already catalogued under another name, and let Edit Existing
+// find images that were moved or renamed on disk. Files are hashed in
+// parallel from a memory mapping.
+class ContentHashes
+{
+public:
+    static void prepareTable();
+
+    static QString hashFile(const QString &path);
+    static QHash<QString, QString> hashFiles(const QStringList &paths);
+    static void store(const QString &identifier, const QString &path, const QString &hash);
+
+    static QHash<QString, QString> catalogued(const QStringList &hashes);
+    static QHash<QString, QString> relocate(const QString &root, const QStringList &identifiers);
+    static void backfill(const QHash<QString, QString> &paths);
+
+private:
+    static QPair<QString, QString> hashPair(const QString &path);
+};
+
+#endif // CONTENTHASHES_H
@@ -0,0 +1,318 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <QCoreApplication>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QtConcurrent>
+
+#include "databaseconnections.h"
+
+namespace {
+
+QString databasePath;
+
+// more distinct statements than this on one thread are prepared each time,
+// which keeps SQL built around changing values from filling the cache
+const int maxCachedStatements = 256;
+
+// the query is on the heap so that one still in use when the cache is dropped
+// can be handed over to its user, and deleted by release()
+struct CachedStatement
+{
+    explicit CachedStatement(const QSqlDatabase &db) : query(new QSqlQuery(db)), inUse(false) {}
+    ~CachedStatement() { if (!inUse) delete query; }
+    QSqlQuery *query;
+    bool inUse;
+};
+
+// a thread's connection and the statements prepared on it; a worker thread's
+// connection is removed when the thread finishes
+struct ThreadConnection
+{
+    ThreadConnection(const QString &name, bool owned) : name(name), owned(owned) {}
+    ~ThreadConnection()
+    {
+        qDeleteAll(statements);
+        statements.clear();
+        if (owned)
+            QSqlDatabase::removeDatabase(name);
+    }
+
+    QString name;
+    bool owned;
+    QHash<QString, CachedStatement *> statements;
+};
+
+QThreadStorage<ThreadConnection *> threadConnections;
+
+ThreadConnection *threadConnection()
+{
+    if (!threadConnections.hasLocalData())
+    {
+        if (QThread::currentThread() == QCoreApplication::instance()->thread())
+            threadConnections.setLocalData(new ThreadConnection(QSqlDatabase::defaultConnection, false));
+        else
+        {
+            const QString name = "thread_" + QString::number(quintptr(QThread::currentThreadId()), 16);
+            threadConnections.setLocalData(new ThreadConnection(name, true));
+
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", name);
+            db.setDatabaseName(databasePath);
+            // background work can wait out a long transaction on the GUI thread
+            db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=30000");
+            if (!db.open())
+                qDebug() << __LINE__ << "Could not open a database connection for a worker thread:" << db.lastError().text();
+            else
+            {
+                QSqlQuery qry(db);
+                qry.exec("PRAGMA synchronous = NORMAL");
+            }
+        }
+    }
+    return threadConnections.localData();
+}
+
+// cache hits and misses, and the number of runs and time spent per SQL text, across all threads
+struct StatementTiming
+{
+    StatementTiming() : runs(0), nanoseconds(0) {}
+    quint64 runs;
+    qint64 nanoseconds;
+};
+
+struct StatementStatistics
+{
+    StatementStatistics() : hits(0), misses(0) {}
+    QMutex mutex;
+    quint64 hits;
+    quint64 misses;
+    QHash<QString, StatementTiming> timings;
+};
+
+StatementStatistics &statementStatistics()
+{
+    static StatementStatistics stats;
+    return stats;
+}
+
+// one thread that never expires, so queued writes run in order on one connection
+struct WriterPool : public QThreadPool
+{
+    WriterPool() { setMaxThreadCount(1); setExpiryTimeout(-1); }
+};
+
+WriterPool &writerPool()
+{
+    static WriterPool pool;
+    return pool;
+}
+
+}
+
+bool DatabaseConnections::open(const QString &path)
+{
+    databasePath = path;
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE");
+    db.setDatabaseName(path);
+    if (!db.open())
+        return false;
+
+    // WAL is stored in the database file, so this only changes anything the first time
+    QSqlQuery qry;
+    qry.exec("PRAGMA journal_mode = WAL");
+    if (!qry.next() || qry.value(0).toString().toLower() != "wal")
+        qDebug() << __LINE__ << "Could not switch the database to WAL mode:" << qry.lastError().text();
+
+    // in WAL mode a commit is still safe against application crashes without syncing every time
+    qry.exec("PRAGMA synchronous = NORMAL");
+    return true;
+}
+
+QSqlDatabase DatabaseConnections::connection()
+{
+    return QSqlDatabase::database(threadConnection()->name);
+}
+
+QFuture<bool> DatabaseConnections::write(const QString &sql, const QList<QVariantList> &columns)
+{
+    // columns holds one list of values per placeholder in sql, bound with execBatch()
+    return QtConcurrent::run(&writerPool(), &DatabaseConnections::runWrite, sql, columns);
+}
+
+bool DatabaseConnections::runWrite(const QString &sql, const QList<QVariantList> &columns)
+{
+    QSqlDatabase db = connection();
+    if (!db.isOpen())
+        return false;
+
+    db.transaction();
+    QSqlQuery qry(db);
+    qry.prepare(sql);
+    for (const QVariantList &column : columns)
+        qry.addBindValue(column);
+
+    if (!qry.execBatch())
+    {
+        qDebug() << __LINE__ << "Problem with queued write:" << qry.lastError().text();
+        db.rollback();
+        return false;
+    }
+    if (!db.commit())
+    {
+        qDebug() << __LINE__ << "Problem with database transaction";
+        db.rollback();
+        return false;
+    }
+    return true;
+}
+
+void DatabaseConnections::close()
+{
+    // let queued writes land; this also ends the writer thread, which removes its connection
+    writerPool().waitForDone();
+
+    bool report = false;
+    {
+        QSqlQuery qry;
+        qry.prepare("SELECT value FROM settings WHERE setting = (?)");
+        qry.addBindValue("debug.statementstatistics");
+        qry.exec();
+        if (qry.next())
+            report = qry.value(0).toBool();
+    }
+
+    // the GUI thread's statements have to go before its connection does
+    if (threadConnections.hasLocalData())
+        threadConnections.setLocalData(0);
+
+    if (report)
+    {
+        for (const QString &line : statistics())
+            qDebug() << line;
+    }
+}
+
+bool DatabaseConnections::reopen()
+{
+    // closing finalizes every statement on the connection, so this thread's
+    // cached ones have to be prepared again afterwards
+    ThreadConnection *thread = threadConnection();
+    qDeleteAll(thread->statements);
+    thread->statements.clear();
+
+    QSqlDatabase db = QSqlDatabase::database(thread->name, false);
+    db.close();
+    if (!db.open())
+    {
+        qDebug() << __LINE__ << "Could not reopen the database:" << db.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+QSqlQuery *DatabaseConnections::statement(const QString &sql)
+{
+    // returns the thread's prepared statement for sql, or a new one when it's
+    // already in use further up the stack; either way it goes back through release()
+    ThreadConnection *thread = threadConnection();
+    CachedStatement *cached = thread->statements.value(sql);
+    StatementStatistics &stats = statementStatistics();
+
+    if (cached && !cached->inUse)
+    {
+        cached->inUse = true;
+        QMutexLocker locker(&stats.mutex);
+        stats.hits++;
+        return cached->query;
+    }
+
+    {
+        QMutexLocker locker(&stats.mutex);
+        stats.misses++;
+    }
+
+    QSqlDatabase db = QSqlDatabase::database(thread->name);
+    if (!cached && thread->statements.size() < maxCachedStatements)
+    {
+        cached = new CachedStatement(db);
+        cached->query->setForwardOnly(true);
+        if (cached->query->prepare(sql))
+        {
+            cached->inUse = true;
+            thread->statements.insert(sql, cached);
+            return cached->query;
+        }
+        delete cached;
+    }
+
+    QSqlQuery *query = new QSqlQuery(db);
+    query->setForwardOnly(true);
+    query->prepare(sql);
+    return query;
+}
+
+void DatabaseConnections::release(const QString &sql, QSqlQuery *query, qint64 nanoseconds)
+{
+    CachedStatement *cached = threadConnection()->statements.value(sql);
+    if (cached && cached->query == query)
+    {
+        // resets the statement, so it holds no read lock while it waits to be used again
+        query->finish();
+        cached->inUse = false;
+    }
+    else
+        delete query;
+
+    StatementStatistics &stats = statementStatistics();
+    QMutexLocker locker(&stats.mutex);
+    StatementTiming &timing = stats.timings[sql];
+    timing.runs++;
+    timing.nanoseconds += nanoseconds;
+}
+
+QStringList DatabaseConnections::statistics()
+{
+    // the statements that took the most time in total, slowest first
+    StatementStatistics &stats = statementStatistics();
+    QMutexLocker locker(&stats.mutex);
+
+    QList<QPair<qint64, QString>> slowest;
+    QHashIterator<QString, StatementTiming> it(stats.timings);
+    while (it.hasNext())
+    {
+        it.next();
+        slowest.append(qMakePair(it.value().nanoseconds, it.key()));
+    }
+    std::sort(slowest.begin(), slowest.end());
+    std::reverse(slowest.begin(), slowest.end());
+
+    QStringList lines;
+    lines << "Prepared statements: " + QString::number(stats.hits) + " cache hits, " + QString::number(stats.misses) + " misses";
+    for (int i = 0; i < slowest.size() && i < 20; i++)
+    {
+        const StatementTiming &timing = stats.timings[slowest.at(i).second];
+        lines << QString::number(slowest.at(i).first / 1e6, 'f', 1) + " ms in " + QString::number(timing.runs) + " runs: " +
+                 slowest.at(i).second.simplified().left(120);
+    }
+    return lines;
+}
@@ -0,0 +1,60 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DATABASECONNECTIONS_H
+#define DATABASECONNECTIONS_H
+
+#include <QtCore>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+// The database is kept in WAL mode so other threads can read while the GUI
+// thread writes. Qt only lets a connection be used by the thread that opened
+// it, so each worker thread gets its own connection to the same file from
+// connection(); the GUI thread keeps the default connection. Writes from
+// worker threads are queued with write() and run one at a time, in order, in
+// a transaction on a single writer thread, so they wait behind each other
+// instead of failing with SQLITE_BUSY.
+//
+// Each thread also keeps the statements it prepares through statement(),
+// keyed by their SQL, so running the same SQL again skips SQLite's parse and
+// plan. PreparedQuery is the usual way to use them. Closing a connection
+// finalizes its statements, so the GUI thread's connection is closed and
+// opened again with reopen(), which drops them first.
+class DatabaseConnections
+{
+public:
+    static bool open(const QString &path);
+    static QSqlDatabase connection();
+    static QFuture<bool> write(const QString &sql, const QList<QVariantList> &columns);
+    static bool reopen();
+    static void close();
+
+    static QSqlQuery *statement(const QString &sql);
+    static void release(const QString &sql, QSqlQuery *query, qint64 nanoseconds);
+    static QStringList statistics();
+
+private:
+    static bool runWrite(const QString &sql, const QList<QVariantList> &columns);
+};
+
+#endif // DATABASECONNECTIONS_H
@@ -47,12 +47,16 @@
 #include "newsensudialog.h"
 #include "startwindow.h"
 #include "tableeditor.h"
+#include "contenthashes.h"
+#include "imageview.h"
+#include "preparedquery.h"
 
 #include <QDebug>
 
 DataEntry::DataEntry(const QStringList &fileNames, const QHash<QString,QString> &incNameSpaceHash,
                      const QHash<QString,QString> &photogHash, const QHash<QString,int> &trailingHash,
-                     const QHash<QString,QString> &incAgentHash, QWidget *parent) :
+                     const QHash<QString,QString> &incAgentHash, const QHash<QString,QString> &contentHashes,
+                     QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::DataEntry)
 {
@@ -67,6 +71,7 @@ DataEntry::DataEntry(const QStringList &fileNames, const QHash<QString,QString>
     nameSpaceHash = incNameSpaceHash;
     photographerHash = photogHash;
     trailingCharsHash = trailingHash;
+    contentHashHash = contentHashes;
 
     setupDataEntry();
 
@@ -91,7 +96,11 @@ DataEntry::DataEntry(const QStringList &fileNames, const QHash<QString,QString>
 
     loadUSDANames();
     setupCompleters();
-    runExifTool();  // when finished, generateThumbnails() will be run
+    // when finished, generateThumbnails() will be run
+    if (imageFileNames.isEmpty())
+        generateThumbnails();
+    else
+        runExifTool();
 }
 
 DataEntry::DataEntry(const QStringList &fileNames, const QHash<QString, QString> &photogHash,
@@ -114,11 +123,19 @@ DataEntry::DataEntry(const QStringList &fileNames, const QHash<QString, QString>
     imageFileNames = fileNames;
     imageFileNamesSize = imageFileNames.size();
 
+    // files found by content hash may have been renamed on disk, so key them by the catalogued fileName
+    QHash<QString,QString> fileNameForPath;
+    for (const Image &image : ims)
+    {
+        if (!image.fileAndPath.isEmpty())
+            fileNameForPath.insert(image.fileAndPath, image.fileName);
+    }
+
     for (int i = 0; i < imageFileNamesSize; ++i)
     {
         QString file = imageFileNames.at(i);
         QFileInfo fileInfo(file);
-        QString base = fileInfo.fileName();
+        QString base = fileNameForPath.value(file, fileInfo.fileName());
         imageHash.insert(base,file);
     }
 
@@ -146,6 +163,8 @@ DataEntry::~DataEntry()
 
 void DataEntry::setupDataEntry()
 {
+    connect(&iconifyWatcher, SIGNAL(finished()), this, SLOT(thumbnailsFinished()));
+
 #ifdef Q_OS_MAC
     this->setStyleSheet("QLabel{font-size: 12px; margin-left: 0px; margin-right: 0px} QLineEdit{font-size: 12px} "
                         "QCheckBox{font-size: 11px} QComboBox{font-size: 12px} QPushButton{font-size:12px}");
@@ -186,12 +205,18 @@ void DataEntry::setupDataEntry()
     lineEditNames = findChildren<QLineEdit *>();
 
     scaleFactor = 1;
-    imageLabel = new QLabel(this);
+    imageLabel = new TiledImageLabel(this);
     imageLabel->setScaledContents(true);
     pauseRefreshing = false;
 
     ui->scrollArea->setWidget(imageLabel);
 
+    previewLoader = new PreviewLoader(this);
+    connect(previewLoader, SIGNAL(previewReady(QString,QImage)), this, SLOT(displayPreview(QString,QImage)));
+
+    geocodeScheduler = new GeocodeScheduler(this);
+    connect(geocodeScheduler, SIGNAL(batchFinished(QList<GeocodeResponse>)), this, SLOT(reverseGeocodeFinished(QList<GeocodeResponse>)));
+
     loadSensu();
 
     ui->thumbWidget->setViewMode(QListWidget::IconMode);
@@ -217,6 +242,7 @@ void DataEntry::setupDataEntry()
     filterList << "Thumbnails with \"unspecified\" specimen view";
     filterList << "Thumbnails with nominal source of name";
     filterList << "Only show cameos (1 image per organism)";
+    filterList << "Possible near-duplicates";
     ui->thumbnailFilter->addItems(filterList);
     ui->thumbnailFilter->view()->setMinimumWidth(ui->thumbnailFilter->minimumSizeHint().width());
 
@@ -238,8 +264,7 @@ void DataEntry::setupDataEntry()
     ui->establishmentMeans->setCurrentText("");
 
     pauseSavingView = true;
-    specimenGroups << "unspecified" << "woody angiosperms" << "herbaceous angiosperms" << "gymnosperms" << "ferns" << "cacti" << "mosses";
-    ui->groupOfSpecimenBox->addItems(specimenGroups);
+    ui->groupOfSpecimenBox->addItems(ImageView::groups());
     ui->groupOfSpecimenBox->setCurrentText("unspecified");
     QStringList specimenParts;
     specimenParts << "unspecified" << "whole organism";
@@ -255,7 +280,8 @@ void DataEntry::setupDataEntry()
     }
     refreshAgentDropdowns();
 
-    loadImageIDs();
+    idAllocator.load();
+    imageHashes.load();
 
     QStringList imageGeorefRemarksList;
     imageGeorefRemarksList.append("Location determined from camera GPS.");
@@ -380,13 +406,6 @@ void DataEntry::setupDataEntry()
     if (qry.next())
         schemeNumber = qry.value(0).toString();
 
-    lastOrgNum = 10000;
-    qry.prepare("SELECT value FROM settings WHERE setting = (?)");
-    qry.addBindValue("last.organismnumber");
-    qry.exec();
-    if (qry.next())
-        lastOrgNum = qry.value(0).toInt();
-
     qry.prepare("SELECT value FROM settings WHERE setting = (?)");
     qry.addBindValue("last.agent");
     qry.exec();
@@ -479,268 +498,216 @@ void DataEntry::exifToolFinished()
         QSqlDatabase db = QSqlDatabase::database();
         db.transaction();
 
-        int imagesIndex = 0;
-        for(QString &row : rowsExifOutput)
+        storeExifRows(rowsExifOutput);
+
+        idAllocator.save();
+
+        if (!db.commit())
+        {
+            qDebug() << "In on_exifTool_finish(): Problem committing changes to database. Data may be lost.";
+            db.rollback();
+            idAllocator.load();
+        }
+
+        qDebug() << "Exiftool finished. Now generating thumbnails.";
+        generateThumbnails();
+
+        // the watched folder's batches are added after the selected images
+        if (hotFolder)
+            hotFolder->start(imageFileNames);
+    }
+}
+
+void DataEntry::storeExifRows(const QStringList &rowsExifOutput)
+{
+    // appends an image for each row of ExifTool output; the caller holds the transaction
+    int imagesIndex = images.size();
+    for (const QString &row : rowsExifOutput)
+    {
+        QStringList columns = row.split("\t");
+        if (columns.size() == 12)
         {
-            QStringList columns = row.split("\t");
-            if (columns.size() == 12)
+            if(columns.at(0).isNull() || columns.at(0).isEmpty())
+            {
+                qDebug() << "Found a NULL or empty filename column";
+                continue;
+            }
+
+            // Convert empty EXIF columns from "-" to ""
+            for (int i=0; i<columns.size(); i++)
+            {
+                if (columns[i] == "-")
+                    columns[i] = "";
+            }
+
+            Image newImage;
+            newImage.fileName = columns.at(0);
+            imageIndexHash.insert(columns.at(0),imagesIndex);
+            // check if exiftool can output full path
+            newImage.fileAndPath = imageHash.value(newImage.fileName); // fix this later
+            QStringList dateTimeSplit;
+
+            // EXIF date/time storage varies, so find one that's used
+            // column 1 holds -datetimeoriginal
+            // column 8 holds -createdate
+            // column 9 holds -modifydate
+            // column 10 holds -filemodifydate
+            QList<int> itColumns;
+            itColumns << 1 << 8 << 9 << 10;
+            //for (int i : {1,8,9,10})
+            for (int i : itColumns)
             {
-                if(columns.at(0).isNull() || columns.at(0).isEmpty())
+                if (!columns.at(i).isEmpty() && columns.at(i).contains(" "))
                 {
-                    qDebug() << "Found a NULL or empty filename column";
-                    continue;
+                    dateTimeSplit = columns.at(i).split(" ");
+                    break;
                 }
+            }
+            QString dts = dateTimeSplit.at(1);
+            dts.remove("\r");
 
-                // Convert empty EXIF columns from "-" to ""
-                for (int i=0; i<columns.size(); i++)
+            if(dateTimeSplit.size() == 2)
+            {
+                QString date = dateTimeSplit.at(0);
+                date = date.replace(":","-");
+                QString time = dateTimeSplit.at(1);
+                time.remove("\r");
+                time = time.replace(".",":");
+                // save time zone if present: hh:mm:ss-hh:mm or hh:mm:ss
+                QString timeNoTZ = time;
+                QString tz = "";
+                if (time.contains("-"))
                 {
-                    if (columns[i] == "-")
-                        columns[i] = "";
+                    timeNoTZ = time.split("-").at(0);
+                    tz = "-" + time.split("-").at(1);
                 }
-
-                Image newImage;
-                newImage.fileName = columns.at(0);
-                imageIndexHash.insert(columns.at(0),imagesIndex);
-                // check if exiftool can output full path
-                newImage.fileAndPath = imageHash.value(newImage.fileName); // fix this later
-                QStringList dateTimeSplit;
-
-                // EXIF date/time storage varies, so find one that's used
-                // column 1 holds -datetimeoriginal
-                // column 8 holds -createdate
-                // column 9 holds -modifydate
-                // column 10 holds -filemodifydate
-                QList<int> itColumns;
-                itColumns << 1 << 8 << 9 << 10;
-                //for (int i : {1,8,9,10})
-                for (int i : itColumns)
+                else if (time.contains("+"))
                 {
-                    if (!columns.at(i).isEmpty() && columns.at(i).contains(" "))
-                    {
-                        dateTimeSplit = columns.at(i).split(" ");
-                        break;
-                    }
+                    timeNoTZ = time.split("+").at(0);
+                    tz = "+" + time.split("+").at(1);
                 }
-                QString dts = dateTimeSplit.at(1);
-                dts.remove("\r");
 
-                if(dateTimeSplit.size() == 2)
-                {
-                    QString date = dateTimeSplit.at(0);
-                    date = date.replace(":","-");
-                    QString time = dateTimeSplit.at(1);
-                    time.remove("\r");
-                    time = time.replace(".",":");
-                    // save time zone if present: hh:mm:ss-hh:mm or hh:mm:ss
-                    QString timeNoTZ = time;
-                    QString tz = "";
-                    if (time.contains("-"))
-                    {
-                        timeNoTZ = time.split("-").at(0);
-                        tz = "-" + time.split("-").at(1);
-                    }
-                    else if (time.contains("+"))
-                    {
-                        timeNoTZ = time.split("+").at(0);
-                        tz = "+" + time.split("+").at(1);
-                    }
+                newImage.date = date;
+                newImage.time = timeNoTZ;
+                newImage.timezone = tz;
+                newImage.dcterms_created = date + "T" + time;
 
-                    newImage.date = date;
-                    newImage.time = timeNoTZ;
-                    newImage.timezone = tz;
-                    newImage.dcterms_created = date + "T" + time;
+            }
+            else
+            {
+                qDebug() << columns.at(0) + ": Error with dateTimeSplit";
+            }
 
-                }
-                else
-                {
-                    qDebug() << columns.at(0) + ": Error with dateTimeSplit";
-                }
+            newImage.focalLength = columns.at(2);
+            newImage.focalLength.remove(" mm");
 
-                newImage.focalLength = columns.at(2);
-                newImage.focalLength.remove(" mm");
+            QString lat = columns.at(3);
+            QString lon = columns.at(4);
+            QString ele = columns.at(5);
+            newImage.decimalLatitude = lat.replace("+","");
+            newImage.decimalLongitude = lon.replace("+","");
+            if (!ele.isEmpty())
+            {
+                newImage.altitudeInMeters = ele.replace(" m Above Sea Level","");
+                newImage.altitudeInMeters = QString::number(qRound(newImage.altitudeInMeters.toDouble()));
+            }
 
-                QString lat = columns.at(3);
-                QString lon = columns.at(4);
-                QString ele = columns.at(5);
-                newImage.decimalLatitude = lat.replace("+","");
-                newImage.decimalLongitude = lon.replace("+","");
-                if (!ele.isEmpty())
-                {
-                    newImage.altitudeInMeters = ele.replace(" m Above Sea Level","");
-                    newImage.altitudeInMeters = QString::number(qRound(newImage.altitudeInMeters.toDouble()));
-                }
+            QString rotStr = columns.at(11);
+            int rot = rotStr.toInt();
+            // if the image has a 90 or 270 degree rotation set in EXIF, fix pixel x,y values
+            if (5 <= rot && rot <= 8)
+            {
+                newImage.height = columns.at(6);
+                newImage.width = columns.at(7);
+            }
+            else
+            {
+                newImage.width = columns.at(6);
+                newImage.height = columns.at(7);
+            }
+            if (newImage.decimalLatitude != "")
+                newImage.coordinateUncertaintyInMeters = "10";
 
-                QString rotStr = columns.at(11);
-                int rot = rotStr.toInt();
-                // if the image has a 90 or 270 degree rotation set in EXIF, fix pixel x,y values
-                if (5 <= rot && rot <= 8)
-                {
-                    newImage.height = columns.at(6);
-                    newImage.width = columns.at(7);
-                }
-                else
-                {
-                    newImage.width = columns.at(6);
-                    newImage.height = columns.at(7);
-                }
-                if (newImage.decimalLatitude != "")
-                    newImage.coordinateUncertaintyInMeters = "10";
+            // create a unique image identifier
+            QString base = newImage.fileName;
+            QString nameSpace = nameSpaceHash.value(newImage.fileAndPath);
 
-                // create a unique image identifier
-                QString base = newImage.fileName;
-                QString nameSpace = nameSpaceHash.value(newImage.fileAndPath);
+            // assign a new identifier if the image doesn't have one
+            int numTrailing = 5;
+            if (trailingCharsHash.contains(newImage.fileAndPath))
+            {
+                numTrailing = trailingCharsHash.value(newImage.fileAndPath);
+            }
+            else
+            {
+                qDebug() << newImage.fileAndPath + " was not in the trailingCharsHash. Using default value of '5'";
+            }
 
-                // assign a new identifier if the image doesn't have one
-                int numTrailing = 5;
-                if (trailingCharsHash.contains(newImage.fileAndPath))
-                {
-                    numTrailing = trailingCharsHash.value(newImage.fileAndPath);
-                }
-                else
-                {
-                    qDebug() << newImage.fileAndPath + " was not in the trailingCharsHash. Using default value of '5'";
-                }
+            QString newIdentifier = base.split(".").at(0).right(numTrailing);
+            newIdentifier = newIdentifier.remove(QRegExp("[^a-zA-Z\\d_-]"));
+            while (newIdentifier.startsWith("_") || newIdentifier.startsWith("-"))
+            {
+                newIdentifier.remove(0,1);
+            }
+            if (newIdentifier.isEmpty())
+            {
+                // just in case the identifier only contained dashes and underscores and we removed them all
+                numTrailing = 0;
+            }
+            newIdentifier = IdAllocator::identifier(nameSpace, newIdentifier);
 
-                QString newIdentifier = base.split(".").at(0).right(numTrailing);
-                newIdentifier = newIdentifier.remove(QRegExp("[^a-zA-Z\\d_-]"));
-                while (newIdentifier.startsWith("_") || newIdentifier.startsWith("-"))
-                {
-                    newIdentifier.remove(0,1);
-                }
-                if (newIdentifier.isEmpty())
-                {
-                    // just in case the identifier only contained dashes and underscores and we removed them all
-                    numTrailing = 0;
-                }
-                newIdentifier = "http://bioimages.vanderbilt.edu/" + nameSpace + "/" + newIdentifier;
+            // if the user set the numTrailing to 0 we do not want to attempt to use newIdentifier
+            if (numTrailing == 0 || !idAllocator.claim("images", newIdentifier))
+                newIdentifier = idAllocator.allocate("images", nameSpace, "", "last.organismnumber");
+            newImage.identifier = newIdentifier;
+            newImage.attributionLinkURL = newIdentifier + ".htm";
+            imageIDFilenameMap.insert(newImage.identifier,newImage.fileName);
+            dateFilenameMap.insertMulti(newImage.dcterms_created,newImage.fileName);
 
-                // if the user set the numTrailing to 0 we do not want to attempt to use newIdentifier
-                while (imageIDList.contains(newIdentifier) || numTrailing == 0)
-                {
-                    numTrailing = 5;
-                    lastOrgNum++;
-                    newIdentifier = "http://bioimages.vanderbilt.edu/" + nameSpace + "/" + QString::number(lastOrgNum);
-                }
-                newImage.identifier = newIdentifier;
-                newImage.attributionLinkURL = newIdentifier + ".htm";
-                imageIDList.append(newIdentifier);
-                imageIDFilenameMap.insert(newImage.identifier,newImage.fileName);
-                dateFilenameMap.insertMulti(newImage.dcterms_created,newImage.fileName);
-
-                if(photographerHash.contains(newImage.fileAndPath)) {
-                    newImage.photographerCode = photographerHash.value(newImage.fileAndPath);
-                    newImage.copyrightOwnerID = newImage.photographerCode;
-                    newImage.copyrightOwnerName = agentHash.value(newImage.photographerCode);
-                    newImage.copyrightStatement = "(c) " + newImage.copyrightYear + " " + newImage.copyrightOwnerName;
-
-                    newImage.credit = newImage.copyrightOwnerName + " http://bioimages.vanderbilt.edu/";
-                }
-                else
-                    qDebug() << "Error: photographer not found for file: " + newImage.fileAndPath;
-
-                images << newImage;
-
-                QSqlQuery query;
-                query.setForwardOnly(true);
-                query.prepare("INSERT INTO images (fileName, focalLength, dwc_georeferenceRemarks, "
-                              "dwc_decimalLatitude, dwc_decimalLongitude, geo_alt, exif_PixelXDimension, "
-                              "exif_PixelYDimension, dwc_occurrenceRemarks, dwc_geodeticDatum, "
-                              "dwc_coordinateUncertaintyInMeters, dwc_locality, dwc_countryCode, dwc_stateProvince, "
-                              "dwc_county, dwc_informationWithheld, dwc_dataGeneralizations, dwc_continent, "
-                              "geonamesAdmin, geonamesOther, dcterms_identifier, dcterms_modified, dcterms_title, "
-                              "dcterms_description, ac_caption, photographerCode, dcterms_created, photoshop_Credit, "
-                              "owner, dcterms_dateCopyrighted, dc_rights, xmpRights_Owner, ac_attributionLinkURL, "
-                              "ac_hasServiceAccessPoint, usageTermsIndex, view, xmp_Rating, foaf_depicts, suppress) "
-                              "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
-                query.addBindValue(newImage.fileName);
-                query.addBindValue(newImage.focalLength);
-                query.addBindValue(newImage.georeferenceRemarks);
-                query.addBindValue(newImage.decimalLatitude);
-                query.addBindValue(newImage.decimalLongitude);
-                query.addBindValue(newImage.altitudeInMeters);
-                query.addBindValue(newImage.width);
-                query.addBindValue(newImage.height);
-                query.addBindValue(newImage.occurrenceRemarks);
-                query.addBindValue(newImage.geodeticDatum);
-
-                query.addBindValue(newImage.coordinateUncertaintyInMeters);
-                query.addBindValue(newImage.locality);
-                query.addBindValue(newImage.countryCode);
-                query.addBindValue(newImage.stateProvince);
-                query.addBindValue(newImage.county);
-                query.addBindValue(newImage.informationWithheld);
-                query.addBindValue(newImage.dataGeneralizations);
-                query.addBindValue(newImage.continent);
-                query.addBindValue(newImage.geonamesAdmin);
-                query.addBindValue(newImage.geonamesOther);
-
-                query.addBindValue(newImage.identifier);
-                query.addBindValue(newImage.lastModified);
-                query.addBindValue(newImage.title);
-                query.addBindValue(newImage.description);
-                query.addBindValue(newImage.caption);
-                query.addBindValue(newImage.photographerCode);
-                query.addBindValue(newImage.dcterms_created);
-                query.addBindValue(newImage.credit);
-                query.addBindValue(newImage.copyrightOwnerID);
-                query.addBindValue(newImage.copyrightYear);
-
-                query.addBindValue(newImage.copyrightStatement);
-                query.addBindValue(newImage.copyrightOwnerName);
-                query.addBindValue(newImage.attributionLinkURL);
-                query.addBindValue(newImage.urlToHighRes);
-                query.addBindValue(newImage.usageTermsIndex);
-                query.addBindValue(newImage.imageView);
-                query.addBindValue(newImage.rating);
-                query.addBindValue(newImage.depicts);
-                query.addBindValue(newImage.suppress);
-
-                query.exec();
-
-                imagesIndex++;
+            if(photographerHash.contains(newImage.fileAndPath)) {
+                newImage.photographerCode = photographerHash.value(newImage.fileAndPath);
+                newImage.copyrightOwnerID = newImage.photographerCode;
+                newImage.copyrightOwnerName = agentHash.value(newImage.photographerCode);
+                newImage.copyrightStatement = "(c) " + newImage.copyrightYear + " " + newImage.copyrightOwnerName;
+
+                newImage.credit = newImage.copyrightOwnerName + " http://bioimages.vanderbilt.edu/";
             }
             else
-                qDebug() << "Found a row without 10 columns: " + columns.at(0);
-        }
+                qDebug() << "Error: photographer not found for file: " + newImage.fileAndPath;
 
-        QSqlQuery qry;
-        qry.prepare("INSERT OR REPLACE INTO settings (setting, value) VALUES (?, ?)");
-        qry.addBindValue("last.organismnumber");
-        qry.addBindValue(lastOrgNum);
-        qry.exec();
+            images << newImage;
 
-        if (!db.commit())
-        {
-            qDebug() << "In on_exifTool_finish(): Problem committing changes to database. Data may be lost.";
-            db.rollback();
-        }
+            PreparedQuery query(TableSchema<Image>::insert("images"));
+            TableSchema<Image>::bind(query, newImage);
+            query.exec();
 
-        qDebug() << "Exiftool finished. Now generating thumbnails.";
-        generateThumbnails();
+            if (contentHashHash.contains(newImage.fileAndPath))
+                ContentHashes::store(newImage.identifier, newImage.fileAndPath, contentHashHash.value(newImage.fileAndPath));
+
+            imagesIndex++;
+        }
+        else
+            qDebug() << "Found a row without 10 columns: " + columns.at(0);
     }
 }
 
-void DataEntry::iconify(const QStringList &imageFileNames)
+Thumbnails DataEntry::iconify(const QList<ThumbnailSource> &sources, const QSet<QString> &hashed)
 {
-    QImageReader defaultImageReader(":/noimage.jpg");
-    int defaultWid = defaultImageReader.size().width();
-    int defaultHei = defaultImageReader.size().height();
-    defaultImageReader.setClipRect(QRect(0,(defaultHei-defaultWid)/2,defaultWid,defaultWid));
-    defaultImageReader.setScaledSize(QSize(100,100));
-    QPixmap defaultThumb;
-    defaultThumb = defaultThumb.fromImage(defaultImageReader.read());
-    QIcon defaultIcon(defaultThumb);
-    defaultIcon.addPixmap(defaultThumb);
+    // runs on a pool thread, so it only decodes QImages; thumbnailsFinished() makes the
+    // pixmaps, icons and list items on the GUI thread
+    Thumbnails thumbnails;
 
-    // load thumbnail cache
+    // load thumbnail cache; older caches held QIcons, which can't be read off the GUI
+    // thread, so anything without the magic number is rebuilt
 #if defined(Q_OS_WIN) || defined(Q_OS_MAC)
     QFile thumbFile(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/data/thumbnails.dat");
 #else
     QFile thumbFile(QApplication::applicationDirPath() + "/data/thumbnails.dat");
 #endif
-    QHash<QString,QIcon> iconCache;
+    const quint32 thumbMagic = 0x42495448;
+    QHash<QString,QImage> imageCache;
     QList<QString> imageURIList;
-    QList<QIcon> iconList;
+    QList<QImage> imageList;
     bool thumbFileModified = false;
     if (thumbFile.exists())
     {
@@ -748,20 +715,30 @@ void DataEntry::iconify(const QStringList &imageFileNames)
         QDataStream thumbStream(&thumbFile);
         thumbStream.setVersion(QDataStream::Qt_5_5);
 
-        thumbStream >> imageURIList >> iconList;
+        quint32 magic = 0;
+        thumbStream >> magic;
+        if (magic == thumbMagic)
+            thumbStream >> imageURIList >> imageList;
         thumbFile.close();
 
-        if (imageURIList.size() == iconList.size())
+        if (magic != thumbMagic)
+        {
+            qDebug() << "Rebuilding the thumbnail cache in the current format.";
+            thumbFileModified = true;
+        }
+        else if (imageURIList.size() == imageList.size())
         {
             for (int i = 0; i < imageURIList.size(); i++)
             {
-                iconCache.insert(imageURIList.at(i),iconList.at(i));
+                imageCache.insert(imageURIList.at(i),imageList.at(i));
             }
         }
         else
         {
-            QString debugMsg = "Error loading thumbnail cache. imageURIList (" + QString::number(imageURIList.size()) + ") and pmList (" + QString::number(iconList.size()) + ") have different sizes.";
+            QString debugMsg = "Error loading thumbnail cache. imageURIList (" + QString::number(imageURIList.size()) + ") and imageList (" + QString::number(imageList.size()) + ") have different sizes.";
             qDebug() << debugMsg;
+            imageURIList.clear();
+            imageList.clear();
         }
     }
     else
@@ -769,97 +746,15 @@ void DataEntry::iconify(const QStringList &imageFileNames)
         qDebug() << "No thumbnail cache exists.";
     }
 
-    QSqlDatabase db = QSqlDatabase::database();
-    if (!fromEditExisting)
-    {
-        db.transaction();
-    }
-
-    thumbWidgetItems.clear();
-    for (int i = 0; i < imageFileNamesSize; i++)
+    // the rows themselves were stored by storeExifRows() on the GUI thread; this thread only
+    // reads image files, since the default connection can't be used from here
+    for (auto source : sources)
     {
-        QString file = imageFileNames[i];
-        QString base = imageHash.key(file);
-        int imInd = -1;
-        if (imageIndexHash.contains(base))
-            imInd = imageIndexHash.value(base);
-        else
-            qDebug() << "Error in the imageIndexHash!";
-
-        // only fill out the image info if we didn't come from Edit Existing
-        if (!fromEditExisting)
-        {
-            if(imInd != -1)
-            {
-                QSqlQuery query;
-                query.setForwardOnly(true);
-                query.prepare("INSERT OR REPLACE INTO images (fileName, focalLength, dwc_georeferenceRemarks, "
-                              "dwc_decimalLatitude, dwc_decimalLongitude, geo_alt, exif_PixelXDimension, "
-                              "exif_PixelYDimension, dwc_occurrenceRemarks, dwc_geodeticDatum, "
-                              "dwc_coordinateUncertaintyInMeters, dwc_locality, dwc_countryCode, dwc_stateProvince, "
-                              "dwc_county, dwc_informationWithheld, dwc_dataGeneralizations, dwc_continent, "
-                              "geonamesAdmin, geonamesOther, dcterms_identifier, dcterms_modified, dcterms_title, "
-                              "dcterms_description, ac_caption, photographerCode, dcterms_created, photoshop_Credit, "
-                              "owner, dcterms_dateCopyrighted, dc_rights, xmpRights_Owner, ac_attributionLinkURL, "
-                              "ac_hasServiceAccessPoint, usageTermsIndex, view, xmp_Rating, foaf_depicts, suppress) "
-                              "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?) "
-                              "WHERE dcterms_identifier = (?)");
-                query.addBindValue(images[imInd].fileName);
-                query.addBindValue(images[imInd].focalLength);
-                query.addBindValue(images[imInd].georeferenceRemarks);
-                query.addBindValue(images[imInd].decimalLatitude);
-                query.addBindValue(images[imInd].decimalLongitude);
-                query.addBindValue(images[imInd].altitudeInMeters);
-                query.addBindValue(images[imInd].width);
-                query.addBindValue(images[imInd].height);
-                query.addBindValue(images[imInd].occurrenceRemarks);
-                query.addBindValue(images[imInd].geodeticDatum);
-
-                query.addBindValue(images[imInd].coordinateUncertaintyInMeters);
-                query.addBindValue(images[imInd].locality);
-                query.addBindValue(images[imInd].countryCode);
-                query.addBindValue(images[imInd].stateProvince);
-                query.addBindValue(images[imInd].county);
-                query.addBindValue(images[imInd].informationWithheld);
-                query.addBindValue(images[imInd].dataGeneralizations);
-                query.addBindValue(images[imInd].continent);
-                query.addBindValue(images[imInd].geonamesAdmin);
-                query.addBindValue(images[imInd].geonamesOther);
-
-                query.addBindValue(images[imInd].identifier);
-                query.addBindValue(images[imInd].lastModified);
-                query.addBindValue(images[imInd].title);
-                query.addBindValue(images[imInd].description);
-                query.addBindValue(images[imInd].caption);
-                query.addBindValue(images[imInd].photographerCode);
-                query.addBindValue(images[imInd].dcterms_created);
-                query.addBindValue(images[imInd].credit);
-                query.addBindValue(images[imInd].copyrightOwnerID);
-                query.addBindValue(images[imInd].copyrightYear);
-
-                query.addBindValue(images[imInd].copyrightStatement);
-                query.addBindValue(images[imInd].copyrightOwnerName);
-                query.addBindValue(images[imInd].attributionLinkURL);
-                query.addBindValue(images[imInd].urlToHighRes);
-                query.addBindValue(images[imInd].usageTermsIndex);
-                query.addBindValue(images[imInd].imageView);
-                query.addBindValue(images[imInd].rating);
-                query.addBindValue(images[imInd].depicts);
-                query.addBindValue(images[imInd].suppress);
-
-                query.addBindValue(images[imInd].identifier);
-
-                query.exec();
-            }
-            else
-                qDebug() << "Error with imageIndexHash call";
-        }
-
-        QString identifier = images[imInd].identifier;
-        if (iconCache.contains(identifier))
-        {
-            ui->thumbWidget->addItem(new QListWidgetItem(iconCache.value(identifier),base));
-        }
+        QString file = source.file;
+        QString identifier = source.identifier;
+        QImage img;
+        if (imageCache.contains(identifier))
+            img = imageCache.value(identifier);
         else if (QFileInfo::exists(file))
         {
             // Scale the images down to thumbnail size
@@ -886,51 +781,33 @@ void DataEntry::iconify(const QStringList &imageFileNames)
 
             if (imageReader.canRead())
             {
-                QImage img = imageReader.read();
-                QPixmap thumb;
-                thumb = thumb.fromImage(img);
+                img = imageReader.read();
                 imageURIList.append(identifier);
-                QIcon thumbIcon(thumb);
-                iconList.append(thumbIcon);
-                iconCache.insert(identifier,thumbIcon);
+                imageList.append(img);
+                imageCache.insert(identifier,img);
                 thumbFileModified = true;
-                ui->thumbWidget->addItem(new QListWidgetItem(thumbIcon,base));
             }
             else
-            {
                 qDebug() << __LINE__ << "Could not load image from file: " + file;
-                ui->thumbWidget->addItem(new QListWidgetItem(QIcon(defaultThumb),base));
-            }
-        }
-        else
-        {
-            ui->thumbWidget->addItem(new QListWidgetItem(QIcon(defaultThumb),base));
         }
-        thumbWidgetItems.append(base);
-    }
 
-    if (!db.commit() && !fromEditExisting)
-    {
-        qDebug() << "In iconify(): Problem committing changes to database: " + db.lastError().text();
-        db.rollback();
+        if (!img.isNull() && !hashed.contains(identifier))
+            thumbnails.hashes.insert(identifier, ImageHashes::dHash(img));
+        thumbnails.bases.append(source.base);
+        thumbnails.images.append(img);
     }
 
-    emit iconifyDone();
-
     // now let's save the thumbnail cache if any changes were made
     if (thumbFileModified)
     {
-        if (imageURIList.size() != iconList.size())
-        {
-            qDebug() << "Error saving thumbnails: imageURIList and iconList are different sizes.";
-            return;
-        }
         thumbFile.open(QIODevice::WriteOnly);
         QDataStream thumbOut(&thumbFile);
-        thumbOut << imageURIList << iconList;
+        thumbOut.setVersion(QDataStream::Qt_5_5);
+        thumbOut << thumbMagic << imageURIList << imageList;
         thumbFile.close();
     }
 
+    return thumbnails;
 }
 
 QString DataEntry::modifiedNow()
@@ -962,110 +839,253 @@ QString DataEntry::modifiedNow()
 
 void DataEntry::generateThumbnails()
 {
-    connect(this,SIGNAL(iconifyDone()),this,SLOT(on_iconifyDone()));
-    auto future = QtConcurrent::run(this, &DataEntry::iconify, imageFileNames);
+    thumbWidgetItems.clear();
+    generateThumbnails(imageFileNames);
 }
 
-void DataEntry::refreshImageLabel()
+void DataEntry::generateThumbnails(const QStringList &files)
 {
-    viewedImage = 0;
-    QList<QListWidgetItem*> itemList = ui->thumbWidget->selectedItems();
-    int numSelect = itemList.count();
-    ui->nSelectedLabel->setText(QString::number(numSelect)+ " selected");
-
-    if (numSelect < 1)
+    // one iconify() at a time; batches from the watched folder wait for the running one
+    if (iconifyWatcher.isRunning())
+    {
+        pendingThumbnails.append(files);
         return;
+    }
 
-    QString fileName = imageHash.value(itemList.at(0)->text());
-    if (fileName.isEmpty())
-        return;
+    QList<ThumbnailSource> sources;
+    for (auto file : files)
+    {
+        ThumbnailSource source;
+        source.file = file;
+        source.base = imageHash.key(file);
+        if (imageIndexHash.contains(source.base))
+            source.identifier = images.at(imageIndexHash.value(source.base)).identifier;
+        else
+            qDebug() << "Error in the imageIndexHash!";
+        sources << source;
+    }
 
-    scaleFactor = 1;
-    int w = ui->scrollArea->width();
-    int h = ui->scrollArea->height();
+    connect(this,SIGNAL(iconifyDone()),this,SLOT(on_iconifyDone()), Qt::UniqueConnection);
+    iconifyWatcher.setFuture(QtConcurrent::run(&DataEntry::iconify, sources, imageHashes.hashed()));
+}
 
-    QString fileToRead = fileName;
-    QFileInfo fileInfo(fileToRead);
-    // use the thumbnail if no other image can be found
-    if (!fileInfo.isFile())
-    {
-        // limit dimensions to 300x300 to somewhat reduce pixelation due to upscaling
-        if (w > 300)
-            w = 300;
-        if (h > 300)
-            h = 300;
-
-        QPixmap pscaled;
-        pscaled = itemList.at(0)->icon().pixmap(100,100).scaled(w,h,Qt::KeepAspectRatio, Qt::SmoothTransformation);
-        imageLabel->resize(w,h);
-        imageLabel->setPixmap(pscaled);
-        return;
-    }
+void DataEntry::thumbnailsFinished()
+{
+    Thumbnails thumbnails = iconifyWatcher.result();
 
-    QImageReader imageReader(fileToRead);
-    imageReader.setAutoTransform(true);
-    imageReader.setScaledSize(QSize(w,h));
-    QSize fullSize = imageReader.size();
-    int wid;
-    int hei;
+    QImageReader defaultImageReader(":/noimage.jpg");
+    int defaultWid = defaultImageReader.size().width();
+    int defaultHei = defaultImageReader.size().height();
+    defaultImageReader.setClipRect(QRect(0,(defaultHei-defaultWid)/2,defaultWid,defaultWid));
+    defaultImageReader.setScaledSize(QSize(100,100));
+    QIcon defaultIcon(QPixmap::fromImage(defaultImageReader.read()));
 
-    // the width and height reported by QImageReader::size() depend upon image orientation
-    if (imageReader.transformation() & QImageIOHandler::TransformationRotate90)
+    for (int i = 0; i < thumbnails.bases.size(); i++)
     {
-        hei = fullSize.width();
-        wid = fullSize.height();
+        QImage img = thumbnails.images.at(i);
+        QIcon icon = img.isNull() ? defaultIcon : QIcon(QPixmap::fromImage(img));
+        ui->thumbWidget->addItem(new QListWidgetItem(icon, thumbnails.bases.at(i)));
+        thumbWidgetItems.append(thumbnails.bases.at(i));
     }
-    else
+    emit iconifyDone();
+
+    if (!thumbnails.hashes.isEmpty())
+        storeImageHashes(thumbnails.hashes);
+
+    if (pendingThumbnails.isEmpty())
+        return;
+    QStringList files = pendingThumbnails;
+    pendingThumbnails.clear();
+    generateThumbnails(files);
+}
+
+void DataEntry::storeImageHashes(const QHash<QString, quint64> &newHashes)
+{
+    // new imports are checked against the whole collection, including the rest of their own batch
+    QStringList flagged;
+    QSqlDatabase db = QSqlDatabase::database();
+    db.transaction();
+
+    QHashIterator<QString, quint64> it(newHashes);
+    while (it.hasNext())
     {
-        wid = fullSize.width();
-        hei = fullSize.height();
+        it.next();
+        if (!fromEditExisting && !imageHashes.nearDuplicates(it.value(), it.key()).isEmpty())
+            flagged.append(imageIDFilenameMap.value(it.key()));
+        imageHashes.insert(it.key(), it.value());
+        ImageHashes::store(it.key(), it.value());
     }
 
-    int setW;
-    int setH;
+    if (!db.commit())
+    {
+        qDebug() << "In storeImageHashes(): Problem committing changes to database: " + db.lastError().text();
+        db.rollback();
+    }
 
-    if (w == h && wid == hei)
+    if (!flagged.isEmpty())
     {
-        setH = h;
-        setW = w;
+        qDebug() << __LINE__ << "Possible near-duplicates:" << flagged;
+        statusBar()->showMessage(QString::number(flagged.size()) + " new images look like near-duplicates. "
+                                 "Use the \"Possible near-duplicates\" thumbnail filter to review them.", 15000);
     }
-    else if (float(wid)/hei > float(w)/h)
+}
+
+void DataEntry::watchFolder(const QString &folder, const QString &nameSpace, const QString &photographer, int trailingChars)
+{
+    hotFolderNamespace = nameSpace;
+    hotFolderPhotographer = photographer;
+    hotFolderTrailingChars = trailingChars;
+
+    QString exifLocation = "";
+    QSqlQuery qry;
+    qry.prepare("SELECT value FROM settings WHERE setting = (?)");
+    qry.addBindValue("path.exiftool");
+    qry.exec();
+    if (qry.next())
+        exifLocation = qry.value(0).toString();
+
+    hotFolder = new HotFolderWatcher(folder, nameSpace, exifLocation, this);
+    connect(hotFolder, SIGNAL(imagesReady(QStringList,QString,QHash<QString,QString>)),
+            this, SLOT(hotFolderImagesReady(QStringList,QString,QHash<QString,QString>)));
+    connect(hotFolder, SIGNAL(imagesRejected(QStringList,QString)), this, SLOT(hotFolderImagesRejected(QStringList,QString)));
+
+    // otherwise exifToolFinished() starts it once the selected images are stored
+    if (imageFileNames.isEmpty())
+        hotFolder->start(imageFileNames);
+}
+
+void DataEntry::hotFolderImagesReady(const QStringList &fileNames, const QString &exifOutput,
+                                     const QHash<QString, QString> &contentHashes)
+{
+    QStringList added;
+    QSet<QString> addedBases;
+    for (auto f : fileNames)
+    {
+        QString base = QFileInfo(f).fileName();
+        if (imageHash.contains(base))
+            continue;
+        imageHash.insert(base, f);
+        nameSpaceHash.insert(f, hotFolderNamespace);
+        photographerHash.insert(f, hotFolderPhotographer);
+        trailingCharsHash.insert(f, hotFolderTrailingChars);
+        if (contentHashes.contains(f))
+            contentHashHash.insert(f, contentHashes.value(f));
+        added.append(f);
+        addedBases.insert(base);
+    }
+    if (added.isEmpty())
+        return;
+
+    QStringList rowsExifOutput;
+    for (auto row : exifOutput.split("\n"))
     {
-        setH = (w*hei)/wid;
-        setW = w;
+        if (addedBases.contains(row.section("\t", 0, 0)))
+            rowsExifOutput.append(row);
     }
-    else
+
+    QSqlDatabase db = QSqlDatabase::database();
+    db.transaction();
+
+    storeExifRows(rowsExifOutput);
+    idAllocator.save();
+
+    if (!db.commit())
     {
-        setH = h;
-        setW = (h*wid)/hei;
+        qDebug() << "In hotFolderImagesReady(): Problem committing changes to database. Data may be lost.";
+        db.rollback();
+        idAllocator.load();
     }
 
-    imageReader.setScaledSize(QSize(setW,setH));
+    imageFileNames.append(added);
+    imageFileNamesSize = imageFileNames.size();
+    generateThumbnails(added);
+
+    statusBar()->showMessage("Added " + QString::number(added.size()) + " images from " + hotFolder->folder(), 10000);
+}
+
+void DataEntry::hotFolderImagesRejected(const QStringList &fileNames, const QString &reason)
+{
+    qDebug() << __LINE__ << "Skipped files from the watched folder: " + reason << fileNames;
+    statusBar()->showMessage("Skipped " + QString::number(fileNames.size()) + " files from the watched folder. " + reason, 10000);
+}
+
+void DataEntry::refreshImageLabel()
+{
+    viewedImage = 0;
+    QList<QListWidgetItem*> itemList = ui->thumbWidget->selectedItems();
+    int numSelect = itemList.count();
+    ui->nSelectedLabel->setText(QString::number(numSelect)+ " selected");
+
+    if (numSelect < 1)
+        return;
+
+    showPreview(itemList, viewedImage);
+}
+
+void DataEntry::showPreview(const QList<QListWidgetItem*> &itemList, int index)
+{
+    QString fileName = imageHash.value(itemList.at(index)->text());
+    if (fileName.isEmpty())
+        return;
+
+    scaleFactor = 1;
+    QSize viewport(ui->scrollArea->width(), ui->scrollArea->height());
+    displayedPreview = fileName;
 
-    if (imageReader.canRead())
+    // decode the neighbors in the order next/previous will visit them
+    QStringList neighbors;
+    for (int i = 1; i <= previewPrefetchCount; i++)
     {
-        QImage img = imageReader.read();
-        QPixmap pscaled;
-        pscaled = pscaled.fromImage(img);
-        imageLabel->resize(setW,setH);
-        imageLabel->setPixmap(pscaled);
+        if (index + i < itemList.count())
+            neighbors.append(imageHash.value(itemList.at(index + i)->text()));
+        if (index - i >= 0)
+            neighbors.append(imageHash.value(itemList.at(index - i)->text()));
     }
-    else
+
+    QImage img = previewLoader->cached(fileName, viewport);
+    if (img.isNull())
+        showThumbnailPreview(itemList.at(index)->text()); // shown until the full preview is decoded
+    previewLoader->request(fileName, viewport, neighbors);
+}
+
+void DataEntry::displayPreview(const QString &fileName, const QImage &image)
+{
+    if (fileName != displayedPreview)
+        return;
+
+    // use the thumbnail if the image file can't be found or read
+    if (image.isNull())
     {
-        qDebug() << __LINE__  << "Could not load image from file: " + fileName;
-        // use the thumbnail instead
-        // limit dimensions to 300x300 to somewhat reduce pixelation due to upscaling
-        if (w > 300)
-            w = 300;
-        if (h > 300)
-            h = 300;
-
-        QPixmap pscaled;
-        pscaled = itemList.at(0)->icon().pixmap(100,100).scaled(w,h,Qt::KeepAspectRatio, Qt::SmoothTransformation);
-        imageLabel->resize(w,h);
-        imageLabel->setPixmap(pscaled);
+        showThumbnailPreview(imageHash.key(fileName));
         return;
     }
+
+    scaleFactor = 1;
+    imageLabel->setSourceFile(fileName);
+    imageLabel->resize(image.size());
+    imageLabel->setPixmap(QPixmap::fromImage(image));
+}
+
+void DataEntry::showThumbnailPreview(const QString &base)
+{
+    QList<QListWidgetItem*> items = ui->thumbWidget->findItems(base, Qt::MatchExactly);
+    if (items.isEmpty())
+        return;
+
+    int w = ui->scrollArea->width();
+    int h = ui->scrollArea->height();
+
+    // limit dimensions to 300x300 to somewhat reduce pixelation due to upscaling
+    if (w > 300)
+        w = 300;
+    if (h > 300)
+        h = 300;
+
+    QPixmap pscaled;
+    pscaled = items.at(0)->icon().pixmap(100,100).scaled(w,h,Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    imageLabel->setSourceFile("");
+    imageLabel->resize(pscaled.size());
+    imageLabel->setPixmap(pscaled);
 }
 
 void DataEntry::refreshInputFields()
@@ -1163,81 +1183,16 @@ void DataEntry::refreshInputFields()
 
         // let's fetch all the image values from the database
         Image image;
-        QSqlQuery imageChanges;
-        imageChanges.prepare("SELECT * FROM images WHERE dcterms_identifier = (?) LIMIT 1");
+        PreparedQuery imageChanges(TableSchema<Image>::select("images") + " WHERE dcterms_identifier = (?) LIMIT 1");
         QString identifier = imageIDFilenameMap.key(itemList.at(0)->text());
-        imageChanges.addBindValue(identifier);
+        imageChanges.bind(identifier);
         imageChanges.exec();
         if (imageChanges.next())
         {
-            image.fileName = imageChanges.value(0).toString();
-            image.focalLength = imageChanges.value(1).toString();
-            image.georeferenceRemarks = imageChanges.value(2).toString();
-            image.decimalLatitude = imageChanges.value(3).toString();
-            image.decimalLongitude = imageChanges.value(4).toString();
-            image.altitudeInMeters = imageChanges.value(5).toString();
-            image.width = imageChanges.value(6).toString();
-            image.height = imageChanges.value(7).toString();
-            image.occurrenceRemarks = imageChanges.value(8).toString();
-            image.geodeticDatum = imageChanges.value(9).toString();
-
-            image.coordinateUncertaintyInMeters = imageChanges.value(10).toString();
-            image.locality = imageChanges.value(11).toString();
-            image.countryCode = imageChanges.value(12).toString();
-            image.stateProvince = imageChanges.value(13).toString();
-            image.county = imageChanges.value(14).toString();
-            image.informationWithheld = imageChanges.value(15).toString();
-            image.dataGeneralizations = imageChanges.value(16).toString();
-            image.continent = imageChanges.value(17).toString();
-            image.geonamesAdmin = imageChanges.value(18).toString();
-            image.geonamesOther = imageChanges.value(19).toString();
-
-            image.identifier = imageChanges.value(20).toString();
-            image.lastModified = imageChanges.value(21).toString();
-            image.title = imageChanges.value(22).toString();
-            image.description = imageChanges.value(23).toString();
-            image.caption = imageChanges.value(24).toString();
-            image.photographerCode = imageChanges.value(25).toString();
-            image.dcterms_created = imageChanges.value(26).toString();
-            QStringList dateTimeSplit = image.dcterms_created.split("T");
-            if(dateTimeSplit.size() == 2)
-            {
-                QString date = dateTimeSplit.at(0);
-                image.date = date;
-                QString time = dateTimeSplit.at(1);
-                QString timeNoTZ = time;
-                QString tz = "";
-                if (time.contains("-"))
-                {
-                    timeNoTZ = time.split("-").at(0);
-                    tz = "-" + time.split("-").at(1);
-                }
-                else if (time.contains("+"))
-                {
-                    timeNoTZ = time.split("+").at(0);
-                    tz = "+" + time.split("+").at(1);
-                }
-                image.time = timeNoTZ;
-                image.timezone = tz;
-            }
-            else
-                image.date = image.dcterms_created;
-
-            image.credit = imageChanges.value(27).toString();
-            image.copyrightOwnerID = imageChanges.value(28).toString();
-            image.copyrightYear = imageChanges.value(29).toString();
-
-            image.copyrightStatement = imageChanges.value(30).toString();
-            image.copyrightOwnerName = imageChanges.value(31).toString();
-            image.attributionLinkURL = imageChanges.value(32).toString();
-            image.urlToHighRes = imageChanges.value(33).toString();
-            image.usageTermsIndex = imageChanges.value(34).toString();
-            image.imageView = imageChanges.value(35).toString();
-            image.rating = imageChanges.value(36).toString();
-            image.depicts = imageChanges.value(37).toString();
-            image.suppress = imageChanges.value(38).toString();
-
-            QStringList groupPartView = numbersToView(image.imageView);
+            TableSchema<Image>::load(image, imageChanges);
+            image.splitCreated();
+
+            QStringList groupPartView = ImageView::decode(image.imageView);
             if (groupPartView.size() == 3)
             {
                 image.groupOfSpecimen = groupPartView.at(0);
@@ -2890,13 +2845,15 @@ void DataEntry::on_reverseGeocodeButton_clicked()
     // 0. gray out "Reverse Geocode" button
     // 1. get a list of all selected images
     // 2. for each image if lat/lon exists add image+lat/lon to new list<map>
-    // 3. send this list to a new queue function
-    // 4. in new function, go through queue and startRequest()
-    // 5. refresh selected county/state/country/etc when completely done
+    // 3. resolve from the geocode_cache or GeoNames data where possible
+    // 4. send the rest to geocodeScheduler
+    // 5. save and refresh selected county/state/country/etc when the batch is done
 
     QList<QListWidgetItem*> itemList = ui->thumbWidget->selectedItems();
-    revgeoURLList.clear();
+    if (geocodeScheduler->isRunning())
+        return;
     revgeoHash.clear();
+    geocodeScheduler->loadSettings();
 
     if (itemList.count() == 0)
     {
@@ -2906,10 +2863,21 @@ void DataEntry::on_reverseGeocodeButton_clicked()
         return;
     }
 
+    // loads the GeoNames data the first time it's needed, if it has been downloaded
+    offlineGeocoder = OfflineGeocoder::shared();
+
     QSqlDatabase db = QSqlDatabase::database();
     db.transaction();
 
-    bool geocodeCacheUsed = false;
+    // gather the coordinates first so the cache can be read for all of them at once
+    struct Located
+    {
+        int h;
+        QString lat;
+        QString lon;
+    };
+    QList<Located> located;
+    QList<QPointF> coordinates;
     for (QListWidgetItem *img : itemList)
     {
         int h = imageIndexHash.value(img->text());
@@ -2937,58 +2905,44 @@ void DataEntry::on_reverseGeocodeButton_clicked()
         if (lat == "" || lon == "")
             continue;
 
-        bool externalSearch = true;
+        Located l = { h, lat, lon };
+        located.append(l);
+        coordinates.append(QPointF(lon.toDouble(), lat.toDouble()));
+    }
 
-        if (!ui->bypassCache->isChecked())
-        {
-            // query the geocode_cache to see if we have the values for these coordinates
-            QSqlQuery checkCacheQuery;
-            checkCacheQuery.prepare("SELECT expires, continent, country, stateProvince, county, locality, geonamesAdmin "
-                                    "FROM geocode_cache WHERE latitude = (?) AND longitude = (?) LIMIT 1");
-            checkCacheQuery.addBindValue(lat);
-            checkCacheQuery.addBindValue(lon);
-            checkCacheQuery.exec();
+    if (!ui->bypassCache->isChecked())
+        geocodeCache.prefetch(coordinates);
 
+    bool locationsUpdated = false;
+    for (auto l : located)
+    {
+        int h = l.h;
+        bool externalSearch = true;
+        GeocodeResult location;
 
-            // if coordinates found and their values have not expired yet, set using those values
-            if (checkCacheQuery.next())
-            {
-                if (checkCacheQuery.value(0).toString() > QDate::currentDate().toString("yyyy-MM-dd"))
-                {
-                    qDebug() << "Using geocode_cache for lat=" + lat + " lon=" + lon;
-                    externalSearch = false;
-                    geocodeCacheUsed = true;
-                    // set images[h] values and set images table values
-                    images[h].continent = checkCacheQuery.value(1).toString();
-                    images[h].countryCode = checkCacheQuery.value(2).toString();
-                    images[h].stateProvince = checkCacheQuery.value(3).toString();
-                    images[h].county = checkCacheQuery.value(4).toString();
-                    images[h].locality = checkCacheQuery.value(5).toString();
-                    images[h].geonamesAdmin = checkCacheQuery.value(6).toString();
-                    images[h].lastModified = modifiedNow();
-
-                    QSqlQuery updateFromCache;
-                    updateFromCache.prepare("UPDATE images SET dwc_locality = (?), dwc_countryCode = (?), "
-                                        "dwc_stateProvince = (?), dwc_county = (?), dwc_continent = (?), "
-                                        "geonamesAdmin = (?), dcterms_modified = (?) WHERE dcterms_identifier = (?)");
-                    updateFromCache.addBindValue(images[h].locality);
-                    updateFromCache.addBindValue(images[h].countryCode);
-                    updateFromCache.addBindValue(images[h].stateProvince);
-                    updateFromCache.addBindValue(images[h].county);
-                    updateFromCache.addBindValue(images[h].continent);
-                    updateFromCache.addBindValue(images[h].geonamesAdmin);
-                    updateFromCache.addBindValue(images[h].lastModified);
-                    updateFromCache.addBindValue(images[h].identifier);
-                    updateFromCache.exec();
-                }
-            }
+        // use a cached location within the tolerance of these coordinates
+        if (!ui->bypassCache->isChecked() && geocodeCache.lookup(l.lat.toDouble(), l.lon.toDouble(), location))
+        {
+            qDebug() << "Using geocode_cache for lat=" + l.lat + " lon=" + l.lon;
+            externalSearch = false;
+            locationsUpdated = true;
+            applyLocation(h, location);
         }
-        // otherwise we need to use a reverse geocoding webservice
-        if (externalSearch)
+
+        // otherwise look the coordinates up in the local GeoNames data, then refine online if asked to
+        if (externalSearch && !offlineGeocoder.isNull() && offlineGeocoder->lookup(l.lat.toDouble(), l.lon.toDouble(), location))
+        {
+            applyLocation(h, location);
+            locationsUpdated = true;
+            externalSearch = ui->refineOnline->isChecked();
+        }
+
+        // and fall back on a reverse geocoding webservice
+        if (externalSearch && !baseReverseGeocodeURL.isEmpty())
         {
             //QString mapquest = "http://open.mapquestapi.com/nominatim/v1/reverse.php?format=json&lat=" + lat + "&lon=" + lon;
-            QString nominatim = baseReverseGeocodeURL + "format=json&lat=" + lat + "&lon=" + lon;
-            revgeoHash.insertMulti(nominatim,h);
+            revgeoHash.insertMulti(GeocodeScheduler::coordinateKey(l.lat, l.lon), h);
+            geocodeScheduler->enqueue(l.lat, l.lon);
         }
     }
 
@@ -2998,175 +2952,147 @@ void DataEntry::on_reverseGeocodeButton_clicked()
         db.rollback();
     }
 
-    revgeoURLList = revgeoHash.uniqueKeys();
-
-    if (!revgeoURLList.isEmpty())
+    if (!revgeoHash.isEmpty())
     {
         ui->reverseGeocodeButton->setEnabled(false);
-        reverseGeocodeQueue();
+        geocodeScheduler->start();
     }
 
-    if (geocodeCacheUsed)
+    if (locationsUpdated)
         refreshInputFields();
 }
 
-void DataEntry::reverseGeocodeQueue()
+void DataEntry::applyLocation(int h, const GeocodeResult &location)
 {
-    if (revgeoURLList.isEmpty())
-    {
-        ui->reverseGeocodeButton->setEnabled(true);
-        refreshInputFields();
-        return;
-    }
-
-    QUrl revgeoURL = QUrl(revgeoURLList.first());
-    revgeoURLList.removeFirst();
+    images[h].continent = location.continent;
+    images[h].countryCode = location.countryCode;
+    images[h].stateProvince = location.stateProvince;
+    images[h].county = location.county;
+    images[h].locality = location.locality;
+    images[h].geonamesAdmin = location.geonamesAdmin;
+    images[h].lastModified = modifiedNow();
+    saveImageLocation(h);
+}
 
-    qDebug() << "Making a request to: " + revgeoURL.toString();
-    startRequest(revgeoURL);
+void DataEntry::saveImageLocation(int h)
+{
+    QSqlQuery updateQuery;
+    updateQuery.prepare("UPDATE images SET dwc_locality = (?), dwc_countryCode = (?), "
+                        "dwc_stateProvince = (?), dwc_county = (?), dwc_continent = (?), "
+                        "geonamesAdmin = (?), dcterms_modified = (?) WHERE dcterms_identifier = (?)");
+    updateQuery.addBindValue(images[h].locality);
+    updateQuery.addBindValue(images[h].countryCode);
+    updateQuery.addBindValue(images[h].stateProvince);
+    updateQuery.addBindValue(images[h].county);
+    updateQuery.addBindValue(images[h].continent);
+    updateQuery.addBindValue(images[h].geonamesAdmin);
+    updateQuery.addBindValue(images[h].lastModified);
+    updateQuery.addBindValue(images[h].identifier);
+    updateQuery.exec();
 }
 
-void DataEntry::startRequest(QUrl url)
+bool DataEntry::parseReverseGeocode(const QByteArray &body, GeocodeResult &location, bool &hasGeonamesAdmin)
 {
-    reply = qnam.get(QNetworkRequest(url));
-    connect( reply, SIGNAL(finished()),
-             this, SLOT(httpFinished()) );
+    QJsonDocument geolocJSON = QJsonDocument::fromJson(body);
+    if (geolocJSON.isNull()) qDebug() << "Error: JSON document is NULL.";
+    if (geolocJSON.isEmpty()) qDebug() << "Error: JSON document is empty.";
+    if (geolocJSON.isNull() || geolocJSON.isEmpty())
+        return false;
+
+    QJsonObject geolocObject = geolocJSON.object();
+    QJsonObject multipartAddress = geolocObject.value("address").toObject();
+
+    location.county = multipartAddress.value("county").toString();
+    location.stateProvince = multipartAddress.value("state").toString();
+    location.countryCode = multipartAddress.value("country_code").toString().toUpper();
+    location.distance = 0;
+
+    // set geonamesAdmin based on the country, state and county
+    // only U.S. geonamesAdmin have been implemented so far
+    hasGeonamesAdmin = false;
+    location.geonamesAdmin = "";
+    if (location.countryCode == "US" && !location.stateProvince.isEmpty() && !location.county.isEmpty())
+    {
+        QString twoLetterState = stateTwoLetter.value(location.stateProvince);
+        QString countyState = location.county + ", " + twoLetterState;
+
+        // check the hash for countyState, returning the 2-letter
+        location.geonamesAdmin = countyGeonameID.value(countyState);
+        hasGeonamesAdmin = true;
+    }
+    // make this more robust
+    location.continent = "";
+    if (multipartAddress.value("country_code") == "us")
+    {
+        location.continent = "NA";
+    }
+    multipartAddress.remove("county");
+    multipartAddress.remove("state");
+    multipartAddress.remove("country_code");
+    multipartAddress.remove("postcode");
+    multipartAddress.remove("city");
+    multipartAddress.remove("country");
+    QStringList localityList;
+    for (auto jIt : multipartAddress)
+    {
+        localityList << jIt.toString();
+    }
+    //images[h].locality = geolocObject.value("display_name").toString();
+    location.locality = localityList.join(", ");
+    return true;
 }
 
-void DataEntry::httpFinished()
+void DataEntry::reverseGeocodeFinished(const QList<GeocodeResponse> &responses)
 {
-    QVariant redirectionTarget = reply->attribute(QNetworkRequest::RedirectionTargetAttribute);
-    if (reply->error())
-    {
-        qDebug() << "Reverse geocoding failed: " + reply->errorString();
-    }
-    else if (!redirectionTarget.isNull()) {
-        QUrl newUrl = url.resolved(redirectionTarget.toUrl());
-        qDebug() << "Redirecting reverse geocoding request to: " + newUrl.toString();
+    // save the whole batch in one transaction and refresh the fields once
+    QSqlDatabase db = QSqlDatabase::database();
+    db.transaction();
 
-        url = newUrl;
-        reply->deleteLater();
-        startRequest(url);
-        return;
-    }
-    else
+    QString now = modifiedNow();
+    for (auto response : responses)
     {
-        QJsonDocument geolocJSON = QJsonDocument::fromJson(reply->readAll());
-        if (geolocJSON.isNull()) qDebug() << "Error: JSON document is NULL.";
-        if (geolocJSON.isEmpty()) qDebug() << "Error: JSON document is empty.";
-
-        QJsonObject geolocObject = geolocJSON.object();
-        QJsonObject multipartAddress = geolocObject.value("address").toObject();
-
-        QString county = multipartAddress.value("county").toString();
-        QString stateProvince = multipartAddress.value("state").toString();
-        QString countryCode = multipartAddress.value("country_code").toString().toUpper();
-
-        // set geonamesAdmin based on the country, state and county
-        // only U.S. geonamesAdmin have been implemented so far
-        QString geonameID;
-        bool setGeonamesAdmin = false;
-        if (countryCode == "US" && !stateProvince.isEmpty() && !county.isEmpty())
-        {
-            QString twoLetterState = stateTwoLetter.value(stateProvince);
-            QString countyState = county + ", " + twoLetterState;
-
-            // check the hash for countyState, returning the 2-letter
-            geonameID = countyGeonameID.value(countyState);
-            setGeonamesAdmin = true;
-        }
-        QString continent;
-        // make this more robust
-        if (multipartAddress.value("country_code") == "us")
-        {
-            continent = "NA";
-        }
-        multipartAddress.remove("county");
-        multipartAddress.remove("state");
-        multipartAddress.remove("country_code");
-        multipartAddress.remove("postcode");
-        multipartAddress.remove("city");
-        multipartAddress.remove("country");
-        QStringList localityList;
-        for (auto jIt : multipartAddress)
-        {
-            localityList << jIt.toString();
-        }
-        //images[h].locality = geolocObject.value("display_name").toString();
-        QString locality = localityList.join(", ");
-        QString now = modifiedNow();
-
-        QSqlDatabase db = QSqlDatabase::database();
-        db.transaction();
+        GeocodeResult location;
+        bool hasGeonamesAdmin;
+        if (!response.ok || !parseReverseGeocode(response.body, location, hasGeonamesAdmin))
+            continue;
 
-        QString lat;
-        QString lon;
         QString upContinent;
         QString upGeonamesAdmin;
-
-        QString requestString = reply->request().url().toString();
-        QList<int> hValues = revgeoHash.values(requestString);
+        QList<int> hValues = revgeoHash.values(GeocodeScheduler::coordinateKey(response.latitude, response.longitude));
         for (int h : hValues)
         {
-            images[h].county = county;
-            images[h].stateProvince = stateProvince;
-            images[h].countryCode = countryCode;
-            if (setGeonamesAdmin)
-                images[h].geonamesAdmin = geonameID;
-            if (!continent.isEmpty())
+            images[h].county = location.county;
+            images[h].stateProvince = location.stateProvince;
+            images[h].countryCode = location.countryCode;
+            if (hasGeonamesAdmin)
+                images[h].geonamesAdmin = location.geonamesAdmin;
+            if (!location.continent.isEmpty())
             {
-                images[h].continent = continent;
+                images[h].continent = location.continent;
             }
 
-            images[h].locality = locality;
+            images[h].locality = location.locality;
             images[h].lastModified = now;
+            saveImageLocation(h);
 
-            QSqlQuery insertQuery;
-            insertQuery.prepare("UPDATE images SET dwc_locality = (?), dwc_countryCode = (?), "
-                                "dwc_stateProvince = (?), dwc_county = (?), dwc_continent = (?), "
-                                "geonamesAdmin = (?), dcterms_modified = (?) WHERE dcterms_identifier = (?)");
-            insertQuery.addBindValue(locality);
-            insertQuery.addBindValue(countryCode);
-            insertQuery.addBindValue(stateProvince);
-            insertQuery.addBindValue(county);
-            insertQuery.addBindValue(images[h].continent);
-            insertQuery.addBindValue(images[h].geonamesAdmin);
-            insertQuery.addBindValue(now);
-            insertQuery.addBindValue(images[h].identifier);
-            insertQuery.exec();
-
-            lat = images[h].decimalLatitude;
-            lon = images[h].decimalLongitude;
             upContinent = images[h].continent;
             upGeonamesAdmin = images[h].geonamesAdmin;
         }
 
-        QSqlQuery cacheQuery;
-        cacheQuery.prepare("INSERT OR REPLACE INTO geocode_cache (latitude, longitude, "
-                           "expires, continent, country, stateProvince, county, locality, "
-                           "geonamesAdmin) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
-        cacheQuery.addBindValue(lat);
-        cacheQuery.addBindValue(lon);
-        cacheQuery.addBindValue(QDate::currentDate().addYears(1).toString("yyyy-MM-dd"));
-        cacheQuery.addBindValue(upContinent);
-        cacheQuery.addBindValue(countryCode);
-        cacheQuery.addBindValue(stateProvince);
-        cacheQuery.addBindValue(county);
-        cacheQuery.addBindValue(locality);
-        cacheQuery.addBindValue(upGeonamesAdmin);
-        cacheQuery.exec();
-
-        if (!db.commit())
-        {
-            qDebug() << "In httpFinished(): Problem updating database.";
-            db.rollback();
-        }
+        location.continent = upContinent;
+        location.geonamesAdmin = upGeonamesAdmin;
+        geocodeCache.store(response.latitude, response.longitude, location);
     }
 
-    reply->deleteLater();
-    reply = 0;
+    if (!db.commit())
+    {
+        qDebug() << "In reverseGeocodeFinished(): Problem updating database.";
+        db.rollback();
+    }
 
-    reverseGeocodeQueue();
+    revgeoHash.clear();
+    ui->reverseGeocodeButton->setEnabled(true);
+    refreshInputFields();
 }
 
 void DataEntry::on_actionQuit_triggered()
@@ -3230,37 +3156,17 @@ void DataEntry::on_generateNewOrganismIDButton_clicked()
     // if there's a scheme number, use it
     if (!schemeNumber.isEmpty())
     {
-        newOrganismID = "http://bioimages.vanderbilt.edu/" + idNamespace + "/" + schemeText + schemeNumber;
-
-        bool keepgoing = true;
+        // the allocator advances the stored scheme number past the ID it hands out
         QSqlDatabase db = QSqlDatabase::database();
         db.transaction();
-        while (keepgoing)
-        {
-            QSqlQuery query;
-            query.prepare("SELECT 1 FROM organisms WHERE dcterms_identifier = (?) LIMIT 1");
-            query.addBindValue(newOrganismID);
-            query.exec();
-            keepgoing = false;
-            while (query.next())
-            {
-                keepgoing = true;
-                schemeNumber = QString::number(schemeNumber.toInt() + 1);
-                newOrganismID = "http://bioimages.vanderbilt.edu/" + idNamespace + "/" + schemeText + schemeNumber;
-            }
-        }
-
-        // increment the schemeNumber for the next ID
-        QSqlQuery qry;
-        qry.prepare("INSERT OR REPLACE INTO settings (setting, value) VALUES (?, ?)");
-        qry.addBindValue("org.scheme.number");
-        qry.addBindValue(schemeNumber);
-        qry.exec();
+        newOrganismID = idAllocator.reserve("organisms", idNamespace, schemeText, "org.scheme.number", 1).first();
+        schemeNumber = QString::number(idAllocator.mark("org.scheme.number"));
 
         if (!db.commit())
         {
             qDebug() << "In generateNewOrganismID(): Using scheme. Problem committing changes to database. Data may be lost.";
             db.rollback();
+            idAllocator.load();
         }
     }
     // if there's no scheme number, try using the last 5 characters of the first selected image
@@ -3271,36 +3177,18 @@ void DataEntry::on_generateNewOrganismIDButton_clicked()
         // only keep alphanumerics, dashes and underscores from the image's identifier then take the rightmost 5
         newEnding = newEnding.remove(QRegExp("[^a-zA-Z\\d_-]")).right(5);
         // to be Utf8 safe maybe use: .remove(QRegExp(QString::fromUtf8("[-`~!@#$%^&*()_—+=|:;<>«»,.?/{}\'\"\\\[\\\]\\\\]")));
-        newOrganismID = "http://bioimages.vanderbilt.edu/" + idNamespace + "/" + schemeText + newEnding;
+        newOrganismID = IdAllocator::identifier(idNamespace, schemeText + newEnding);
 
-        bool keepgoing = true;
         QSqlDatabase db = QSqlDatabase::database();
         db.transaction();
-        while (keepgoing)
-        {
-            QSqlQuery query;
-            query.prepare("SELECT 1 FROM organisms WHERE dcterms_identifier = (?) LIMIT 1");
-            query.addBindValue(newOrganismID);
-            query.exec();
-            keepgoing = false;
-            while (query.next())
-            {
-                keepgoing = true;
-                lastOrgNum++;
-                newOrganismID = "http://bioimages.vanderbilt.edu/" + idNamespace + "/" + schemeText + QString::number(lastOrgNum);
-            }
-        }
-
-        QSqlQuery qry;
-        qry.prepare("INSERT OR REPLACE INTO settings (setting, value) VALUES (?, ?)");
-        qry.addBindValue("last.organismnumber");
-        qry.addBindValue(lastOrgNum);
-        qry.exec();
+        if (!idAllocator.claim("organisms", newOrganismID))
+            newOrganismID = idAllocator.reserve("organisms", idNamespace, schemeText, "last.organismnumber", 1).first();
 
         if (!db.commit())
         {
             qDebug() << "In generateNewOrganismID(): Not using scheme. Problem committing changes to database. Data may be lost.";
             db.rollback();
+            idAllocator.load();
         }
     }
 
@@ -3314,29 +3202,14 @@ void DataEntry::on_generateNewOrganismIDButton_clicked()
     ui->cameoText->setText(images[h].identifier);
     ui->cameoText->setToolTip(images[h].identifier);
 
+    newOrganism.lastModified = modifiedNow();
+    newOrganism.decimalLatitude = images[h].decimalLatitude;
+    newOrganism.decimalLongitude = images[h].decimalLongitude;
+    newOrganism.altitudeInMeters = images[h].altitudeInMeters;
+
     // Add newOrganism to the list of Organisms
-    QSqlQuery insert;
-    insert.prepare("INSERT INTO organisms (dcterms_identifier, dwc_establishmentMeans, "
-                   "dcterms_modified, dwc_organismRemarks, dwc_collectionCode, dwc_catalogNumber, "
-                   "dwc_georeferenceRemarks, dwc_decimalLatitude, dwc_decimalLongitude, geo_alt, "
-                   "dwc_organismName, dwc_organismScope, cameo, notes, suppress) VALUES "
-                   "(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
-    insert.addBindValue(newOrganismID);
-    insert.addBindValue("uncertain");
-    insert.addBindValue(modifiedNow());
-    insert.addBindValue(newOrganism.organismRemarks);
-    insert.addBindValue(newOrganism.collectionCode);
-    insert.addBindValue(newOrganism.catalogNumber);
-    insert.addBindValue(newOrganism.georeferenceRemarks);
-
-    insert.addBindValue(images[h].decimalLatitude);
-    insert.addBindValue(images[h].decimalLongitude);
-    insert.addBindValue(images[h].altitudeInMeters);
-    insert.addBindValue(newOrganism.organismName);
-    insert.addBindValue("multicellular organism");
-    insert.addBindValue(images[h].identifier);
-    insert.addBindValue(newOrganism.notes);
-    insert.addBindValue(newOrganism.suppress);
+    PreparedQuery insert(TableSchema<Organism>::insert("organisms"));
+    TableSchema<Organism>::bind(insert, newOrganism);
 
     if (!insert.exec()) {
         QMessageBox::critical(0, "", "Organism insertion failed: " + insert.lastError().text());
@@ -3356,11 +3229,10 @@ void DataEntry::on_generateNewOrganismIDButton_clicked()
 
         images[i].depicts = newOrganism.identifier;
 
-        QSqlQuery insertQuery;
-        insertQuery.prepare("UPDATE images SET foaf_depicts = (?), dcterms_modified = (?) WHERE dcterms_identifier = (?)");
-        insertQuery.addBindValue(newOrganism.identifier);
-        insertQuery.addBindValue(modifiedNow());
-        insertQuery.addBindValue(images[i].identifier);
+        PreparedQuery insertQuery("UPDATE images SET foaf_depicts = (?), dcterms_modified = (?) WHERE dcterms_identifier = (?)");
+        insertQuery.bind(newOrganism.identifier);
+        insertQuery.bind(modifiedNow());
+        insertQuery.bind(images[i].identifier);
         insertQuery.exec();
     }
 
@@ -3379,59 +3251,8 @@ void DataEntry::on_generateNewOrganismIDButton_clicked()
 
 void DataEntry::loadUSDANames()
 {
-    usdaNames.clear();
-    allGenera.clear();
-    allSpecies.clear();
-    allCommonNames.clear();
-    allFamilies.clear();
-
-    QSqlQuery query;
-    query.setForwardOnly(true);
-    query.prepare("SELECT dcterms_identifier, dwc_kingdom, dwc_class, dwc_order, dwc_family, dwc_genus, dwc_specificEpithet, dwc_infraspecificEpithet, dwc_taxonRank, dwc_scientificNameAuthorship, dwc_vernacularName FROM taxa");
-    query.exec();
-    while (query.next())
-    {
-        QString tsnID = query.value(0).toString();
-        QString family = query.value(4).toString();
-        QString genus = query.value(5).toString();
-        QString species = query.value(6).toString();
-        QString infraspecific = query.value(7).toString();
-        QString commonName = query.value(10).toString();
-
-        if (tsnID.isEmpty())
-            continue;
-
-        // add the species and subspecies names in a genus search
-        if (!species.isEmpty())
-        {
-            genus.append(" " + species);
-
-            // only add the subspecies if there was a species name
-            if (!infraspecific.isEmpty())
-            {
-                genus.append(" " + infraspecific);
-            }
-        }
-
-        if (!infraspecific.isEmpty())
-        {
-            species.append(" " + infraspecific);
-        }
-
-        family.append(" (" + tsnID + ")");
-        species.append(" (" + tsnID + ")");
-        genus.append(" (" + tsnID + ")");
-        commonName.append(" (" + tsnID + ")");
-
-        QString scientificName = query.value(1).toString() + "|" + query.value(2).toString() + "|" + query.value(3).toString() + "|" +
-                query.value(4).toString() + "|" + genus + "|" + species + "|" + infraspecific + "|" + query.value(8).toString() + "|" + commonName;
-
-        usdaNames.insert(tsnID,scientificName);
-        allGenera.append(genus);
-        allSpecies.append(species);
-        allCommonNames.append(commonName);
-        allFamilies.append(family);
-    }
+    // reuses the index already loaded by another window, and only rebuilds it if taxa has changed
+    taxonIndex = TaxonIndex::shared();
 }
 
 void DataEntry::resizeEvent(QResizeEvent *)
@@ -3441,100 +3262,10 @@ void DataEntry::resizeEvent(QResizeEvent *)
     int numSelect = itemList.count();
     ui->nSelectedLabel->setText(QString::number(numSelect)+" selected");
 
+    // previews decoded for the old viewport size are no longer useful
+    previewLoader->clear();
     if (numSelect >= 1)
-    {
-        scaleFactor = 1;
-        imageLabel->resize(imageLabel->pixmap()->size());
-
-        QString fileName = imageHash.value(itemList.at(0)->text());
-        if (!fileName.isEmpty()) {
-            int w = ui->scrollArea->width();
-            int h = ui->scrollArea->height();
-
-            QString fileToRead = fileName;
-            QFileInfo fileInfo(fileToRead);
-            // use the thumbnail if no other image can be found
-            if (!fileInfo.isFile())
-            {
-                // limit dimensions to 300x300 to somewhat reduce pixelation due to upscaling
-                if (w > 300)
-                    w = 300;
-                if (h > 300)
-                    h = 300;
-
-                QPixmap pscaled;
-                pscaled = itemList.at(0)->icon().pixmap(100,100).scaled(w,h,Qt::KeepAspectRatio, Qt::SmoothTransformation);
-                imageLabel->resize(w,h);
-                imageLabel->setPixmap(pscaled);
-            }
-            else
-            {
-                QImageReader imageReader(fileToRead);
-                imageReader.setAutoTransform(true);
-                imageReader.setScaledSize(QSize(w,h));
-                QSize fullSize = imageReader.size();
-                int wid;
-                int hei;
-
-                // the width and height reported by QImageReader::size() depend upon image orientation
-                if (imageReader.transformation() & QImageIOHandler::TransformationRotate90)
-                {
-                    hei = fullSize.width();
-                    wid = fullSize.height();
-                }
-                else
-                {
-                    wid = fullSize.width();
-                    hei = fullSize.height();
-                }
-
-                int setW;
-                int setH;
-
-                if (w == h && wid == hei)
-                {
-                    setH = h;
-                    setW = w;
-                }
-                else if (float(wid)/hei > float(w)/h)
-                {
-                    setH = (w*hei)/wid;
-                    setW = w;
-                }
-                else
-                {
-                    setH = h;
-                    setW = (h*wid)/hei;
-                }
-
-                imageReader.setScaledSize(QSize(setW,setH));
-
-                if (imageReader.canRead())
-                {
-                    QImage img = imageReader.read();
-                    QPixmap pscaled;
-                    pscaled = pscaled.fromImage(img);
-                    imageLabel->resize(setW,setH);
-                    imageLabel->setPixmap(pscaled);
-                }
-                else
-                {
-                    qDebug() << __LINE__ << "Could not load image from file: " + fileName;
-                    // use the thumbnail instead
-                    // limit dimensions to 300x300 to somewhat reduce pixelation due to upscaling
-                    if (w > 300)
-                        w = 300;
-                    if (h > 300)
-                        h = 300;
-
-                    QPixmap pscaled;
-                    pscaled = itemList.at(0)->icon().pixmap(100,100).scaled(w,h,Qt::KeepAspectRatio, Qt::SmoothTransformation);
-                    imageLabel->resize(w,h);
-                    imageLabel->setPixmap(pscaled);
-                }
-            }
-        }
-    }
+        showPreview(itemList, viewedImage);
 
     QSqlQuery qry;
     qry.prepare("INSERT OR REPLACE INTO settings (setting, value) VALUES (?, ?)");
@@ -3567,18 +3298,6 @@ void DataEntry::changeEvent(QEvent* event)
     }
 }
 
-void DataEntry::loadImageIDs()
-{
-    imageIDList.clear();
-    QSqlQuery query;
-    query.prepare("SELECT dwc_identifier from images");
-    query.exec();
-    while (query.next())
-    {
-        imageIDList.append(query.value(0).toString());    // dwc_identifier
-    }
-}
-
 void DataEntry::on_actionHelp_Index_triggered()
 {
     // Open Help window
@@ -3614,95 +3333,7 @@ void DataEntry::on_nextButton_clicked()
     else
     {
         viewedImage++;
-        QString fileName = imageHash.value(itemList.at(viewedImage)->text());
-        if (!fileName.isEmpty()) {
-            scaleFactor = 1;
-            int w = ui->scrollArea->width();
-            int h = ui->scrollArea->height();
-
-            QString fileToRead = fileName;
-            QFileInfo fileInfo(fileToRead);
-            // use the thumbnail if no other image can be found
-            if (!fileInfo.isFile())
-            {
-                // limit dimensions to 300x300 to somewhat reduce pixelation due to upscaling
-                if (w > 300)
-                    w = 300;
-                if (h > 300)
-                    h = 300;
-
-                QPixmap pscaled;
-                pscaled = itemList.at(0)->icon().pixmap(100,100).scaled(w,h,Qt::KeepAspectRatio, Qt::SmoothTransformation);
-                imageLabel->resize(w,h);
-                imageLabel->setPixmap(pscaled);
-                return;
-            }
-
-            QImageReader imageReader(fileToRead);
-            imageReader.setAutoTransform(true);
-            imageReader.setScaledSize(QSize(w,h));
-            QSize fullSize = imageReader.size();
-            int wid;
-            int hei;
-
-            // the width and height reported by QImageReader::size() depend upon image orientation
-            if (imageReader.transformation() & QImageIOHandler::TransformationRotate90)
-            {
-                hei = fullSize.width();
-                wid = fullSize.height();
-            }
-            else
-            {
-                wid = fullSize.width();
-                hei = fullSize.height();
-            }
-
-            int setW;
-            int setH;
-
-            if (w == h && wid == hei)
-            {
-                setH = h;
-                setW = w;
-            }
-            else if (float(wid)/hei > float(w)/h)
-            {
-                setH = (w*hei)/wid;
-                setW = w;
-            }
-            else
-            {
-                setH = h;
-                setW = (h*wid)/hei;
-            }
-
-            imageReader.setScaledSize(QSize(setW,setH));
-
-            if (imageReader.canRead())
-            {
-                QImage img = imageReader.read();
-                QPixmap pscaled;
-                pscaled = pscaled.fromImage(img);
-                imageLabel->resize(setW,setH);
-                imageLabel->setPixmap(pscaled);
-            }
-            else
-            {
-                qDebug() << __LINE__ << "Could not load image from file: " + fileName;
-                // use the thumbnail instead
-                // limit dimensions to 300x300 to somewhat reduce pixelation due to upscaling
-                if (w > 300)
-                    w = 300;
-                if (h > 300)
-                    h = 300;
-
-                QPixmap pscaled;
-                pscaled = itemList.at(0)->icon().pixmap(100,100).scaled(w,h,Qt::KeepAspectRatio, Qt::SmoothTransformation);
-                imageLabel->resize(w,h);
-                imageLabel->setPixmap(pscaled);
-                return;
-            }
-        }
+        showPreview(itemList, viewedImage);
     }
 }
 
@@ -3724,92 +3355,12 @@ void DataEntry::on_previousButton_clicked()
     else
     {
         viewedImage--;
-        QString fileName = imageHash.value(itemList.at(viewedImage)->text());
-        if (!fileName.isEmpty()) {
-            scaleFactor = 1;
-            int w = ui->scrollArea->width();
-            int h = ui->scrollArea->height();
-
-            QString fileToRead = fileName;
-            QFileInfo fileInfo(fileToRead);
-            // use the thumbnail if no other image can be found
-            if (!fileInfo.isFile())
-            {
-                // limit dimensions to 300x300 to somewhat reduce pixelation due to upscaling
-                if (w > 300)
-                    w = 300;
-                if (h > 300)
-                    h = 300;
-
-                QPixmap pscaled;
-                pscaled = itemList.at(0)->icon().pixmap(100,100).scaled(w,h,Qt::KeepAspectRatio, Qt::SmoothTransformation);
-                imageLabel->resize(w,h);
-                imageLabel->setPixmap(pscaled);
-                return;
-            }
-
-            QImageReader imageReader(fileToRead);
-            imageReader.setAutoTransform(true);
-            imageReader.setScaledSize(QSize(w,h));
-            QSize fullSize = imageReader.size();
-            int wid;
-            int hei;
-
-            // the width and height reported by QImageReader::size() depend upon image orientation
-            if (imageReader.transformation() & QImageIOHandler::TransformationRotate90)
-            {
-                hei = fullSize.width();
-                wid = fullSize.height();
-            }
-            else
-            {
-                wid = fullSize.width();
-                hei = fullSize.height();
-            }
-
-            int setW;
-            int setH;
-
-            if (w == h && wid == hei)
-            {
-                setH = h;
-                setW = w;
-            }
-            else if (float(wid)/hei > float(w)/h)
-            {
-                setH = (w*hei)/wid;
-                setW = w;
-            }
-            else
-            {
-                setH = h;
-                setW = (h*wid)/hei;
-            }
-
-            imageReader.setScaledSize(QSize(setW,setH));
-
-            if (imageReader.canRead())
-            {
-                QImage img = imageReader.read();
-                QPixmap pscaled;
-                pscaled = pscaled.fromImage(img);
-                imageLabel->resize(setW,setH);
-                imageLabel->setPixmap(pscaled);
-            }
-            else
-            {
-                qDebug() << __LINE__  << "Could not load image from file: " + fileName;
-                return;
-            }
-        }
+        showPreview(itemList, viewedImage);
     }
 }
 
 void DataEntry::setupCompleters()
 {
-    allGenera.sort(Qt::CaseInsensitive);
-    allCommonNames.sort(Qt::CaseInsensitive);
-    allFamilies.sort(Qt::CaseInsensitive);
     sensus.sort(Qt::CaseInsensitive);
 
     completeSensu = new QCompleter(sensus, this);
@@ -3920,14 +3471,6 @@ void DataEntry::saveInput(const QString &inputField, const QString &inputData)
     QSqlDatabase db = QSqlDatabase::database();
     db.transaction();
 
-    QSqlQuery insertQuery;
-    QSqlQuery uQuery;
-    QSqlQuery nQuery;
-    nQuery.setForwardOnly(true);
-    QSqlQuery dQuery;
-    QSqlQuery oQuery;
-    QSqlQuery updateQuery;
-
     foreach (QListWidgetItem* img, itemList)
     {
         int i = imageIndexHash.value(img->text());
@@ -3938,10 +3481,10 @@ void DataEntry::saveInput(const QString &inputField, const QString &inputData)
         if (inputField == "organismID")
         {
             images[i].depicts = data;
-            insertQuery.prepare("UPDATE images SET foaf_depicts = (?), dcterms_modified = (?) WHERE dcterms_identifier = (?)");
-            insertQuery.addBindValue(data);
-            insertQuery.addBindValue(modifiedNow());
-            insertQuery.addBindValue(images[i].identifier);
+            PreparedQuery insertQuery("UPDATE images SET foaf_depicts = (?), dcterms_modified = (?) WHERE dcterms_identifier = (?)");
+            insertQuery.bind(data);
+            insertQuery.bind(modifiedNow());
+            insertQuery.bind(images[i].identifier);
             insertQuery.exec();
         }
         // the following rely on data stored in Determination/Organism rather than Image
@@ -3959,14 +3502,14 @@ void DataEntry::saveInput(const QString &inputField, const QString &inputData)
             }
 
             if (inputField == "tsnID") {
-                uQuery.prepare("UPDATE determinations SET tsnID = (?), dcterms_modified = (?) WHERE dsw_identified = (?)");
-                uQuery.addBindValue(data);
-                uQuery.addBindValue(modifiedNow());
-                uQuery.addBindValue(images[i].depicts);
+                PreparedQuery uQuery("UPDATE determinations SET tsnID = (?), dcterms_modified = (?) WHERE dsw_identified = (?)");
+                uQuery.bind(data);
+                uQuery.bind(modifiedNow());
+                uQuery.bind(images[i].depicts);
                 uQuery.exec();
 
-                nQuery.prepare("SELECT 1 FROM taxa WHERE dcterms_identifier = (?) LIMIT 1");
-                nQuery.addBindValue(data);
+                PreparedQuery nQuery("SELECT 1 FROM taxa WHERE dcterms_identifier = (?) LIMIT 1");
+                nQuery.bind(data);
                 nQuery.exec();
                 if (nQuery.next())
                 {
@@ -3992,12 +3535,12 @@ void DataEntry::saveInput(const QString &inputField, const QString &inputData)
 
             if (!ui->tsnID->text().isEmpty() && !ui->identifiedBy->text().isEmpty())
             {
-                dQuery.prepare("UPDATE determinations SET " + field + " = (?), dcterms_modified = (?) WHERE dsw_identified = (?) AND identifiedBy = (?) AND tsnID = (?)");
-                dQuery.addBindValue(data);
-                dQuery.addBindValue(modifiedNow());
-                dQuery.addBindValue(images[i].depicts);
-                dQuery.addBindValue(ui->identifiedBy->text());
-                dQuery.addBindValue(ui->tsnID->text());
+                PreparedQuery dQuery("UPDATE determinations SET " + field + " = (?), dcterms_modified = (?) WHERE dsw_identified = (?) AND identifiedBy = (?) AND tsnID = (?)");
+                dQuery.bind(data);
+                dQuery.bind(modifiedNow());
+                dQuery.bind(images[i].depicts);
+                dQuery.bind(ui->identifiedBy->text());
+                dQuery.bind(ui->tsnID->text());
                 dQuery.exec();
             }
         }
@@ -4058,10 +3601,10 @@ void DataEntry::saveInput(const QString &inputField, const QString &inputData)
             {
                 column = "dwc_establishmentMeans";
             }
-            oQuery.prepare("UPDATE organisms SET " + column + " = (?), dcterms_modified = (?) WHERE dcterms_identifier = (?)");
-            oQuery.addBindValue(data);
-            oQuery.addBindValue(modifiedNow());
-            oQuery.addBindValue(images[i].depicts);
+            PreparedQuery oQuery("UPDATE organisms SET " + column + " = (?), dcterms_modified = (?) WHERE dcterms_identifier = (?)");
+            oQuery.bind(data);
+            oQuery.bind(modifiedNow());
+            oQuery.bind(images[i].depicts);
             oQuery.exec();
         }
         else if (inputField == "specimenGroup" || inputField == "specimenPart" || inputField == "specimenView")
@@ -4074,13 +3617,13 @@ void DataEntry::saveInput(const QString &inputField, const QString &inputData)
                 images[i].viewOfSpecimen = data;
 
             // convert these values into #010101 format and save to database
-            QString view = viewToNumbers(images[i].groupOfSpecimen, images[i].portionOfSpecimen, images[i].viewOfSpecimen);
+            QString view = ImageView::encode(images[i].groupOfSpecimen, images[i].portionOfSpecimen, images[i].viewOfSpecimen);
             images[i].imageView = view;
 
-            updateQuery.prepare("UPDATE images SET view = (?), dcterms_modified = (?) WHERE dcterms_identifier = (?)");
-            updateQuery.addBindValue(view);
-            updateQuery.addBindValue(modifiedNow());
-            updateQuery.addBindValue(images[i].identifier);
+            PreparedQuery updateQuery("UPDATE images SET view = (?), dcterms_modified = (?) WHERE dcterms_identifier = (?)");
+            updateQuery.bind(view);
+            updateQuery.bind(modifiedNow());
+            updateQuery.bind(images[i].identifier);
             updateQuery.exec();
         }
         else if (inputField == "imageCoordinates")
@@ -4105,21 +3648,20 @@ void DataEntry::saveInput(const QString &inputField, const QString &inputData)
             images[i].continent = "";
             images[i].locality = "";
 
-            QSqlQuery upImLocQuery;
-            upImLocQuery.prepare("UPDATE images SET dwc_decimalLatitude = (?), dwc_decimalLongitude = (?), "
-                                 "dwc_county = (?), dwc_stateProvince = (?), dwc_countryCode = (?), "
-                                 "dwc_continent = (?), dwc_locality = (?), dcterms_modified = (?) "
-                                 "WHERE dcterms_identifier = (?) and dwc_georeferenceRemarks != (?)");
-            upImLocQuery.addBindValue(lat);
-            upImLocQuery.addBindValue(lon);
-            upImLocQuery.addBindValue("");
-            upImLocQuery.addBindValue("");
-            upImLocQuery.addBindValue("");
-            upImLocQuery.addBindValue("");
-            upImLocQuery.addBindValue("");
-            upImLocQuery.addBindValue(modifiedNow());
-            upImLocQuery.addBindValue(images[i].identifier);
-            upImLocQuery.addBindValue("Location inferred from organism coordinates.");
+            PreparedQuery upImLocQuery("UPDATE images SET dwc_decimalLatitude = (?), dwc_decimalLongitude = (?), "
+                                       "dwc_county = (?), dwc_stateProvince = (?), dwc_countryCode = (?), "
+                                       "dwc_continent = (?), dwc_locality = (?), dcterms_modified = (?) "
+                                       "WHERE dcterms_identifier = (?) and dwc_georeferenceRemarks != (?)");
+            upImLocQuery.bind(lat);
+            upImLocQuery.bind(lon);
+            upImLocQuery.bind("");
+            upImLocQuery.bind("");
+            upImLocQuery.bind("");
+            upImLocQuery.bind("");
+            upImLocQuery.bind("");
+            upImLocQuery.bind(modifiedNow());
+            upImLocQuery.bind(images[i].identifier);
+            upImLocQuery.bind("Location inferred from organism coordinates.");
             upImLocQuery.exec();
         }
         else if (inputField == "dwc_county")
@@ -4141,12 +3683,11 @@ void DataEntry::saveInput(const QString &inputField, const QString &inputData)
 
             images[i].geonamesAdmin = newGeonamesAdmin;
 
-            QSqlQuery updateCounty;
-            updateCounty.prepare("UPDATE images SET dwc_county = (?), geonamesAdmin = (?), dcterms_modified = (?) WHERE dcterms_identifier = (?)");
-            updateCounty.addBindValue(data);
-            updateCounty.addBindValue(newGeonamesAdmin);
-            updateCounty.addBindValue(modifiedNow());
-            updateCounty.addBindValue(images[i].identifier);
+            PreparedQuery updateCounty("UPDATE images SET dwc_county = (?), geonamesAdmin = (?), dcterms_modified = (?) WHERE dcterms_identifier = (?)");
+            updateCounty.bind(data);
+            updateCounty.bind(newGeonamesAdmin);
+            updateCounty.bind(modifiedNow());
+            updateCounty.bind(images[i].identifier);
             updateCounty.exec();
         }
         else if (inputField == "dcterms_dateCopyrighted")
@@ -4160,12 +3701,11 @@ void DataEntry::saveInput(const QString &inputField, const QString &inputData)
                 images[i].copyrightStatement = rights;
             }
 
-            QSqlQuery updateCopyrightYear;
-            updateCopyrightYear.prepare("UPDATE images SET dcterms_dateCopyrighted = (?), dc_rights = (?), dcterms_modified = (?) WHERE dcterms_identifier = (?)");
-            updateCopyrightYear.addBindValue(data);
-            updateCopyrightYear.addBindValue(rights);
-            updateCopyrightYear.addBindValue(modifiedNow());
-            updateCopyrightYear.addBindValue(images[i].identifier);
+            PreparedQuery updateCopyrightYear("UPDATE images SET dcterms_dateCopyrighted = (?), dc_rights = (?), dcterms_modified = (?) WHERE dcterms_identifier = (?)");
+            updateCopyrightYear.bind(data);
+            updateCopyrightYear.bind(rights);
+            updateCopyrightYear.bind(modifiedNow());
+            updateCopyrightYear.bind(images[i].identifier);
             updateCopyrightYear.exec();
         }
         else
@@ -4218,10 +3758,10 @@ void DataEntry::saveInput(const QString &inputField, const QString &inputData)
                 }
             }
             // save data to the Image table
-            updateQuery.prepare("UPDATE images SET " + field + " = (?), dcterms_modified = (?) WHERE dcterms_identifier = (?)");
-            updateQuery.addBindValue(data);
-            updateQuery.addBindValue(modifiedNow());
-            updateQuery.addBindValue(images[i].identifier);
+            PreparedQuery updateQuery("UPDATE images SET " + field + " = (?), dcterms_modified = (?) WHERE dcterms_identifier = (?)");
+            updateQuery.bind(data);
+            updateQuery.bind(modifiedNow());
+            updateQuery.bind(images[i].identifier);
             updateQuery.exec();
 
             if (inputField == "dwc_geodeticDatum")
@@ -4536,31 +4076,10 @@ void DataEntry::refreshSpecimenGroup(const QString &arg1)
 {
     QList<QListWidgetItem*> itemList = ui->thumbWidget->selectedItems();
 
-    if (itemList.count() > 0 && specimenGroups.contains(arg1))
+    if (itemList.count() > 0)
     {
-        QStringList newParts;
-        if (arg1 == "unspecified") {
-            newParts << "unspecified" << "whole organism";
-        }
-        else if (arg1 == "woody angiosperms") {
-            newParts << "unspecified" << "whole tree (or vine)" << "bark" << "twig" << "leaf" << "inflorescence" << "fruit" << "seed";
-        }
-        else if (arg1 == "herbaceous angiosperms") {
-            newParts << "unspecified" << "whole plant" << "stem" << "leaf" << "inflorescence" << "fruit" << "seed";
-        }
-        else if (arg1 == "gymnosperms") {
-            newParts << "unspecified" << "whole tree" << "bark" << "twig" << "leaf" << "cone" << "seed";
-        }
-        else if (arg1 == "ferns") {
-            newParts << "unspecified" << "whole plant";
-        }
-        else if (arg1 == "cacti") {
-            newParts << "unspecified" << "whole plant";
-        }
-        else if (arg1 == "mosses") {
-            newParts << "unspecified" << "whole gametophyte";
-        }
-        else {
+        QStringList newParts = ImageView::parts(arg1);
+        if (newParts.isEmpty()) {
             qDebug() << "A strange value for groupOfSpecimenBox was set: " << arg1;
             return;
         }
@@ -4594,14 +4113,13 @@ void DataEntry::on_groupOfSpecimenBox_currentTextChanged(const QString &arg1)
             if (depicts.isEmpty())
                 continue;
 
-            QSqlQuery qry;
-            qry.prepare("SELECT tsnID FROM determinations WHERE dsw_identified = (?) ORDER BY dwc_dateIdentified DESC LIMIT 1");
-            qry.addBindValue(depicts);
+            PreparedQuery qry("SELECT tsnID FROM determinations WHERE dsw_identified = (?) ORDER BY dwc_dateIdentified DESC LIMIT 1");
+            qry.bind(depicts);
             qry.exec();
 
             if (qry.next())
             {
-                QString tsnID = qry.value(0).toString();
+                QString tsnID = qry.string(0);
                 if (!tsnID.isEmpty())
                 {
                     autosetTitle(tsnID, depicts);
@@ -4623,65 +4141,7 @@ bool DataEntry::refreshSpecimenPart(const QString &arg1)
 
     if (itemList.count() > 0)
     {
-        QStringList newViews;
-        QString group = ui->groupOfSpecimenBox->currentText();
-
-        if (arg1 == "unspecified" || group == "unspecified")
-            newViews <<  "unspecified";
-        else if ((group == "ferns" || group == "cacti") && arg1 == "whole plant")
-            newViews << "unspecified";
-        else if (group == "mosses" && arg1 == "whole gametophyte")
-            newViews << "unspecified";
-        else if (group == "woody angiosperms") {
-            if (arg1 == "whole tree (or vine)")
-                newViews <<  "unspecified" << "general" << "winter" << "view up trunk";
-            else if (arg1 == "bark")
-                newViews <<  "unspecified" << "of a large tree" << "of a medium tree or large branch" << "of a small tree or small branch";
-            else if (arg1 == "twig")
-                newViews <<  "unspecified" << "orientation of petioles" << "winter overall" << "close-up winter leaf scar/bud" << "close-up winter terminal bud";
-            else if (arg1 == "leaf")
-                newViews <<  "unspecified" << "whole upper surface" << "margin of upper + lower surface" << "showing orientation on twig";
-            else if (arg1 == "inflorescence")
-                newViews << "unspecified" << "whole - unspecified" << "whole - female" << "whole - male" << "lateral view of flower" << "frontal view of flower"
-                             << "ventral view of flower + perianth" << "close-up of flower interior";
-            else if (arg1 == "fruit")
-                newViews <<  "unspecified" << "as borne on the plant" << "lateral or general close-up" << "section or open" << "immature";
-            else if (arg1 == "seed")
-                newViews <<  "unspecified" << "general view";
-        }
-        else if (group == "herbaceous angiosperms") {
-            if (arg1 == "whole plant")
-                newViews <<  "unspecified" << "juvenile" << "in flower - general view" << "in fruit";
-            else if (arg1 == "stem")
-                newViews <<  "unspecified" << "showing leaf bases";
-            else if (arg1 == "leaf")
-                newViews <<  "unspecified" << "basal or on lower stem" << "on upper stem" << "margin of upper + lower surface";
-            else if (arg1 == "inflorescence")
-                newViews << "unspecified" << "whole - unspecified" << "whole - female" << "whole - male" << "whole - male" << "lateral view of flower"
-                         << "frontal view of flower" << "ventral view of flower + perianth" << "close-up of flower interior";
-            else if (arg1 == "fruit")
-                newViews <<  "unspecified" << "as borne on the plant" << "lateral or general close-up" << "section or open" << "immature";
-            else if (arg1 == "seed")
-                newViews <<  "unspecified" << "general view";
-        }
-        else if (group == "gymnosperms") {
-            if (arg1 == "whole tree")
-                newViews <<  "unspecified" << "general" << "view up trunk";
-            else if (arg1 == "bark")
-                newViews <<  "unspecified" << "of a large tree" << "of a medium tree or large branch" << "of a small tree or small branch";
-            else if (arg1 == "twig")
-                newViews <<  "unspecified" << "after fallen needles" << "showing attachment of needles";
-            else if (arg1 == "leaf")
-                newViews <<  "unspecified" << "entire needle" << "showing orientation of twig";
-            else if (arg1 == "cone")
-                newViews <<  "unspecified" << "male" << "female - mature open" << "female - closed" << "female - receptive" << "one year-old female";
-            else if (arg1 == "seed")
-                newViews <<  "unspecified" << "general view";
-        }
-        else {
-            qDebug() << "Somehow we set a strange part of a specimen: " << arg1;
-            return false;
-        }
+        QStringList newViews = ImageView::views(ui->groupOfSpecimenBox->currentText(), arg1);
 
         if (!newViews.isEmpty()) {
             ui->viewOfSpecimenBox->clear();
@@ -4689,6 +4149,7 @@ bool DataEntry::refreshSpecimenPart(const QString &arg1)
             ui->viewOfSpecimenBox->setCurrentText("unspecified");
             return true;
         }
+        qDebug() << "Somehow we set a strange part of a specimen: " << arg1;
     }
     return false;
 }
@@ -4715,14 +4176,13 @@ void DataEntry::on_partOfSpecimenBox_currentTextChanged(const QString &arg1)
             if (depicts.isEmpty())
                 continue;
 
-            QSqlQuery qry;
-            qry.prepare("SELECT tsnID FROM determinations WHERE dsw_identified = (?) ORDER BY dwc_dateIdentified DESC LIMIT 1");
-            qry.addBindValue(depicts);
+            PreparedQuery qry("SELECT tsnID FROM determinations WHERE dsw_identified = (?) ORDER BY dwc_dateIdentified DESC LIMIT 1");
+            qry.bind(depicts);
             qry.exec();
 
             if (qry.next())
             {
-                QString tsnID = qry.value(0).toString();
+                QString tsnID = qry.string(0);
                 if (!tsnID.isEmpty())
                 {
                     autosetTitle(tsnID, depicts);
@@ -4776,14 +4236,13 @@ void DataEntry::on_viewOfSpecimenBox_currentTextChanged(const QString &arg1)
             if (depicts.isEmpty())
                 continue;
 
-            QSqlQuery qry;
-            qry.prepare("SELECT tsnID FROM determinations WHERE dsw_identified = (?) ORDER BY dwc_dateIdentified DESC LIMIT 1");
-            qry.addBindValue(depicts);
+            PreparedQuery qry("SELECT tsnID FROM determinations WHERE dsw_identified = (?) ORDER BY dwc_dateIdentified DESC LIMIT 1");
+            qry.bind(depicts);
             qry.exec();
 
             if (qry.next())
             {
-                QString tsnID = qry.value(0).toString();
+                QString tsnID = qry.string(0);
                 if (!tsnID.isEmpty())
                 {
                     autosetTitle(tsnID, depicts);
@@ -4878,29 +4337,13 @@ void DataEntry::on_manualIDOverride_clicked()
     QSqlDatabase db = QSqlDatabase::database();
     db.transaction();
 
+    newOrganism.lastModified = modifiedNow();
+
     QSqlQuery insert;
-    insert.prepare("INSERT INTO organisms (dcterms_identifier, dwc_establishmentMeans, "
-                   "dcterms_modified, dwc_organismRemarks, dwc_collectionCode, dwc_catalogNumber, "
-                   "dwc_georeferenceRemarks, dwc_decimalLatitude, dwc_decimalLongitude, geo_alt, "
-                   "dwc_organismName, dwc_organismScope, cameo, notes, suppress) VALUES "
-                   "(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
-    insert.addBindValue(newOrganismID);
-    insert.addBindValue("uncertain");
-    insert.addBindValue(modifiedNow());
-    insert.addBindValue(newOrganism.organismRemarks);
-    insert.addBindValue(newOrganism.collectionCode);
-    insert.addBindValue(newOrganism.catalogNumber);
-    insert.addBindValue(newOrganism.georeferenceRemarks);
-
-    insert.addBindValue(images[h].decimalLatitude);
-    insert.addBindValue(images[h].decimalLongitude);
-    insert.addBindValue(images[h].altitudeInMeters);
-    insert.addBindValue(newOrganism.organismName);
-    insert.addBindValue("multicellular organism");
-    insert.addBindValue(images[h].identifier);
-    insert.addBindValue(newOrganism.notes);
-    insert.addBindValue(newOrganism.suppress);
+    insert.prepare(TableSchema<Organism>::insert("organisms"));
+    TableSchema<Organism>::bind(insert, newOrganism);
     insert.exec();
+    idAllocator.claim("organisms", newOrganismID);
 
     ui->organismID->setText(newOrganismID);
 
@@ -5040,6 +4483,7 @@ void DataEntry::on_thumbnailFilter_activated(int index)
     // 6 : Only thumbnails with "unspecified" specimen view
     // 7 : Only thumbnails with nominal source of name
     // 8 : Only show cameos (1 image per organism)
+    // 9 : Only thumbnails that look like another image in the collection
 
     for (auto sim : similarImages)
     {
@@ -5224,6 +4668,26 @@ void DataEntry::on_thumbnailFilter_activated(int index)
             }
         }
     }
+    else if (index == 9)
+    {
+        for (int x = 0; x < ui->thumbWidget->count(); x++)
+        {
+            // first make each thumbnail hidden--we don't know its state when this filter was applied
+            ui->thumbWidget->item(x)->setHidden(true);
+
+            int h = imageIndexHash.value(ui->thumbWidget->item(x)->text());
+            if (h == -1)
+            {
+                qDebug() << "Error: hashIndex not found when checking imageIndexHash in thumbnailFilter.";
+                continue;
+            }
+            QString identifier = images[h].identifier;
+            if (!imageHashes.contains(identifier))
+                continue;
+            if (!imageHashes.nearDuplicates(imageHashes.hash(identifier), identifier).isEmpty())
+                ui->thumbWidget->item(x)->setHidden(false);
+        }
+    }
 }
 
 void DataEntry::on_schemeButton_clicked()
@@ -5276,6 +4740,8 @@ void DataEntry::on_schemeButton_clicked()
         schemeNamespace = namespaceText;
         schemeText = prependText;
         schemeNumber = nextNumber;
+        if (!schemeNumber.isEmpty())
+            idAllocator.setMark("org.scheme.number", schemeNumber.toInt());
 
         QSqlDatabase db = QSqlDatabase::database();
         db.transaction();
@@ -5884,245 +5350,6 @@ void DataEntry::adjustScrollBar(QScrollBar *scrollBar, double factor)
     scrollBar->setValue(int(factor * scrollBar->value() + ((factor - 1) * scrollBar->pageStep()/2)));
 }
 
-QString DataEntry::viewToNumbers(const QString &group, const QString &part, const QString &view)
-{
-    QString pt1 = "00";
-    QString pt2 = "00";
-    QString pt3 = "00";
-    if (group == "unspecified")
-    {
-        if (part == "whole organism")
-            pt2 = "01";
-    }
-    else if (group == "woody angiosperms")
-    {
-        pt1 = "01";
-        if (part == "whole tree (or vine)")
-        {
-            pt2 = "01";
-            if (view == "general")
-                pt3 = "01";
-            else if (view == "winter")
-                pt3 = "02";
-            else if (view == "view up trunk")
-                pt3 = "03";
-        }
-        else if (part == "bark")
-        {
-            pt2 = "02";
-            if (view == "of a large tree")
-                pt3 = "01";
-            else if (view == "of a medium tree or large branch")
-                pt3 = "02";
-            else if (view == "of a small tree or small branch")
-                pt3 = "03";
-        }
-        else if (part == "twig")
-        {
-            pt2 = "03";
-            if (view == "orientation of petioles")
-                pt3 = "01";
-            else if (view == "winter overall")
-                pt3 = "02";
-            else if (view == "close-up winter leaf scar/bud")
-                pt3 = "03";
-            else if (view == "close-up winter terminal bud")
-                pt3 = "04";
-        }
-        else if (part == "leaf")
-        {
-            pt2 = "04";
-            if (view == "whole upper surface")
-                pt3 = "01";
-            else if (view == "margin of upper + lower surface")
-                pt3 = "02";
-            else if (view == "showing orientation on twig")
-                pt3 = "03";
-        }
-        else if (part == "inflorescence")
-        {
-            pt2 = "05";
-            if (view == "whole - unspecified")
-                pt3 = "01";
-            else if (view == "whole - female")
-                pt3 = "02";
-            else if (view == "whole - male")
-                pt3 = "03";
-            else if (view == "lateral view of flower")
-                pt3 = "04";
-            else if (view == "frontal view of flower")
-                pt3 = "05";
-            else if (view == "ventral view of flower + perianth")
-                pt3 = "06";
-            else if (view == "close-up of flower interior")
-                pt3 = "07";
-        }
-        else if (part == "fruit")
-        {
-            pt2 = "06";
-            if (view == "as borne on the plant")
-                pt3 = "01";
-            else if (view == "lateral or general close-up")
-                pt3 = "02";
-            else if (view == "section or open")
-                pt3 = "03";
-            else if (view == "immature")
-                pt3 = "04";
-        }
-        else if (part == "seed")
-        {
-            pt2 = "07";
-            if (view == "general view")
-                pt3 = "01";
-        }
-    }
-    else if (group == "herbaceous angiosperms")
-    {
-        pt1 = "02";
-        if (part == "whole plant")
-        {
-            pt2 = "01";
-            if (view == "juvenile")
-                pt3 = "01";
-            else if (view == "in flower - general view")
-                pt3 = "02";
-            else if (view == "in fruit")
-                pt3 = "03";
-        }
-        else if (part == "stem")
-        {
-            pt2 = "02";
-            if (view == "showing leaf bases")
-                pt3 = "01";
-        }
-        else if (part == "leaf")
-        {
-            pt2 = "03";
-            if (view == "basal or on lower stem")
-                pt3 = "01";
-            else if (view == "on upper stem")
-                pt3 = "02";
-            else if (view == "margin of upper + lower surface")
-                pt3 = "03";
-        }
-        else if (part == "inflorescence")
-        {
-            pt2 = "04";
-            if (view == "whole - unspecified")
-                pt3 = "01";
-            else if (view == "whole - female")
-                pt3 = "02";
-            else if (view == "whole - male")
-                pt3 = "03";
-            else if (view == "lateral view of flower")
-                pt3 = "04";
-            else if (view == "frontal view of flower")
-                pt3 = "05";
-            else if (view == "ventral view of flower + perianth")
-                pt3 = "06";
-            else if (view == "close-up of flower interior")
-                pt3 = "07";
-        }
-        else if (part == "fruit")
-        {
-            pt2 = "05";
-            if (view == "as borne on the plant")
-                pt3 = "01";
-            else if (view == "lateral or general close-up")
-                pt3 = "02";
-            else if (view == "section or open")
-                pt3 = "03";
-            else if (view == "immature")
-                pt3 = "04";
-        }
-        else if (part == "seed")
-        {
-            pt2 = "06";
-            if (view == "general view")
-                pt3 = "01";
-        }
-    }
-    else if (group == "gymnosperms")
-    {
-        pt1 = "03";
-        if (part == "whole tree")
-        {
-            pt2 = "01";
-            if (view == "general")
-                pt3 = "01";
-            else if (view == "view up trunk")
-                pt3 = "02";
-        }
-        else if (part == "bark")
-        {
-            pt2 = "02";
-            if (view == "of a large tree")
-                pt3 = "01";
-            else if (view == "of a medium tree or large branch")
-                pt3 = "02";
-            else if (view == "of a small tree or small branch")
-                pt3 = "03";
-        }
-        else if (part == "twig")
-        {
-            pt2 = "03";
-            if (view == "after fallen needles")
-                pt3 = "01";
-            else if (view == "showing attachment of needles")
-                pt3 = "02";
-        }
-        else if (part == "leaf")
-        {
-            pt2 = "04";
-            if (view == "entire needle")
-                pt3 = "01";
-            else if (view == "showing orientation on twig")
-                pt3 = "02";
-        }
-        else if (part == "cone")
-        {
-            pt2 = "05";
-            if (view == "male")
-                pt3 = "01";
-            else if (view == "female - mature open")
-                pt3 = "02";
-            else if (view == "female - closed")
-                pt3 = "03";
-            else if (view == "female - receptive")
-                pt3 = "04";
-            else if (view == "one year-old female")
-                pt3 = "05";
-        }
-        else if (part == "seed")
-        {
-            pt2 = "06";
-            if (view == "general view")
-                pt3 = "01";
-        }
-    }
-    else if (group == "ferns")
-    {
-        pt1 = "04";
-        if (part == "whole plant")
-            pt2 = "01";
-    }
-    else if (group == "cacti")
-    {
-        pt1 = "05";
-        if (part == "whole plant")
-            pt2 = "01";
-    }
-    else if (group == "mosses")
-    {
-        pt1 = "06";
-        if (part == "whole gametophyte")
-            pt2 = "01";
-    }
-
-    QString imageView = "#" + pt1 + pt2 + pt3;
-    return imageView;
-}
-
 QString DataEntry::singleResult(const QString result, const QString table, const QString field, const QString value)
 {
     QSqlQuery query;
@@ -6136,256 +5363,6 @@ QString DataEntry::singleResult(const QString result, const QString table, const
         return "";
 }
 
-QStringList DataEntry::numbersToView(const QString &numbers)
-{
-    // Convert imageview #010203 format to group/part/view QStrings
-    QString group = "unspecified";
-    QString part = "unspecified";
-    QString view = "unspecified";
-    QString imageView = numbers;
-    imageView.remove("#");
-    // make sure imageView is 6 digits long before splitting
-    if (imageView.length() == 6)
-    {
-        QString pt1 = QString(imageView.at(0)) + QString(imageView.at(1));
-        QString pt2 = QString(imageView.at(2)) + QString(imageView.at(3));
-        QString pt3 = QString(imageView.at(4)) + QString(imageView.at(5));
-
-        if (pt1 == "00" && pt2 == "01")
-            part = "whole organism";
-        else if (pt1 == "01")
-        {
-            group = "woody angiosperms";
-            if (pt2 == "01")
-            {
-                part = "whole tree (or vine)";
-                if (pt3 == "01")
-                    view = "general";
-                else if (pt3 == "02")
-                    view = "winter";
-                else if (pt3 == "03")
-                    view = "view up trunk";
-            }
-            else if (pt2 == "02")
-            {
-                part = "bark";
-                if (pt3 == "01")
-                    view = "of a large tree";
-                else if (pt3 == "02")
-                    view  = "of a medium tree or large branch";
-                else if (pt3 == "03")
-                    view = "of a small tree or small branch";
-            }
-            else if (pt2 == "03")
-            {
-                part = "twig";
-                if (pt3 == "01")
-                    view = "orientation of petioles";
-                else if (pt3 == "02")
-                    view = "winter overall";
-                else if (pt3 == "03")
-                    view = "close-up winter leaf scar/bud";
-                else if (pt3 == "04")
-                    view = "close-up winter terminal bud";
-            }
-            else if (pt2 == "04")
-            {
-                part = "leaf";
-                if (pt3 == "01")
-                    view = "whole upper surface";
-                else if (pt3 == "02")
-                    view = "margin of upper + lower surface";
-                else if (pt3 == "03")
-                    view = "showing orientation on twig";
-            }
-            else if (pt2 == "05")
-            {
-                part = "inflorescence";
-                if (pt3 == "01")
-                    view = "whole - unspecified";
-                else if (pt3 == "02")
-                    view = "whole - female";
-                else if (pt3 == "03")
-                    view = "whole - male";
-                else if (pt3 == "04")
-                    view = "lateral view of flower";
-                else if (pt3 == "05")
-                    view = "frontal view of flower";
-                else if (pt3 == "06")
-                    view = "ventral view of flower + perianth";
-                else if (pt3 == "07")
-                    view = "close-up of flower interior";
-            }
-            else if (pt2 == "06")
-            {
-                part = "fruit";
-                if (pt3 == "01")
-                    view = "as borne on the plant";
-                else if (pt3 == "02")
-                    view = "lateral or general close-up";
-                else if (pt3 == "03")
-                    view = "section or open";
-                else if (pt3 == "04")
-                    view = "immature";
-            }
-            else if (pt2 == "07")
-            {
-                part = "seed";
-                if (pt3 == "01")
-                    view = "general view";
-            }
-        }
-        else if (pt1 == "02")
-        {
-            group = "herbaceous angiosperms";
-            if (pt2 == "01")
-            {
-                part = "whole plant";
-                if (pt3 == "01")
-                    view = "juvenile";
-                else if (pt3 == "02")
-                    view = "in flower - general view";
-                else if (pt3 == "03")
-                    view = "in fruit";
-            }
-            else if (pt2 == "02")
-            {
-                part = "stem";
-                if (pt3 == "01")
-                    view = "showing leaf bases";
-            }
-            else if (pt2 == "03")
-            {
-                part = "leaf";
-                if (pt3 == "01")
-                    view = "basal or on lower stem";
-                else if (pt3 == "02")
-                    view = "on upper stem";
-                else if (pt3 == "03")
-                    view = "margin of upper + lower surface";
-            }
-            else if (pt2 == "04")
-            {
-                part = "inflorescence";
-                if (pt3 == "01")
-                    view = "whole - unspecified";
-                else if (pt3 == "02")
-                    view = "whole - female";
-                else if (pt3 == "03")
-                    view = "whole - male";
-                else if (pt3 == "04")
-                    view = "lateral view of flower";
-                else if (pt3 == "05")
-                    view = "frontal view of flower";
-                else if (pt3 == "06")
-                    view = "ventral view of flower + perianth";
-                else if (pt3 == "07")
-                    view = "close-up of flower interior";
-            }
-            else if (pt2 == "05")
-            {
-                part = "fruit";
-                if (pt3 == "01")
-                    view = "as borne on the plant";
-                else if (pt3 == "02")
-                    view = "lateral or general close-up";
-                else if (pt3 == "03")
-                    view = "section or open";
-                else if (pt3 == "04")
-                    view = "immature";
-            }
-            else if (pt2 == "06")
-            {
-                part = "seed";
-                if (pt3 == "01")
-                    view = "general view";
-            }
-        }
-        else if (pt1 == "03")
-        {
-            group = "gymnosperms";
-            if (pt2 == "01")
-            {
-                part = "whole tree";
-                if (pt3 == "01")
-                    view = "general";
-                else if (pt3 == "02")
-                    view = "view up trunk";
-            }
-            else if (pt2 == "02")
-            {
-                part = "bark";
-                if (pt3 == "01")
-                    view = "of a large tree";
-                else if (pt3 == "02")
-                    view = "of a medium tree or large branch";
-                else if (pt3 == "03")
-                    view = "of a small tree or small branch";
-            }
-            else if (pt2 == "03")
-            {
-                part = "twig";
-                if (pt3 == "01")
-                    view = "after fallen needles";
-                else if (pt3 == "02")
-                    view = "showing attachment of needles";
-            }
-            else if (pt2 == "04")
-            {
-                part = "leaf";
-                if (pt3 == "01")
-                    view = "entire needle";
-                else if (pt3 == "02")
-                    view = "showing orientation on twig";
-            }
-            else if (pt2 == "05")
-            {
-                part = "cone";
-                if (pt3 == "01")
-                    view = "male";
-                else if (pt3 == "02")
-                    view = "female - mature open";
-                else if (pt3 == "03")
-                    view = "female - closed";
-                else if (pt3 == "04")
-                    view = "female - receptive";
-                else if (pt3 == "05")
-                    view = "one year-old female";
-            }
-            else if (pt2 == "06")
-            {
-                part = "seed";
-                if (pt3 == "01")
-                    view = "general view";
-            }
-        }
-        else if (pt1 == "04")
-        {
-            group = "ferns";
-            if (pt2 == "01")
-                part = "whole plant";
-        }
-        else if (pt1 == "05")
-        {
-            group = "cacti";
-            if (pt2 == "01")
-                part = "whole plant";
-        }
-        else if (pt1 == "06")
-        {
-            group = "mosses";
-            if (pt2 == "01")
-                part = "whole gametophyte";
-        }
-    }
-
-    QStringList groupPartView;
-    groupPartView.append(group);
-    groupPartView.append(part);
-    groupPartView.append(view);
-    return groupPartView;
-}
-
 void DataEntry::on_newDeterminationButton_clicked()
 {
     if (ui->organismID->text().isEmpty())
@@ -6405,7 +5382,7 @@ void DataEntry::on_newDeterminationButton_clicked()
         msgBox.exec();
         return;
     }
-    NewDeterminationDialog determinationDialog(ui->organismID->text(), allGenera, allCommonNames, allFamilies, agents, sensus, this);
+    NewDeterminationDialog determinationDialog(ui->organismID->text(), taxonIndex.data(), agents, sensus, this);
     int dialogResult = determinationDialog.exec();
 
     if (determinationDialog.newSensu())
@@ -6448,19 +5425,11 @@ void DataEntry::on_newDeterminationButton_clicked()
     nameAccordingTo.remove(")");
     if (nameAccordingTo.isEmpty())
         nameAccordingTo = "nominal";
+    d.nameAccordingToID = nameAccordingTo;
 
     QSqlQuery query;
-    query.prepare("INSERT INTO determinations (dsw_identified, identifiedBy, dwc_dateIdentified, "
-                  "dwc_identificationRemarks, tsnID, nameAccordingToID, dcterms_modified, suppress) "
-                  "VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
-    query.addBindValue(d.identified);
-    query.addBindValue(d.identifiedBy);
-    query.addBindValue(d.dateIdentified);
-    query.addBindValue(d.identificationRemarks);
-    query.addBindValue(d.tsnID);
-    query.addBindValue(nameAccordingTo);
-    query.addBindValue(d.lastModified);
-    query.addBindValue(d.suppress);
+    query.prepare(TableSchema<Determination>::insert("determinations"));
+    TableSchema<Determination>::bind(query, d);
     if (!query.exec()) {
         QMessageBox::critical(0, "", "Determination insertion failed: " + query.lastError().text());
         return;
@@ -6506,7 +5475,7 @@ void DataEntry::autosetTitle(QString tsnID, QString organismID)
 
     while (imageQuery.next())
     {
-        QStringList groupPartView = numbersToView(imageQuery.value(1).toString());
+        QStringList groupPartView = ImageView::decode(imageQuery.value(1).toString());
         if (groupPartView.size() == 3)
         {
             QString group = groupPartView.at(0);
@@ -6963,17 +5932,8 @@ void DataEntry::on_actionNew_sensu_triggered()
     db.transaction();
 
     QSqlQuery query;
-    query.prepare("INSERT INTO sensu (dcterms_identifier, dc_creator, tcsSignature, "
-                  "dcterms_title, dc_publisher, dcterms_created, iri, dcterms_modified) "
-                  "VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
-    query.addBindValue(s.identifier);
-    query.addBindValue(s.creator);
-    query.addBindValue(s.tcsSignature);
-    query.addBindValue(s.title);
-    query.addBindValue(s.publisher);
-    query.addBindValue(s.dcterms_created);
-    query.addBindValue(s.iri);
-    query.addBindValue(s.lastModified);
+    query.prepare(TableSchema<Sensu>::insert("sensu"));
+    TableSchema<Sensu>::bind(query, s);
     if (!query.exec()) {
         QMessageBox::critical(0, "", "New Source of Name insertion failed: " + query.lastError().text());
         return;
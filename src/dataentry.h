@@ -43,11 +43,37 @@
 #include "organism.h"
 #include "sensu.h"
 #include "help.h"
+#include "previewloader.h"
+#include "taxonindex.h"
+#include "offlinegeocoder.h"
+#include "geocodecache.h"
+#include "geocodescheduler.h"
+#include "tiledimagelabel.h"
+#include "idallocator.h"
+#include "hotfolderwatcher.h"
+#include "imagehashes.h"
 
 namespace Ui {
 class DataEntry;
 }
 
+// what iconify() needs to know about one image, copied on the GUI thread so
+// the worker doesn't read images or its hashes while new images are added
+struct ThumbnailSource
+{
+    QString file;
+    QString base;
+    QString identifier;
+};
+
+// what iconify() hands back to the GUI thread, which makes the icons and items
+struct Thumbnails
+{
+    QStringList bases;
+    QList<QImage> images;              // one per base; null where the default image is shown
+    QHash<QString, quint64> hashes;    // dHash of each image that wasn't hashed yet
+};
+
 class DataEntry : public QMainWindow
 {
     Q_OBJECT
@@ -55,11 +81,14 @@ class DataEntry : public QMainWindow
 public:
     explicit DataEntry(const QStringList &fileNames, const QHash<QString,QString> &incNameSpaceHash,
                        const QHash<QString, QString> &photogHash, const QHash<QString, int> &trailingHash,
-                       const QHash<QString, QString> &incAgentHash, QWidget *parent = 0);
+                       const QHash<QString, QString> &incAgentHash, const QHash<QString, QString> &contentHashes,
+                       QWidget *parent = 0);
     explicit DataEntry(const QStringList &fileNames, const QHash<QString, QString> &photogHash,
                        const QHash<QString,QString> &incAgentHash, const QList<Image> &ims, QWidget *parent = 0);
     ~DataEntry();
 
+    void watchFolder(const QString &folder, const QString &nameSpace, const QString &photographer, int trailingChars);
+
 signals:
    void windowClosed();
    void iconifyDone();
@@ -79,7 +108,7 @@ private slots:
     void on_zoomOut_clicked();
 
     void on_reverseGeocodeButton_clicked();
-    void httpFinished();
+    void reverseGeocodeFinished(const QList<GeocodeResponse> &responses);
 
     void on_generateNewOrganismIDButton_clicked();
     void on_image_county_box_textEdited(const QString &arg1);
@@ -158,6 +187,10 @@ private slots:
     void on_actionNew_sensu_triggered();
 
     void on_iconifyDone();
+    void thumbnailsFinished();
+    void hotFolderImagesReady(const QStringList &fileNames, const QString &exifOutput, const QHash<QString, QString> &contentHashes);
+    void hotFolderImagesRejected(const QStringList &fileNames, const QString &reason);
+    void displayPreview(const QString &fileName, const QImage &image);
     void showContextMenu(const QPoint &pos);
     void deleteThumbnail();
 
@@ -174,7 +207,6 @@ private:
     int currentDetermination;
     void loadSensu();
     QHash<QString,QString> sensuHash;
-    QMap<QString,QString> usdaNames; // map of <tsnID, "comma-separated scientific names">
     QProgressDialog *progress;
     int progressLength;
     int currentProgress;
@@ -183,14 +215,7 @@ private:
 
     void setupDataEntry();
     void setupCompleters();
-    QStringList allGenera;
-    QCompleter *completeGenera;
-    QStringList allSpecies;
-    QCompleter *completeSpecies;
-    QStringList allCommonNames;
-    QCompleter *completeCommonNames;
-    QStringList allFamilies;
-    QCompleter *completeFamilyNames;
+    QSharedPointer<const TaxonIndex> taxonIndex;
     QStringList sensus;
     QCompleter *completeSensu;
     void setTaxaFromTSN(const QString &tsnID);
@@ -207,24 +232,22 @@ private:
     QHash<QString, QString> nameSpaceHash;
     QHash<QString, QString> photographerHash;
     QHash<QString, int> trailingCharsHash;
+    QHash<QString, QString> contentHashHash;
     QList<Image> images;
 
     QString appDir;
     bool fromEditExisting;
 
-    void loadImageIDs();
-    QStringList imageIDList;
+    IdAllocator idAllocator;
     QStringList organismIDList;
-    int lastOrgNum;
     QString agent;
     QHash<QString,QString> agentHash;
     QString schemeNamespace;
     QString schemeText;
     QString schemeNumber;
 
-    QStringList specimenGroups;// { "unspecified", "woody angiosperms", "herbaceous angiosperms",
-                               //  "gymnosperms", "ferns", "cacti", "mosses" };
     void runExifTool();
+    void storeExifRows(const QStringList &rowsExifOutput);
     QList<QString> imageFileNames;
     int imageFileNamesSize;
     QProcess ps;
@@ -234,7 +257,21 @@ private:
 
     QList<QLineEdit*> lineEditNames;
     void generateThumbnails();
+    void generateThumbnails(const QStringList &files);
+    QFutureWatcher<Thumbnails> iconifyWatcher;
+    ImageHashes imageHashes;
+    void storeImageHashes(const QHash<QString, quint64> &newHashes);
+    QStringList pendingThumbnails;
+    QPointer<HotFolderWatcher> hotFolder;
+    QString hotFolderNamespace;
+    QString hotFolderPhotographer;
+    int hotFolderTrailingChars;
     void refreshImageLabel();
+    void showPreview(const QList<QListWidgetItem*> &itemList, int index);
+    void showThumbnailPreview(const QString &base);
+    PreviewLoader *previewLoader;
+    QString displayedPreview;
+    static const int previewPrefetchCount = 2;
     void refreshInputFields();
     void clearInputFields();
     void clearToolTips();
@@ -243,13 +280,13 @@ private:
     int viewedImage;
 
     QString baseReverseGeocodeURL;
-    void startRequest(QUrl url);
-    void reverseGeocodeQueue();
-    QList<QString> revgeoURLList;
-    QHash<QString,int> revgeoHash;
-    QUrl url;
-    QNetworkAccessManager qnam;
-    QNetworkReply *reply;
+    bool parseReverseGeocode(const QByteArray &body, GeocodeResult &location, bool &hasGeonamesAdmin);
+    void applyLocation(int h, const GeocodeResult &location);
+    void saveImageLocation(int h);
+    QSharedPointer<const OfflineGeocoder> offlineGeocoder;
+    GeocodeCache geocodeCache;
+    GeocodeScheduler *geocodeScheduler;
+    QHash<QString,int> revgeoHash;   // coordinateKey -> images index, for each image waiting on the web service
 
     QHash<QString,QString> stateTwoLetter;
     QHash<QString,QString> countyGeonameID;
@@ -258,19 +295,17 @@ private:
     bool refreshSpecimenPart(const QString &arg1);
     bool refreshSpecimenView(const QString &arg1);
     void averageLocations(const QString &orgID);
-    void iconify(const QStringList &imageFileNames);
+    static Thumbnails iconify(const QList<ThumbnailSource> &sources, const QSet<QString> &hashed);
 
     QString modifiedNow();
 
     void scaleImage(double factor);
     void adjustScrollBar(QScrollBar *scrollBar, double factor);
     double scaleFactor;
-    QLabel *imageLabel;
-    QString viewToNumbers(const QString &group, const QString &part, const QString &view);
+    TiledImageLabel *imageLabel;
     bool pauseSavingView;
 
     QString singleResult(const QString result, const QString table, const QString field, const QString value);
-    QStringList numbersToView(const QString &numbers);
     void removeUnlinkedOrganisms();
     void autosetTitle(QString tsnID, QString organismID);
 
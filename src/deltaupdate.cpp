@@ -0,0 +1,322 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <QCryptographicHash>
+#include <QSqlDatabase>
+#include <QSqlError>
+
+#include "deltaupdate.h"
+
+static const QChar keySeparator(0x1f);
+
+DeltaUpdate::DeltaUpdate(const QString &databaseVersion) :
+    databaseVersion(databaseVersion)
+{
+}
+
+QStringList DeltaUpdate::tables()
+{
+    QStringList list;
+    list << "agents" << "determinations" << "images" << "organisms" << "sensu" << "taxa";
+    return list;
+}
+
+QStringList DeltaUpdate::keyColumns(const QString &table)
+{
+    QStringList keys;
+    if (table == "determinations")
+        keys << "dsw_identified" << "dwc_dateIdentified" << "tsnID" << "nameAccordingToID";
+    else
+        keys << "dcterms_identifier";
+    return keys;
+}
+
+bool DeltaUpdate::hasSnapshot() const
+{
+    QStringList dbTables = QSqlDatabase::database().tables();
+    bool hasRows = false;
+    for (auto t : tables())
+    {
+        if (!dbTables.contains("pub_" + t))
+            return false;
+
+        QSqlQuery qry;
+        qry.exec("SELECT 1 FROM pub_" + t + " LIMIT 1");
+        if (qry.next())
+            hasRows = true;
+    }
+    return hasRows;
+}
+
+QByteArray DeltaUpdate::rowHash(const QSqlRecord &record, int firstColumn)
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    for (int i = firstColumn; i < record.count(); i++)
+    {
+        QVariant value = record.value(i);
+        if (value.isNull())
+            hash.addData("\x1e", 1);
+        else
+            hash.addData(value.toString().toUtf8());
+        hash.addData("\x1f", 1);
+    }
+    return hash.result();
+}
+
+QString DeltaUpdate::rowKey(const QSqlRecord &record, const QStringList &keyColumns)
+{
+    QStringList values;
+    for (auto column : keyColumns)
+        values << record.value(column).toString();
+    return values.join(keySeparator);
+}
+
+QString DeltaUpdate::keyCondition(const QStringList &keyColumns)
+{
+    QStringList conditions;
+    for (auto column : keyColumns)
+        conditions << column + " = (?)";
+    return conditions.join(" AND ");
+}
+
+QHash<QString, DeltaUpdate::Row> DeltaUpdate::hashRows(const QString &table, const QStringList &keyColumns) const
+{
+    QHash<QString, Row> rows;
+    QSqlQuery qry;
+    qry.setForwardOnly(true);
+    qry.exec("SELECT rowid, * FROM " + table);
+    while (qry.next())
+    {
+        QSqlRecord record = qry.record();
+        Row row;
+        row.hash = rowHash(record, 1);
+        row.rowid = record.value(0).toLongLong();
+        rows.insert(rowKey(record, keyColumns), row);
+    }
+    return rows;
+}
+
+bool DeltaUpdate::localRow(QSqlQuery &qry, const QString &key, QByteArray &hash, QString &modified)
+{
+    for (auto value : key.split(keySeparator))
+        qry.addBindValue(value);
+    qry.exec();
+    if (!qry.next())
+        return false;
+
+    QSqlRecord record = qry.record();
+    hash = rowHash(record, 0);
+    modified = record.value("dcterms_modified").toString();
+    return true;
+}
+
+void DeltaUpdate::compute()
+{
+    deltas.clear();
+    for (auto t : tables())
+    {
+        computeTable(t);
+        QCoreApplication::processEvents();
+    }
+}
+
+void DeltaUpdate::computeTable(const QString &table)
+{
+    TableDelta delta;
+    delta.table = table;
+    delta.keyColumns = keyColumns(table);
+    delta.inserted = 0;
+    delta.updated = 0;
+    delta.deleted = 0;
+
+    QHash<QString, Row> published = hashRows("pub_" + table, delta.keyColumns);
+    QHash<QString, Row> release = hashRows("tmp_" + table, delta.keyColumns);
+
+    QSqlQuery localQry;
+    localQry.prepare("SELECT * FROM " + table + " WHERE " + keyCondition(delta.keyColumns) + " LIMIT 1");
+
+    // inserted and updated rows
+    for (auto it = release.constBegin(); it != release.constEnd(); ++it)
+    {
+        auto old = published.constFind(it.key());
+        bool isNew = old == published.constEnd();
+        if (!isNew && old->hash == it->hash)
+            continue;
+
+        if (isNew)
+            delta.inserted++;
+        else
+            delta.updated++;
+
+        // a conflict is a local edit since the last release that matches neither release
+        QByteArray localHash;
+        QString localModified;
+        bool conflict = false;
+        if (localRow(localQry, it.key(), localHash, localModified))
+        {
+            conflict = localModified > databaseVersion && localHash != it->hash &&
+                    (isNew || localHash != old->hash);
+        }
+
+        if (conflict)
+        {
+            delta.conflicts.append(it->rowid);
+            continue;
+        }
+        delta.upserts.append(it->rowid);
+        if (!isNew)
+            delta.replacedPub.append(old->rowid);
+    }
+
+    // deleted rows
+    for (auto it = published.constBegin(); it != published.constEnd(); ++it)
+    {
+        if (release.contains(it.key()))
+            continue;
+
+        delta.deleted++;
+        delta.replacedPub.append(it->rowid);
+
+        // the local taxa table holds more names than are published, so never remove them
+        if (table == "taxa")
+            continue;
+
+        QByteArray localHash;
+        QString localModified;
+        if (!localRow(localQry, it.key(), localHash, localModified))
+            continue;
+        if (localModified > databaseVersion && localHash != it->hash)
+            continue;
+        delta.deletes.append(it.key());
+    }
+
+    qDebug() << table + ": " << delta.inserted << "inserted," << delta.updated << "updated," <<
+                delta.deleted << "deleted," << delta.conflicts.size() << "conflicting";
+    deltas.append(delta);
+}
+
+bool DeltaUpdate::apply(const QString &modified)
+{
+    QSqlDatabase db = QSqlDatabase::database();
+    db.transaction();
+    bool ok = true;
+
+    // keep local edits newer than the release being applied, as a full merge does
+    for (auto t : tables())
+    {
+        QSqlQuery updateModified;
+        updateModified.prepare("UPDATE " + t + " SET dcterms_modified = (?) WHERE dcterms_modified > (?)");
+        updateModified.addBindValue(modified);
+        updateModified.addBindValue(databaseVersion);
+        ok = ok && updateModified.exec();
+    }
+
+    for (auto delta : deltas)
+    {
+        QString t = delta.table;
+
+        QSqlQuery pubDeleteQry;
+        pubDeleteQry.prepare("DELETE FROM pub_" + t + " WHERE rowid = (?)");
+        for (auto rowid : delta.replacedPub)
+        {
+            pubDeleteQry.addBindValue(rowid);
+            ok = ok && pubDeleteQry.exec();
+        }
+
+        QSqlQuery upsertQry;
+        upsertQry.prepare("INSERT OR REPLACE INTO " + t + " SELECT * FROM tmp_" + t + " WHERE rowid = (?)");
+        QSqlQuery pubInsertQry;
+        pubInsertQry.prepare("INSERT INTO pub_" + t + " SELECT * FROM tmp_" + t + " WHERE rowid = (?)");
+        for (auto rowid : delta.upserts)
+        {
+            upsertQry.addBindValue(rowid);
+            ok = ok && upsertQry.exec();
+            pubInsertQry.addBindValue(rowid);
+            ok = ok && pubInsertQry.exec();
+        }
+
+        QSqlQuery deleteQry;
+        deleteQry.prepare("DELETE FROM " + t + " WHERE " + keyCondition(delta.keyColumns));
+        for (auto key : delta.deletes)
+        {
+            for (auto value : key.split(keySeparator))
+                deleteQry.addBindValue(value);
+            ok = ok && deleteQry.exec();
+        }
+
+        // leave only the conflicting rows for MergeTables
+        QStringList conflictRows;
+        for (auto rowid : delta.conflicts)
+            conflictRows << QString::number(rowid);
+        QSqlQuery trimQry;
+        if (conflictRows.isEmpty())
+            ok = ok && trimQry.exec("DELETE FROM tmp_" + t);
+        else
+            ok = ok && trimQry.exec("DELETE FROM tmp_" + t + " WHERE rowid NOT IN (" + conflictRows.join(",") + ")");
+
+        if (!ok)
+        {
+            qDebug() << __LINE__ << "Problem applying changes to " + t;
+            break;
+        }
+    }
+
+    if (!ok || !db.commit())
+    {
+        qDebug() << __LINE__ << "Problem with database transaction: " << db.lastError();
+        db.rollback();
+        return false;
+    }
+    return true;
+}
+
+int DeltaUpdate::conflictCount() const
+{
+    int count = 0;
+    for (auto delta : deltas)
+        count += delta.conflicts.size();
+    return count;
+}
+
+void DeltaUpdate::recordPublished()
+{
+    // replace the pub_ rows for everything currently in the tmp_ tables
+    QSqlDatabase db = QSqlDatabase::database();
+    db.transaction();
+    for (auto t : tables())
+    {
+        QStringList conditions;
+        for (auto column : keyColumns(t))
+            conditions << "tmp_" + t + "." + column + " = pub_" + t + "." + column;
+
+        QSqlQuery deleteQry;
+        deleteQry.exec("DELETE FROM pub_" + t + " WHERE EXISTS (SELECT 1 FROM tmp_" + t + " WHERE " +
+                       conditions.join(" AND ") + ")");
+        QSqlQuery copyQry;
+        copyQry.exec("INSERT INTO pub_" + t + " SELECT * FROM tmp_" + t);
+    }
+    if (!db.commit())
+    {
+        qDebug() << __LINE__ << "Problem with database transaction";
+        db.rollback();
+    }
+}
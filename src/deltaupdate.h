@@ -0,0 +1,85 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DELTAUPDATE_H
+#define DELTAUPDATE_H
+
+#include <QtCore>
+#include <QSqlQuery>
+#include <QSqlRecord>
+
+// Applies a published metadata release as a set of row changes instead of
+// reloading every table. The pub_ tables hold the release that was applied
+// last; the new release is loaded into the tmp_ tables. Rows are keyed by
+// their primary key and compared by a hash of all their columns, which gives
+// the inserted, updated and deleted rows of each table.
+//
+// A change is applied directly unless the local row was edited since the last
+// release (dcterms_modified newer than metadata.version) and differs from
+// both releases. Only those conflicting rows are left in the tmp_ tables, so
+// MergeTables (in delta mode) prompts for real conflicts and nothing else.
+class DeltaUpdate
+{
+public:
+    explicit DeltaUpdate(const QString &databaseVersion);
+
+    bool hasSnapshot() const;
+    void compute();
+    bool apply(const QString &modified);
+    int conflictCount() const;
+
+    static void recordPublished();
+
+private:
+    struct Row
+    {
+        QByteArray hash;
+        qint64 rowid;
+    };
+
+    struct TableDelta
+    {
+        QString table;
+        QStringList keyColumns;
+        QList<qint64> upserts;         // tmp_ rowids to copy into the table and pub_
+        QList<qint64> replacedPub;     // pub_ rowids superseded by upserts or deletions
+        QStringList deletes;           // keys to remove from the table
+        QList<qint64> conflicts;       // tmp_ rowids left for MergeTables
+        int inserted;
+        int updated;
+        int deleted;
+    };
+
+    static QStringList tables();
+    static QStringList keyColumns(const QString &table);
+    static QByteArray rowHash(const QSqlRecord &record, int firstColumn);
+    static QString rowKey(const QSqlRecord &record, const QStringList &keyColumns);
+    static QString keyCondition(const QStringList &keyColumns);
+    static bool localRow(QSqlQuery &qry, const QString &key, QByteArray &hash, QString &modified);
+    QHash<QString, Row> hashRows(const QString &table, const QStringList &keyColumns) const;
+    void computeTable(const QString &table);
+
+    QString databaseVersion;
+    QList<TableDelta> deltas;
+};
+
+#endif // DELTAUPDATE_H
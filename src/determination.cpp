@@ -22,6 +22,8 @@
 
 #include "determination.h"
 
+constexpr SchemaColumn<Determination> RowSchema<Determination>::columns[];
+
 Determination::Determination()
 {
     identified = "";
@@ -25,6 +25,8 @@
 
 #include <QtCore>
 
+#include "tableschema.h"
+
 class Determination
 {
 public:
@@ -42,4 +44,20 @@ public:
 
 };
 
+// the columns of the determination table, in table order
+template <>
+struct RowSchema<Determination>
+{
+    static constexpr SchemaColumn<Determination> columns[] = {
+        { "dsw_identified",            &Determination::identified },
+        { "identifiedBy",              &Determination::identifiedBy },
+        { "dwc_dateIdentified",        &Determination::dateIdentified },
+        { "dwc_identificationRemarks", &Determination::identificationRemarks },
+        { "tsnID",                     &Determination::tsnID },
+        { "nameAccordingToID",         &Determination::nameAccordingToID },
+        { "dcterms_modified",          &Determination::lastModified },
+        { "suppress",                  &Determination::suppress }
+    };
+};
+
 #endif // DETERMINATION_H
@@ -0,0 +1,151 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtConcurrent>
+
+#include "directoryindex.h"
+
+namespace
+{
+    const quint32 cacheFormatVersion = 1;
+
+    // lists one folder, or keeps the cached listing if the folder hasn't changed since
+    struct FolderLister
+    {
+        typedef QPair<QString, DirectoryIndex::Listing> result_type;
+
+        FolderLister(const QHash<QString, DirectoryIndex::Listing> &cached) : cached(cached) {}
+
+        result_type operator()(const QString &folder) const
+        {
+            DirectoryIndex::Listing listing;
+            QFileInfo folderInfo(folder);
+            listing.modified = folderInfo.isDir() ? folderInfo.lastModified().toMSecsSinceEpoch() : -1;
+
+            auto it = cached.constFind(folder);
+            if (it != cached.constEnd() && it.value().modified == listing.modified)
+                return qMakePair(folder, it.value());
+
+            // the time is read before listing, so a change during the listing shows up next time
+            for (auto name : QDir(folder).entryList(QDir::Files))
+                listing.names.insert(name);
+            return qMakePair(folder, listing);
+        }
+
+        const QHash<QString, DirectoryIndex::Listing> &cached;
+    };
+}
+
+QDataStream &operator<<(QDataStream &out, const DirectoryIndex::Listing &listing)
+{
+    return out << listing.modified << listing.names;
+}
+
+QDataStream &operator>>(QDataStream &in, DirectoryIndex::Listing &listing)
+{
+    return in >> listing.modified >> listing.names;
+}
+
+DirectoryIndex::DirectoryIndex(const QString &cachePath)
+{
+    this->cachePath = cachePath;
+    changed = false;
+    load();
+}
+
+QString DirectoryIndex::key(const QString &name)
+{
+    // match the file system's own case rules
+#if defined(Q_OS_WIN) || defined(Q_OS_MAC)
+    return name.toLower();
+#else
+    return name;
+#endif
+}
+
+void DirectoryIndex::load()
+{
+    QFile cacheFile(cachePath);
+    if (!cacheFile.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream in(&cacheFile);
+    in.setVersion(QDataStream::Qt_5_5);
+    quint32 version;
+    in >> version;
+    if (version != cacheFormatVersion)
+        return;
+    in >> listings;
+    if (in.status() != QDataStream::Ok)
+    {
+        qDebug() << __LINE__ << "Directory index cache is unreadable and will be rebuilt.";
+        listings.clear();
+    }
+}
+
+void DirectoryIndex::save()
+{
+    if (!changed)
+        return;
+
+    QDir().mkpath(QFileInfo(cachePath).absolutePath());
+    QSaveFile cacheFile(cachePath);
+    if (!cacheFile.open(QIODevice::WriteOnly))
+    {
+        qDebug() << __LINE__ << "Could not write the directory index cache: " + cachePath;
+        return;
+    }
+    QDataStream out(&cacheFile);
+    out.setVersion(QDataStream::Qt_5_5);
+    out << cacheFormatVersion << listings;
+    if (cacheFile.commit())
+        changed = false;
+}
+
+void DirectoryIndex::refresh(const QStringList &folders)
+{
+    // one modification time check per folder, and a listing only for folders that changed
+    QList<QPair<QString, Listing>> results =
+            QtConcurrent::blockingMapped<QList<QPair<QString, Listing>>>(folders, FolderLister(listings));
+
+    for (auto result : results)
+    {
+        auto it = listings.constFind(result.first);
+        if (it != listings.constEnd() && it.value().modified == result.second.modified)
+            continue;
+
+        Listing listing;
+        listing.modified = result.second.modified;
+        for (auto name : result.second.names)
+            listing.names.insert(key(name));
+        listings.insert(result.first, listing);
+        changed = true;
+    }
+}
+
+bool DirectoryIndex::contains(const QString &folder, const QString &fileName) const
+{
+    return listings.value(folder).names.contains(key(fileName));
+}
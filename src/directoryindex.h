@@ -0,0 +1,60 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DIRECTORYINDEX_H
+#define DIRECTORYINDEX_H
+
+#include <QtCore>
+
+// The file names in each photo folder, listed once per folder instead of
+// checking every image's path on its own, which costs a round trip per file
+// on a network share. Folders are listed in parallel. The listings are
+// cached on disk and reused for as long as a folder's modification time is
+// unchanged, which it is until files are added, removed or renamed in it.
+class DirectoryIndex
+{
+public:
+    explicit DirectoryIndex(const QString &cachePath);
+
+    void refresh(const QStringList &folders);
+    bool contains(const QString &folder, const QString &fileName) const;
+    void save();
+
+    struct Listing
+    {
+        qint64 modified;
+        QSet<QString> names;
+    };
+
+private:
+    static QString key(const QString &name);
+    void load();
+
+    QString cachePath;
+    QHash<QString, Listing> listings;
+    bool changed;
+};
+
+QDataStream &operator<<(QDataStream &out, const DirectoryIndex::Listing &listing);
+QDataStream &operator>>(QDataStream &in, DirectoryIndex::Listing &listing);
+
+#endif // DIRECTORYINDEX_H
@@ -27,18 +27,28 @@
 #include <QMessageBox>
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QtConcurrent>
 
 #include "newagentdialog.h"
 #include "startwindow.h"
 #include "editexisting.h"
+#include "contenthashes.h"
+#include "imageview.h"
 #include "ui_editexisting.h"
 
 EditExisting::EditExisting(QWidget *parent) :
     QWidget(parent),
-    ui(new Ui::EditExisting)
+    ui(new Ui::EditExisting),
+#if defined(Q_OS_WIN) || defined(Q_OS_MAC)
+    directoryIndex(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/data/directoryindex.dat")
+#else
+    directoryIndex(QApplication::applicationDirPath() + "/data/directoryindex.dat")
+#endif
 {
     ui->setupUi(this);
     screenPosLoaded = false;
+    relocatingCount = 0;
+    connect(&relocateWatcher, SIGNAL(finished()), this, SLOT(relocateFinished()));
     move(QApplication::desktop()->screen()->rect().center() - rect().center());
     QString lastAgent = "";
 
@@ -282,21 +292,12 @@ void EditExisting::loadDeterminations()
 
     QSqlQuery query;
     query.setForwardOnly(true);
-    query.prepare("SELECT dsw_identified, identifiedBy, dwc_dateIdentified, dwc_identificationRemarks, "
-                    "tsnID, nameAccordingToID, dcterms_modified, suppress from determinations");
+    query.prepare(TableSchema<Determination>::select("determinations"));
     query.exec();
     while (query.next())
     {
         Determination determination;
-        determination.identified = query.value(0).toString();
-        determination.identifiedBy = query.value(1).toString();
-        determination.dateIdentified = query.value(2).toString();
-        determination.identificationRemarks = query.value(3).toString();
-        determination.tsnID = query.value(4).toString();
-        determination.nameAccordingToID = query.value(5).toString();
-        determination.lastModified = query.value(6).toString();
-        determination.suppress = query.value(7).toString();
-
+        TableSchema<Determination>::load(determination, query);
         determinations << determination;
     }
 }
@@ -316,29 +317,9 @@ void EditExisting::loadImages()
 
     QString selection;
     if (ui->loadAllImagesCheckbox->isChecked())
-    {
-        selection= "SELECT fileName, focalLength, dwc_georeferenceRemarks, dwc_decimalLatitude, "
-                            "dwc_decimalLongitude, geo_alt, exif_PixelXDimension, exif_PixelYDimension, "
-                            "dwc_occurrenceRemarks, dwc_geodeticDatum, dwc_coordinateUncertaintyInMeters, "
-                            "dwc_locality, dwc_countryCode, dwc_stateProvince, dwc_county, dwc_informationWithheld, "
-                            "dwc_dataGeneralizations, dwc_continent, geonamesAdmin, geonamesOther, dcterms_identifier, "
-                            "dcterms_modified, dcterms_title, dcterms_description, ac_caption, photographerCode, dcterms_created, "
-                            "photoshop_Credit, owner, dcterms_dateCopyrighted, dc_rights, xmpRights_Owner, ac_attributionLinkURL, "
-                            "ac_hasServiceAccessPoint, usageTermsIndex, view, xmp_Rating, foaf_depicts, "
-                            "suppress from images" + recentlyModifiedPlusWhere;
-    }
+        selection = TableSchema<Image>::select("images") + recentlyModifiedPlusWhere;
     else
-    {
-        selection= "SELECT fileName, focalLength, dwc_georeferenceRemarks, dwc_decimalLatitude, "
-                        "dwc_decimalLongitude, geo_alt, exif_PixelXDimension, exif_PixelYDimension, "
-                        "dwc_occurrenceRemarks, dwc_geodeticDatum, dwc_coordinateUncertaintyInMeters, "
-                        "dwc_locality, dwc_countryCode, dwc_stateProvince, dwc_county, dwc_informationWithheld, "
-                        "dwc_dataGeneralizations, dwc_continent, geonamesAdmin, geonamesOther, dcterms_identifier, "
-                        "dcterms_modified, dcterms_title, dcterms_description, ac_caption, photographerCode, dcterms_created, "
-                        "photoshop_Credit, owner, dcterms_dateCopyrighted, dc_rights, xmpRights_Owner, ac_attributionLinkURL, "
-                        "ac_hasServiceAccessPoint, usageTermsIndex, view, xmp_Rating, foaf_depicts, "
-                        "suppress from images WHERE photographerCode = '" + ui->agentBox->currentText() +"'" + recentlyModified;
-    }
+        selection = TableSchema<Image>::select("images") + " WHERE photographerCode = '" + ui->agentBox->currentText() + "'" + recentlyModified;
     QSqlQuery query;
     query.setForwardOnly(true);
     query.prepare(selection);
@@ -348,314 +329,13 @@ void EditExisting::loadImages()
     while (query.next())
     {
         Image image;
-        image.fileName = query.value(0).toString();
-        image.focalLength = query.value(1).toString();
-        image.georeferenceRemarks = query.value(2).toString();
-        image.decimalLatitude = query.value(3).toString();
-        image.decimalLongitude = query.value(4).toString();
-        image.altitudeInMeters = query.value(5).toString();
-        image.width = query.value(6).toString();
-        image.height = query.value(7).toString();
-        image.occurrenceRemarks = query.value(8).toString();
-        image.geodeticDatum = query.value(9).toString();
-        image.coordinateUncertaintyInMeters = query.value(10).toString();
-        image.locality = query.value(11).toString();
-        image.countryCode = query.value(12).toString();
-        image.stateProvince = query.value(13).toString();
-        image.county = query.value(14).toString();
-        image.informationWithheld = query.value(15).toString();
-        image.dataGeneralizations = query.value(16).toString();
-        image.continent = query.value(17).toString();
-        image.geonamesAdmin = query.value(18).toString();
-        image.geonamesOther = query.value(19).toString();
-        image.identifier = query.value(20).toString();
-        image.lastModified = query.value(21).toString();
-        image.title = query.value(22).toString();
-        image.description = query.value(23).toString();
-        image.caption = query.value(24).toString();
-        image.photographerCode = query.value(25).toString();
-        image.dcterms_created = query.value(26).toString();
-
-        QStringList eventDateSplit = image.dcterms_created.split("T");
-        if (eventDateSplit.length() == 2)
-        {
-            image.date = eventDateSplit.at(0);
-            QStringList timeSplit;
-            if (eventDateSplit.at(1).contains("-"))
-            {
-                timeSplit = eventDateSplit.at(1).split("-");
-                image.time = timeSplit.at(0);
-                image.timezone = "-" + timeSplit.at(1);
-            }
-            else if (eventDateSplit.at(1).contains("+"))
-            {
-                timeSplit = eventDateSplit.at(1).split("+");
-                image.time = timeSplit.at(0);
-                image.timezone = "+" + timeSplit.at(1);
-            }
-            else
-                image.time = eventDateSplit.at(1);
-        }
-        else
-            image.date = image.dcterms_created;
-
-        image.credit = query.value(27).toString();
-        image.copyrightOwnerID = query.value(28).toString();
-        image.copyrightYear = query.value(29).toString();
-        image.copyrightStatement = query.value(30).toString();
-        image.copyrightOwnerName = query.value(31).toString();
-        image.attributionLinkURL = query.value(32).toString();
-        image.urlToHighRes = query.value(33).toString();
-        image.usageTermsIndex = query.value(34).toString();
-        image.imageView = query.value(35).toString();
-        image.rating = query.value(36).toString();
-        image.depicts = query.value(37).toString();
-        image.suppress = query.value(38).toString();
-
-        // Convert imageview #010203 format to group/part/view QStrings
-        QString group = "unspecified";
-        QString part = "unspecified";
-        QString view = "unspecified";
-        QString imageView = image.imageView;
-        imageView.remove("#");
-        // make sure imageView is 6 digits long before splitting
-        if (imageView.length() == 6)
-        {
-            QString pt1 = QString(imageView.at(0)) + QString(imageView.at(1));
-            QString pt2 = QString(imageView.at(2)) + QString(imageView.at(3));
-            QString pt3 = QString(imageView.at(4)) + QString(imageView.at(5));
-
-            if (pt1 == "00" && pt2 == "01")
-                part = "whole organism";
-            else if (pt1 == "01")
-            {
-                group = "woody angiosperms";
-                if (pt2 == "01")
-                {
-                    part = "whole tree (or vine)";
-                    if (pt3 == "01")
-                        view = "general";
-                    else if (pt3 == "02")
-                        view = "winter";
-                    else if (pt3 == "03")
-                        view = "view up trunk";
-                }
-                else if (pt2 == "02")
-                {
-                    part = "bark";
-                    if (pt3 == "01")
-                        view = "of a large tree";
-                    else if (pt3 == "02")
-                        view  = "of a medium tree or large branch";
-                    else if (pt3 == "03")
-                        view = "of a small tree or small branch";
-                }
-                else if (pt2 == "03")
-                {
-                    part = "twig";
-                    if (pt3 == "01")
-                        view = "orientation of petioles";
-                    else if (pt3 == "02")
-                        view = "winter overall";
-                    else if (pt3 == "03")
-                        view = "close-up winter leaf scar/bud";
-                    else if (pt3 == "04")
-                        view = "close-up winter terminal bud";
-                }
-                else if (pt2 == "04")
-                {
-                    part = "leaf";
-                    if (pt3 == "01")
-                        view = "whole upper surface";
-                    else if (pt3 == "02")
-                        view = "margin of upper + lower surface";
-                    else if (pt3 == "03")
-                        view = "showing orientation on twig";
-                }
-                else if (pt2 == "05")
-                {
-                    part = "inflorescence";
-                    if (pt3 == "01")
-                        view = "whole - unspecified";
-                    else if (pt3 == "02")
-                        view = "whole - female";
-                    else if (pt3 == "03")
-                        view = "whole - male";
-                    else if (pt3 == "04")
-                        view = "lateral view of flower";
-                    else if (pt3 == "05")
-                        view = "frontal view of flower";
-                    else if (pt3 == "06")
-                        view = "ventral view of flower + perianth";
-                    else if (pt3 == "07")
-                        view = "close-up of flower interior";
-                }
-                else if (pt2 == "06")
-                {
-                    part = "fruit";
-                    if (pt3 == "01")
-                        view = "as borne on the plant";
-                    else if (pt3 == "02")
-                        view = "lateral or general close-up";
-                    else if (pt3 == "03")
-                        view = "section or open";
-                    else if (pt3 == "04")
-                        view = "immature";
-                }
-                else if (pt2 == "07")
-                {
-                    part = "seed";
-                    if (pt3 == "01")
-                        view = "general view";
-                }
-            }
-            else if (pt1 == "02")
-            {
-                group = "herbaceous angiosperms";
-                if (pt2 == "01")
-                {
-                    part = "whole plant";
-                    if (pt3 == "01")
-                        view = "juvenile";
-                    else if (pt3 == "02")
-                        view = "in flower - general view";
-                    else if (pt3 == "03")
-                        view = "in fruit";
-                }
-                else if (pt2 == "02")
-                {
-                    part = "stem";
-                    if (pt3 == "01")
-                        view = "showing leaf bases";
-                }
-                else if (pt2 == "03")
-                {
-                    part = "leaf";
-                    if (pt3 == "01")
-                        view = "basal or on lower stem";
-                    else if (pt3 == "02")
-                        view = "on upper stem";
-                    else if (pt3 == "03")
-                        view = "margin of upper + lower surface";
-                }
-                else if (pt2 == "04")
-                {
-                    part = "inflorescence";
-                    if (pt3 == "01")
-                        view = "whole - unspecified";
-                    else if (pt3 == "02")
-                        view = "whole - female";
-                    else if (pt3 == "03")
-                        view = "whole - male";
-                    else if (pt3 == "04")
-                        view = "lateral view of flower";
-                    else if (pt3 == "05")
-                        view = "frontal view of flower";
-                    else if (pt3 == "06")
-                        view = "ventral view of flower + perianth";
-                    else if (pt3 == "07")
-                        view = "close-up of flower interior";
-                }
-                else if (pt2 == "05")
-                {
-                    part = "fruit";
-                    if (pt3 == "01")
-                        view = "as borne on the plant";
-                    else if (pt3 == "02")
-                        view = "lateral or general close-up";
-                    else if (pt3 == "03")
-                        view = "section or open";
-                    else if (pt3 == "04")
-                        view = "immature";
-                }
-                else if (pt2 == "06")
-                {
-                    part = "seed";
-                    if (pt3 == "01")
-                        view = "general view";
-                }
-            }
-            else if (pt1 == "03")
-            {
-                group = "gymnosperms";
-                if (pt2 == "01")
-                {
-                    part = "whole tree";
-                    if (pt3 == "01")
-                        view = "general";
-                    else if (pt3 == "02")
-                        view = "view up trunk";
-                }
-                else if (pt2 == "02")
-                {
-                    part = "bark";
-                    if (pt3 == "01")
-                        view = "of a large tree";
-                    else if (pt3 == "02")
-                        view = "of a medium tree or large branch";
-                    else if (pt3 == "03")
-                        view = "of a small tree or small branch";
-                }
-                else if (pt2 == "03")
-                {
-                    part = "twig";
-                    if (pt3 == "01")
-                        view = "after fallen needles";
-                    else if (pt3 == "02")
-                        view = "showing attachment of needles";
-                }
-                else if (pt2 == "04")
-                {
-                    part = "leaf";
-                    if (pt3 == "01")
-                        view = "entire needle";
-                    else if (pt3 == "02")
-                        view = "showing orientation on twig";
-                }
-                else if (pt2 == "05")
-                {
-                    part = "cone";
-                    if (pt3 == "01")
-                        view = "male";
-                    else if (pt3 == "02")
-                        view = "female - mature open";
-                    else if (pt3 == "03")
-                        view = "female - closed";
-                    else if (pt3 == "04")
-                        view = "female - receptive";
-                    else if (pt3 == "05")
-                        view = "one year-old female";
-                }
-                else if (pt2 == "06")
-                {
-                    part = "seed";
-                    if (pt3 == "01")
-                        view = "general view";
-                }
-            }
-            else if (pt1 == "04")
-            {
-                group = "ferns";
-                if (pt2 == "01")
-                    part = "whole plant";
-            }
-            else if (pt1 == "05")
-            {
-                group = "cacti";
-                if (pt2 == "01")
-                    part = "whole plant";
-            }
-            else if (pt1 == "06")
-            {
-                group = "mosses";
-                if (pt2 == "01")
-                    part = "whole gametophyte";
-            }
-        }
+        TableSchema<Image>::load(image, query);
+        image.splitCreated();
 
-        image.groupOfSpecimen = group;
-        image.portionOfSpecimen = part;
-        image.viewOfSpecimen = view;
+        QStringList groupPartView = ImageView::decode(image.imageView);
+        image.groupOfSpecimen = groupPartView.at(0);
+        image.portionOfSpecimen = groupPartView.at(1);
+        image.viewOfSpecimen = groupPartView.at(2);
 
         images << image;
 
@@ -668,30 +348,13 @@ void EditExisting::loadOrganisms()
     organisms.clear();
 
     QSqlQuery query;
-    query.prepare("SELECT dcterms_identifier, dwc_establishmentMeans, dcterms_modified, "
-                    "dwc_organismRemarks, dwc_collectionCode, dwc_catalogNumber, "
-                    "dwc_georeferenceRemarks, dwc_decimalLatitude, dwc_decimalLongitude, geo_alt, "
-                    "dwc_organismName, dwc_organismScope, cameo, notes, suppress from organisms");
+    query.setForwardOnly(true);
+    query.prepare(TableSchema<Organism>::select("organisms"));
     query.exec();
     while (query.next())
     {
         Organism organism;
-        organism.identifier = query.value(0).toString(); // remove URL from ID http://foo/bar/ID
-        organism.establishmentMeans = query.value(1).toString();
-        organism.lastModified = query.value(2).toString();
-        organism.organismRemarks = query.value(3).toString();
-        organism.collectionCode = query.value(4).toString();
-        organism.catalogNumber = query.value(5).toString();
-        organism.georeferenceRemarks = query.value(6).toString();
-        organism.decimalLatitude = query.value(7).toString();
-        organism.decimalLongitude = query.value(8).toString();
-        organism.altitudeInMeters = query.value(9).toString();
-        organism.organismName = query.value(10).toString();
-        organism.organismScope = query.value(11).toString();
-        organism.cameo = query.value(12).toString();
-        organism.notes = query.value(13).toString();
-        organism.suppress = query.value(14).toString();
-
+        TableSchema<Organism>::load(organism, query);
         organisms << organism;
     }
 }
@@ -702,20 +365,12 @@ void EditExisting::loadSensu()
 
     QSqlQuery query;
     query.setForwardOnly(true);
-    query.prepare("SELECT dcterms_identifier, dc_creator, tcsSignature, dcterms_title, "
-                    "dc_publisher, dcterms_created, iri, dcterms_modified from sensu");
+    query.prepare(TableSchema<Sensu>::select("sensu"));
     query.exec();
     while (query.next())
     {
         Sensu sensu;
-        sensu.identifier = query.value(0).toString();
-        sensu.creator = query.value(1).toString();
-        sensu.tcsSignature = query.value(2).toString();
-        sensu.title = query.value(3).toString();
-        sensu.publisher = query.value(4).toString();
-        sensu.dcterms_created = query.value(5).toString();
-        sensu.iri = query.value(6).toString();
-        sensu.lastModified = query.value(7).toString();
+        TableSchema<Sensu>::load(sensu, query);
         sensus << sensu;
     }
 }
@@ -806,6 +461,8 @@ void EditExisting::on_selectImageLocationButton_clicked()
 void EditExisting::findMatchingFiles()
 {
     fullPathFileNames.clear();
+    imagePaths.clear();
+    foundImagePaths.clear();
     numImagesFound = 0;
     ui->listWidget->clear();
 
@@ -818,9 +475,9 @@ void EditExisting::findMatchingFiles()
     loadImages();
     QCoreApplication::processEvents();
 
+    QStringList imageFolders;
     for (Image image : images)
     {
-        QString file = image.fileName;
         QString folder = photoFolder;
 
         if (ui->rootFolderCheckbox->isChecked())
@@ -833,6 +490,21 @@ void EditExisting::findMatchingFiles()
                 folder = folder + "/" + photographer;
             }
         }
+        imageFolders.append(folder);
+    }
+
+    // list each folder once (or reuse its cached listing) rather than checking every file
+    QStringList folders = imageFolders;
+    folders.removeDuplicates();
+    directoryIndex.refresh(folders);
+    directoryIndex.save();
+
+    for (int i = 0; i < images.size(); i++)
+    {
+        const Image &image = images.at(i);
+        QString file = image.fileName;
+        QString folder = imageFolders.at(i);
+        bool found = directoryIndex.contains(folder, file);
 
         QString filepath = folder + "/" + file;
 
@@ -850,8 +522,15 @@ void EditExisting::findMatchingFiles()
 //        else
 //            filepath = folder + "/" + file;
 
-        QFileInfo fileInfo(filepath);
-        if (!fileInfo.isFile())
+        // a file found elsewhere by its content stands in for one missing from the expected path
+        if (!found && relocatedFiles.contains(image.identifier))
+        {
+            filepath = relocatedFiles.value(image.identifier);
+            found = QFileInfo(filepath).isFile();
+        }
+        imagePaths.insert(image.identifier, filepath);
+
+        if (!found)
         {
             fullPathFileNames.append(filepath);
         }
@@ -859,6 +538,7 @@ void EditExisting::findMatchingFiles()
         {
             numImagesFound++;
             fullPathFileNames.append(filepath);
+            foundImagePaths.insert(image.identifier, filepath);
         }
     }
 
@@ -904,9 +584,9 @@ void EditExisting::on_doneButton_clicked()
             baseFullHash.insert(base,fullPath);
         }
 
-        for (Image im : images)
+        for (Image &im : images)
         {
-            im.fileAndPath = baseFullHash.value(im.fileName);
+            im.fileAndPath = imagePaths.value(im.identifier, baseFullHash.value(im.fileName));
             photographerHash.insert(im.fileAndPath, im.photographerCode);
         }
 
@@ -926,6 +606,9 @@ void EditExisting::on_doneButton_clicked()
         qry.addBindValue(ui->agentBox->currentText());
         qry.exec();
 
+        // record content hashes for images catalogued before they were kept, so they can be found if moved
+        QtConcurrent::run(&ContentHashes::backfill, foundImagePaths);
+
         dataEntry = new DataEntry(imageFileNames, photographerHash, agentHash, images);
         dataEntry->setAttribute(Qt::WA_DeleteOnClose);
         connect(dataEntry,SIGNAL(windowClosed()),this,SLOT(closeDataEntry()));
@@ -1145,6 +828,60 @@ void EditExisting::on_showHideButton_clicked()
     }
 }
 
+void EditExisting::on_findMovedFilesButton_clicked()
+{
+    if (photoFolder.isEmpty())
+    {
+        QMessageBox msgBox;
+        msgBox.setText("No image folder has been selected. Select one first to proceed.");
+        msgBox.exec();
+        return;
+    }
+
+    QStringList missing;
+    for (Image image : images)
+    {
+        if (!foundImagePaths.contains(image.identifier))
+            missing.append(image.identifier);
+    }
+    if (missing.isEmpty())
+    {
+        QMessageBox msgBox;
+        msgBox.setText("All images were found.");
+        msgBox.exec();
+        return;
+    }
+
+    // hashes only the files under the selected folder whose size matches a missing image;
+    // that walks the whole tree, so it runs on a worker thread and relocateFinished() goes on
+    relocatingCount = missing.size();
+    relocatingFolder = photoFolder;
+    ui->findMovedFilesButton->setEnabled(false);
+    setCursor(Qt::BusyCursor);
+    relocateWatcher.setFuture(QtConcurrent::run(&ContentHashes::relocate, photoFolder, missing));
+}
+
+void EditExisting::relocateFinished()
+{
+    QHash<QString,QString> found = relocateWatcher.result();
+    unsetCursor();
+    ui->findMovedFilesButton->setEnabled(true);
+
+    QHashIterator<QString,QString> it(found);
+    while (it.hasNext())
+    {
+        it.next();
+        relocatedFiles.insert(it.key(), it.value());
+    }
+    findMatchingFiles();
+
+    QMessageBox msgBox;
+    msgBox.setText("Found " + QString::number(found.size()) + " of " + QString::number(relocatingCount) +
+                   " missing images elsewhere in\n" + relocatingFolder + "\n\n"
+                   "Only images whose content was recorded when they were added or last opened here can be found this way.");
+    msgBox.exec();
+}
+
 void EditExisting::on_rootFolderCheckbox_toggled(bool checked)
 {
     if (pauseLoading)
@@ -25,6 +25,7 @@
 
 #include <QWidget>
 #include <QProcess>
+#include <QFutureWatcher>
 
 #include "agent.h"
 #include "determination.h"
@@ -33,6 +34,7 @@
 #include "sensu.h"
 #include "dataentry.h"
 #include "help.h"
+#include "directoryindex.h"
 
 namespace Ui {
 class EditExisting;
@@ -61,6 +63,8 @@ private slots:
     void closeDataEntry();
     void on_showHideButton_clicked();
     void on_rootFolderCheckbox_toggled(bool checked);
+    void on_findMovedFilesButton_clicked();
+    void relocateFinished();
     void on_clearCache_clicked();
 
 private:
@@ -77,6 +81,13 @@ private:
     QString photoFolder;
     QStringList fileNames;
     QStringList fullPathFileNames;
+    QHash<QString,QString> imagePaths;
+    QHash<QString,QString> foundImagePaths;
+    QHash<QString,QString> relocatedFiles;
+    QFutureWatcher<QHash<QString,QString> > relocateWatcher;
+    int relocatingCount;
+    QString relocatingFolder;
+    DirectoryIndex directoryIndex;
     void setNumFiles();
     bool checkExifLocation();
     QPointer<DataEntry> dataEntry;
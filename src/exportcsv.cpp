@@ -21,20 +21,28 @@
 // SOFTWARE.
 
 #include <QSqlQuery>
+#include <QSqlDatabase>
+#include <QSqlRecord>
+#include <QFileInfo>
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QEventLoop>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <QSaveFile>
 
 #include "exportcsv.h"
-#include "startwindow.h"
-#include "agent.h"
-#include "determination.h"
+#include "exportlog.h"
+#include "databaseconnections.h"
 #include "image.h"
 #include "organism.h"
+#include "determination.h"
 #include "sensu.h"
 #include "taxa.h"
 
 ExportCSV::ExportCSV(QObject *parent) : QObject(parent)
 {
+    incremental = false;
 }
 
 ExportCSV::~ExportCSV()
@@ -42,6 +50,12 @@ ExportCSV::~ExportCSV()
 
 }
 
+void ExportCSV::setIncremental(bool state)
+{
+    // only export what changed since the last export to the same folder or archive
+    incremental = state;
+}
+
 void ExportCSV::saveData(const QString &where, const QString &tpref)
 {
     // Retrieve last folder saved to
@@ -63,545 +77,451 @@ void ExportCSV::saveData(const QString &where, const QString &tpref)
     qry.addBindValue(workingFolder);
     qry.exec();
 
-    // Save image data to <working_folder>/images.csv
-    QSqlQuery imageChanges;
-    imageChanges.prepare("select * from " + tpref + "images" + where);
-    imageChanges.exec();
-    QList<Image> changedImages;
-    while (imageChanges.next())
-    {
-        Image newImage;
-
-        newImage.fileName = imageChanges.value(0).toString();
-        newImage.focalLength = imageChanges.value(1).toString();
-        newImage.georeferenceRemarks = imageChanges.value(2).toString();
-        newImage.decimalLatitude = imageChanges.value(3).toString();
-        newImage.decimalLongitude = imageChanges.value(4).toString();
-        newImage.altitudeInMeters = imageChanges.value(5).toString();
-        newImage.width = imageChanges.value(6).toString();
-        newImage.height = imageChanges.value(7).toString();
-        newImage.occurrenceRemarks = imageChanges.value(8).toString();
-        newImage.geodeticDatum = imageChanges.value(9).toString();
-
-        newImage.coordinateUncertaintyInMeters = imageChanges.value(10).toString();
-        newImage.locality = imageChanges.value(11).toString();
-        newImage.countryCode = imageChanges.value(12).toString();
-        newImage.stateProvince = imageChanges.value(13).toString();
-        newImage.county = imageChanges.value(14).toString();
-        newImage.informationWithheld = imageChanges.value(15).toString();
-        newImage.dataGeneralizations = imageChanges.value(16).toString();
-        newImage.continent = imageChanges.value(17).toString();
-        newImage.geonamesAdmin = imageChanges.value(18).toString();
-        newImage.geonamesOther = imageChanges.value(19).toString();
-
-        newImage.identifier = imageChanges.value(20).toString();
-        newImage.lastModified = imageChanges.value(21).toString();
-        newImage.title = imageChanges.value(22).toString();
-        newImage.description = imageChanges.value(23).toString();
-        newImage.caption = imageChanges.value(24).toString();
-        newImage.photographerCode = imageChanges.value(25).toString();
-        newImage.dcterms_created = imageChanges.value(26).toString();
-        newImage.credit = imageChanges.value(27).toString();
-        newImage.copyrightOwnerID = imageChanges.value(28).toString();
-        newImage.copyrightYear = imageChanges.value(29).toString();
-
-        newImage.copyrightStatement = imageChanges.value(30).toString();
-        newImage.copyrightOwnerName = imageChanges.value(31).toString();
-        newImage.attributionLinkURL = imageChanges.value(32).toString();
-        newImage.urlToHighRes = imageChanges.value(33).toString();
-        newImage.usageTermsIndex = imageChanges.value(34).toString();
-        newImage.imageView = imageChanges.value(35).toString();
-        newImage.rating = imageChanges.value(36).toString();
-        newImage.depicts = imageChanges.value(37).toString();
-        newImage.suppress = imageChanges.value(38).toString();
-
-        changedImages << newImage;
-    }
+    // the sequence is taken before exporting, so anything changed while exporting goes out next time
+    qint64 since = -1;
+    qint64 sequence = ExportLog::currentSequence();
+    if (incremental && tpref.isEmpty())
+        since = ExportLog::watermark(workingFolder);
 
-    if (!changedImages.isEmpty())
+    // ask about overwriting before anything is written
+    QList<TableExport> jobs = tableExports(where, tpref, since);
+    for (int i = 0; i < jobs.size(); i++)
     {
-        QFile imageCSV(workingFolder + "/images.csv");
-        if (imageCSV.exists())
-        {
-            if (QMessageBox::No == QMessageBox(QMessageBox::Information, "File already exists",
-                                                "Caution - images.csv already exists in this folder.\nAre you sure you want to overwrite it?",
-                                                QMessageBox::Yes|QMessageBox::No).exec())
-            {
-                QMessageBox msgBox;
-                msgBox.setText("Saving was canceled.");
-                msgBox.exec();
-                return;
-            }
-        }
-
-        if (!imageCSV.open(QFile::WriteOnly | QFile::Text))
-        {
-            QMessageBox msgBox;
-            msgBox.setText("Could not open images.csv for writing.");
-            msgBox.exec();
+        if (!confirmOverwrite(workingFolder + "/" + jobs.at(i).fileName))
             return;
-        }
-
-        QString imageHeader = "fileName|focalLength|dwc_georeferenceRemarks|dwc_decimalLatitude|dwc_decimalLongitude|geo_alt|exif_PixelXDimension|exif_PixelYDimension|dwc_occurrenceRemarks|dwc_geodeticDatum|dwc_coordinateUncertaintyInMeters|dwc_locality|dwc_countryCode|dwc_stateProvince|dwc_county|dwc_informationWithheld|dwc_dataGeneralizations|dwc_continent|geonamesAdmin|geonamesOther|dcterms_identifier|dcterms_modified|dcterms_title|dcterms_description|ac_caption|photographerCode|dcterms_created|photoshop_Credit|owner|dcterms_dateCopyrighted|dc_rights|xmpRights_Owner|ac_attributionLinkURL|ac_hasServiceAccessPoint|usageTermsIndex|view|xmp_Rating|foaf_depicts|suppress";
-        QTextStream imageOut(&imageCSV);
-        imageOut.setCodec("UTF-8");
-        imageOut << imageHeader;
-
-        for (Image img : changedImages)
-        {
-            // Convert other values to their saved form
-            QString attributionURL = img.identifier + ".htm";
-            QString coordinateUncertainty = img.coordinateUncertaintyInMeters;
-            if (coordinateUncertainty == "")
-                coordinateUncertainty = "1000";
-
-            QString depicts = "";
-            if (!img.depicts.isEmpty())
-                depicts = img.depicts;
-
-            // fields contains everything except the first column (img.filename) which will be added separately
-            QStringList fields;
-            fields << img.focalLength << img.georeferenceRemarks << img.decimalLatitude << img.decimalLongitude << img.altitudeInMeters
-                   << img.width << img.height << img.occurrenceRemarks << img.geodeticDatum << coordinateUncertainty
-                   << img.locality << img.countryCode << img.stateProvince << img.county << img.informationWithheld
-                   << img.dataGeneralizations << img.continent << img.geonamesAdmin << img.geonamesOther << img.identifier
-                   << img.lastModified << img.title << img.description << img.caption << img.photographerCode
-                   << img.dcterms_created << img.credit << img.copyrightOwnerID << img.copyrightYear << img.copyrightStatement
-                   << img.copyrightOwnerName << attributionURL << img.urlToHighRes << img.usageTermsIndex << img.imageView
-                   << img.rating << depicts << img.suppress;
-
-            QString row = "\n" + img.fileName;
-            for (QString field : fields)
-            {
-                // if the field contains any pipes surround the entire field in quotes
-                if (field.contains("|"))
-                    row = row + "|\"" + field + "\"";
-                else
-                    row = row + "|" + field;
-            }
-
-            imageOut << row;
-        }
-
-        imageCSV.flush();
-        imageCSV.close();
+        jobs[i].fileName = workingFolder + "/" + jobs.at(i).fileName;
     }
-
-    // Save organism data to <working_folder>/organisms.csv
-    QSqlQuery orgChanges;
-    orgChanges.prepare("select * from " + tpref + "organisms" + where);
-    orgChanges.exec();
-    QList<Organism> changedOrgs;
-    while (orgChanges.next())
+    QByteArray deletions;
+    if (since >= 0)
     {
-        Organism newOrg;
-        newOrg.identifier = orgChanges.value(0).toString();
-        newOrg.establishmentMeans = orgChanges.value(1).toString();
-        newOrg.lastModified = orgChanges.value(2).toString();
-        newOrg.organismRemarks = orgChanges.value(3).toString();
-        newOrg.collectionCode = orgChanges.value(4).toString();
-        newOrg.catalogNumber = orgChanges.value(5).toString();
-        newOrg.georeferenceRemarks = orgChanges.value(6).toString();
-        newOrg.decimalLatitude = orgChanges.value(7).toString();
-        newOrg.decimalLongitude = orgChanges.value(8).toString();
-        newOrg.altitudeInMeters = orgChanges.value(9).toString();
-
-        newOrg.organismName = orgChanges.value(10).toString();
-        newOrg.organismScope = orgChanges.value(11).toString();
-        newOrg.cameo = orgChanges.value(12).toString();
-        newOrg.notes = orgChanges.value(13).toString();
-        newOrg.suppress = orgChanges.value(14).toString();
-
-        changedOrgs << newOrg;
-    }
-
-    if (!changedOrgs.isEmpty())
-    {
-        QFile organismCSV(workingFolder + "/organisms.csv");
-        if (organismCSV.exists())
-        {
-            if (QMessageBox::No == QMessageBox(QMessageBox::Information, "File already exists",
-                                                "Caution - organisms.csv already exists in this folder.\nAre you sure you want to overwrite it?",
-                                                QMessageBox::Yes|QMessageBox::No).exec())
-            {
-                QMessageBox msgBox;
-                msgBox.setText("Saving was canceled.");
-                msgBox.exec();
-                return;
-            }
-        }
-
-
-        if (!organismCSV.open(QFile::WriteOnly | QFile::Text))
-        {
-            QMessageBox msgBox;
-            msgBox.setText("Could not open organisms.csv for writing.");
-            msgBox.exec();
+        deletions = deletionsCSV(since);
+        if (!deletions.isEmpty() && !confirmOverwrite(workingFolder + "/deletions.csv"))
             return;
-        }
-
-        QString organismHeader = "dcterms_identifier|dwc_establishmentMeans|dcterms_modified|dwc_organismRemarks|dwc_collectionCode|dwc_catalogNumber|dwc_georeferenceRemarks|dwc_decimalLatitude|dwc_decimalLongitude|geo_alt|dwc_organismName|dwc_organismScope|cameo|notes|suppress";
-
-        QTextStream organismsOut(&organismCSV);
-        organismsOut.setCodec("UTF-8");
-        organismsOut << organismHeader;
+    }
 
-        for (auto org : changedOrgs)
-        {
-            QString indID = org.identifier;
-            QString estabMeans = org.establishmentMeans;
-            if (estabMeans == "")
-                estabMeans = "uncertain";
-
-            // fields contains everything except indID, which will be handled separately
-            QStringList fields;
-            fields << estabMeans << org.lastModified << org.organismRemarks << org.collectionCode << org.catalogNumber
-                   << org.georeferenceRemarks << org.decimalLatitude << org.decimalLongitude << org.altitudeInMeters
-                   << org.organismName << org.organismScope << org.cameo << org.notes << org.suppress;
-
-            QString row = "\n" + indID;
-            for (QString field : fields)
-            {
-                if (field.contains("|"))
-                    row = row + "|\"" + field + "\"";
-                else
-                    row = row + "|" + field;
-            }
+    // each table is written on its own thread and read connection
+    QFutureWatcher<QString> watcher;
+    QEventLoop loop;
+    connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+    watcher.setFuture(QtConcurrent::mapped(jobs, &ExportCSV::writeTable));
+    if (!watcher.isFinished())
+        loop.exec(QEventLoop::ExcludeUserInputEvents);
 
-            organismsOut << row;
-        }
-        organismCSV.close();
+    QStringList errors;
+    for (auto error : watcher.future().results())
+    {
+        if (!error.isEmpty())
+            errors << error;
     }
 
-    // Save determination data to <working_folder>/determinations.csv
-    QSqlQuery detChanges;
-    detChanges.prepare("select * from " + tpref + "determinations" + where);
-    detChanges.exec();
-    QList<Determination> changedDets;
-    while (detChanges.next())
+    if (!deletions.isEmpty())
     {
-        Determination newDet;
-        newDet.identified = detChanges.value(0).toString();
-        newDet.identifiedBy = detChanges.value(1).toString();
-        newDet.dateIdentified = detChanges.value(2).toString();
-        newDet.identificationRemarks = detChanges.value(3).toString();
-        newDet.tsnID = detChanges.value(4).toString();
-        newDet.nameAccordingToID = detChanges.value(5).toString();
-        newDet.lastModified = detChanges.value(6).toString();
-        newDet.suppress = detChanges.value(7).toString();
-
-        changedDets << newDet;
+        QFile deletionsFile(workingFolder + "/deletions.csv");
+        if (!deletionsFile.open(QFile::WriteOnly | QFile::Text) || deletionsFile.write(deletions) != deletions.size())
+            errors << "Could not write deletions.csv.";
+        deletionsFile.close();
     }
 
-    QStringList tsnIDs;
-    if (!changedDets.isEmpty())
-    {
-        QFile determinationCSV(workingFolder + "/determinations.csv");
+    if (errors.isEmpty() && incremental && tpref.isEmpty())
+        ExportLog::setWatermark(workingFolder, sequence);
 
-        if (determinationCSV.exists())
-        {
-            if (QMessageBox::No == QMessageBox(QMessageBox::Information, "File already exists",
-                                                "Caution - determinations.csv already exists in this folder.\nAre you sure you want to overwrite it?",
-                                                QMessageBox::Yes|QMessageBox::No).exec())
-            {
-                QMessageBox msgBox;
-                msgBox.setText("Saving was canceled.");
-                msgBox.exec();
-                return;
-            }
-        }
+    QMessageBox msgBox;
+    if (errors.isEmpty())
+        msgBox.setText("Data saved to CSV files successfully.");
+    else
+        msgBox.setText(errors.join("\n"));
+    msgBox.exec();
+}
 
-        if (!determinationCSV.open(QFile::WriteOnly | QFile::Text))
-        {
-            QMessageBox msgBox;
-            msgBox.setText("Could not open determinations.csv for writing.");
-            msgBox.exec();
-            return;
-        }
+void ExportCSV::saveArchive(const QString &where, const QString &tpref)
+{
+    QString workingFolder = "";
+    QSqlQuery qry;
+    qry.prepare("SELECT value FROM settings WHERE setting = (?)");
+    qry.addBindValue("path.saveCSVfolder");
+    qry.exec();
+    if (qry.next())
+        workingFolder = qry.value(0).toString();
 
-        QString determinationHeader = "dsw_identified|identifiedBy|dwc_dateIdentified|dwc_identificationRemarks|tsnID|nameAccordingToID|dcterms_modified|suppress";
-        QTextStream determinationsOut(&determinationCSV);
-        determinationsOut.setCodec("UTF-8");
-        determinationsOut << determinationHeader;
+    QWidget *parentWidget = qobject_cast<QWidget*>(this->parent());
+    QString archivePath = QFileDialog::getSaveFileName(parentWidget, "Save submission archive",
+                                                       workingFolder + "/submission.zip", "Zip archives (*.zip)");
+    if (archivePath.isEmpty())
+        return;
+    if (!archivePath.endsWith(".zip", Qt::CaseInsensitive))
+        archivePath += ".zip";
 
-        for (Determination det : changedDets)
-        {
-            // it's not a determination if it hasn't been determined
-            if (det.tsnID.isEmpty())
-                continue;
-
-            tsnIDs.append(det.tsnID);
-
-            //QString dwcidentID = det.ID;
-            QString nameAccordingTo = det.nameAccordingToID.split(" ").last();
-            nameAccordingTo.remove("(");
-            nameAccordingTo.remove(")");
-            if (nameAccordingTo.isEmpty())
-                nameAccordingTo = "nominal";
-
-            // fields contains everything except det.ID, which is handled separately
-            QStringList fields;
-            fields << det.identifiedBy << det.dateIdentified << det.identificationRemarks
-                   << det.tsnID << nameAccordingTo << det.lastModified << det.suppress;
-
-            QString row = "\n" + det.identified;
-            for (QString field : fields)
-            {
-                // if the field contains any pipes surround the entire field in quotes
-                if (field.contains("|"))
-                    row = row + "|\"" + field + "\"";
-                else
-                    row = row + "|" + field;
-            }
+    qry.prepare("INSERT OR REPLACE INTO settings (setting, value) VALUES (?, ?)");
+    qry.addBindValue("path.saveCSVfolder");
+    qry.addBindValue(QFileInfo(archivePath).absolutePath());
+    qry.exec();
 
-            determinationsOut << row;
-        }
-        determinationCSV.close();
+    // the derivatives are where the Advanced Options resizer puts them: <base>/gq/<photographer>/g<fileName>, etc.
+    QString baseFolder;
+    if (QMessageBox::Yes == QMessageBox(QMessageBox::Question, "Derivative images",
+                                         "Include the GQ, LQ and TN derivatives of the exported images?",
+                                         QMessageBox::Yes|QMessageBox::No).exec())
+    {
+        baseFolder = QFileDialog::getExistingDirectory(parentWidget, "Select base directory for TN, LQ and GQ images",
+                                                       QFileInfo(archivePath).absolutePath(), QFileDialog::ShowDirsOnly);
     }
 
-    // Save agent data to <working_folder>/agents.csv
-    QSqlQuery agentChanges;
-    agentChanges.prepare("select * from " + tpref + "agents" + where);
-    agentChanges.exec();
-    QList<Agent> changedAgents;
-    while (agentChanges.next())
+    qint64 since = -1;
+    qint64 sequence = ExportLog::currentSequence();
+    if (incremental && tpref.isEmpty())
+        since = ExportLog::watermark(archivePath);
+
+    QList<ArchiveEntry> entries;
+    for (auto job : tableExports(where, tpref, since))
     {
-        Agent newAgent;
-        newAgent.setAgentCode(agentChanges.value(0).toString());
-        newAgent.setFullName(agentChanges.value(1).toString());
-        newAgent.setAgentURI(agentChanges.value(2).toString());
-        newAgent.setContactURL(agentChanges.value(3).toString());
-        newAgent.setMorphbankID(agentChanges.value(4).toString());
-        newAgent.setLastModified(agentChanges.value(5).toString());
-        newAgent.setAgentType(agentChanges.value(6).toString());
-
-        changedAgents << newAgent;
+        ArchiveEntry entry;
+        entry.name = job.fileName;
+        entry.table = job;
+        entries << entry;
     }
 
-    if (!changedAgents.isEmpty())
+    if (!baseFolder.isEmpty())
     {
-        QFile agentCSV(workingFolder + "/agents.csv");
-
-        if (agentCSV.exists())
+        QStringList folders;
+        folders << "gq" << "lq" << "tn";
+        QStringList prefixes;
+        prefixes << "g" << "w" << "t";
+
+        QSqlQuery imageQry;
+        imageQry.setForwardOnly(true);
+        QString imageWhere = where;
+        if (since >= 0)
+            imageWhere = filtered(where, ExportLog::changedCondition("images", since));
+        imageQry.exec("SELECT fileName, photographerCode FROM " + tpref + "images" + imageWhere);
+        while (imageQry.next())
         {
-            if (QMessageBox::No == QMessageBox(QMessageBox::Information, "File already exists",
-                                                "Caution - agents.csv already exists in this folder.\nAre you sure you want to overwrite it?",
-                                                QMessageBox::Yes|QMessageBox::No).exec())
+            QString fileName = imageQry.value(0).toString();
+            QString photographer = imageQry.value(1).toString();
+            for (int i = 0; i < folders.size(); i++)
             {
-                QMessageBox msgBox;
-                msgBox.setText("Saving was canceled.");
-                msgBox.exec();
-                return;
+                QString name = folders.at(i) + "/" + photographer + "/" + prefixes.at(i) + fileName;
+                if (!QFile::exists(baseFolder + "/" + name))
+                    continue;
+
+                ArchiveEntry entry;
+                entry.name = name;
+                entry.sourcePath = baseFolder + "/" + name;
+                entries << entry;
             }
         }
+    }
 
-        if (!agentCSV.open(QFile::WriteOnly | QFile::Text))
-        {
-            QMessageBox msgBox;
-            msgBox.setText("Could not open agents.csv for writing.");
-            msgBox.exec();
-            return;
-        }
-
-        QString agentHeader = "dcterms_identifier|dc_contributor|iri|contactURL|morphbankUserID|dcterms_modified|type";
-        QTextStream agentsOut(&agentCSV);
-        agentsOut.setCodec("UTF-8");
-        agentsOut << agentHeader;
+    QByteArray deletions;
+    if (since >= 0)
+        deletions = deletionsCSV(since);
 
-        for (Agent agent : changedAgents)
-        {
-            if (agent.getAgentCode().isEmpty())
-                continue;
+    if (entries.isEmpty() && deletions.isEmpty())
+    {
+        QMessageBox msgBox;
+        msgBox.setText("There is nothing to export.");
+        msgBox.exec();
+        return;
+    }
 
-            // fields contains everything except agent.ID, which is handled separately
-            QStringList fields;
-            fields << agent.getFullName() << agent.getAgentURI()
-                   << agent.getContactURL() << agent.getMorphbankID() << agent.getLastModified() << agent.getAgentType();
+    // the archive is written in one pass on a worker thread, every entry streamed through
+    // ZipWriter, so memory use doesn't depend on the size of the tables or images
+    QFutureWatcher<QString> watcher;
+    QEventLoop loop;
+    connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+    watcher.setFuture(QtConcurrent::run(&ExportCSV::writeArchive, archivePath, entries, deletions));
+    if (!watcher.isFinished())
+        loop.exec(QEventLoop::ExcludeUserInputEvents);
+    QString error = watcher.result();
 
-            QString row = "\n" + agent.getAgentCode();
-            for (QString field : fields)
-            {
-                // if the field contains any pipes surround the entire field in quotes
-                if (field.contains("|"))
-                    row = row + "|\"" + field + "\"";
-                else
-                    row = row + "|" + field;
-            }
+    if (error.isEmpty() && incremental && tpref.isEmpty())
+        ExportLog::setWatermark(archivePath, sequence);
 
-            agentsOut << row;
-        }
+    QMessageBox msgBox;
+    if (error.isEmpty())
+        msgBox.setText("Data saved to " + QFileInfo(archivePath).fileName() + " successfully.");
+    else
+        msgBox.setText(error);
+    msgBox.exec();
+}
 
-        agentCSV.flush();
-        agentCSV.close();
+QList<ExportCSV::TableExport> ExportCSV::tableExports(const QString &allWhere, const QString &tpref, qint64 since)
+{
+    // with a watermark, each table is further limited to the rows changed after it
+    QHash<QString, QString> whereFor;
+    for (auto t : QStringList() << "images" << "organisms" << "determinations" << "agents" << "sensu" << "taxa")
+        whereFor.insert(t, since < 0 ? allWhere : filtered(allWhere, ExportLog::changedCondition(t, since)));
+
+    QList<TableExport> tables;
+    TableExport images;
+    images.fileName = "images.csv";
+    images.header = TableSchema<Image>::header();
+    images.query = TableSchema<Image>::select(tpref + "images") + whereFor.value("images");
+    images.formats = QVector<int>(TableSchema<Image>::size, Plain);
+    images.formats[TableSchema<Image>::index("dwc_coordinateUncertaintyInMeters")] = CoordinateUncertainty;
+    images.formats[TableSchema<Image>::index("ac_attributionLinkURL")] = AttributionURL;
+    images.identifierColumn = TableSchema<Image>::index("dcterms_identifier");
+    tables << images;
+
+    TableExport organisms;
+    organisms.fileName = "organisms.csv";
+    organisms.header = TableSchema<Organism>::header();
+    organisms.query = TableSchema<Organism>::select(tpref + "organisms") + whereFor.value("organisms");
+    organisms.formats = QVector<int>(TableSchema<Organism>::size, Plain);
+    organisms.formats[TableSchema<Organism>::index("dwc_establishmentMeans")] = EstablishmentMeans;
+    tables << organisms;
+
+    // it's not a determination if it hasn't been determined
+    TableExport determinations;
+    determinations.fileName = "determinations.csv";
+    determinations.header = TableSchema<Determination>::header();
+    determinations.query = TableSchema<Determination>::select(tpref + "determinations") + filtered(whereFor.value("determinations"), "tsnID != ''");
+    determinations.formats = QVector<int>(TableSchema<Determination>::size, Plain);
+    determinations.formats[TableSchema<Determination>::index("nameAccordingToID")] = NameAccordingTo;
+    tables << determinations;
+
+    TableExport agents;
+    agents.fileName = "agents.csv";
+    agents.header = "dcterms_identifier|dc_contributor|iri|contactURL|morphbankUserID|dcterms_modified|type";
+    agents.query = "select * from " + tpref + "agents" + filtered(whereFor.value("agents"), "dcterms_identifier != ''");
+    tables << agents;
+
+    TableExport sensu;
+    sensu.fileName = "sensu.csv";
+    sensu.header = TableSchema<Sensu>::header();
+    sensu.query = TableSchema<Sensu>::select(tpref + "sensu") + filtered(whereFor.value("sensu"), "dcterms_identifier != ''");
+    tables << sensu;
+
+    // only export tsnIDs from actual determinations
+    TableExport taxa;
+    taxa.fileName = "names.csv";
+    taxa.header = TableSchema<Taxa>::header();
+    taxa.query = TableSchema<Taxa>::select(tpref + "taxa") + filtered(whereFor.value("taxa"), "dcterms_identifier IN (SELECT tsnID FROM " +
+                 tpref + "determinations" + filtered(allWhere, "tsnID != ''") + ")");
+    tables << taxa;
+
+    // only tables with something to export are kept
+    QList<TableExport> withRows;
+    for (auto job : tables)
+    {
+        QSqlQuery countQry;
+        countQry.exec("SELECT 1 FROM (" + job.query + ") LIMIT 1");
+        if (!countQry.next())
+            continue;
+
+        if (!job.formats.contains(AttributionURL))
+            job.identifierColumn = -1;
+        withRows << job;
     }
+    return withRows;
+}
 
-    // Save sensu data to <working_folder>/sensu.csv
-    QSqlQuery sensuChanges;
-    sensuChanges.prepare("select dcterms_identifier, dc_creator, tcsSignature, dcterms_title, dc_publisher, "
-                         "dcterms_created, iri, dcterms_modified from " + tpref + "sensu" + where);
-    sensuChanges.exec();
-    QList<Sensu> changedSensus;
-    while (sensuChanges.next())
+bool ExportCSV::confirmOverwrite(const QString &path)
+{
+    if (!QFile::exists(path))
+        return true;
+
+    if (QMessageBox::No == QMessageBox(QMessageBox::Information, "File already exists",
+                                        "Caution - " + QFileInfo(path).fileName() + " already exists in this folder.\nAre you sure you want to overwrite it?",
+                                        QMessageBox::Yes|QMessageBox::No).exec())
     {
-        Sensu newSensu;
-        newSensu.identifier = sensuChanges.value(0).toString();
-        newSensu.creator = sensuChanges.value(1).toString();
-        newSensu.tcsSignature = sensuChanges.value(2).toString();
-        newSensu.title = sensuChanges.value(3).toString();
-        newSensu.publisher = sensuChanges.value(4).toString();
-        newSensu.dcterms_created = sensuChanges.value(5).toString();
-        newSensu.iri = sensuChanges.value(6).toString();
-        newSensu.lastModified = sensuChanges.value(7).toString();
-
-        changedSensus << newSensu;
+        QMessageBox msgBox;
+        msgBox.setText("Saving was canceled.");
+        msgBox.exec();
+        return false;
     }
+    return true;
+}
 
-    if (!changedSensus.isEmpty())
+QByteArray ExportCSV::deletionsCSV(qint64 since)
+{
+    // the identifier is dcterms_identifier, or dsw_identified for determinations,
+    // whose other key columns are only filled in for them
+    QList<QStringList> rows = ExportLog::deletions(since);
+    if (rows.isEmpty())
+        return QByteArray();
+
+    QByteArray csv = "table|identifier|dwc_dateIdentified|tsnID|nameAccordingToID";
+    for (auto row : rows)
     {
-        QFile sensuCSV(workingFolder + "/sensu.csv");
-
-        if (sensuCSV.exists())
+        csv.append('\n');
+        for (int i = 0; i < row.size(); i++)
         {
-            if (QMessageBox::No == QMessageBox(QMessageBox::Information, "File already exists",
-                                                "Caution - sensu.csv already exists in this folder.\nAre you sure you want to overwrite it?",
-                                                QMessageBox::Yes|QMessageBox::No).exec())
-            {
-                QMessageBox msgBox;
-                msgBox.setText("Saving was canceled.");
-                msgBox.exec();
-                return;
-            }
+            if (i > 0)
+                csv.append('|');
+            appendField(csv, row.at(i));
         }
+    }
+    return csv;
+}
 
-        if (!sensuCSV.open(QFile::WriteOnly | QFile::Text))
-        {
-            QMessageBox msgBox;
-            msgBox.setText("Could not open sensus.csv for writing.");
-            msgBox.exec();
-            return;
-        }
+QString ExportCSV::writeTable(const TableExport &job)
+{
+    QFile csv(job.fileName);
+    if (!csv.open(QFile::WriteOnly | QFile::Text))
+        return "Could not open " + QFileInfo(job.fileName).fileName() + " for writing.";
 
-        QString sensuHeader = "dcterms_identifier|dc_creator|tcsSignature|dcterms_title|dc_publisher|dcterms_created|iri|dcterms_modified";
-        QTextStream sensusOut(&sensuCSV);
-        sensusOut.setCodec("UTF-8");
-        sensusOut << sensuHeader;
+    QString error = writeRows(job, &csv);
+    csv.close();
+    return error;
+}
 
-        for (Sensu sensu : changedSensus)
+QString ExportCSV::writeRows(const TableExport &job, QIODevice *out)
+{
+    // rows are appended to one buffer that's written out whenever it fills,
+    // so memory use doesn't depend on the size of the table
+    const int blockSize = 1 << 20;
+    QString error;
+    QSqlDatabase db = DatabaseConnections::connection();
+    if (!db.isOpen())
+        error = "Could not open the database to export " + QFileInfo(job.fileName).fileName() + ".";
+    else
+    {
+        QByteArray buffer;
+        buffer.reserve(blockSize + 4096);
+        buffer.append(job.header.toUtf8());
+
+        QSqlQuery rows(db);
+        rows.setForwardOnly(true);
+        rows.exec(job.query);
+        const int columns = rows.record().count();
+        while (rows.next())
         {
-            if (sensu.identifier.isEmpty())
-                continue;
-
-            // fields contains everything except sensu.ID, which is handled separately
-            QStringList fields;
-            fields << sensu.creator << sensu.tcsSignature << sensu.title
-                   << sensu.publisher << sensu.dcterms_created << sensu.iri << sensu.lastModified;
-
-            QString row = "\n" + sensu.identifier;
-            for (QString field : fields)
+            buffer.append('\n');
+            for (int i = 0; i < columns; i++)
             {
-                // if the field contains any pipes surround the entire field in quotes
-                if (field.contains("|"))
-                    row = row + "|\"" + field + "\"";
-                else
-                    row = row + "|" + field;
+                QString field = rows.value(i).toString();
+                switch (job.formats.value(i, Plain))
+                {
+                case CoordinateUncertainty:
+                    if (field.isEmpty())
+                        field = "1000";
+                    break;
+                case EstablishmentMeans:
+                    if (field.isEmpty())
+                        field = "uncertain";
+                    break;
+                case AttributionURL:
+                    field = rows.value(job.identifierColumn).toString() + ".htm";
+                    break;
+                case NameAccordingTo:
+                    field = field.split(" ").last();
+                    field.remove("(");
+                    field.remove(")");
+                    if (field.isEmpty())
+                        field = "nominal";
+                    break;
+                default:
+                    break;
+                }
+
+                if (i > 0)
+                    buffer.append('|');
+                appendField(buffer, field);
             }
 
-            sensusOut << row;
+            if (buffer.size() >= blockSize)
+            {
+                if (out->write(buffer) != buffer.size())
+                {
+                    error = "Could not write " + QFileInfo(job.fileName).fileName() + ".";
+                    break;
+                }
+                buffer.resize(0);
+            }
         }
 
-        sensuCSV.flush();
-        sensuCSV.close();
+        if (error.isEmpty() && out->write(buffer) != buffer.size())
+            error = "Could not write " + QFileInfo(job.fileName).fileName() + ".";
     }
+    return error;
+}
 
-    // Save taxa data to <working_folder>/names.csv
-    QSqlQuery taxaChanges;
-    taxaChanges.prepare("select * from " + tpref + "taxa" + where);
-    taxaChanges.exec();
-    QList<Taxa> changedTaxa;
-    while (taxaChanges.next())
+QString ExportCSV::writeArchive(const QString &archivePath, const QList<ArchiveEntry> &entries, const QByteArray &deletions)
+{
+    QSaveFile archive(archivePath);
+    if (!archive.open(QIODevice::WriteOnly))
+        return "Could not open " + QFileInfo(archivePath).fileName() + " for writing.";
+
+    ZipWriter zip(&archive);
+    QString manifest;
+    QString error;
+    QString writeError = "Could not write " + QFileInfo(archivePath).fileName() + ".";
+    for (auto entry : entries)
     {
-        Taxa taxon;
-        taxon.ubioID = taxaChanges.value(0).toString();
-        taxon.identifier = taxaChanges.value(1).toString();
-        taxon.kingdom = taxaChanges.value(2).toString();
-        taxon.className = taxaChanges.value(3).toString();
-        taxon.order = taxaChanges.value(4).toString();
-        taxon.family = taxaChanges.value(5).toString();
-        taxon.genus = taxaChanges.value(6).toString();
-        taxon.species = taxaChanges.value(7).toString();
-        taxon.subspecies = taxaChanges.value(8).toString();
-        taxon.taxonRank = taxaChanges.value(9).toString();
-        taxon.authorship = taxaChanges.value(10).toString();
-        taxon.vernacular = taxaChanges.value(11).toString();
-        taxon.lastModified = taxaChanges.value(12).toString();
-
-        changedTaxa << taxon;
+        // the derivatives are JPEGs, which don't get any smaller
+        QIODevice *out = zip.open(entry.name, entry.sourcePath.isEmpty());
+        if (entry.sourcePath.isEmpty())
+            error = writeRows(entry.table, out);
+        else
+            error = copyFile(entry.sourcePath, out);
+        if (!zip.close() && error.isEmpty())
+            error = writeError;
+        if (!error.isEmpty())
+            break;
+        manifest += QString::fromLatin1(zip.sha256()) + "  " + entry.name + "\n";
     }
 
-    if (!changedTaxa.isEmpty())
+    if (error.isEmpty() && !deletions.isEmpty())
     {
-        QFile taxaCSV(workingFolder + "/names.csv");
+        if (!zip.add("deletions.csv", deletions, true))
+            error = writeError;
+        manifest += QString::fromLatin1(zip.sha256()) + "  deletions.csv\n";
+    }
 
-        if (taxaCSV.exists())
-        {
-            if (QMessageBox::No == QMessageBox(QMessageBox::Information, "File already exists",
-                                                "Caution - names.csv already exists in this folder.\nAre you sure you want to overwrite it?",
-                                                QMessageBox::Yes|QMessageBox::No).exec())
-            {
-                QMessageBox msgBox;
-                msgBox.setText("Saving was canceled.");
-                msgBox.exec();
-                return;
-            }
-        }
+    // checksums.sha256 can be checked with 'sha256sum -c' after unpacking
+    if (error.isEmpty() && (!zip.add("checksums.sha256", manifest.toUtf8(), true) || !zip.finish() || !archive.commit()))
+        error = writeError;
+    if (!error.isEmpty())
+        archive.cancelWriting();
+    return error;
+}
 
-        if (!taxaCSV.open(QFile::WriteOnly | QFile::Text))
-        {
-            QMessageBox msgBox;
-            msgBox.setText("Could not open names.csv for writing.");
-            msgBox.exec();
-            return;
-        }
+QString ExportCSV::copyFile(const QString &path, QIODevice *out)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return "Could not read " + path + ".";
 
-        QString taxaHeader = "ubioID|dcterms_identifier|dwc_kingdom|dwc_class|dwc_order|dwc_family|dwc_genus|dwc_specificEpithet|dwc_infraspecificEpithet|dwc_taxonRank|dwc_scientificNameAuthorship|dwc_vernacularName|dcterms_modified";
-        QTextStream taxaOut(&taxaCSV);
-        taxaOut.setCodec("UTF-8");
-        taxaOut << taxaHeader;
+    QByteArray block;
+    while (!(block = file.read(1 << 20)).isEmpty())
+    {
+        if (out->write(block) != block.size())
+            return "Could not write " + QFileInfo(path).fileName() + ".";
+    }
+    if (file.error() != QFile::NoError)
+        return "Could not read " + path + ".";
+    return "";
+}
 
-        tsnIDs.removeDuplicates();
-        for (Taxa taxon : changedTaxa)
+void ExportCSV::appendField(QByteArray &buffer, const QString &field)
+{
+    // surround fields that would break the line apart in quotes, doubling any quotes inside
+    bool quote = false;
+    for (auto c : field)
+    {
+        if (c == '|' || c == '"' || c == '\n' || c == '\r')
         {
-            if (taxon.identifier.isEmpty())
-                continue;
-            // only export tsnIDs from actual determinations
-            if (!tsnIDs.contains(taxon.identifier))
-                continue;
-
-            // fields contains everything except taxon.ubioID, which is handled separately
-            QStringList fields;
-            fields << taxon.identifier << taxon.kingdom << taxon.className
-                   << taxon.order << taxon.family << taxon.genus << taxon.species
-                   << taxon.subspecies << taxon.taxonRank << taxon.authorship
-                   << taxon.vernacular << taxon.lastModified;
-
-            QString row = "\n" + taxon.ubioID;
-            for (QString field : fields)
-            {
-                // if the field contains any pipes surround the entire field in quotes
-                if (field.contains("|"))
-                    row = row + "|\"" + field + "\"";
-                else
-                    row = row + "|" + field;
-            }
-
-            taxaOut << row;
+            quote = true;
+            break;
         }
+    }
 
-        taxaCSV.close();
+    if (!quote)
+    {
+        buffer.append(field.toUtf8());
+        return;
     }
 
-    QMessageBox msgBox;
-    msgBox.setText("Data saved to CSV files successfully.");
-    msgBox.exec();
+    QString quoted = field;
+    quoted.replace("\"", "\"\"");
+    buffer.append('"');
+    buffer.append(quoted.toUtf8());
+    buffer.append('"');
 }
 
+QString ExportCSV::filtered(const QString &where, const QString &condition)
+{
+    if (where.isEmpty())
+        return " where " + condition;
+    return where + " AND " + condition;
+}
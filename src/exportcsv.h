@@ -24,6 +24,9 @@
 #define EXPORTCSV_H
 
 #include <QObject>
+#include <QVector>
+
+#include "zipwriter.h"
 
 class ExportCSV : public QObject
 {
@@ -32,13 +35,44 @@ public:
     explicit ExportCSV(QObject *parent = 0);
     ~ExportCSV();
     void saveData(const QString &where, const QString &tpref);
+    void saveArchive(const QString &where, const QString &tpref);
+    void setIncremental(bool state);
 
 signals:
 
 public slots:
 
 private:
+    // how a column's value is written when it differs from the stored value
+    enum ColumnFormat { Plain, CoordinateUncertainty, EstablishmentMeans, AttributionURL, NameAccordingTo };
+
+    struct TableExport
+    {
+        QString fileName;
+        QString header;
+        QString query;
+        QVector<int> formats;   // ColumnFormat per column; empty when every column is Plain
+        int identifierColumn;
+    };
+
+    // one file in a submission archive: a table export, or a derivative image read from sourcePath
+    struct ArchiveEntry
+    {
+        QString name;
+        TableExport table;
+        QString sourcePath;
+    };
 
+    static QList<TableExport> tableExports(const QString &allWhere, const QString &tpref, qint64 since);
+    static bool confirmOverwrite(const QString &path);
+    static QByteArray deletionsCSV(qint64 since);
+    static QString writeTable(const TableExport &job);
+    static QString writeRows(const TableExport &job, QIODevice *out);
+    static QString writeArchive(const QString &archivePath, const QList<ArchiveEntry> &entries, const QByteArray &deletions);
+    static QString copyFile(const QString &path, QIODevice *out);
+    static void appendField(QByteArray &buffer, const QString &field);
+    static QString filtered(const QString &where, const QString &condition);
+    bool incremental;
 };
 
 #endif // EXPORTCSV_H
@@ -0,0 +1,234 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+
+#include "exportlog.h"
+
+QStringList ExportLog::tables()
+{
+    QStringList list;
+    list << "agents" << "determinations" << "images" << "organisms" << "sensu" << "taxa";
+    return list;
+}
+
+void ExportLog::prepareTables()
+{
+    QSqlDatabase db = QSqlDatabase::database();
+    db.transaction();
+
+    // rowKey is dcterms_identifier, or dsw_identified for determinations, whose
+    // other key columns are only needed to write tombstones
+    QSqlQuery qry;
+    qry.exec("CREATE TABLE IF NOT EXISTS export_changelog (seq INTEGER PRIMARY KEY AUTOINCREMENT, "
+             "tableName TEXT, rowKey TEXT, dateIdentified TEXT, tsnID TEXT, nameAccordingToID TEXT, operation TEXT)");
+    qry.exec("CREATE INDEX IF NOT EXISTS export_changelog_table ON export_changelog (tableName, seq)");
+
+    for (auto t : tables())
+        createTriggers(t);
+
+    if (!db.commit())
+    {
+        qDebug() << __LINE__ << "Problem with database transaction";
+        db.rollback();
+    }
+
+    prune();
+}
+
+QString ExportLog::keyColumns(const QString &table, const QString &prefix)
+{
+    if (table == "determinations")
+        return prefix + "dsw_identified, " + prefix + "dwc_dateIdentified, " + prefix + "tsnID, " + prefix + "nameAccordingToID";
+    return prefix + "dcterms_identifier, NULL, NULL, NULL";
+}
+
+void ExportLog::createTriggers(const QString &table)
+{
+    QString keyChanged = "OLD.dcterms_identifier IS NOT NEW.dcterms_identifier";
+    if (table == "determinations")
+    {
+        keyChanged = "OLD.dsw_identified IS NOT NEW.dsw_identified OR OLD.dwc_dateIdentified IS NOT NEW.dwc_dateIdentified "
+                     "OR OLD.tsnID IS NOT NEW.tsnID OR OLD.nameAccordingToID IS NOT NEW.nameAccordingToID";
+    }
+    QString newKeys = keyColumns(table, "NEW.");
+    QString oldKeys = keyColumns(table, "OLD.");
+    QString columns = "INSERT INTO export_changelog (tableName, rowKey, dateIdentified, tsnID, nameAccordingToID, operation) ";
+
+    QStringList triggers;
+    triggers << "CREATE TRIGGER IF NOT EXISTS " + table + "_changelog_insert AFTER INSERT ON " + table + " BEGIN " +
+                columns + "VALUES ('" + table + "', " + newKeys + ", 'insert'); END";
+    // an update that changes the key also removes the row under its old key
+    triggers << "CREATE TRIGGER IF NOT EXISTS " + table + "_changelog_update AFTER UPDATE ON " + table + " BEGIN " +
+                columns + "VALUES ('" + table + "', " + newKeys + ", 'update'); " +
+                columns + "SELECT '" + table + "', " + oldKeys + ", 'delete' WHERE " + keyChanged + "; END";
+    triggers << "CREATE TRIGGER IF NOT EXISTS " + table + "_changelog_delete AFTER DELETE ON " + table + " BEGIN " +
+                columns + "VALUES ('" + table + "', " + oldKeys + ", 'delete'); END";
+    for (auto trigger : triggers)
+    {
+        QSqlQuery triggerQry;
+        if (!triggerQry.exec(trigger))
+            qDebug() << "Problem creating export changelog trigger on " + table + ": " + triggerQry.lastError().text();
+    }
+}
+
+void ExportLog::dropTriggers(const QString &table)
+{
+    QSqlQuery qry;
+    qry.exec("DROP TRIGGER IF EXISTS " + table + "_changelog_insert");
+    qry.exec("DROP TRIGGER IF EXISTS " + table + "_changelog_update");
+    qry.exec("DROP TRIGGER IF EXISTS " + table + "_changelog_delete");
+}
+
+void ExportLog::suspend(const QStringList &reloading)
+{
+    // a reload deletes and reinserts every row, which the triggers would log twice over (and
+    // which stops SQLite truncating the table), so they come off until resume() and the rows
+    // as they were are kept to compare against. Call both inside the reload's transaction.
+    for (auto t : reloading)
+    {
+        if (!tables().contains(t))
+            continue;
+
+        dropTriggers(t);
+        QSqlQuery qry;
+        qry.exec("DROP TABLE IF EXISTS temp.export_before_" + t);
+        if (!qry.exec("CREATE TEMP TABLE export_before_" + t + " AS SELECT * FROM " + t))
+            qDebug() << __LINE__ << "Problem saving " + t + " before reload: " + qry.lastError().text();
+    }
+}
+
+void ExportLog::resume()
+{
+    // log only the rows whose content the reload actually changed
+    QString columns = "INSERT INTO export_changelog (tableName, rowKey, dateIdentified, tsnID, nameAccordingToID, operation) ";
+    for (auto t : tables())
+    {
+        QSqlQuery existsQry;
+        existsQry.prepare("SELECT 1 FROM sqlite_temp_master WHERE type = 'table' AND name = (?)");
+        existsQry.addBindValue("export_before_" + t);
+        existsQry.exec();
+        if (!existsQry.next())
+            continue;
+
+        QString before = "temp.export_before_" + t;
+        QSqlQuery qry;
+        if (!qry.exec(columns + "SELECT '" + t + "', " + keyColumns(t, "") + ", 'update' FROM "
+                      "(SELECT * FROM " + t + " EXCEPT SELECT * FROM " + before + ")"))
+            qDebug() << __LINE__ << "Problem logging reloaded " + t + ": " + qry.lastError().text();
+        // rows that were changed rather than removed still exist, so deletions() doesn't tombstone them
+        if (!qry.exec(columns + "SELECT '" + t + "', " + keyColumns(t, "") + ", 'delete' FROM "
+                      "(SELECT * FROM " + before + " EXCEPT SELECT * FROM " + t + ")"))
+            qDebug() << __LINE__ << "Problem logging reloaded " + t + ": " + qry.lastError().text();
+
+        qry.exec("DROP TABLE " + before);
+        createTriggers(t);
+    }
+}
+
+qint64 ExportLog::currentSequence()
+{
+    QSqlQuery qry;
+    qry.exec("SELECT MAX(seq) FROM export_changelog");
+    if (qry.next())
+        return qry.value(0).toLongLong();
+    return 0;
+}
+
+qint64 ExportLog::watermark(const QString &destination)
+{
+    QSqlQuery qry;
+    qry.prepare("SELECT value FROM settings WHERE setting = (?)");
+    qry.addBindValue("export.watermark." + destination);
+    qry.exec();
+    if (qry.next())
+        return qry.value(0).toLongLong();
+    return -1;
+}
+
+void ExportLog::setWatermark(const QString &destination, qint64 sequence)
+{
+    QSqlQuery qry;
+    qry.prepare("INSERT OR REPLACE INTO settings (setting, value) VALUES (?, ?)");
+    qry.addBindValue("export.watermark." + destination);
+    qry.addBindValue(sequence);
+    qry.exec();
+
+    prune();
+}
+
+void ExportLog::prune()
+{
+    // nothing needs entries that every destination has already exported, and
+    // without any destination the log only matters from the next export on
+    qint64 oldest = currentSequence();
+    QSqlQuery qry;
+    qry.exec("SELECT MIN(CAST(value AS INTEGER)) FROM settings WHERE setting LIKE 'export.watermark.%'");
+    if (qry.next() && !qry.value(0).isNull())
+        oldest = qry.value(0).toLongLong();
+
+    QSqlQuery deleteQry;
+    deleteQry.prepare("DELETE FROM export_changelog WHERE seq <= (?)");
+    deleteQry.addBindValue(oldest);
+    deleteQry.exec();
+}
+
+QString ExportLog::changedCondition(const QString &table, qint64 since)
+{
+    // determinations are matched by organism, so a change exports all of that organism's determinations
+    QString keyColumn = table == "determinations" ? "dsw_identified" : "dcterms_identifier";
+    return keyColumn + " IN (SELECT rowKey FROM export_changelog WHERE tableName = '" + table +
+            "' AND seq > " + QString::number(since) + " AND operation != 'delete')";
+}
+
+QList<QStringList> ExportLog::deletions(qint64 since)
+{
+    // rows deleted and inserted again (a full reload, say) still exist, so they aren't tombstoned
+    QList<QStringList> rows;
+    for (auto t : tables())
+    {
+        QString exists = "SELECT 1 FROM " + t + " WHERE dcterms_identifier = c.rowKey";
+        if (t == "determinations")
+        {
+            exists = "SELECT 1 FROM determinations d WHERE d.dsw_identified = c.rowKey AND "
+                     "d.dwc_dateIdentified IS c.dateIdentified AND d.tsnID IS c.tsnID AND "
+                     "d.nameAccordingToID IS c.nameAccordingToID";
+        }
+
+        QSqlQuery qry;
+        qry.setForwardOnly(true);
+        qry.prepare("SELECT DISTINCT c.rowKey, c.dateIdentified, c.tsnID, c.nameAccordingToID FROM export_changelog c "
+                    "WHERE c.tableName = (?) AND c.seq > (?) AND c.operation = 'delete' AND NOT EXISTS (" + exists + ")");
+        qry.addBindValue(t);
+        qry.addBindValue(since);
+        qry.exec();
+        while (qry.next())
+        {
+            QStringList row;
+            row << t << qry.value(0).toString() << qry.value(1).toString() << qry.value(2).toString() << qry.value(3).toString();
+            rows << row;
+        }
+    }
+    return rows;
+}
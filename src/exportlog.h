@@ -0,0 +1,55 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef EXPORTLOG_H
+#define EXPORTLOG_H
+
+#include <QtCore>
+
+// Records which rows of the data tables change, so an export can write only
+// what changed since the last export to the same destination. Triggers on
+// each table append the row's key to export_changelog, whose sequence number
+// is the watermark saved per destination (export.watermark.<destination> in
+// settings). Entries every destination has already seen are pruned. Bulk
+// reloads wrap themselves in suspend()/resume() so only rows whose content
+// changed are logged.
+class ExportLog
+{
+public:
+    static void prepareTables();
+    static qint64 currentSequence();
+    static qint64 watermark(const QString &destination);
+    static void setWatermark(const QString &destination, qint64 sequence);
+    static QString changedCondition(const QString &table, qint64 since);
+    static QList<QStringList> deletions(qint64 since);
+    static void suspend(const QStringList &reloading);
+    static void resume();
+
+private:
+    static QStringList tables();
+    static QString keyColumns(const QString &table, const QString &prefix);
+    static void createTriggers(const QString &table);
+    static void dropTriggers(const QString &table);
+    static void prune();
+};
+
+#endif // EXPORTLOG_H
@@ -0,0 +1,290 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <cmath>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QtMath>
+
+#include "geocodecache.h"
+#include "preparedquery.h"
+
+const int GeocodeCache::fullPrecision;
+
+GeocodeCache::GeocodeCache()
+{
+    precision = defaultPrecision;
+    tolerance = defaultTolerance;
+}
+
+void GeocodeCache::prepareTable()
+{
+    QSqlDatabase db = QSqlDatabase::database();
+    db.transaction();
+
+    QSqlQuery qry;
+    qry.exec("CREATE TABLE IF NOT EXISTS geocode_cache (latitude TEXT, longitude TEXT, expires TEXT, "
+             "continent TEXT, country TEXT, stateProvince TEXT, county TEXT, locality TEXT, geonamesAdmin TEXT, "
+             "geohash TEXT, PRIMARY KEY(latitude, longitude))");
+
+    if (db.record("geocode_cache").indexOf("geohash") == -1)
+        qry.exec("ALTER TABLE geocode_cache ADD COLUMN geohash TEXT");
+    qry.exec("CREATE INDEX IF NOT EXISTS geocode_cache_geohash ON geocode_cache (geohash)");
+
+    // fill in the geohash of rows cached before the column existed
+    QSqlQuery rowsQuery;
+    rowsQuery.exec("SELECT rowid, latitude, longitude FROM geocode_cache WHERE geohash IS NULL");
+    QSqlQuery updateQuery;
+    updateQuery.prepare("UPDATE geocode_cache SET geohash = (?) WHERE rowid = (?)");
+    while (rowsQuery.next())
+    {
+        bool latOK, lonOK;
+        double lat = rowsQuery.value(1).toDouble(&latOK);
+        double lon = rowsQuery.value(2).toDouble(&lonOK);
+        if (!latOK || !lonOK)
+            continue;
+        updateQuery.addBindValue(geohash(lat, lon));
+        updateQuery.addBindValue(rowsQuery.value(0));
+        updateQuery.exec();
+    }
+
+    if (!db.commit())
+    {
+        qDebug() << __LINE__ << "Problem with database transaction";
+        db.rollback();
+    }
+}
+
+QString GeocodeCache::geohash(double latitude, double longitude, int precision)
+{
+    static const char base32[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+
+    double latRange[2] = { -90.0, 90.0 };
+    double lonRange[2] = { -180.0, 180.0 };
+    QString hash;
+    bool evenBit = true;
+    int bit = 0;
+    int ch = 0;
+    while (hash.size() < precision)
+    {
+        // bits alternate between longitude and latitude, starting with longitude
+        double *range = evenBit ? lonRange : latRange;
+        double value = evenBit ? longitude : latitude;
+        double mid = (range[0] + range[1]) / 2;
+        ch <<= 1;
+        if (value >= mid)
+        {
+            ch |= 1;
+            range[0] = mid;
+        }
+        else
+            range[1] = mid;
+        evenBit = !evenBit;
+
+        if (++bit == 5)
+        {
+            hash.append(QLatin1Char(base32[ch]));
+            bit = 0;
+            ch = 0;
+        }
+    }
+    return hash;
+}
+
+void GeocodeCache::loadSettings()
+{
+    precision = defaultPrecision;
+    tolerance = defaultTolerance;
+
+    QSqlQuery qry;
+    qry.prepare("SELECT setting, value FROM settings WHERE setting IN (?, ?)");
+    qry.addBindValue("geocode.cacheprecision");
+    qry.addBindValue("geocode.cachetolerance");
+    qry.exec();
+    while (qry.next())
+    {
+        bool ok;
+        double value = qry.value(1).toDouble(&ok);
+        if (!ok)
+            continue;
+        if (qry.value(0).toString() == "geocode.cacheprecision")
+            precision = qBound(1, int(value), fullPrecision);
+        else
+            tolerance = qMax(0.0, value);
+    }
+}
+
+QStringList GeocodeCache::coveringCells(double latitude, double longitude) const
+{
+    // the tolerance as degrees at this latitude
+    double dLat = tolerance / 111320.0;
+    double dLon = tolerance / (111320.0 * qMax(0.01, std::cos(qDegreesToRadians(latitude))));
+
+    // use larger cells than configured if needed, so that the cells at the corners of the
+    // tolerance box (at most four) cover all of it
+    int p = precision;
+    while (p > 1)
+    {
+        int lonBits = (5 * p + 1) / 2;
+        int latBits = 5 * p / 2;
+        if (360.0 / (1 << lonBits) >= 2 * dLon && 180.0 / (1 << latBits) >= 2 * dLat)
+            break;
+        p--;
+    }
+
+    QStringList cells;
+    cells << geohash(latitude, longitude, p);
+    for (int i = -1; i <= 1; i += 2)
+    {
+        for (int j = -1; j <= 1; j += 2)
+        {
+            double lat = qBound(-90.0, latitude + i * dLat, 90.0);
+            double lon = longitude + j * dLon;
+            if (lon > 180.0)
+                lon -= 360.0;
+            else if (lon < -180.0)
+                lon += 360.0;
+            QString cell = geohash(lat, lon, p);
+            if (!cells.contains(cell))
+                cells << cell;
+        }
+    }
+    return cells;
+}
+
+void GeocodeCache::prefetch(const QList<QPointF> &coordinates)
+{
+    loadSettings();
+    entries.clear();
+
+    QSet<QString> cellSet;
+    for (auto c : coordinates)
+        for (auto cell : coveringCells(c.y(), c.x()))
+            cellSet.insert(cell);
+    if (cellSet.isEmpty())
+        return;
+
+    // each cell is a range of the geohash index; '~' sorts after every geohash character
+    QStringList cells = cellSet.toList();
+    const int cellsPerQuery = 200;
+    for (int start = 0; start < cells.size(); start += cellsPerQuery)
+    {
+        QStringList ranges;
+        QList<QString> bounds;
+        for (int i = start; i < qMin(start + cellsPerQuery, cells.size()); i++)
+        {
+            ranges << "(geohash >= ? AND geohash < ?)";
+            bounds << cells.at(i) << cells.at(i) + "~";
+        }
+
+        PreparedQuery qry("SELECT geohash, latitude, longitude, continent, country, stateProvince, county, locality, geonamesAdmin "
+                          "FROM geocode_cache WHERE expires > (?) AND (" + ranges.join(" OR ") + ")");
+        qry.bind(QDate::currentDate().toString("yyyy-MM-dd"));
+        for (auto b : bounds)
+            qry.bind(b);
+        qry.exec();
+        while (qry.next())
+        {
+            Entry e;
+            e.geohash = qry.string(0);
+            e.latitude = qry.value(1).toDouble();
+            e.longitude = qry.value(2).toDouble();
+            e.result.continent = qry.string(3);
+            e.result.countryCode = qry.string(4);
+            e.result.stateProvince = qry.string(5);
+            e.result.county = qry.string(6);
+            e.result.locality = qry.string(7);
+            e.result.geonamesAdmin = qry.string(8);
+            e.result.distance = 0;
+            entries.append(e);
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.geohash < b.geohash; });
+}
+
+bool GeocodeCache::lookup(double latitude, double longitude, GeocodeResult &result) const
+{
+    const Entry *best = 0;
+    double bestDistance = tolerance;
+    for (auto cell : coveringCells(latitude, longitude))
+    {
+        auto it = std::lower_bound(entries.begin(), entries.end(), cell,
+                                   [](const Entry &e, const QString &key) { return e.geohash < key; });
+        for (; it != entries.end() && it->geohash.startsWith(cell); ++it)
+        {
+            double d = distanceInMeters(latitude, longitude, it->latitude, it->longitude);
+            if (d <= bestDistance)
+            {
+                bestDistance = d;
+                best = &(*it);
+            }
+        }
+    }
+    if (!best)
+        return false;
+
+    result = best->result;
+    result.distance = bestDistance / 1000.0;
+    return true;
+}
+
+void GeocodeCache::store(const QString &latitude, const QString &longitude, const GeocodeResult &result)
+{
+    Entry e;
+    e.latitude = latitude.toDouble();
+    e.longitude = longitude.toDouble();
+    e.geohash = geohash(e.latitude, e.longitude);
+    e.result = result;
+
+    PreparedQuery cacheQuery("INSERT OR REPLACE INTO geocode_cache (latitude, longitude, "
+                             "expires, continent, country, stateProvince, county, locality, "
+                             "geonamesAdmin, geohash) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    cacheQuery.bind(latitude);
+    cacheQuery.bind(longitude);
+    cacheQuery.bind(QDate::currentDate().addYears(1).toString("yyyy-MM-dd"));
+    cacheQuery.bind(result.continent);
+    cacheQuery.bind(result.countryCode);
+    cacheQuery.bind(result.stateProvince);
+    cacheQuery.bind(result.county);
+    cacheQuery.bind(result.locality);
+    cacheQuery.bind(result.geonamesAdmin);
+    cacheQuery.bind(e.geohash);
+    cacheQuery.exec();
+
+    // later lookups in the same batch can use it too
+    auto it = std::lower_bound(entries.begin(), entries.end(), e.geohash,
+                               [](const Entry &a, const QString &key) { return a.geohash < key; });
+    entries.insert(it, e);
+}
+
+double GeocodeCache::distanceInMeters(double lat1, double lon1, double lat2, double lon2)
+{
+    double dLat = qDegreesToRadians(lat2 - lat1);
+    double dLon = qDegreesToRadians(lon2 - lon1);
+    double a = std::sin(dLat / 2) * std::sin(dLat / 2) +
+            std::cos(qDegreesToRadians(lat1)) * std::cos(qDegreesToRadians(lat2)) *
+            std::sin(dLon / 2) * std::sin(dLon / 2);
+    return 6371000.0 * 2 * std::atan2(std::sqrt(a), std::sqrt(1 - a));
+}
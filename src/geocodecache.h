@@ -0,0 +1,72 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GEOCODECACHE_H
+#define GEOCODECACHE_H
+
+#include <QtCore>
+
+#include "offlinegeocoder.h"
+
+// Finds geocode_cache entries near a coordinate instead of at exactly the same
+// coordinate. Each row carries a geohash of its latitude and longitude, and since
+// a geohash prefix is a grid cell, every entry within the distance tolerance is
+// in one of the few cells around the coordinate. prefetch() reads the cells for
+// a whole batch of coordinates in one query, after which lookup() is in memory.
+//
+// The cell size (geohash precision) and tolerance (meters) are the
+// geocode.cacheprecision and geocode.cachetolerance settings.
+class GeocodeCache
+{
+public:
+    GeocodeCache();
+
+    static void prepareTable();
+    static QString geohash(double latitude, double longitude, int precision = fullPrecision);
+
+    void prefetch(const QList<QPointF> &coordinates);   // x is longitude, y is latitude
+    bool lookup(double latitude, double longitude, GeocodeResult &result) const;
+    void store(const QString &latitude, const QString &longitude, const GeocodeResult &result);
+
+    static const int fullPrecision = 12;
+    static const int defaultPrecision = 6;
+    static const int defaultTolerance = 100;
+
+private:
+    struct Entry
+    {
+        QString geohash;
+        double latitude;
+        double longitude;
+        GeocodeResult result;
+    };
+
+    void loadSettings();
+    QStringList coveringCells(double latitude, double longitude) const;
+    static double distanceInMeters(double lat1, double lon1, double lat2, double lon2);
+
+    QVector<Entry> entries;   // sorted by geohash, so each cell is a contiguous range
+    int precision;
+    double tolerance;
+};
+
+#endif // GEOCODECACHE_H
@@ -0,0 +1,253 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <QSqlQuery>
+
+#include "geocodescheduler.h"
+
+GeocodeScheduler::GeocodeScheduler(QObject *parent) :
+    QObject(parent)
+{
+    nextDispatch = 0;
+    running = false;
+    maxInFlight = defaultMaxInFlight;
+    requestsPerSecond = 1.0;   // the Nominatim usage policy's limit
+    maxRetries = defaultMaxRetries;
+
+    dispatchTimer.setSingleShot(true);
+    connect(&dispatchTimer, SIGNAL(timeout()), this, SLOT(dispatch()));
+    clock.start();
+}
+
+void GeocodeScheduler::loadSettings()
+{
+    QSqlQuery qry;
+    qry.prepare("SELECT setting, value FROM settings WHERE setting IN (?, ?, ?, ?)");
+    qry.addBindValue("url.reversegeocode");
+    qry.addBindValue("geocode.maxinflight");
+    qry.addBindValue("geocode.requestspersecond");
+    qry.addBindValue("geocode.maxretries");
+    qry.exec();
+    while (qry.next())
+    {
+        QString setting = qry.value(0).toString();
+        QString value = qry.value(1).toString();
+        if (setting == "url.reversegeocode")
+            setBaseUrl(value);
+        else if (setting == "geocode.maxinflight")
+            setMaxInFlight(value.toInt());
+        else if (setting == "geocode.requestspersecond")
+            setRequestsPerSecond(value.toDouble());
+        else if (setting == "geocode.maxretries")
+            setMaxRetries(value.toInt());
+    }
+}
+
+void GeocodeScheduler::setBaseUrl(const QString &url)
+{
+    baseUrl = url;
+}
+
+void GeocodeScheduler::setMaxInFlight(int requests)
+{
+    maxInFlight = qMax(1, requests);
+}
+
+void GeocodeScheduler::setRequestsPerSecond(double requests)
+{
+    // zero or less means no limit
+    requestsPerSecond = requests;
+}
+
+void GeocodeScheduler::setMaxRetries(int retries)
+{
+    maxRetries = qMax(0, retries);
+}
+
+QString GeocodeScheduler::coordinateKey(const QString &latitude, const QString &longitude)
+{
+    return latitude + "," + longitude;
+}
+
+bool GeocodeScheduler::isRunning() const
+{
+    return running;
+}
+
+void GeocodeScheduler::enqueue(const QString &latitude, const QString &longitude)
+{
+    QString key = coordinateKey(latitude, longitude);
+    if (seen.contains(key))
+        return;
+    seen.insert(key);
+
+    Request request;
+    request.latitude = latitude;
+    request.longitude = longitude;
+    request.url = QUrl(baseUrl + "format=json&lat=" + latitude + "&lon=" + longitude);
+    request.attempt = 0;
+    request.redirects = 0;
+    request.notBefore = 0;
+    queue.append(request);
+
+    if (running)
+        dispatch();
+}
+
+void GeocodeScheduler::start()
+{
+    running = true;
+    dispatch();
+    finishIfDone();
+}
+
+void GeocodeScheduler::dispatch()
+{
+    if (!running)
+        return;
+
+    qint64 interval = requestsPerSecond > 0 ? qint64(1000.0 / requestsPerSecond) : 0;
+    while (inFlight.size() < maxInFlight && !queue.isEmpty())
+    {
+        qint64 now = clock.elapsed();
+
+        // the first request that isn't waiting on a retry backoff
+        int ready = -1;
+        qint64 earliest = -1;
+        for (int i = 0; i < queue.size(); i++)
+        {
+            if (queue.at(i).notBefore <= now)
+            {
+                ready = i;
+                break;
+            }
+            if (earliest == -1 || queue.at(i).notBefore < earliest)
+                earliest = queue.at(i).notBefore;
+        }
+
+        qint64 wait = nextDispatch - now;
+        if (ready == -1)
+            wait = qMax(wait, earliest - now);
+        if (wait > 0)
+        {
+            if (!dispatchTimer.isActive() || dispatchTimer.remainingTime() > wait)
+                dispatchTimer.start(int(wait));
+            return;
+        }
+
+        nextDispatch = now + interval;
+        send(queue.takeAt(ready));
+    }
+}
+
+void GeocodeScheduler::send(Request request)
+{
+    qDebug() << "Making a request to: " + request.url.toString();
+    QNetworkReply *reply = manager.get(QNetworkRequest(request.url));
+    inFlight.insert(reply, request);
+    connect(reply, SIGNAL(finished()), this, SLOT(requestFinished()));
+}
+
+bool GeocodeScheduler::retry(Request request, QNetworkReply *reply)
+{
+    // retry dropped connections, timeouts, rate limiting and server errors, but not bad requests
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    bool transient = status == 429 || status >= 500 || status == 0;
+    if (!transient || request.attempt >= maxRetries)
+        return false;
+
+    qint64 delay = qint64(baseBackoff) << request.attempt;
+    if (reply->hasRawHeader("Retry-After"))
+        delay = qMax(delay, reply->rawHeader("Retry-After").toLongLong() * 1000);
+    request.attempt++;
+    request.notBefore = clock.elapsed() + delay;
+    queue.append(request);
+
+    qDebug() << "Retrying reverse geocoding request in " + QString::number(delay) + " ms: " + reply->errorString();
+    return true;
+}
+
+void GeocodeScheduler::requestFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply || !inFlight.contains(reply))
+        return;
+    Request request = inFlight.take(reply);
+
+    QVariant redirectionTarget = reply->attribute(QNetworkRequest::RedirectionTargetAttribute);
+    if (reply->error())
+    {
+        if (!retry(request, reply))
+        {
+            qDebug() << "Reverse geocoding failed: " + reply->errorString();
+            GeocodeResponse response;
+            response.latitude = request.latitude;
+            response.longitude = request.longitude;
+            response.ok = false;
+            response.error = reply->errorString();
+            responses.append(response);
+        }
+    }
+    else if (!redirectionTarget.isNull() && ++request.redirects > maxRedirects)
+    {
+        qDebug() << "Too many redirects for reverse geocoding request: " + request.url.toString();
+        GeocodeResponse response;
+        response.latitude = request.latitude;
+        response.longitude = request.longitude;
+        response.ok = false;
+        response.error = "Too many redirects";
+        responses.append(response);
+    }
+    else if (!redirectionTarget.isNull())
+    {
+        request.url = request.url.resolved(redirectionTarget.toUrl());
+        qDebug() << "Redirecting reverse geocoding request to: " + request.url.toString();
+        request.notBefore = 0;
+        queue.prepend(request);
+    }
+    else
+    {
+        GeocodeResponse response;
+        response.latitude = request.latitude;
+        response.longitude = request.longitude;
+        response.body = reply->readAll();
+        response.ok = true;
+        responses.append(response);
+    }
+
+    reply->deleteLater();
+    dispatch();
+    finishIfDone();
+}
+
+void GeocodeScheduler::finishIfDone()
+{
+    if (!running || !queue.isEmpty() || !inFlight.isEmpty())
+        return;
+
+    running = false;
+    dispatchTimer.stop();
+    QList<GeocodeResponse> batch = responses;
+    responses.clear();
+    seen.clear();
+    emit batchFinished(batch);
+}
@@ -0,0 +1,109 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GEOCODESCHEDULER_H
+#define GEOCODESCHEDULER_H
+
+#include <QObject>
+#include <QtCore>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+
+struct GeocodeResponse
+{
+    QString latitude;
+    QString longitude;
+    QByteArray body;
+    bool ok;
+    QString error;
+};
+
+// Sends reverse geocoding requests for a batch of coordinates, keeping up to
+// maxInFlight requests open at once while never starting more than
+// requestsPerSecond of them. Repeated coordinates are only requested once, and
+// failed requests are retried with exponential backoff. The responses are
+// handed back together in batchFinished() so they can be saved at once.
+//
+// The service is whatever url.reversegeocode points to, so a local server
+// returning canned Nominatim JSON can stand in for it.
+class GeocodeScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit GeocodeScheduler(QObject *parent = 0);
+
+    void loadSettings();
+    void setBaseUrl(const QString &url);
+    void setMaxInFlight(int requests);
+    void setRequestsPerSecond(double requests);
+    void setMaxRetries(int retries);
+
+    void enqueue(const QString &latitude, const QString &longitude);
+    void start();
+    bool isRunning() const;
+
+    static QString coordinateKey(const QString &latitude, const QString &longitude);
+
+signals:
+    void batchFinished(const QList<GeocodeResponse> &responses);
+
+private slots:
+    void dispatch();
+    void requestFinished();
+
+private:
+    struct Request
+    {
+        QString latitude;
+        QString longitude;
+        QUrl url;
+        int attempt;
+        int redirects;
+        qint64 notBefore;   // ms on clock, for requests waiting to be retried
+    };
+
+    void send(Request request);
+    bool retry(Request request, QNetworkReply *reply);
+    void finishIfDone();
+
+    QNetworkAccessManager manager;
+    QString baseUrl;
+    QList<Request> queue;
+    QSet<QString> seen;
+    QHash<QNetworkReply*,Request> inFlight;
+    QList<GeocodeResponse> responses;
+    QTimer dispatchTimer;
+    QElapsedTimer clock;
+    qint64 nextDispatch;
+    bool running;
+
+    int maxInFlight;
+    double requestsPerSecond;
+    int maxRetries;
+
+    static const int defaultMaxInFlight = 2;
+    static const int defaultMaxRetries = 3;
+    static const int baseBackoff = 1000;   // ms before the first retry, doubling after that
+    static const int maxRedirects = 5;
+};
+
+#endif // GEOCODESCHEDULER_H
@@ -0,0 +1,224 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <QDir>
+#include <QFileInfo>
+#include <QtConcurrent>
+
+#include "hotfolderwatcher.h"
+#include "imageidentifiers.h"
+#include "contenthashes.h"
+
+HotFolderWatcher::HotFolderWatcher(const QString &folder, const QString &nameSpace,
+                                   const QString &exifLocation, QObject *parent) :
+    QObject(parent)
+{
+    watchedFolder = folder;
+    this->nameSpace = nameSpace;
+    this->exifLocation = exifLocation;
+
+    // a burst of directory events only restarts the settle timer
+    settleTimer.setSingleShot(true);
+    settleTimer.setInterval(settleMsecs);
+    connect(&watcher, SIGNAL(directoryChanged(QString)), &settleTimer, SLOT(start()));
+    connect(&settleTimer, SIGNAL(timeout()), this, SLOT(rescan()));
+
+    rescanTimer.setInterval(rescanMsecs);
+    connect(&rescanTimer, SIGNAL(timeout()), this, SLOT(rescan()));
+
+    ps.setProcessChannelMode(QProcess::MergedChannels);
+    connect(&ps, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(exifToolFinished()));
+    connect(&ps, SIGNAL(error(QProcess::ProcessError)), this, SLOT(exifToolError(QProcess::ProcessError)));
+
+    connect(&hashWatcher, SIGNAL(finished()), this, SLOT(hashesFinished()));
+}
+
+QString HotFolderWatcher::folder() const
+{
+    return watchedFolder;
+}
+
+void HotFolderWatcher::start(const QStringList &knownFiles)
+{
+    // files DataEntry already has are never picked up again
+    for (auto f : knownFiles)
+        handled.insert(QFileInfo(f).absoluteFilePath());
+
+    if (!watcher.addPath(watchedFolder))
+        qDebug() << __LINE__ << "Could not watch folder: " + watchedFolder + ". Relying on periodic rescans.";
+    rescanTimer.start();
+    rescan();
+}
+
+void HotFolderWatcher::rescan()
+{
+    // the files this one would have settled are found by the next rescan; hashing is only
+    // cleared in hashesFinished(), since the watcher stops running before that is delivered
+    if (!hashing.isEmpty())
+        return;
+
+    QDir dir(watchedFolder);
+    QStringList filters;
+    filters << "*.jpg" << "*.jpeg";
+    QFileInfoList entries = dir.entryInfoList(filters, QDir::Files | QDir::Readable, QDir::Name);
+
+    QStringList settled;
+    for (auto fileInfo : entries)
+    {
+        QString f = fileInfo.absoluteFilePath();
+        if (handled.contains(f))
+            continue;
+
+        qint64 size = fileInfo.size();
+        if (size > 0 && pendingSizes.value(f, -1) == size)
+        {
+            settled.append(f);
+            pendingSizes.remove(f);
+        }
+        else
+            pendingSizes.insert(f, size);
+    }
+
+    // files still being written get another look shortly
+    if (!pendingSizes.isEmpty())
+        settleTimer.start();
+
+    if (settled.isEmpty())
+        return;
+
+    QStringList containedSpaces;
+    QStringList baseNames;
+    QHash<QString,QString> baseToFileHash;
+    for (auto f : settled)
+    {
+        handled.insert(f);
+        QString base = QFileInfo(f).fileName();
+        if (base.contains(" "))
+        {
+            containedSpaces.append(f);
+            continue;
+        }
+        baseNames.append(base);
+        baseToFileHash.insert(base, f);
+    }
+
+    QStringList collisions;
+    for (auto base : ImageIdentifiers::collisions(nameSpace, baseNames))
+    {
+        baseNames.removeOne(base);
+        collisions.append(baseToFileHash.value(base));
+    }
+
+    if (!containedSpaces.isEmpty())
+        emit imagesRejected(containedSpaces, "Image filenames must not contain spaces.");
+    if (!collisions.isEmpty())
+        emit imagesRejected(collisions, "These filenames already exist in the '" + nameSpace + "' namespace.");
+
+    for (auto base : baseNames)
+        hashing.append(baseToFileHash.value(base));
+    if (hashing.isEmpty())
+        return;
+
+    // hashing whole files takes a while during a card dump, so it's kept off the GUI thread
+    hashWatcher.setFuture(QtConcurrent::run(&ContentHashes::hashFiles, hashing));
+}
+
+void HotFolderWatcher::hashesFinished()
+{
+    QStringList candidates = hashing;
+    hashing.clear();
+
+    // copies of images that are already catalogued, perhaps under another name
+    QHash<QString, QString> hashes = hashWatcher.result();
+    QHash<QString, QString> catalogued = ContentHashes::catalogued(hashes.values());
+    QStringList alreadyCatalogued;
+    for (auto f : candidates)
+    {
+        if (catalogued.contains(hashes.value(f)))
+            alreadyCatalogued.append(f);
+        else
+        {
+            if (hashes.contains(f))
+                contentHashes.insert(f, hashes.value(f));
+            queued.append(f);
+        }
+    }
+    if (!alreadyCatalogued.isEmpty())
+        emit imagesRejected(alreadyCatalogued, "These images are already in the database.");
+
+    if (ps.state() == QProcess::NotRunning)
+        runExifTool();
+}
+
+void HotFolderWatcher::runExifTool()
+{
+    if (queued.isEmpty())
+        return;
+
+    // same command line limit as DataEntry::runExifTool()
+    QString filesToScan = "";
+    scanning.clear();
+    while (!queued.isEmpty() && (scanning.isEmpty() || filesToScan.length() + queued.first().length() < 31000))
+    {
+        QString f = queued.takeFirst();
+        filesToScan += "\"" + f + "\" ";
+        scanning.append(f);
+    }
+
+    QString exifParams = "-c \%+.6f -filename -datetimeoriginal -focallength -gpslatitude -gpslongitude -gpsaltitude -imagewidth -imageheight -createdate -modifydate -filemodifydate -Orientation -n -T";
+    QString exifCmd = "\"" + exifLocation + "\" " + filesToScan + exifParams;
+
+    ps.start(exifCmd);
+}
+
+void HotFolderWatcher::exifToolFinished()
+{
+    QString exifOutput = ps.readAll();
+    QStringList batch = scanning;
+    scanning.clear();
+
+    QHash<QString, QString> batchHashes;
+    for (auto f : batch)
+    {
+        if (contentHashes.contains(f))
+            batchHashes.insert(f, contentHashes.take(f));
+    }
+
+    // start on the next batch before DataEntry stores this one
+    runExifTool();
+
+    emit imagesReady(batch, exifOutput, batchHashes);
+}
+
+void HotFolderWatcher::exifToolError(QProcess::ProcessError error)
+{
+    // finished() never comes when ExifTool can't start, so give the batch back
+    if (error != QProcess::FailedToStart)
+        return;
+
+    qDebug() << __LINE__ << "Could not start ExifTool: " + exifLocation;
+    QStringList batch = scanning + queued;
+    scanning.clear();
+    queued.clear();
+    contentHashes.clear();
+    emit imagesRejected(batch, "ExifTool could not be started.");
+}
@@ -0,0 +1,84 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef HOTFOLDERWATCHER_H
+#define HOTFOLDERWATCHER_H
+
+#include <QtCore>
+#include <QFileSystemWatcher>
+#include <QProcess>
+#include <QFutureWatcher>
+
+// Watches a folder that a card reader or tethered camera writes into and feeds
+// new JPEGs to DataEntry in batches. A file is taken once its size has stopped
+// changing between two scans, so half-copied files are left alone. Settled
+// files go through the same checks as ProcessNewImages (no spaces, no filename
+// collision in the namespace, content not already catalogued, with the hashing
+// on worker threads) and then ExifTool; imagesReady() hands over each batch
+// with its ExifTool rows and content hashes while the watcher goes on
+// collecting the next one. The QFileSystemWatcher events only trigger a
+// rescan; the periodic rescan catches whatever they miss.
+class HotFolderWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HotFolderWatcher(const QString &folder, const QString &nameSpace,
+                              const QString &exifLocation, QObject *parent = 0);
+
+    void start(const QStringList &knownFiles);
+    QString folder() const;
+
+signals:
+    void imagesReady(const QStringList &fileNames, const QString &exifOutput, const QHash<QString, QString> &contentHashes);
+    void imagesRejected(const QStringList &fileNames, const QString &reason);
+
+private slots:
+    void rescan();
+    void hashesFinished();
+    void exifToolFinished();
+    void exifToolError(QProcess::ProcessError error);
+
+private:
+    void runExifTool();
+
+    QString watchedFolder;
+    QString nameSpace;
+    QString exifLocation;
+
+    QFileSystemWatcher watcher;
+    QTimer settleTimer;
+    QTimer rescanTimer;
+    QProcess ps;
+    QFutureWatcher<QHash<QString, QString> > hashWatcher;
+    QStringList hashing;
+
+    QHash<QString, qint64> pendingSizes;
+    QSet<QString> handled;
+    QStringList queued;
+    QStringList scanning;
+    QHash<QString, QString> contentHashes;
+
+    static const int settleMsecs = 2000;
+    static const int rescanMsecs = 15000;
+};
+
+#endif // HOTFOLDERWATCHER_H
@@ -0,0 +1,151 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+
+#include "idallocator.h"
+
+const QString idBase = "http://bioimages.vanderbilt.edu/";
+
+QString IdAllocator::identifier(const QString &nameSpace, const QString &localID)
+{
+    return idBase + nameSpace + "/" + localID;
+}
+
+void IdAllocator::split(const QString &identifier, QString &nameSpace, QString &localID)
+{
+    // same split as the image_ids table uses
+    QString rest = identifier.startsWith(idBase) ? identifier.mid(idBase.length()) : identifier;
+    int slash = rest.indexOf("/");
+    nameSpace = slash >= 0 ? rest.left(slash) : rest;
+    localID = slash >= 0 ? rest.mid(slash + 1) : "";
+}
+
+void IdAllocator::load()
+{
+    used.clear();
+    marks.clear();
+    dirty.clear();
+
+    QSqlQuery qry;
+    qry.setForwardOnly(true);
+    qry.exec("SELECT namespace, localID FROM image_ids");
+    while (qry.next())
+        used["images"][qry.value(0).toString()].insert(qry.value(1).toString());
+
+    qry.exec("SELECT dcterms_identifier FROM organisms");
+    while (qry.next())
+        claim("organisms", qry.value(0).toString());
+
+    qry.prepare("SELECT setting, value FROM settings WHERE setting IN (?, ?)");
+    qry.addBindValue("last.organismnumber");
+    qry.addBindValue("org.scheme.number");
+    qry.exec();
+    while (qry.next())
+    {
+        bool ok;
+        int next = qry.value(1).toInt(&ok);
+        if (ok)
+            marks.insert(qry.value(0).toString(), next);
+    }
+}
+
+bool IdAllocator::contains(const QString &table, const QString &identifier) const
+{
+    QString nameSpace, localID;
+    split(identifier, nameSpace, localID);
+    return used.value(table).value(nameSpace).contains(localID);
+}
+
+bool IdAllocator::claim(const QString &table, const QString &identifier)
+{
+    // returns false if the identifier was already taken in that table
+    QString nameSpace, localID;
+    split(identifier, nameSpace, localID);
+    QSet<QString> &ids = used[table][nameSpace];
+    if (ids.contains(localID))
+        return false;
+    ids.insert(localID);
+    return true;
+}
+
+QString IdAllocator::allocate(const QString &table, const QString &nameSpace, const QString &prefix, const QString &counter)
+{
+    // the first free <prefix><number> in the table's namespace, starting from the counter
+    QSet<QString> &ids = used[table][nameSpace];
+    int next = mark(counter);
+    while (ids.contains(prefix + QString::number(next)))
+        next++;
+
+    QString localID = prefix + QString::number(next);
+    ids.insert(localID);
+    marks.insert(counter, next + 1);
+    dirty.insert(counter);
+    return identifier(nameSpace, localID);
+}
+
+QStringList IdAllocator::reserve(const QString &table, const QString &nameSpace, const QString &prefix, const QString &counter, int count)
+{
+    // allocates a whole range, then advances the stored counter once
+    QStringList ids;
+    for (int i = 0; i < count; i++)
+        ids << allocate(table, nameSpace, prefix, counter);
+    save();
+    return ids;
+}
+
+void IdAllocator::save()
+{
+    // writes the counters that moved; run it inside the transaction that inserts the new rows
+    // so the identifiers and the counters are committed together
+    if (dirty.isEmpty())
+        return;
+
+    QSqlQuery qry;
+    qry.prepare("INSERT OR REPLACE INTO settings (setting, value) VALUES (?, ?)");
+    QVariantList settings;
+    QVariantList values;
+    for (auto counter : dirty)
+    {
+        settings << counter;
+        values << marks.value(counter);
+    }
+    qry.addBindValue(settings);
+    qry.addBindValue(values);
+    if (!qry.execBatch())
+        qDebug() << __LINE__ << "Problem saving identifier counters: " + qry.lastError().text();
+    dirty.clear();
+}
+
+int IdAllocator::mark(const QString &counter) const
+{
+    // the next number to try; 10001 follows the historical default of last.organismnumber
+    return marks.value(counter, 10001);
+}
+
+void IdAllocator::setMark(const QString &counter, int next)
+{
+    marks.insert(counter, next);
+    dirty.insert(counter);
+}
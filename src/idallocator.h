@@ -0,0 +1,60 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef IDALLOCATOR_H
+#define IDALLOCATOR_H
+
+#include <QtCore>
+
+// Hands out image and organism identifiers
+// (http://bioimages.vanderbilt.edu/<namespace>/<localID>). The identifiers
+// already in use are loaded once into sets per table ("images" or "organisms")
+// and namespace, so checking a candidate never touches the database; an image
+// and an organism may share a local ID. Numbered identifiers come from
+// counters kept in the settings table (e.g. "last.organismnumber"), each
+// holding the next number to try; a counter is written back once per batch
+// rather than once per identifier.
+class IdAllocator
+{
+public:
+    static QString identifier(const QString &nameSpace, const QString &localID);
+
+    void load();
+    bool contains(const QString &table, const QString &identifier) const;
+    bool claim(const QString &table, const QString &identifier);
+
+    QString allocate(const QString &table, const QString &nameSpace, const QString &prefix, const QString &counter);
+    QStringList reserve(const QString &table, const QString &nameSpace, const QString &prefix, const QString &counter, int count);
+    void save();
+
+    int mark(const QString &counter) const;
+    void setMark(const QString &counter, int next);
+
+private:
+    static void split(const QString &identifier, QString &nameSpace, QString &localID);
+
+    QHash<QString, QHash<QString, QSet<QString>>> used;
+    QHash<QString, int> marks;
+    QSet<QString> dirty;
+};
+
+#endif // IDALLOCATOR_H
@@ -26,6 +26,8 @@
 #include <QTimeZone>
 #include "image.h"
 
+constexpr SchemaColumn<Image> RowSchema<Image>::columns[];
+
 Image::Image()
 {
     Initialize();
@@ -111,3 +113,30 @@ void Image::Initialize()
     depicts = "";
     suppress = "";
 }
+
+void Image::splitCreated()
+{
+    // fill date, time and timezone from dcterms_created (yyyy-MM-ddThh:mm:ss+hh:mm)
+    QStringList dateTimeSplit = dcterms_created.split("T");
+    if (dateTimeSplit.size() == 2)
+    {
+        date = dateTimeSplit.at(0);
+        QString dateTime = dateTimeSplit.at(1);
+        QString timeNoTZ = dateTime;
+        QString tz = "";
+        if (dateTime.contains("-"))
+        {
+            timeNoTZ = dateTime.split("-").at(0);
+            tz = "-" + dateTime.split("-").at(1);
+        }
+        else if (dateTime.contains("+"))
+        {
+            timeNoTZ = dateTime.split("+").at(0);
+            tz = "+" + dateTime.split("+").at(1);
+        }
+        time = timeNoTZ;
+        timezone = tz;
+    }
+    else
+        date = dcterms_created;
+}
@@ -25,12 +25,15 @@
 
 #include <QtCore>
 
+#include "tableschema.h"
+
 class Image
 {
 public:
     Image();
     ~Image();
     void Initialize();
+    void splitCreated();
 
     QString fileAndPath;
     QString groupOfSpecimen;
@@ -81,4 +84,51 @@ public:
     QString suppress;
 };
 
+// the columns of the image table, in table order
+template <>
+struct RowSchema<Image>
+{
+    static constexpr SchemaColumn<Image> columns[] = {
+        { "fileName",                          &Image::fileName },
+        { "focalLength",                       &Image::focalLength },
+        { "dwc_georeferenceRemarks",           &Image::georeferenceRemarks },
+        { "dwc_decimalLatitude",               &Image::decimalLatitude },
+        { "dwc_decimalLongitude",              &Image::decimalLongitude },
+        { "geo_alt",                           &Image::altitudeInMeters },
+        { "exif_PixelXDimension",              &Image::width },
+        { "exif_PixelYDimension",              &Image::height },
+        { "dwc_occurrenceRemarks",             &Image::occurrenceRemarks },
+        { "dwc_geodeticDatum",                 &Image::geodeticDatum },
+        { "dwc_coordinateUncertaintyInMeters", &Image::coordinateUncertaintyInMeters },
+        { "dwc_locality",                      &Image::locality },
+        { "dwc_countryCode",                   &Image::countryCode },
+        { "dwc_stateProvince",                 &Image::stateProvince },
+        { "dwc_county",                        &Image::county },
+        { "dwc_informationWithheld",           &Image::informationWithheld },
+        { "dwc_dataGeneralizations",           &Image::dataGeneralizations },
+        { "dwc_continent",                     &Image::continent },
+        { "geonamesAdmin",                     &Image::geonamesAdmin },
+        { "geonamesOther",                     &Image::geonamesOther },
+        { "dcterms_identifier",                &Image::identifier },
+        { "dcterms_modified",                  &Image::lastModified },
+        { "dcterms_title",                     &Image::title },
+        { "dcterms_description",               &Image::description },
+        { "ac_caption",                        &Image::caption },
+        { "photographerCode",                  &Image::photographerCode },
+        { "dcterms_created",                   &Image::dcterms_created },
+        { "photoshop_Credit",                  &Image::credit },
+        { "owner",                             &Image::copyrightOwnerID },
+        { "dcterms_dateCopyrighted",           &Image::copyrightYear },
+        { "dc_rights",                         &Image::copyrightStatement },
+        { "xmpRights_Owner",                   &Image::copyrightOwnerName },
+        { "ac_attributionLinkURL",             &Image::attributionLinkURL },
+        { "ac_hasServiceAccessPoint",          &Image::urlToHighRes },
+        { "usageTermsIndex",                   &Image::usageTermsIndex },
+        { "view",                              &Image::imageView },
+        { "xmp_Rating",                        &Image::rating },
+        { "foaf_depicts",                      &Image::depicts },
+        { "suppress",                          &Image::suppress }
+    };
+};
+
 #endif // IMAGE_H
@@ -0,0 +1,201 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+
+#include "imagehashes.h"
+
+void ImageHashes::prepareTable()
+{
+    QSqlDatabase db = QSqlDatabase::database();
+    db.transaction();
+
+    QStringList statements;
+    statements << "CREATE TABLE IF NOT EXISTS image_hashes (dcterms_identifier TEXT PRIMARY KEY, dhash INTEGER)";
+    statements << "CREATE TRIGGER IF NOT EXISTS images_hashes_update AFTER UPDATE OF dcterms_identifier ON images BEGIN "
+                  "UPDATE image_hashes SET dcterms_identifier = NEW.dcterms_identifier "
+                  "WHERE dcterms_identifier = OLD.dcterms_identifier; END";
+
+    // merges and resets delete every image and insert it again, so hashes aren't dropped with
+    // the row; ones whose image is really gone are skipped when loading and pruned here
+    statements << "DROP TRIGGER IF EXISTS images_hashes_delete";
+    statements << "DELETE FROM image_hashes WHERE NOT EXISTS "
+                  "(SELECT 1 FROM images i WHERE i.dcterms_identifier = image_hashes.dcterms_identifier)";
+
+    for (auto statement : statements)
+    {
+        QSqlQuery qry;
+        if (!qry.exec(statement))
+            qDebug() << "Problem preparing image_hashes: " + qry.lastError().text();
+    }
+
+    if (!db.commit())
+    {
+        qDebug() << __LINE__ << "Problem with database transaction";
+        db.rollback();
+    }
+}
+
+quint64 ImageHashes::dHash(const QImage &image)
+{
+    // one bit per horizontally adjacent pair of a 9x8 grayscale copy: set where brightness increases
+    QImage small = image.scaled(9, 8, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)
+                        .convertToFormat(QImage::Format_Grayscale8);
+    quint64 hash = 0;
+    for (int y = 0; y < 8; y++)
+    {
+        const uchar *row = small.constScanLine(y);
+        for (int x = 0; x < 8; x++)
+        {
+            hash <<= 1;
+            if (row[x] < row[x + 1])
+                hash |= 1;
+        }
+    }
+    return hash;
+}
+
+int ImageHashes::distance(quint64 a, quint64 b)
+{
+    // qPopulationCount compiles to a single POPCNT where the CPU has one
+    return int(qPopulationCount(a ^ b));
+}
+
+void ImageHashes::store(const QString &identifier, quint64 hash)
+{
+    QSqlQuery qry;
+    qry.prepare("INSERT OR REPLACE INTO image_hashes (dcterms_identifier, dhash) VALUES (?, ?)");
+    qry.addBindValue(identifier);
+    qry.addBindValue(qint64(hash));    // SQLite integers are signed
+    if (!qry.exec())
+        qDebug() << __LINE__ << "Problem storing image hash: " + qry.lastError().text();
+}
+
+void ImageHashes::load()
+{
+    index.clear();
+    identifiers.clear();
+    hashes.clear();
+    for (int c = 0; c < chunkCount; c++)
+        chunks[c].clear();
+
+    // past 11 bits some chunk could differ in more than maxChunkRadius bits and be missed
+    duplicateDistance = 8;
+    QSqlQuery qry;
+    qry.prepare("SELECT value FROM settings WHERE setting = (?)");
+    qry.addBindValue("duplicates.maxdistance");
+    qry.exec();
+    if (qry.next())
+        duplicateDistance = qBound(0, qry.value(0).toInt(), chunkCount * (maxChunkRadius + 1) - 1);
+
+    QSqlQuery hashQry;
+    hashQry.setForwardOnly(true);
+    hashQry.exec("SELECT h.dcterms_identifier, h.dhash FROM image_hashes h "
+                 "JOIN images i ON i.dcterms_identifier = h.dcterms_identifier");
+    while (hashQry.next())
+        insert(hashQry.value(0).toString(), quint64(hashQry.value(1).toLongLong()));
+}
+
+void ImageHashes::insert(const QString &identifier, quint64 hash)
+{
+    int i = index.value(identifier, -1);
+    if (i == -1)
+    {
+        i = hashes.size();
+        index.insert(identifier, i);
+        identifiers.append(identifier);
+        hashes.append(hash);
+    }
+    else
+    {
+        for (int c = 0; c < chunkCount; c++)
+            chunks[c].remove(quint16(hashes.at(i) >> (16 * c)), i);
+        hashes[i] = hash;
+    }
+
+    for (int c = 0; c < chunkCount; c++)
+        chunks[c].insert(quint16(hash >> (16 * c)), i);
+}
+
+bool ImageHashes::contains(const QString &identifier) const
+{
+    return index.contains(identifier);
+}
+
+quint64 ImageHashes::hash(const QString &identifier) const
+{
+    int i = index.value(identifier, -1);
+    return i == -1 ? 0 : hashes.at(i);
+}
+
+QSet<QString> ImageHashes::hashed() const
+{
+    return QSet<QString>::fromList(identifiers);
+}
+
+int ImageHashes::maxDistance() const
+{
+    return duplicateDistance;
+}
+
+QVector<quint16> ImageHashes::probeMasks(int radius)
+{
+    // every 16-bit mask with at most radius bits set
+    QVector<quint16> masks;
+    masks << 0;
+    if (radius >= 1)
+        for (int i = 0; i < 16; i++)
+            masks << quint16(1 << i);
+    if (radius >= 2)
+        for (int i = 0; i < 16; i++)
+            for (int j = i + 1; j < 16; j++)
+                masks << quint16((1 << i) | (1 << j));
+    return masks;
+}
+
+QStringList ImageHashes::nearDuplicates(quint64 hash, const QString &except) const
+{
+    // the stored images within maxDistance() bits of hash
+    QVector<quint16> masks = probeMasks(duplicateDistance / chunkCount);
+
+    QSet<int> candidates;
+    for (int c = 0; c < chunkCount; c++)
+    {
+        quint16 chunk = quint16(hash >> (16 * c));
+        for (auto mask : masks)
+        {
+            quint16 key = chunk ^ mask;
+            for (auto it = chunks[c].find(key); it != chunks[c].end() && it.key() == key; ++it)
+                candidates.insert(it.value());
+        }
+    }
+
+    QStringList found;
+    for (auto i : candidates)
+    {
+        if (identifiers.at(i) != except && distance(hashes.at(i), hash) <= duplicateDistance)
+            found.append(identifiers.at(i));
+    }
+    return found;
+}
@@ -0,0 +1,66 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef IMAGEHASHES_H
+#define IMAGEHASHES_H
+
+#include <QtCore>
+#include <QImage>
+
+// 64-bit difference hashes (dHash) of image thumbnails, used to find
+// near-duplicate shots such as bursts and re-imports. The hashes live in the
+// image_hashes side table, keyed by the image's dcterms_identifier.
+//
+// Lookups use multi-index hashing: each hash is split into four 16-bit
+// chunks with an exact-match index per chunk. If two hashes differ in at
+// most d bits, one of their chunks differs in at most d / 4 bits, so probing
+// every chunk value within that radius finds all candidates, which are then
+// checked with a popcount of the XOR.
+class ImageHashes
+{
+public:
+    static void prepareTable();
+    static quint64 dHash(const QImage &image);
+    static int distance(quint64 a, quint64 b);
+    static void store(const QString &identifier, quint64 hash);
+
+    void load();
+    void insert(const QString &identifier, quint64 hash);
+    bool contains(const QString &identifier) const;
+    quint64 hash(const QString &identifier) const;
+    QSet<QString> hashed() const;
+    QStringList nearDuplicates(quint64 hash, const QString &except = "") const;
+    int maxDistance() const;
+
+private:
+    static const int chunkCount = 4;
+    static const int maxChunkRadius = 2;
+    static QVector<quint16> probeMasks(int radius);
+
+    QHash<QString, int> index;
+    QStringList identifiers;
+    QVector<quint64> hashes;
+    QMultiHash<quint16, int> chunks[chunkCount];
+    int duplicateDistance = 8;
+};
+
+#endif // IMAGEHASHES_H
@@ -0,0 +1,115 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+
+#include "imageidentifiers.h"
+
+QString ImageIdentifiers::idColumns(const QString &identifier, const QString &fileName, const QString &source)
+{
+    // selects (dcterms_identifier, namespace, localID, fileName) for the identifier expression, from source if given
+    QString rest = "CASE WHEN " + identifier + " LIKE 'http://bioimages.vanderbilt.edu/%' "
+                   "THEN substr(" + identifier + ", 33) ELSE " + identifier + " END";
+    return "SELECT id, CASE WHEN instr(rest, '/') > 0 THEN substr(rest, 1, instr(rest, '/') - 1) ELSE rest END, "
+           "CASE WHEN instr(rest, '/') > 0 THEN substr(rest, instr(rest, '/') + 1) ELSE '' END, fileName "
+           "FROM (SELECT " + identifier + " AS id, " + rest + " AS rest, " + fileName + " AS fileName" + source + ")";
+}
+
+void ImageIdentifiers::prepareTable()
+{
+    QSqlDatabase db = QSqlDatabase::database();
+    db.transaction();
+
+    QStringList statements;
+    statements << "CREATE TABLE IF NOT EXISTS image_ids (dcterms_identifier TEXT PRIMARY KEY, "
+                  "namespace TEXT, localID TEXT, fileName TEXT)";
+    statements << "CREATE INDEX IF NOT EXISTS image_ids_filename ON image_ids (namespace, fileName)";
+    statements << "CREATE INDEX IF NOT EXISTS image_ids_localid ON image_ids (namespace, localID)";
+    statements << "CREATE TRIGGER IF NOT EXISTS images_ids_insert AFTER INSERT ON images BEGIN "
+                  "INSERT OR REPLACE INTO image_ids " + idColumns("NEW.dcterms_identifier", "NEW.fileName", "") + "; END";
+    statements << "CREATE TRIGGER IF NOT EXISTS images_ids_update AFTER UPDATE OF dcterms_identifier, fileName ON images BEGIN "
+                  "DELETE FROM image_ids WHERE dcterms_identifier = OLD.dcterms_identifier; "
+                  "INSERT OR REPLACE INTO image_ids " + idColumns("NEW.dcterms_identifier", "NEW.fileName", "") + "; END";
+    statements << "CREATE TRIGGER IF NOT EXISTS images_ids_delete AFTER DELETE ON images BEGIN "
+                  "DELETE FROM image_ids WHERE dcterms_identifier = OLD.dcterms_identifier; END";
+
+    // catch up with rows from before the table existed
+    statements << "DELETE FROM image_ids WHERE NOT EXISTS "
+                  "(SELECT 1 FROM images i WHERE i.dcterms_identifier = image_ids.dcterms_identifier)";
+    statements << "INSERT INTO image_ids " + idColumns("i.dcterms_identifier", "i.fileName", " FROM images i WHERE NOT EXISTS "
+                      "(SELECT 1 FROM image_ids d WHERE d.dcterms_identifier = i.dcterms_identifier)");
+
+    for (auto statement : statements)
+    {
+        QSqlQuery qry;
+        if (!qry.exec(statement))
+            qDebug() << "Problem preparing image_ids: " + qry.lastError().text();
+    }
+
+    if (!db.commit())
+    {
+        qDebug() << __LINE__ << "Problem with database transaction";
+        db.rollback();
+    }
+}
+
+QStringList ImageIdentifiers::collisions(const QString &nameSpace, const QStringList &fileNames)
+{
+    // the selected file names that are already used by an image in the namespace
+    QStringList found;
+    if (fileNames.isEmpty())
+        return found;
+
+    QSqlDatabase db = QSqlDatabase::database();
+    db.transaction();
+
+    QSqlQuery qry;
+    qry.exec("CREATE TEMP TABLE IF NOT EXISTS selected_files (fileName TEXT PRIMARY KEY)");
+    qry.exec("DELETE FROM selected_files");
+
+    QSqlQuery insertQry;
+    insertQry.prepare("INSERT OR IGNORE INTO selected_files (fileName) VALUES (?)");
+    QVariantList names;
+    for (auto f : fileNames)
+        names << f;
+    insertQry.addBindValue(names);
+    if (!insertQry.execBatch())
+        qDebug() << "Problem storing the selected file names: " + insertQry.lastError().text();
+
+    QSqlQuery joinQry;
+    joinQry.prepare("SELECT s.fileName FROM selected_files s JOIN image_ids i "
+                    "ON i.namespace = (?) AND i.fileName = s.fileName GROUP BY s.fileName");
+    joinQry.addBindValue(nameSpace);
+    joinQry.exec();
+    while (joinQry.next())
+        found << joinQry.value(0).toString();
+
+    qry.exec("DELETE FROM selected_files");
+    if (!db.commit())
+    {
+        qDebug() << __LINE__ << "Problem with database transaction";
+        db.rollback();
+    }
+    return found;
+}
@@ -0,0 +1,44 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef IMAGEIDENTIFIERS_H
+#define IMAGEIDENTIFIERS_H
+
+#include <QtCore>
+
+// Keeps the namespace and local part of each image's dcterms_identifier
+// (http://bioimages.vanderbilt.edu/<namespace>/<localID>) in the indexed
+// image_ids table, next to its fileName. Triggers on images keep it current,
+// so lookups by namespace never have to parse identifiers. It's a side table
+// rather than new images columns because images is copied to and from its
+// tmp_ and pub_ twins with SELECT *.
+class ImageIdentifiers
+{
+public:
+    static void prepareTable();
+    static QStringList collisions(const QString &nameSpace, const QStringList &fileNames);
+
+private:
+    static QString idColumns(const QString &identifier, const QString &fileName, const QString &source);
+};
+
+#endif // IMAGEIDENTIFIERS_H
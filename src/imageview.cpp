@@ -0,0 +1,239 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "imageview.h"
+
+namespace {
+
+const int partSlots = 7;
+const int viewSlots = 7;
+
+struct PartEntry
+{
+    const char *name;
+    const char *views[viewSlots];
+};
+
+struct GroupEntry
+{
+    const char *name;
+    PartEntry parts[partSlots];
+};
+
+// A group's code is its index in this table; part and view codes are their
+// index plus one, 00 being "unspecified" at every level.
+constexpr GroupEntry table[] = {
+    { "unspecified", {
+        { "whole organism", {} } } },
+    { "woody angiosperms", {
+        { "whole tree (or vine)", { "general", "winter", "view up trunk" } },
+        { "bark", { "of a large tree", "of a medium tree or large branch", "of a small tree or small branch" } },
+        { "twig", { "orientation of petioles", "winter overall", "close-up winter leaf scar/bud", "close-up winter terminal bud" } },
+        { "leaf", { "whole upper surface", "margin of upper + lower surface", "showing orientation on twig" } },
+        { "inflorescence", { "whole - unspecified", "whole - female", "whole - male", "lateral view of flower",
+                             "frontal view of flower", "ventral view of flower + perianth", "close-up of flower interior" } },
+        { "fruit", { "as borne on the plant", "lateral or general close-up", "section or open", "immature" } },
+        { "seed", { "general view" } } } },
+    { "herbaceous angiosperms", {
+        { "whole plant", { "juvenile", "in flower - general view", "in fruit" } },
+        { "stem", { "showing leaf bases" } },
+        { "leaf", { "basal or on lower stem", "on upper stem", "margin of upper + lower surface" } },
+        { "inflorescence", { "whole - unspecified", "whole - female", "whole - male", "lateral view of flower",
+                             "frontal view of flower", "ventral view of flower + perianth", "close-up of flower interior" } },
+        { "fruit", { "as borne on the plant", "lateral or general close-up", "section or open", "immature" } },
+        { "seed", { "general view" } } } },
+    { "gymnosperms", {
+        { "whole tree", { "general", "view up trunk" } },
+        { "bark", { "of a large tree", "of a medium tree or large branch", "of a small tree or small branch" } },
+        { "twig", { "after fallen needles", "showing attachment of needles" } },
+        { "leaf", { "entire needle", "showing orientation on twig" } },
+        { "cone", { "male", "female - mature open", "female - closed", "female - receptive", "one year-old female" } },
+        { "seed", { "general view" } } } },
+    { "ferns", {
+        { "whole plant", {} } } },
+    { "cacti", {
+        { "whole plant", {} } } },
+    { "mosses", {
+        { "whole gametophyte", {} } } }
+};
+
+const int groupCount = sizeof(table) / sizeof(table[0]);
+static_assert(groupCount <= 100, "group codes are two digits");
+
+const QLatin1Char separator('\n');
+
+// QString copies of the table, so decoding shares them instead of
+// converting names for every image, and each name path's code, keyed on
+// "group", "group\npart" and "group\npart\nview".
+struct Lookup
+{
+    Lookup();
+
+    QString unspecified;
+    QString groups[groupCount];
+    QString parts[groupCount][partSlots];
+    QString views[groupCount][partSlots][viewSlots];
+    QHash<QString, int> codes;
+};
+
+Lookup::Lookup() : unspecified("unspecified")
+{
+    for (int g = 0; g < groupCount; g++)
+    {
+        groups[g] = QString::fromLatin1(table[g].name);
+        codes.insert(groups[g], g * 10000);
+
+        for (int p = 0; p < partSlots && table[g].parts[p].name; p++)
+        {
+            parts[g][p] = QString::fromLatin1(table[g].parts[p].name);
+            const QString groupPart = groups[g] + separator + parts[g][p];
+            codes.insert(groupPart, g * 10000 + (p + 1) * 100);
+
+            for (int v = 0; v < viewSlots && table[g].parts[p].views[v]; v++)
+            {
+                views[g][p][v] = QString::fromLatin1(table[g].parts[p].views[v]);
+                codes.insert(groupPart + separator + views[g][p][v], g * 10000 + (p + 1) * 100 + v + 1);
+            }
+        }
+    }
+}
+
+const Lookup &lookup()
+{
+    static const Lookup lookup;
+    return lookup;
+}
+
+}
+
+QStringList ImageView::decode(const QString &imageView)
+{
+    const Lookup &names = lookup();
+    QString group = names.unspecified;
+    QString part = names.unspecified;
+    QString view = names.unspecified;
+
+    // the code must be six digits once any '#' is dropped
+    int digits[6];
+    int length = 0;
+    for (const QChar &c : imageView)
+    {
+        if (c == QLatin1Char('#'))
+            continue;
+        if (length == 6)
+        {
+            length = 0;
+            break;
+        }
+        const int digit = c.unicode() - '0';
+        digits[length++] = (digit >= 0 && digit <= 9) ? digit : -1;
+    }
+
+    if (length == 6)
+    {
+        int codes[3];
+        for (int i = 0; i < 3; i++)
+        {
+            const int tens = digits[2 * i];
+            const int ones = digits[2 * i + 1];
+            codes[i] = (tens < 0 || ones < 0) ? -1 : tens * 10 + ones;
+        }
+
+        const int g = codes[0];
+        const int p = codes[1] - 1;
+        const int v = codes[2] - 1;
+        if (g >= 0 && g < groupCount)
+        {
+            group = names.groups[g];
+            if (p >= 0 && p < partSlots && table[g].parts[p].name)
+            {
+                part = names.parts[g][p];
+                if (v >= 0 && v < viewSlots && table[g].parts[p].views[v])
+                    view = names.views[g][p][v];
+            }
+        }
+    }
+
+    QStringList groupPartView;
+    groupPartView << group << part << view;
+    return groupPartView;
+}
+
+QString ImageView::encode(const QString &group, const QString &part, const QString &view)
+{
+    const QHash<QString, int> &codes = lookup().codes;
+    const QString groupPart = group + separator + part;
+
+    int code = codes.value(groupPart + separator + view, -1);
+    if (code < 0)
+        code = codes.value(groupPart, -1);
+    if (code < 0)
+        code = codes.value(group, 0);
+
+    return QString("#%1").arg(code, 6, 10, QLatin1Char('0'));
+}
+
+QStringList ImageView::groups()
+{
+    const Lookup &names = lookup();
+    QStringList groups;
+    for (int g = 0; g < groupCount; g++)
+        groups << names.groups[g];
+    return groups;
+}
+
+QStringList ImageView::parts(const QString &group)
+{
+    const Lookup &names = lookup();
+    const int code = names.codes.value(group, -1);
+    if (code < 0 || code % 10000 != 0)
+        return QStringList();
+
+    const int g = code / 10000;
+    QStringList parts;
+    parts << names.unspecified;
+    for (int p = 0; p < partSlots && table[g].parts[p].name; p++)
+        parts << names.parts[g][p];
+    return parts;
+}
+
+QStringList ImageView::views(const QString &group, const QString &part)
+{
+    const Lookup &names = lookup();
+    QStringList views;
+    if (part == names.unspecified)
+    {
+        views << names.unspecified;
+        return views;
+    }
+
+    const int code = names.codes.value(group + separator + part, -1);
+    if (code < 0 || code % 100 != 0)
+        return views;
+
+    const int g = code / 10000;
+    const int p = code / 100 % 100 - 1;
+    views << names.unspecified;
+    for (int v = 0; v < viewSlots && table[g].parts[p].views[v]; v++)
+        views << names.views[g][p][v];
+    return views;
+}
@@ -0,0 +1,46 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef IMAGEVIEW_H
+#define IMAGEVIEW_H
+
+#include <QtCore>
+
+// Converts between an image's imageView code (#GGPPVV: two digits each for
+// the specimen group, the part of the specimen and the view of that part)
+// and the group/part/view names shown in Data Entry. Every code is listed
+// once, in a table in imageview.cpp, which also supplies the entries of the
+// group, part and view combo boxes. Codes that don't match the table decode
+// to "unspecified" from the first unknown level down, and names that don't
+// match encode to 00 the same way.
+class ImageView
+{
+public:
+    static QStringList decode(const QString &imageView);
+    static QString encode(const QString &group, const QString &part, const QString &view);
+
+    static QStringList groups();
+    static QStringList parts(const QString &group);
+    static QStringList views(const QString &group, const QString &part);
+};
+
+#endif // IMAGEVIEW_H
@@ -33,6 +33,8 @@
 #include "organism.h"
 #include "sensu.h"
 #include "taxa.h"
+#include "imageview.h"
+#include "preparedquery.h"
 
 ImportCSV::ImportCSV()
 {
@@ -185,10 +187,11 @@ bool ImportCSV::extractSingleColumn(const QString &CSVPath, const QString &table
             identifier = idValuePair.at(1);
         }
 
-        QSqlQuery query;
         QString idFieldName = "dcterms_identifier";
         if (table == "tmp_images" && identifierIsFileName)
             idFieldName = "fileName";
+        QString sql;
+        QVariantList values;
         if (field == "coordinates")
         {
             QStringList splitValue = value.split(",");
@@ -196,19 +199,19 @@ bool ImportCSV::extractSingleColumn(const QString &CSVPath, const QString &table
                 continue;
             QString lat = splitValue.at(0).trimmed();
             QString lon = splitValue.at(1).trimmed();
-            query.prepare("UPDATE " + table + " SET dwc_decimalLatitude = (?), dwc_decimalLongitude = (?), dcterms_modified = (?) WHERE " + idFieldName + " = (?)");
-            query.addBindValue(lat);
-            query.addBindValue(lon);
-            query.addBindValue(modifiedNow());
-            query.addBindValue(identifier);
+            sql = "UPDATE " + table + " SET dwc_decimalLatitude = (?), dwc_decimalLongitude = (?), dcterms_modified = (?) WHERE " + idFieldName + " = (?)";
+            values << lat << lon << modifiedNow() << identifier;
         }
         else
         {
-            query.prepare("UPDATE " + table + " SET " + field + " = (?), dcterms_modified = (?) WHERE " + idFieldName + " = (?)");
-            query.addBindValue(value);
-            query.addBindValue(modifiedNow());
-            query.addBindValue(identifier);
+            sql = "UPDATE " + table + " SET " + field + " = (?), dcterms_modified = (?) WHERE " + idFieldName + " = (?)";
+            values << value << modifiedNow() << identifier;
         }
+
+        // the same one or two statements run for every row
+        PreparedQuery query(sql);
+        for (const QVariant &bindValue : values)
+            query.bind(bindValue);
         if (!query.exec()) {
             QMessageBox::critical(0, "", table + " insertion failed: " + query.lastError().text());
             return false;
@@ -380,7 +383,7 @@ bool ImportCSV::extractDeterminations(const QString &CSVPath, const QString &tab
     in.setCodec("UTF-8");
     QString line = in.readLine();
     line = line.replace("\"","");
-    if (line != "dsw_identified|identifiedBy|dwc_dateIdentified|dwc_identificationRemarks|tsnID|nameAccordingToID|dcterms_modified|suppress")
+    if (line != TableSchema<Determination>::header())
     {
         qDebug() << "Error loading determinations.csv. Header line does not match.";
         return false;
@@ -392,19 +395,12 @@ bool ImportCSV::extractDeterminations(const QString &CSVPath, const QString &tab
         if (line.isNull() || line.isEmpty())
             continue;
 
-        QStringList splitLine = parseCSV(line,8);
-        if (splitLine.length() != 8)
+        QStringList splitLine = parseCSV(line, TableSchema<Determination>::size);
+        if (splitLine.length() != TableSchema<Determination>::size)
             continue;
 
         Determination determination;
-        determination.identified = splitLine.at(0);
-        determination.identifiedBy = splitLine.at(1);
-        determination.dateIdentified = splitLine.at(2);
-        determination.identificationRemarks = splitLine.at(3);
-        determination.tsnID = splitLine.at(4);
-        determination.nameAccordingToID = splitLine.at(5);
-        determination.lastModified = splitLine.at(6);
-        determination.suppress = splitLine.at(7);
+        TableSchema<Determination>::load(determination, splitLine);
 
         determinations << determination;
 
@@ -423,18 +419,8 @@ bool ImportCSV::extractDeterminations(const QString &CSVPath, const QString &tab
 
     for (Determination d : determinations)
     {
-        QSqlQuery query;
-        query.prepare("INSERT OR REPLACE INTO " + table + " (dsw_identified, identifiedBy, dwc_dateIdentified, "
-                      "dwc_identificationRemarks, tsnID, nameAccordingToID, dcterms_modified, suppress) "
-                      "VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
-        query.addBindValue(d.identified);
-        query.addBindValue(d.identifiedBy);
-        query.addBindValue(d.dateIdentified);
-        query.addBindValue(d.identificationRemarks);
-        query.addBindValue(d.tsnID);
-        query.addBindValue(d.nameAccordingToID);
-        query.addBindValue(d.lastModified);
-        query.addBindValue(d.suppress);
+        PreparedQuery query(TableSchema<Determination>::insert(table, "INSERT OR REPLACE"));
+        TableSchema<Determination>::bind(query, d);
         if (!query.exec()) {
             QMessageBox::critical(0, "", "Determination insertion failed: " + query.lastError().text());
             return false;
@@ -467,7 +453,7 @@ bool ImportCSV::extractOrganisms(const QString &CSVPath, const QString &table)
     in.setCodec("UTF-8");
     QString line = in.readLine();
     line = line.replace("\"","");
-    if (line != "dcterms_identifier|dwc_establishmentMeans|dcterms_modified|dwc_organismRemarks|dwc_collectionCode|dwc_catalogNumber|dwc_georeferenceRemarks|dwc_decimalLatitude|dwc_decimalLongitude|geo_alt|dwc_organismName|dwc_organismScope|cameo|notes|suppress")
+    if (line != TableSchema<Organism>::header())
     {
         qDebug() << "Error loading organisms.csv. Header line does not match.";
         return false;
@@ -479,26 +465,12 @@ bool ImportCSV::extractOrganisms(const QString &CSVPath, const QString &table)
         if (line.isNull() || line.isEmpty())
             continue;
 
-        QStringList splitLine = parseCSV(line,15);
-        if (splitLine.length() != 15)
+        QStringList splitLine = parseCSV(line, TableSchema<Organism>::size);
+        if (splitLine.length() != TableSchema<Organism>::size)
             continue;
 
         Organism organism;
-        organism.identifier = splitLine.at(0); // remove URL from ID http://foo/bar/ID
-        organism.establishmentMeans = splitLine.at(1);
-        organism.lastModified = splitLine.at(2);
-        organism.organismRemarks = splitLine.at(3);
-        organism.collectionCode = splitLine.at(4);
-        organism.catalogNumber = splitLine.at(5);
-        organism.georeferenceRemarks = splitLine.at(6);
-        organism.decimalLatitude = splitLine.at(7);
-        organism.decimalLongitude = splitLine.at(8);
-        organism.altitudeInMeters = splitLine.at(9);
-        organism.organismName = splitLine.at(10);
-        organism.organismScope = splitLine.at(11);
-        organism.cameo = splitLine.at(12);
-        organism.notes = splitLine.at(13);
-        organism.suppress = splitLine.at(14);
+        TableSchema<Organism>::load(organism, splitLine);
 
         organisms << organism;
 
@@ -517,28 +489,8 @@ bool ImportCSV::extractOrganisms(const QString &CSVPath, const QString &table)
 
     for (Organism newOrganism : organisms)
     {
-        QSqlQuery insert;
-        insert.prepare("INSERT OR REPLACE INTO " + table + " (dcterms_identifier, dwc_establishmentMeans, "
-                       "dcterms_modified, dwc_organismRemarks, dwc_collectionCode, dwc_catalogNumber, "
-                       "dwc_georeferenceRemarks, dwc_decimalLatitude, dwc_decimalLongitude, geo_alt, "
-                       "dwc_organismName, dwc_organismScope, cameo, notes, suppress) VALUES "
-                       "(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
-        insert.addBindValue(newOrganism.identifier);
-        insert.addBindValue(newOrganism.establishmentMeans);
-        insert.addBindValue(newOrganism.lastModified);
-        insert.addBindValue(newOrganism.organismRemarks);
-        insert.addBindValue(newOrganism.collectionCode);
-        insert.addBindValue(newOrganism.catalogNumber);
-        insert.addBindValue(newOrganism.georeferenceRemarks);
-
-        insert.addBindValue(newOrganism.decimalLatitude);
-        insert.addBindValue(newOrganism.decimalLongitude);
-        insert.addBindValue(newOrganism.altitudeInMeters);
-        insert.addBindValue(newOrganism.organismName);
-        insert.addBindValue(newOrganism.organismScope);
-        insert.addBindValue(newOrganism.cameo);
-        insert.addBindValue(newOrganism.notes);
-        insert.addBindValue(newOrganism.suppress);
+        PreparedQuery insert(TableSchema<Organism>::insert(table, "INSERT OR REPLACE"));
+        TableSchema<Organism>::bind(insert, newOrganism);
 
         if (!insert.exec()) {
             QMessageBox::critical(0, "", "Organism insertion failed: " + insert.lastError().text());
@@ -572,7 +524,7 @@ bool ImportCSV::extractSensu(const QString &CSVPath, const QString &table)
     in.setCodec("UTF-8");
     QString line = in.readLine();
     line = line.replace("\"","");
-    if (line != "dcterms_identifier|dc_creator|tcsSignature|dcterms_title|dc_publisher|dcterms_created|iri|dcterms_modified")
+    if (line != TableSchema<Sensu>::header())
     {
         qDebug() << "Error loading sensu.csv. Header line does not match.";
         return false;
@@ -584,19 +536,12 @@ bool ImportCSV::extractSensu(const QString &CSVPath, const QString &table)
         if (line.isNull() || line.isEmpty())
             continue;
 
-        QStringList splitLine = parseCSV(line,8);
-        if (splitLine.length() != 8)
+        QStringList splitLine = parseCSV(line, TableSchema<Sensu>::size);
+        if (splitLine.length() != TableSchema<Sensu>::size)
             continue;
 
         Sensu sensu;
-        sensu.identifier = splitLine.at(0);
-        sensu.creator = splitLine.at(1);
-        sensu.tcsSignature = splitLine.at(2);
-        sensu.title = splitLine.at(3);
-        sensu.publisher = splitLine.at(4);
-        sensu.dcterms_created = splitLine.at(5);
-        sensu.iri = splitLine.at(6);
-        sensu.lastModified = splitLine.at(7);
+        TableSchema<Sensu>::load(sensu, splitLine);
         sensus << sensu;
 
     } while (!line.isNull());
@@ -612,18 +557,8 @@ bool ImportCSV::extractSensu(const QString &CSVPath, const QString &table)
 
     for (Sensu s : sensus)
     {
-        QSqlQuery query;
-        query.prepare("INSERT OR REPLACE INTO " + table + " (dcterms_identifier, dc_creator, tcsSignature, "
-                      "dcterms_title, dc_publisher, dcterms_created, iri, dcterms_modified) "
-                      "VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
-        query.addBindValue(s.identifier);
-        query.addBindValue(s.creator);
-        query.addBindValue(s.tcsSignature);
-        query.addBindValue(s.title);
-        query.addBindValue(s.publisher);
-        query.addBindValue(s.dcterms_created);
-        query.addBindValue(s.iri);
-        query.addBindValue(s.lastModified);
+        PreparedQuery query(TableSchema<Sensu>::insert(table, "INSERT OR REPLACE"));
+        TableSchema<Sensu>::bind(query, s);
         if (!query.exec()) {
             QMessageBox::critical(0, "", "Sensu insertion failed: " + query.lastError().text());
             return false;
@@ -656,7 +591,7 @@ QStringList ImportCSV::extractImageNames(const QString &CSVPath, const QString &
     QString line = in.readLine();
     line = line.replace("\"","");
 
-    if (line != "fileName|focalLength|dwc_georeferenceRemarks|dwc_decimalLatitude|dwc_decimalLongitude|geo_alt|exif_PixelXDimension|exif_PixelYDimension|dwc_occurrenceRemarks|dwc_geodeticDatum|dwc_coordinateUncertaintyInMeters|dwc_locality|dwc_countryCode|dwc_stateProvince|dwc_county|dwc_informationWithheld|dwc_dataGeneralizations|dwc_continent|geonamesAdmin|geonamesOther|dcterms_identifier|dcterms_modified|dcterms_title|dcterms_description|ac_caption|photographerCode|dcterms_created|photoshop_Credit|owner|dcterms_dateCopyrighted|dc_rights|xmpRights_Owner|ac_attributionLinkURL|ac_hasServiceAccessPoint|usageTermsIndex|view|xmp_Rating|foaf_depicts|suppress")
+    if (line != TableSchema<Image>::header())
     {
         qDebug() << "Error loading images.csv. Header line does not match.";
         return { };
@@ -670,8 +605,8 @@ QStringList ImportCSV::extractImageNames(const QString &CSVPath, const QString &
         if (line.isNull() || line.isEmpty())
             continue;
 
-        QStringList splitLine = parseCSV(line,39);
-        if (splitLine.length() != 39)
+        QStringList splitLine = parseCSV(line, TableSchema<Image>::size);
+        if (splitLine.length() != TableSchema<Image>::size)
             continue;
 
         QString imageName = splitLine.at(0);
@@ -679,300 +614,13 @@ QStringList ImportCSV::extractImageNames(const QString &CSVPath, const QString &
             imageNames.append(imageName);
 
         Image image;
-        image.fileName = splitLine.at(0);
-        image.focalLength = splitLine.at(1);
-        image.georeferenceRemarks = splitLine.at(2);
-        image.decimalLatitude = splitLine.at(3);
-        image.decimalLongitude = splitLine.at(4);
-        image.altitudeInMeters = splitLine.at(5);
-        image.width = splitLine.at(6);
-        image.height = splitLine.at(7);
-        image.occurrenceRemarks = splitLine.at(8);
-        image.geodeticDatum = splitLine.at(9);
-        image.coordinateUncertaintyInMeters = splitLine.at(10);
-        image.locality = splitLine.at(11);
-        image.countryCode = splitLine.at(12);
-        image.stateProvince = splitLine.at(13);
-        image.county = splitLine.at(14);
-        image.informationWithheld = splitLine.at(15);
-        image.dataGeneralizations = splitLine.at(16);
-        image.continent = splitLine.at(17);
-        image.geonamesAdmin = splitLine.at(18);
-        image.geonamesOther = splitLine.at(19);
-        image.identifier = splitLine.at(20);
-        image.lastModified = splitLine.at(21);
-        image.title = splitLine.at(22);
-        image.description = splitLine.at(23);
-        image.caption = splitLine.at(24);
-        image.photographerCode = splitLine.at(25);
-        image.dcterms_created = splitLine.at(26);
-
-        QStringList eventDateSplit = image.dcterms_created.split("T");
-        if (eventDateSplit.length() == 2)
-        {
-            image.date = eventDateSplit.at(0);
-            image.time = eventDateSplit.at(1);
-        }
-        else
-            image.date = image.dcterms_created;
-
-        image.credit = splitLine.at(27);
-        image.copyrightOwnerID = splitLine.at(28);
-        image.copyrightYear = splitLine.at(29);
-        image.copyrightStatement = splitLine.at(30);
-        image.copyrightOwnerName = splitLine.at(31);
-        image.attributionLinkURL = splitLine.at(32);
-        image.urlToHighRes = splitLine.at(33);
-        image.usageTermsIndex = splitLine.at(34);
-        image.imageView = splitLine.at(35);
-        image.rating = splitLine.at(36);
-        image.depicts = splitLine.at(37);
-        image.suppress = splitLine.at(38);
-
-        // Convert imageview #010203 format to group/part/view QStrings
-        QString group = "unspecified";
-        QString part = "unspecified";
-        QString view = "unspecified";
-        QString imageView = image.imageView;
-        imageView.remove("#");
-        // make sure imageView is 6 digits long before splitting
-        if (imageView.length() == 6)
-        {
-            QString pt1 = QString(imageView.at(0)) + QString(imageView.at(1));
-            QString pt2 = QString(imageView.at(2)) + QString(imageView.at(3));
-            QString pt3 = QString(imageView.at(4)) + QString(imageView.at(5));
-
-            if (pt1 == "00" && pt2 == "01")
-                part = "whole organism";
-            else if (pt1 == "01")
-            {
-                group = "woody angiosperms";
-                if (pt2 == "01")
-                {
-                    part = "whole tree (or vine)";
-                    if (pt3 == "01")
-                        view = "general";
-                    else if (pt3 == "02")
-                        view = "winter";
-                    else if (pt3 == "03")
-                        view = "view up trunk";
-                }
-                else if (pt2 == "02")
-                {
-                    part = "bark";
-                    if (pt3 == "01")
-                        view = "of a large tree";
-                    else if (pt3 == "02")
-                        view  = "of a medium tree or large branch";
-                    else if (pt3 == "03")
-                        view = "of a small tree or small branch";
-                }
-                else if (pt2 == "03")
-                {
-                    part = "twig";
-                    if (pt3 == "01")
-                        view = "orientation of petioles";
-                    else if (pt3 == "02")
-                        view = "winter overall";
-                    else if (pt3 == "03")
-                        view = "close-up winter leaf scar/bud";
-                    else if (pt3 == "04")
-                        view = "close-up winter terminal bud";
-                }
-                else if (pt2 == "04")
-                {
-                    part = "leaf";
-                    if (pt3 == "01")
-                        view = "whole upper surface";
-                    else if (pt3 == "02")
-                        view = "margin of upper + lower surface";
-                    else if (pt3 == "03")
-                        view = "showing orientation on twig";
-                }
-                else if (pt2 == "05")
-                {
-                    part = "inflorescence";
-                    if (pt3 == "01")
-                        view = "whole - unspecified";
-                    else if (pt3 == "02")
-                        view = "whole - female";
-                    else if (pt3 == "03")
-                        view = "whole - male";
-                    else if (pt3 == "04")
-                        view = "lateral view of flower";
-                    else if (pt3 == "05")
-                        view = "frontal view of flower";
-                    else if (pt3 == "06")
-                        view = "ventral view of flower + perianth";
-                    else if (pt3 == "07")
-                        view = "close-up of flower interior";
-                }
-                else if (pt2 == "06")
-                {
-                    part = "fruit";
-                    if (pt3 == "01")
-                        view = "as borne on the plant";
-                    else if (pt3 == "02")
-                        view = "lateral or general close-up";
-                    else if (pt3 == "03")
-                        view = "section or open";
-                    else if (pt3 == "04")
-                        view = "immature";
-                }
-                else if (pt2 == "07")
-                {
-                    part = "seed";
-                    if (pt3 == "01")
-                        view = "general view";
-                }
-            }
-            else if (pt1 == "02")
-            {
-                group = "herbaceous angiosperms";
-                if (pt2 == "01")
-                {
-                    part = "whole plant";
-                    if (pt3 == "01")
-                        view = "juvenile";
-                    else if (pt3 == "02")
-                        view = "in flower - general view";
-                    else if (pt3 == "03")
-                        view = "in fruit";
-                }
-                else if (pt2 == "02")
-                {
-                    part = "stem";
-                    if (pt3 == "01")
-                        view = "showing leaf bases";
-                }
-                else if (pt2 == "03")
-                {
-                    part = "leaf";
-                    if (pt3 == "01")
-                        view = "basal or on lower stem";
-                    else if (pt3 == "02")
-                        view = "on upper stem";
-                    else if (pt3 == "03")
-                        view = "margin of upper + lower surface";
-                }
-                else if (pt2 == "04")
-                {
-                    part = "inflorescence";
-                    if (pt3 == "01")
-                        view = "whole - unspecified";
-                    else if (pt3 == "02")
-                        view = "whole - female";
-                    else if (pt3 == "03")
-                        view = "whole - male";
-                    else if (pt3 == "04")
-                        view = "lateral view of flower";
-                    else if (pt3 == "05")
-                        view = "frontal view of flower";
-                    else if (pt3 == "06")
-                        view = "ventral view of flower + perianth";
-                    else if (pt3 == "07")
-                        view = "close-up of flower interior";
-                }
-                else if (pt2 == "05")
-                {
-                    part = "fruit";
-                    if (pt3 == "01")
-                        view = "as borne on the plant";
-                    else if (pt3 == "02")
-                        view = "lateral or general close-up";
-                    else if (pt3 == "03")
-                        view = "section or open";
-                    else if (pt3 == "04")
-                        view = "immature";
-                }
-                else if (pt2 == "06")
-                {
-                    part = "seed";
-                    if (pt3 == "01")
-                        view = "general view";
-                }
-            }
-            else if (pt1 == "03")
-            {
-                group = "gymnosperms";
-                if (pt2 == "01")
-                {
-                    part = "whole tree";
-                    if (pt3 == "01")
-                        view = "general";
-                    else if (pt3 == "02")
-                        view = "view up trunk";
-                }
-                else if (pt2 == "02")
-                {
-                    part = "bark";
-                    if (pt3 == "01")
-                        view = "of a large tree";
-                    else if (pt3 == "02")
-                        view = "of a medium tree or large branch";
-                    else if (pt3 == "03")
-                        view = "of a small tree or small branch";
-                }
-                else if (pt2 == "03")
-                {
-                    part = "twig";
-                    if (pt3 == "01")
-                        view = "after fallen needles";
-                    else if (pt3 == "02")
-                        view = "showing attachment of needles";
-                }
-                else if (pt2 == "04")
-                {
-                    part = "leaf";
-                    if (pt3 == "01")
-                        view = "entire needle";
-                    else if (pt3 == "02")
-                        view = "showing orientation on twig";
-                }
-                else if (pt2 == "05")
-                {
-                    part = "cone";
-                    if (pt3 == "01")
-                        view = "male";
-                    else if (pt3 == "02")
-                        view = "female - mature open";
-                    else if (pt3 == "03")
-                        view = "female - closed";
-                    else if (pt3 == "04")
-                        view = "female - receptive";
-                    else if (pt3 == "05")
-                        view = "one year-old female";
-                }
-                else if (pt2 == "06")
-                {
-                    part = "seed";
-                    if (pt3 == "01")
-                        view = "general view";
-                }
-            }
-            else if (pt1 == "04")
-            {
-                group = "ferns";
-                if (pt2 == "01")
-                    part = "whole plant";
-            }
-            else if (pt1 == "05")
-            {
-                group = "cacti";
-                if (pt2 == "01")
-                    part = "whole plant";
-            }
-            else if (pt1 == "06")
-            {
-                group = "mosses";
-                if (pt2 == "01")
-                    part = "whole gametophyte";
-            }
-        }
+        TableSchema<Image>::load(image, splitLine);
+        image.splitCreated();
 
-        image.groupOfSpecimen = group;
-        image.portionOfSpecimen = part;
-        image.viewOfSpecimen = view;
+        QStringList groupPartView = ImageView::decode(image.imageView);
+        image.groupOfSpecimen = groupPartView.at(0);
+        image.portionOfSpecimen = groupPartView.at(1);
+        image.viewOfSpecimen = groupPartView.at(2);
 
         extractedImages << image;
 
@@ -999,60 +647,8 @@ QStringList ImportCSV::extractImageNames(const QString &CSVPath, const QString &
 
     for (Image newImage : extractedImages)
     {
-        QSqlQuery query;
-        query.setForwardOnly(true);
-        query.prepare("INSERT OR REPLACE INTO " + table + " (fileName, focalLength, dwc_georeferenceRemarks, "
-                      "dwc_decimalLatitude, dwc_decimalLongitude, geo_alt, exif_PixelXDimension, "
-                      "exif_PixelYDimension, dwc_occurrenceRemarks, dwc_geodeticDatum, "
-                      "dwc_coordinateUncertaintyInMeters, dwc_locality, dwc_countryCode, dwc_stateProvince, "
-                      "dwc_county, dwc_informationWithheld, dwc_dataGeneralizations, dwc_continent, "
-                      "geonamesAdmin, geonamesOther, dcterms_identifier, dcterms_modified, dcterms_title, "
-                      "dcterms_description, ac_caption, photographerCode, dcterms_created, photoshop_Credit, "
-                      "owner, dcterms_dateCopyrighted, dc_rights, xmpRights_Owner, ac_attributionLinkURL, "
-                      "ac_hasServiceAccessPoint, usageTermsIndex, view, xmp_Rating, foaf_depicts, suppress) "
-                      "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
-        query.addBindValue(newImage.fileName);
-        query.addBindValue(newImage.focalLength);
-        query.addBindValue(newImage.georeferenceRemarks);
-        query.addBindValue(newImage.decimalLatitude);
-        query.addBindValue(newImage.decimalLongitude);
-        query.addBindValue(newImage.altitudeInMeters);
-        query.addBindValue(newImage.width);
-        query.addBindValue(newImage.height);
-        query.addBindValue(newImage.occurrenceRemarks);
-        query.addBindValue(newImage.geodeticDatum);
-
-        query.addBindValue(newImage.coordinateUncertaintyInMeters);
-        query.addBindValue(newImage.locality);
-        query.addBindValue(newImage.countryCode);
-        query.addBindValue(newImage.stateProvince);
-        query.addBindValue(newImage.county);
-        query.addBindValue(newImage.informationWithheld);
-        query.addBindValue(newImage.dataGeneralizations);
-        query.addBindValue(newImage.continent);
-        query.addBindValue(newImage.geonamesAdmin);
-        query.addBindValue(newImage.geonamesOther);
-
-        query.addBindValue(newImage.identifier);
-        query.addBindValue(newImage.lastModified);
-        query.addBindValue(newImage.title);
-        query.addBindValue(newImage.description);
-        query.addBindValue(newImage.caption);
-        query.addBindValue(newImage.photographerCode);
-        query.addBindValue(newImage.dcterms_created);
-        query.addBindValue(newImage.credit);
-        query.addBindValue(newImage.copyrightOwnerID);
-        query.addBindValue(newImage.copyrightYear);
-
-        query.addBindValue(newImage.copyrightStatement);
-        query.addBindValue(newImage.copyrightOwnerName);
-        query.addBindValue(newImage.attributionLinkURL);
-        query.addBindValue(newImage.urlToHighRes);
-        query.addBindValue(newImage.usageTermsIndex);
-        query.addBindValue(newImage.imageView);
-        query.addBindValue(newImage.rating);
-        query.addBindValue(newImage.depicts);
-        query.addBindValue(newImage.suppress);
+        PreparedQuery query(TableSchema<Image>::insert(table, "INSERT OR REPLACE"));
+        TableSchema<Image>::bind(query, newImage);
 
         query.exec();
     }
@@ -1082,7 +678,7 @@ bool ImportCSV::extractTaxa(const QString &CSVPath, const QString &table)
     in.setCodec("UTF-8");
     QString line = in.readLine();
     line = line.replace("\"","");
-    if (line != "ubioID|dcterms_identifier|dwc_kingdom|dwc_class|dwc_order|dwc_family|dwc_genus|dwc_specificEpithet|dwc_infraspecificEpithet|dwc_taxonRank|dwc_scientificNameAuthorship|dwc_vernacularName|dcterms_modified")
+    if (line != TableSchema<Taxa>::header())
     {
         qDebug() << "Error loading names.csv. Header line does not match.";
         return false;
@@ -1094,24 +690,12 @@ bool ImportCSV::extractTaxa(const QString &CSVPath, const QString &table)
         if (line.isNull() || line.isEmpty())
             continue;
 
-        QStringList splitLine = parseCSV(line,13);
-        if (splitLine.length() != 13)
+        QStringList splitLine = parseCSV(line, TableSchema<Taxa>::size);
+        if (splitLine.length() != TableSchema<Taxa>::size)
             continue;
 
         Taxa t;
-        t.ubioID = splitLine.at(0);
-        t.identifier = splitLine.at(1);
-        t.kingdom = splitLine.at(2);
-        t.className = splitLine.at(3);
-        t.order = splitLine.at(4);
-        t.family = splitLine.at(5);
-        t.genus = splitLine.at(6);
-        t.species = splitLine.at(7);
-        t.subspecies = splitLine.at(8);
-        t.taxonRank = splitLine.at(9);
-        t.authorship = splitLine.at(10);
-        t.vernacular = splitLine.at(11);
-        t.lastModified = splitLine.at(12);
+        TableSchema<Taxa>::load(t, splitLine);
         taxa << t;
 
     } while (!line.isNull());
@@ -1129,25 +713,8 @@ bool ImportCSV::extractTaxa(const QString &CSVPath, const QString &table)
 
     for (Taxa t : taxa)
     {
-        QSqlQuery query;
-        query.prepare("INSERT OR REPLACE INTO " + table + " (ubioID, dcterms_identifier, "
-                      "dwc_kingdom, dwc_class, dwc_order, dwc_family, dwc_genus, "
-                      "dwc_specificEpithet, dwc_infraspecificEpithet, dwc_taxonRank, "
-                      "dwc_scientificNameAuthorship, dwc_vernacularName, dcterms_modified) "
-                      "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
-        query.addBindValue(t.ubioID);
-        query.addBindValue(t.identifier);
-        query.addBindValue(t.kingdom);
-        query.addBindValue(t.className);
-        query.addBindValue(t.order);
-        query.addBindValue(t.family);
-        query.addBindValue(t.genus);
-        query.addBindValue(t.species);
-        query.addBindValue(t.subspecies);
-        query.addBindValue(t.taxonRank);
-        query.addBindValue(t.authorship);
-        query.addBindValue(t.vernacular);
-        query.addBindValue(t.lastModified);
+        PreparedQuery query(TableSchema<Taxa>::insert(table, "INSERT OR REPLACE"));
+        TableSchema<Taxa>::bind(query, t);
         if (!query.exec()) {
             QMessageBox::critical(0, "", "Taxa insertion failed: " + query.lastError().text());
             return false;
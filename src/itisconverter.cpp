@@ -0,0 +1,264 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <QtConcurrent>
+#include <QSqlDatabase>
+#include <QSqlError>
+
+#include "itisconverter.h"
+
+ITISConverter::ITISConverter(const QString &dbPath, QObject *parent) :
+    QObject(parent),
+    dbPath(dbPath)
+{
+    connect(&watcher, SIGNAL(finished()), this, SLOT(conversionFinished()));
+}
+
+ITISConverter::~ITISConverter()
+{
+    cancel();
+    watcher.waitForFinished();
+}
+
+void ITISConverter::start()
+{
+    cancelled = 0;
+    watcher.setFuture(QtConcurrent::run(this, &ITISConverter::convert));
+}
+
+void ITISConverter::cancel()
+{
+    cancelled = 1;
+}
+
+void ITISConverter::conversionFinished()
+{
+    QString error = watcher.result();
+    if (error.isEmpty())
+        emit finished(true, "Hierarchy extraction complete.");
+    else
+        emit finished(false, error);
+}
+
+QStringList ITISConverter::excludedRanks()
+{
+    // ranks that are left out of taxa entirely
+    QStringList ranks;
+    ranks << "Subkingdom" << "Phylum" << "Subphylum" << "Superclass" << "Subclass" << "Infraclass" <<
+             "Superorder" << "Suborder" << "Infraorder" << "Superfamily" << "Subfamily" << "Tribe" <<
+             "Subtribe" << "Subgenus" << "Infrakingdom" << "Parvphylum" << "Variety" << "Superdivision" <<
+             "Division" << "Subdivision" << "Infradivision" << "Section" << "Subsection" << "Subvariety" <<
+             "Form" << "Subform" << "Race" << "Stirp" << "Morph" << "Aberration" << "Unspecified";
+    return ranks;
+}
+
+bool ITISConverter::exec(QSqlQuery &qry, const QString &sql)
+{
+    if (qry.exec(sql))
+        return true;
+    qDebug() << __LINE__ << "ITIS conversion query failed: " + qry.lastError().text();
+    return false;
+}
+
+void ITISConverter::resolveHierarchy(Hierarchy &h, const Ranks &ranks)
+{
+    // the first ID is always the kingdom, and class must be found before order, and order before family
+    QVector<QStringRef> ids = h.hierarchyString.splitRef('-', QString::SkipEmptyParts);
+    bool foundClass = false;
+    bool foundOrder = false;
+    for (int i = 1; i < ids.size(); i++)
+    {
+        int id = ids.at(i).toInt();
+        if (!foundClass)
+        {
+            h.className = ranks.classes.value(id);
+            foundClass = !h.className.isEmpty();
+        }
+        else if (!foundOrder)
+        {
+            h.orderName = ranks.orders.value(id);
+            foundOrder = !h.orderName.isEmpty();
+        }
+        else
+        {
+            h.familyName = ranks.families.value(id);
+            if (!h.familyName.isEmpty())
+                break;
+        }
+    }
+}
+
+QString ITISConverter::convert()
+{
+    const QString connectionName = "ITISConnection";
+    QString error;
+    {
+        // the connection belongs to this thread, so it's opened and removed here
+        QSqlDatabase dbhier = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        dbhier.setDatabaseName(dbPath);
+        if (!dbhier.open())
+            error = "Unable to open database at: " + dbPath;
+        else
+        {
+            dbhier.transaction();
+            QSqlQuery qry(dbhier);
+
+            emit progressChanged(0, "Removing names that aren't valid or accepted...");
+            if (!exec(qry, "DELETE FROM taxonomic_units WHERE name_usage NOT IN ('valid', 'accepted')"))
+                error = "The ITIS taxonomic_units table could not be read.";
+
+            if (error.isEmpty() && !cancelled)
+            {
+                exec(qry, "DROP TABLE IF EXISTS taxa");
+                exec(qry, "CREATE TABLE `taxa` ("
+                          "`ubioID`	TEXT, `dcterms_identifier`	TEXT,"
+                          "`dwc_kingdom`	TEXT, `dwc_class`	TEXT,"
+                          "`dwc_order`	TEXT, `dwc_family`	TEXT,"
+                          "`dwc_genus`	TEXT, `dwc_specificEpithet`	TEXT,"
+                          "`dwc_infraspecificEpithet`	TEXT, `dwc_taxonRank`	TEXT, "
+                          "`dwc_scientificNameAuthorship`	TEXT,"
+                          "`dwc_vernacularName`	TEXT, `dcterms_modified`	TEXT,"
+                          "PRIMARY KEY(`dcterms_identifier`) )");
+                exec(qry, "CREATE INDEX IF NOT EXISTS `rank_id_index` ON `taxonomic_units` (`rank_id`, `tsn`)");
+                exec(qry, "CREATE INDEX IF NOT EXISTS `vernaculars_tsn_index` ON `vernaculars` (`tsn`)");
+
+                // one pass over taxonomic_units: authors and vernacular names are reduced to one row per key
+                // so the joins can't duplicate a tsn, and the excluded ranks are filtered out as rows are copied
+                emit progressChanged(5, "Copying names into the taxa table...");
+                QStringList placeholders;
+                for (int i = 0; i < excludedRanks().size(); i++)
+                    placeholders.append("?");
+                QString rank = "IFNULL(taxon_unit_types.rank_name, '')";
+                QSqlQuery insertQry(dbhier);
+                insertQry.prepare("INSERT INTO taxa SELECT '', taxonomic_units.tsn, kingdoms.kingdom_name, '', '', '', "
+                                  "CASE WHEN " + rank + " IN ('Genus', 'Species', 'Subspecies', 'Variety') "
+                                  "THEN IFNULL(taxonomic_units.unit_name1, '') ELSE '' END, "
+                                  "CASE WHEN " + rank + " IN ('Species', 'Subspecies', 'Variety') "
+                                  "THEN IFNULL(taxonomic_units.unit_name2, '') ELSE '' END, "
+                                  "CASE WHEN " + rank + " IN ('Subspecies', 'Variety') AND taxonomic_units.unit_ind3 IS NULL "
+                                  "THEN IFNULL(taxonomic_units.unit_name3, '') ELSE '' END, "
+                                  + rank + ", IFNULL(authors.taxon_author, ''), IFNULL(english.vernacular_name, ''), "
+                                  "'2016-12-22T00:00:00-06:00' "
+                                  "FROM taxonomic_units "
+                                  "INNER JOIN kingdoms ON taxonomic_units.kingdom_id = kingdoms.kingdom_id "
+                                  "LEFT JOIN taxon_unit_types ON taxonomic_units.rank_id = taxon_unit_types.rank_id "
+                                  "AND taxonomic_units.kingdom_id = taxon_unit_types.kingdom_id "
+                                  "LEFT JOIN (SELECT taxon_author_id, taxon_author FROM taxon_authors_lkp GROUP BY taxon_author_id) "
+                                  "AS authors ON taxonomic_units.taxon_author_id = authors.taxon_author_id "
+                                  "LEFT JOIN (SELECT tsn, vernacular_name FROM vernaculars WHERE language IN ('English', 'unspecified') "
+                                  "GROUP BY tsn) AS english ON taxonomic_units.tsn = english.tsn "
+                                  "WHERE " + rank + " NOT IN (" + placeholders.join(", ") + ")");
+                for (auto r : excludedRanks())
+                    insertQry.addBindValue(r);
+                if (!insertQry.exec())
+                {
+                    qDebug() << __LINE__ << "ITIS conversion query failed: " + insertQry.lastError().text();
+                    error = "The taxa table could not be built: " + insertQry.lastError().text();
+                }
+            }
+
+            Ranks ranks;
+            QVector<Hierarchy> hierarchies;
+            if (error.isEmpty() && !cancelled)
+            {
+                emit progressChanged(35, "Reading the hierarchy...");
+                QHash<int,QString> *rankNames[] = { &ranks.classes, &ranks.orders, &ranks.families };
+                int rankIDs[] = { 60, 100, 140 };
+                for (int i = 0; i < 3; i++)
+                {
+                    QSqlQuery rankQry(dbhier);
+                    rankQry.setForwardOnly(true);
+                    rankQry.prepare("SELECT tsn, unit_name1 FROM taxonomic_units WHERE rank_id = (?)");
+                    rankQry.addBindValue(rankIDs[i]);
+                    rankQry.exec();
+                    while (rankQry.next())
+                        rankNames[i]->insert(rankQry.value(0).toInt(), rankQry.value(1).toString());
+                }
+
+                // only the hierarchies of rows that made it into taxa, and not ones holding only a kingdom
+                QSqlQuery hierarchyQry(dbhier);
+                hierarchyQry.setForwardOnly(true);
+                hierarchyQry.exec("SELECT hierarchy.TSN, hierarchy.hierarchy_string FROM hierarchy "
+                                  "INNER JOIN taxa ON taxa.dcterms_identifier = hierarchy.TSN "
+                                  "WHERE hierarchy.hierarchy_string LIKE '%-%'");
+                while (hierarchyQry.next())
+                {
+                    Hierarchy h;
+                    h.tsnID = hierarchyQry.value(0).toInt();
+                    h.hierarchyString = hierarchyQry.value(1).toString();
+                    hierarchies.append(h);
+                }
+            }
+
+            // parse the hierarchy strings in parallel, a chunk at a time so progress and cancel stay responsive
+            for (int start = 0; start < hierarchies.size() && error.isEmpty() && !cancelled; start += hierarchyChunkSize)
+            {
+                emit progressChanged(45 + 35 * start / hierarchies.size(), "Finding class, order and family...");
+                auto end = hierarchies.begin() + qMin(start + hierarchyChunkSize, hierarchies.size());
+                QtConcurrent::blockingMap(hierarchies.begin() + start, end, [&ranks](Hierarchy &h) {
+                    resolveHierarchy(h, ranks);
+                });
+            }
+
+            if (error.isEmpty() && !cancelled)
+            {
+                emit progressChanged(80, "Saving class, order and family...");
+                QSqlQuery updateQry(dbhier);
+                updateQry.prepare("UPDATE taxa SET dwc_class = (?), dwc_order = (?), dwc_family = (?) WHERE dcterms_identifier = (?)");
+                for (int i = 0; i < hierarchies.size() && !cancelled; i++)
+                {
+                    const Hierarchy &h = hierarchies.at(i);
+                    if (h.className.isEmpty())
+                        continue;
+                    updateQry.addBindValue(h.className);
+                    updateQry.addBindValue(h.orderName);
+                    updateQry.addBindValue(h.familyName);
+                    updateQry.addBindValue(QString::number(h.tsnID));
+                    updateQry.exec();
+                }
+            }
+
+            if (error.isEmpty() && cancelled)
+                error = "The ITIS conversion was cancelled. The database has not been changed.";
+
+            if (!error.isEmpty())
+                dbhier.rollback();
+            else if (!dbhier.commit())
+            {
+                qDebug() << __LINE__ << "Problem with database transaction.";
+                dbhier.rollback();
+                error = "The converted taxa table could not be saved.";
+            }
+
+            if (error.isEmpty())
+            {
+                emit progressChanged(95, "Compacting the database...");
+                exec(qry, "VACUUM");
+                emit progressChanged(100, "");
+            }
+            qry.clear();
+            dbhier.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    return error;
+}
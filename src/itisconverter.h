@@ -0,0 +1,84 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ITISCONVERTER_H
+#define ITISCONVERTER_H
+
+#include <QObject>
+#include <QtCore>
+#include <QFutureWatcher>
+#include <QSqlQuery>
+
+// Builds a taxa table inside a downloaded ITIS database. The valid names are
+// copied into taxa with one INSERT ... SELECT joined against the rank, author
+// and vernacular tables, then the hierarchy strings are parsed on worker
+// threads to fill in class, order and family. Everything runs on a background
+// thread in a single transaction, so a cancelled conversion leaves the
+// database as it was.
+class ITISConverter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ITISConverter(const QString &dbPath, QObject *parent = 0);
+    ~ITISConverter();
+
+    void start();
+
+public slots:
+    void cancel();
+
+signals:
+    void progressChanged(int percent, const QString &label);
+    void finished(bool completed, const QString &message);
+
+private slots:
+    void conversionFinished();
+
+private:
+    struct Hierarchy
+    {
+        int tsnID;
+        QString hierarchyString;
+        QString className;
+        QString orderName;
+        QString familyName;
+    };
+    struct Ranks
+    {
+        QHash<int,QString> classes;
+        QHash<int,QString> orders;
+        QHash<int,QString> families;
+    };
+
+    QString convert();
+    bool exec(QSqlQuery &qry, const QString &sql);
+    static void resolveHierarchy(Hierarchy &h, const Ranks &ranks);
+    static QStringList excludedRanks();
+
+    QString dbPath;
+    QAtomicInt cancelled;
+    QFutureWatcher<QString> watcher;  // result is empty on success, otherwise the reason it stopped
+
+    static const int hierarchyChunkSize = 20000;
+};
+
+#endif // ITISCONVERTER_H
@@ -21,6 +21,7 @@
 // SOFTWARE.
 
 #include "startwindow.h"
+#include "databaseconnections.h"
 #include <QApplication>
 
 int main(int argc, char *argv[])
@@ -29,5 +30,9 @@ int main(int argc, char *argv[])
 
     StartWindow sw;
 
-    return a.exec();
+    int result = a.exec();
+
+    // let queued background writes land and report statement statistics before the connections go away
+    DatabaseConnections::close();
+    return result;
 }
@@ -30,6 +30,7 @@
 #include "startwindow.h"
 #include "importcsv.h"
 #include "exportcsv.h"
+#include "databaseconnections.h"
 
 ManageCSVs::ManageCSVs(QWidget *parent) :
     QWidget(parent),
@@ -901,8 +902,7 @@ void ManageCSVs::cleanupab()
         qDebug() << __LINE__ << "Problem with database transaction";
         db.rollback();
     }
-    db.close();
-    db.open();
+    DatabaseConnections::reopen();
     QSqlQuery query;
     query.exec("VACUUM");
 }
@@ -1056,8 +1056,7 @@ void ManageCSVs::cleanuptmp()
         qDebug() << __LINE__ << "Problem with database transaction";
         db.rollback();
     }
-    db.close();
-    db.open();
+    DatabaseConnections::reopen();
     QSqlQuery query;
     query.exec("VACUUM");
 }
@@ -1181,5 +1180,9 @@ void ManageCSVs::on_exportButton_clicked()
         where = " where dcterms_modified > '" + dbLastPublished + "'";
 
     ExportCSV exportCSV;
-    exportCSV.saveData(where,"");
+    exportCSV.setIncremental(ui->sinceLastExport->isChecked());
+    if (ui->exportArchive->isChecked())
+        exportCSV.saveArchive(where,"");
+    else
+        exportCSV.saveData(where,"");
 }
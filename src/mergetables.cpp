@@ -22,6 +22,10 @@
 
 #include <QtSql>
 #include "mergetables.h"
+#include "deltaupdate.h"
+#include "preparedquery.h"
+#include "databaseconnections.h"
+#include "exportlog.h"
 
 MergeTables::MergeTables(QWidget *parent) :
     QWidget(parent)
@@ -33,6 +37,7 @@ MergeTables::MergeTables(QWidget *parent) :
     if (versionQry.next())
         databaseVersion = versionQry.value(0).toString();
     updating = true;
+    deltaUpdate = false;
 
     ageT = "agents";
     imaT = "images";
@@ -59,6 +64,7 @@ MergeTables::MergeTables(const QString &firstPrefix, const QString &secondPrefix
     if (versionQry.next())
         databaseVersion = versionQry.value(0).toString();
     updating = false;
+    deltaUpdate = false;
 
     ageT = firstPrefix + "agents";
     imaT = firstPrefix + "images";
@@ -85,6 +91,7 @@ MergeTables::MergeTables(const QString &firstPrefix, const QString &secondPrefix
     if (versionQry.next())
         databaseVersion = versionQry.value(0).toString();
     updating = false;
+    deltaUpdate = false;
     onlyTable = oneTable;
 
     ageT = firstPrefix + "agents";
@@ -116,6 +123,12 @@ void MergeTables::setSilentMerge(bool state)
     silentMerge = state;
 }
 
+void MergeTables::setDeltaUpdate(bool state)
+{
+    // the tmp_ tables only hold the conflicting rows of a release DeltaUpdate already applied
+    deltaUpdate = state;
+}
+
 void MergeTables::displayChoices()
 {
     // first let's query the tables for conflicting records, storing the dcterms_identifier (or PK values, for determinations)
@@ -127,6 +140,8 @@ void MergeTables::displayChoices()
     if (imageIDs.isEmpty() && agentIDs.isEmpty() && determinationIDs.isEmpty()
             && organismIDs.isEmpty() && sensuIDs.isEmpty() && taxaIDs.isEmpty())
     {
+        if (deltaUpdate)
+            DeltaUpdate::recordPublished();
         mergeNonConflicts();
         QCoreApplication::processEvents();
         alterTables();
@@ -690,62 +705,14 @@ void MergeTables::displayChoices()
 QList<Image> MergeTables::loadImages(const QString &t, const QString &whereStatement)
 {
     QList<Image> images;
-    QString selection;
-    selection= "SELECT fileName, focalLength, dwc_georeferenceRemarks, dwc_decimalLatitude, "
-            "dwc_decimalLongitude, geo_alt, exif_PixelXDimension, exif_PixelYDimension, "
-            "dwc_occurrenceRemarks, dwc_geodeticDatum, dwc_coordinateUncertaintyInMeters, "
-            "dwc_locality, dwc_countryCode, dwc_stateProvince, dwc_county, dwc_informationWithheld, "
-            "dwc_dataGeneralizations, dwc_continent, geonamesAdmin, geonamesOther, dcterms_identifier, "
-            "dcterms_modified, dcterms_title, dcterms_description, ac_caption, photographerCode, dcterms_created, "
-            "photoshop_Credit, owner, dcterms_dateCopyrighted, dc_rights, xmpRights_Owner, ac_attributionLinkURL, "
-            "ac_hasServiceAccessPoint, usageTermsIndex, view, xmp_Rating, foaf_depicts, "
-            "suppress FROM " + t + whereStatement;
     QSqlQuery query;
-    query.prepare(selection);
+    query.setForwardOnly(true);
+    query.prepare(TableSchema<Image>::select(t) + whereStatement);
     query.exec();
     while (query.next())
     {
         Image image;
-        image.fileName = query.value(0).toString();
-        image.focalLength = query.value(1).toString();
-        image.georeferenceRemarks = query.value(2).toString();
-        image.decimalLatitude = query.value(3).toString();
-        image.decimalLongitude = query.value(4).toString();
-        image.altitudeInMeters = query.value(5).toString();
-        image.width = query.value(6).toString();
-        image.height = query.value(7).toString();
-        image.occurrenceRemarks = query.value(8).toString();
-        image.geodeticDatum = query.value(9).toString();
-        image.coordinateUncertaintyInMeters = query.value(10).toString();
-        image.locality = query.value(11).toString();
-        image.countryCode = query.value(12).toString();
-        image.stateProvince = query.value(13).toString();
-        image.county = query.value(14).toString();
-        image.informationWithheld = query.value(15).toString();
-        image.dataGeneralizations = query.value(16).toString();
-        image.continent = query.value(17).toString();
-        image.geonamesAdmin = query.value(18).toString();
-        image.geonamesOther = query.value(19).toString();
-        image.identifier = query.value(20).toString();
-        image.lastModified = query.value(21).toString();
-        image.title = query.value(22).toString();
-        image.description = query.value(23).toString();
-        image.caption = query.value(24).toString();
-        image.photographerCode = query.value(25).toString();
-        image.dcterms_created = query.value(26).toString();
-        image.credit = query.value(27).toString();
-        image.copyrightOwnerID = query.value(28).toString();
-        image.copyrightYear = query.value(29).toString();
-        image.copyrightStatement = query.value(30).toString();
-        image.copyrightOwnerName = query.value(31).toString();
-        image.attributionLinkURL = query.value(32).toString();
-        image.urlToHighRes = query.value(33).toString();
-        image.usageTermsIndex = query.value(34).toString();
-        image.imageView = query.value(35).toString();
-        image.rating = query.value(36).toString();
-        image.depicts = query.value(37).toString();
-        image.suppress = query.value(38).toString();
-
+        TableSchema<Image>::load(image, query);
         images << image;
     }
     return images;
@@ -777,21 +744,13 @@ QList<Determination> MergeTables::loadDeterminations(const QString &t, const QSt
 {
     QList<Determination> determinations;
     QSqlQuery query;
-    query.prepare("SELECT dsw_identified, identifiedBy, dwc_dateIdentified, dwc_identificationRemarks, "
-                  "tsnID, nameAccordingToID, dcterms_modified, suppress FROM " + t + whereStatement);
+    query.setForwardOnly(true);
+    query.prepare(TableSchema<Determination>::select(t) + whereStatement);
     query.exec();
     while (query.next())
     {
         Determination determination;
-        determination.identified = query.value(0).toString();
-        determination.identifiedBy = query.value(1).toString();
-        determination.dateIdentified = query.value(2).toString();
-        determination.identificationRemarks = query.value(3).toString();
-        determination.tsnID = query.value(4).toString();
-        determination.nameAccordingToID = query.value(5).toString();
-        determination.lastModified = query.value(6).toString();
-        determination.suppress = query.value(7).toString();
-
+        TableSchema<Determination>::load(determination, query);
         determinations << determination;
     }
     return determinations;
@@ -801,30 +760,13 @@ QList<Organism> MergeTables::loadOrganisms(const QString &t, const QString &wher
 {
     QList<Organism> organisms;
     QSqlQuery query;
-    query.prepare("SELECT dcterms_identifier, dwc_establishmentMeans, dcterms_modified, "
-                    "dwc_organismRemarks, dwc_collectionCode, dwc_catalogNumber, "
-                    "dwc_georeferenceRemarks, dwc_decimalLatitude, dwc_decimalLongitude, geo_alt, "
-                    "dwc_organismName, dwc_organismScope, cameo, notes, suppress from " + t + whereStatement);
+    query.setForwardOnly(true);
+    query.prepare(TableSchema<Organism>::select(t) + whereStatement);
     query.exec();
     while (query.next())
     {
         Organism organism;
-        organism.identifier = query.value(0).toString();
-        organism.establishmentMeans = query.value(1).toString();
-        organism.lastModified = query.value(2).toString();
-        organism.organismRemarks = query.value(3).toString();
-        organism.collectionCode = query.value(4).toString();
-        organism.catalogNumber = query.value(5).toString();
-        organism.georeferenceRemarks = query.value(6).toString();
-        organism.decimalLatitude = query.value(7).toString();
-        organism.decimalLongitude = query.value(8).toString();
-        organism.altitudeInMeters = query.value(9).toString();
-        organism.organismName = query.value(10).toString();
-        organism.organismScope = query.value(11).toString();
-        organism.cameo = query.value(12).toString();
-        organism.notes = query.value(13).toString();
-        organism.suppress = query.value(14).toString();
-
+        TableSchema<Organism>::load(organism, query);
         organisms << organism;
     }
     return organisms;
@@ -833,22 +775,14 @@ QList<Organism> MergeTables::loadOrganisms(const QString &t, const QString &wher
 QList<Sensu> MergeTables::loadSensu(const QString &t, const QString &whereStatement)
 {
     QList<Sensu> sensus;
-
     QSqlQuery query;
-    query.prepare("SELECT dcterms_identifier, dc_creator, tcsSignature, dcterms_title, "
-                  "dc_publisher, dcterms_created, iri, dcterms_modified from " + t + whereStatement);
+    query.setForwardOnly(true);
+    query.prepare(TableSchema<Sensu>::select(t) + whereStatement);
     query.exec();
     while (query.next())
     {
         Sensu sensu;
-        sensu.identifier = query.value(0).toString();
-        sensu.creator = query.value(1).toString();
-        sensu.tcsSignature = query.value(2).toString();
-        sensu.title = query.value(3).toString();
-        sensu.publisher = query.value(4).toString();
-        sensu.dcterms_created = query.value(5).toString();
-        sensu.iri = query.value(6).toString();
-        sensu.lastModified = query.value(7).toString();
+        TableSchema<Sensu>::load(sensu, query);
         sensus << sensu;
     }
     return sensus;
@@ -857,29 +791,14 @@ QList<Sensu> MergeTables::loadSensu(const QString &t, const QString &whereStatem
 QList<Taxa> MergeTables::loadTaxa(const QString &t, const QString &whereStatement)
 {
     QList<Taxa> taxa;
-
     QSqlQuery query;
-    query.prepare("SELECT ubioID, dcterms_identifier, dwc_kingdom, dwc_class, "
-                  "dwc_order, dwc_family, dwc_genus, dwc_specificEpithet, "
-                  "dwc_infraspecificEpithet, dwc_taxonRank, dwc_scientificNameAuthorship, "
-                  "dwc_vernacularName, dcterms_modified FROM " + t + whereStatement);
+    query.setForwardOnly(true);
+    query.prepare(TableSchema<Taxa>::select(t) + whereStatement);
     query.exec();
     while (query.next())
     {
         Taxa taxon;
-        taxon.ubioID = query.value(0).toString();
-        taxon.identifier = query.value(1).toString();
-        taxon.kingdom = query.value(2).toString();
-        taxon.className = query.value(3).toString();
-        taxon.order = query.value(4).toString();
-        taxon.family = query.value(5).toString();
-        taxon.genus = query.value(6).toString();
-        taxon.species = query.value(7).toString();
-        taxon.subspecies = query.value(8).toString();
-        taxon.taxonRank = query.value(9).toString();
-        taxon.authorship = query.value(10).toString();
-        taxon.vernacular = query.value(11).toString();
-        taxon.lastModified = query.value(12).toString();
+        TableSchema<Taxa>::load(taxon, query);
         taxa << taxon;
     }
     return taxa;
@@ -1363,8 +1282,10 @@ void MergeTables::mergeNonConflicts()
 
     // we have all the information we need to merge/prompt for action
     // first let's update the dcterms_modified so they show up relative to the last_published.xml date
+    // (a delta update has already done this, before applying the release)
     QStringList tables;
-    tables << ageT << detT << imaT << orgT << senT << namT;
+    if (!deltaUpdate)
+        tables << ageT << detT << imaT << orgT << senT << namT;
 
     for (auto t : tables)
     {
@@ -1375,22 +1296,29 @@ void MergeTables::mergeNonConflicts()
     }
 
     // special case for taxa: merge the full record of 'id' into the (in this case) existing table
+    QString mergeTaxa = "INSERT OR REPLACE INTO " + nam2T + " SELECT * FROM " + namT + " WHERE dcterms_identifier = (?)";
+    if (updating)
+        mergeTaxa = "INSERT OR REPLACE INTO " + namT + " SELECT * FROM " + nam2T + " WHERE dcterms_identifier = (?)";
     for (auto id : newTaxaIDs)
     {
-        QSqlQuery mergeQry;
-        if (updating)
-            mergeQry.prepare("INSERT OR REPLACE INTO " + namT + " SELECT * FROM " + nam2T + " WHERE dcterms_identifier = (?)");
-        else
-            mergeQry.prepare("INSERT OR REPLACE INTO " + nam2T + " SELECT * FROM " + namT + " WHERE dcterms_identifier = (?)");
-        mergeQry.addBindValue(id);
+        PreparedQuery mergeQry(mergeTaxa);
+        mergeQry.bind(id);
         mergeQry.exec();
     }
     // the other newWhateverIDs also need to be merged, but INTO tmp_table FROM table, opposite of taxa
+    // (unless this is a delta update, which leaves the tables in place instead of reloading them)
+    if (deltaUpdate)
+    {
+        newAgentIDs.clear();
+        newDeterminationIDs.clear();
+        newImageIDs.clear();
+        newOrganismIDs.clear();
+        newSensuIDs.clear();
+    }
     for (auto id : newAgentIDs)
     {
-        QSqlQuery mergeQry;
-        mergeQry.prepare("INSERT OR REPLACE INTO " + age2T + " SELECT * FROM " + ageT + " WHERE dcterms_identifier = (?)");
-        mergeQry.addBindValue(id);
+        PreparedQuery mergeQry("INSERT OR REPLACE INTO " + age2T + " SELECT * FROM " + ageT + " WHERE dcterms_identifier = (?)");
+        mergeQry.bind(id);
         mergeQry.exec();
     }
     // special case since determinations have 4 primary keys
@@ -1404,23 +1332,20 @@ void MergeTables::mergeNonConflicts()
     }
     for (auto id : newImageIDs)
     {
-        QSqlQuery mergeQry;
-        mergeQry.prepare("INSERT OR REPLACE INTO " + ima2T + " SELECT * FROM " + imaT + " WHERE dcterms_identifier = (?)");
-        mergeQry.addBindValue(id);
+        PreparedQuery mergeQry("INSERT OR REPLACE INTO " + ima2T + " SELECT * FROM " + imaT + " WHERE dcterms_identifier = (?)");
+        mergeQry.bind(id);
         mergeQry.exec();
     }
     for (auto id : newOrganismIDs)
     {
-        QSqlQuery mergeQry;
-        mergeQry.prepare("INSERT OR REPLACE INTO " + org2T + " SELECT * FROM " + orgT + " WHERE dcterms_identifier = (?)");
-        mergeQry.addBindValue(id);
+        PreparedQuery mergeQry("INSERT OR REPLACE INTO " + org2T + " SELECT * FROM " + orgT + " WHERE dcterms_identifier = (?)");
+        mergeQry.bind(id);
         mergeQry.exec();
     }
     for (auto id : newSensuIDs)
     {
-        QSqlQuery mergeQry;
-        mergeQry.prepare("INSERT OR REPLACE INTO " + sen2T + " SELECT * FROM " + senT + " WHERE dcterms_identifier = (?)");
-        mergeQry.addBindValue(id);
+        PreparedQuery mergeQry("INSERT OR REPLACE INTO " + sen2T + " SELECT * FROM " + senT + " WHERE dcterms_identifier = (?)");
+        mergeQry.bind(id);
         mergeQry.exec();
     }
 
@@ -1450,6 +1375,8 @@ void MergeTables::alterTables()
         else if (onlyTable == "taxa")
             deleteTables << nam2T;
     }
+    else if (updating && deltaUpdate)
+        deleteTables << nam2T;
     else if (updating)
         deleteTables << ageT << detT << imaT << orgT << senT << nam2T;
     else
@@ -1457,6 +1384,7 @@ void MergeTables::alterTables()
 
     QSqlDatabase db = QSqlDatabase::database();
     db.transaction();
+    ExportLog::suspend(deleteTables);
     for (auto t : deleteTables)
     {
         QSqlQuery dropQry;
@@ -1495,7 +1423,10 @@ void MergeTables::alterTables()
     for (auto t : insertQuery)
     {
         QSqlQuery renameQry;
-        renameQry.prepare("INSERT INTO " + t);
+        if (updating && deltaUpdate)
+            renameQry.prepare("INSERT OR REPLACE INTO " + t);
+        else
+            renameQry.prepare("INSERT INTO " + t);
         renameQry.exec();
     }
 
@@ -1526,16 +1457,18 @@ void MergeTables::alterTables()
         dropQry.prepare("DELETE FROM " + t);
         dropQry.exec();
     }
+    ExportLog::resume();
 
     if (!db.commit())
     {
         qDebug() << __LINE__ << "Problem with database transaction";
         db.rollback();
     }
+    else if (updating && deltaUpdate)
+        close();
     else
     {
-        db.close();
-        db.open();
+        DatabaseConnections::reopen();
         QSqlQuery query;
         query.exec("VACUUM");
         close();
@@ -1549,6 +1482,10 @@ void MergeTables::submit()
 
     merging = true;
 
+    // the released rows count as applied whichever version is kept
+    if (deltaUpdate)
+        DeltaUpdate::recordPublished();
+
     // first let's merge the changes that have no conflicts
     mergeNonConflicts();
 
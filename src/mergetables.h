@@ -50,6 +50,7 @@ public:
     ~MergeTables();
     void displayChoices();
     void setSilentMerge(bool state);
+    void setDeltaUpdate(bool state);
 
 signals:
     void finished();
@@ -72,6 +73,7 @@ private:
     bool updating;
     bool merging;
     bool silentMerge;
+    bool deltaUpdate;
     QString onlyTable;
 
     QString ageT;
@@ -24,6 +24,7 @@
 #include <QDialogButtonBox>
 #include <QFormLayout>
 #include <QListView>
+#include <QStringListModel>
 #include <QMessageBox>
 #include <QSqlQuery>
 #include <QSqlError>
@@ -36,7 +37,7 @@
 #include "newsensudialog.h"
 #include "ui_newdeterminationdialog.h"
 
-NewDeterminationDialog::NewDeterminationDialog(const QString &organismID, const QStringList &genera, const QStringList &commonNames, const QStringList &families, const QStringList &agents, const QStringList &sensus, QWidget *parent) :
+NewDeterminationDialog::NewDeterminationDialog(const QString &organismID, const TaxonIndex *index, const QStringList &agents, const QStringList &sensus, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::NewDeterminationDialog)
 {
@@ -49,33 +50,16 @@ NewDeterminationDialog::NewDeterminationDialog(const QString &organismID, const
     sensuAdded = false;
 
     dsw_identified = organismID;
-    allGenera = genera;
-    allCommonNames = commonNames;
+    taxonIndex = index;
     allSensus = sensus;
-    allFamilies = families;
-
-    completeGenera = new QCompleter(allGenera, this);
-    completeGenera->setCaseSensitivity(Qt::CaseInsensitive);
-    completeGenera->popup()->setHorizontalScrollBarPolicy(Qt::ScrollBarAsNeeded);
-    completeGenera->popup()->setMinimumWidth(300);
-    completeGenera->popup()->setMinimumHeight(200);
-    completeGenera->setFilterMode(Qt::MatchContains);
+
+    completeGenera = setupTaxonCompleter(200);
     ui->genusSearch->setCompleter(0);
 
-    completeCommonNames = new QCompleter(allCommonNames, this);
-    completeCommonNames->setCaseSensitivity(Qt::CaseInsensitive);
-    completeCommonNames->popup()->setHorizontalScrollBarPolicy(Qt::ScrollBarAsNeeded);
-    completeCommonNames->popup()->setMinimumWidth(300);
-    completeCommonNames->popup()->setMinimumHeight(167);
-    completeCommonNames->setFilterMode(Qt::MatchContains);
+    completeCommonNames = setupTaxonCompleter(167);
     ui->commonNameSearch->setCompleter(0);
 
-    completeFamilies = new QCompleter(allFamilies, this);
-    completeFamilies->setCaseSensitivity(Qt::CaseInsensitive);
-    completeFamilies->popup()->setHorizontalScrollBarPolicy(Qt::ScrollBarAsNeeded);
-    completeFamilies->popup()->setMinimumWidth(300);
-    completeFamilies->popup()->setMinimumHeight(134);
-    completeFamilies->setFilterMode(Qt::MatchContains);
+    completeFamilies = setupTaxonCompleter(134);
     ui->familySearch->setCompleter(0);
 
     QString agent = "";
@@ -134,72 +118,59 @@ bool NewDeterminationDialog::newSensu()
     return sensuAdded;
 }
 
-void NewDeterminationDialog::on_genusSearch_textChanged(const QString &arg1)
+QCompleter *NewDeterminationDialog::setupTaxonCompleter(int minHeight)
 {
-    if (arg1.length() > 0 && arg1.length() < 3)
-    {
-        ui->genusSearch->setCompleter(0);
-    }
-    else
-    {
-        ui->genusSearch->setCompleter(completeGenera);
-    }
-
-    // If the current text isn't recognized as a genus, do not set other taxonomic names
-    if (!allGenera.contains(arg1,Qt::CaseInsensitive))
-    {
-        return;
-    }
-
-    tsnID = arg1.split(" ").last();
-    tsnID.remove("(");
-    tsnID.remove(")");
-    ui->tsnID->setText(tsnID);
-    setTaxaFromTSNID();
+    // the completer only ever holds the current top matches from the taxon index,
+    // so it shows its model as-is instead of filtering the full list itself
+    QCompleter *completer = new QCompleter(new QStringListModel(this), this);
+    completer->setCaseSensitivity(Qt::CaseInsensitive);
+    completer->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+    completer->popup()->setHorizontalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+    completer->popup()->setMinimumWidth(300);
+    completer->popup()->setMinimumHeight(minHeight);
+    return completer;
 }
 
-void NewDeterminationDialog::on_commonNameSearch_textChanged(const QString &arg1)
+void NewDeterminationDialog::taxonSearch(TaxonIndex::Field field, QLineEdit *box, QCompleter *completer, const QString &arg1)
 {
-    if (arg1.length() > 0 && arg1.length() < 3)
+    // a leading * also searches inside names, which scans the whole list
+    QStringListModel *model = static_cast<QStringListModel*>(completer->model());
+    bool anywhere = arg1.startsWith("*");
+    QString text = anywhere ? arg1.mid(1) : arg1;
+    if (text.length() > 0 && text.length() < 3)
     {
-        ui->commonNameSearch->setCompleter(0);
+        box->setCompleter(0);
+        model->setStringList(QStringList());
     }
     else
     {
-        ui->commonNameSearch->setCompleter(completeCommonNames);
+        model->setStringList(taxonIndex->matches(field, text, 100, anywhere));
+        box->setCompleter(completer);
     }
 
-    // If the current text isn't recognized as a common name, do not set other taxonomic names
-    if (!allCommonNames.contains(arg1,Qt::CaseInsensitive))
+    // If the current text isn't recognized as a name, do not set other taxonomic names
+    QString tsn = taxonIndex->exactTSN(field, arg1);
+    if (tsn.isEmpty())
         return;
 
-    tsnID = arg1.split(" ").last();
-    tsnID.remove("(");
-    tsnID.remove(")");
+    tsnID = tsn;
     ui->tsnID->setText(tsnID);
     setTaxaFromTSNID();
 }
 
-void NewDeterminationDialog::on_familySearch_textChanged(const QString &arg1)
+void NewDeterminationDialog::on_genusSearch_textChanged(const QString &arg1)
 {
-    if (arg1.length() > 0 && arg1.length() < 3)
-    {
-        ui->familySearch->setCompleter(0);
-    }
-    else
-    {
-        ui->familySearch->setCompleter(completeFamilies);
-    }
+    taxonSearch(TaxonIndex::Genus, ui->genusSearch, completeGenera, arg1);
+}
 
-    // If the current text isn't recognized as a family name, do not set other taxonomic names
-    if (!allFamilies.contains(arg1,Qt::CaseInsensitive))
-        return;
+void NewDeterminationDialog::on_commonNameSearch_textChanged(const QString &arg1)
+{
+    taxonSearch(TaxonIndex::CommonName, ui->commonNameSearch, completeCommonNames, arg1);
+}
 
-    tsnID = arg1.split(" ").last();
-    tsnID.remove("(");
-    tsnID.remove(")");
-    ui->tsnID->setText(tsnID);
-    setTaxaFromTSNID();
+void NewDeterminationDialog::on_familySearch_textChanged(const QString &arg1)
+{
+    taxonSearch(TaxonIndex::Family, ui->familySearch, completeFamilies, arg1);
 }
 
 void NewDeterminationDialog::on_identifiedBy_currentTextChanged(const QString &arg1)
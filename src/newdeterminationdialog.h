@@ -25,7 +25,10 @@
 
 #include <QDialog>
 #include <QCompleter>
+#include <QLineEdit>
+#include <QStringListModel>
 #include "determination.h"
+#include "taxonindex.h"
 
 namespace Ui {
 class NewDeterminationDialog;
@@ -36,7 +39,7 @@ class NewDeterminationDialog : public QDialog
     Q_OBJECT
 
 public:
-    explicit NewDeterminationDialog(const QString &organismID, const QStringList &allGenera,  const QStringList &allCommonNames, const QStringList &families, const QStringList &agents, const QStringList &sensus, QWidget *parent = 0);
+    explicit NewDeterminationDialog(const QString &organismID, const TaxonIndex *index, const QStringList &agents, const QStringList &sensus, QWidget *parent = 0);
     ~NewDeterminationDialog();
 
     Determination getDetermination();
@@ -71,9 +74,9 @@ private:
     QPointer<QCompleter> completeCommonNames;
     QPointer<QCompleter> completeFamilies;
     QPointer<QCompleter> completeSensu;
-    QStringList allGenera;
-    QStringList allCommonNames;
-    QStringList allFamilies;
+    const TaxonIndex *taxonIndex;
+    QCompleter *setupTaxonCompleter(int minHeight);
+    void taxonSearch(TaxonIndex::Field field, QLineEdit *box, QCompleter *completer, const QString &arg1);
     bool sensuAdded;
     QStringList allSensus;
     QString modifiedNow();
@@ -0,0 +1,272 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <cmath>
+#include <QApplication>
+#include <QStandardPaths>
+#include <QtMath>
+
+#include "offlinegeocoder.h"
+
+OfflineGeocoder::OfflineGeocoder()
+{
+}
+
+QString OfflineGeocoder::dataPath()
+{
+    // use QStandardPaths::AppDataLocation for Windows or Mac, for *NIX use applicationDirPath
+#if defined(Q_OS_WIN) || defined(Q_OS_MAC)
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/data/geonames";
+#else
+    return QApplication::applicationDirPath() + "/data/geonames";
+#endif
+}
+
+QSharedPointer<const OfflineGeocoder> OfflineGeocoder::shared()
+{
+    static QMutex mutex;
+    static QSharedPointer<const OfflineGeocoder> instance;
+
+    // the files are only read once; if they were missing, check again next time in case they've been added
+    QMutexLocker locker(&mutex);
+    if (instance.isNull())
+    {
+        OfflineGeocoder *geocoder = new OfflineGeocoder;
+        if (geocoder->load())
+            instance = QSharedPointer<const OfflineGeocoder>(geocoder);
+        else
+            delete geocoder;
+    }
+    return instance;
+}
+
+int OfflineGeocoder::size() const
+{
+    return places.size();
+}
+
+bool OfflineGeocoder::load()
+{
+    QString path = dataPath();
+    QString placesFile;
+    QStringList candidates;
+    candidates << "cities500.txt" << "cities1000.txt" << "cities5000.txt" << "cities15000.txt";
+    for (auto c : candidates)
+    {
+        if (QFileInfo::exists(path + "/" + c))
+        {
+            placesFile = path + "/" + c;
+            break;
+        }
+    }
+    if (placesFile.isEmpty())
+        return false;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QHash<QString,int> countryIndexes;
+    QHash<QString,int> admin1Codes;
+    QHash<QString,int> admin2Codes;
+    if (!loadCountries(countryIndexes))
+        return false;
+    loadAreas(path + "/admin1CodesASCII.txt", admin1Codes);
+    loadAreas(path + "/admin2Codes.txt", admin2Codes);
+    if (!loadPlaces(placesFile, countryIndexes, admin1Codes, admin2Codes))
+        return false;
+
+    build(0, places.size(), 0);
+
+    qDebug() << __LINE__ << "Loaded " + QString::number(places.size()) + " GeoNames places for offline geocoding in " +
+                QString::number(timer.elapsed()) + " ms";
+    return true;
+}
+
+bool OfflineGeocoder::loadCountries(QHash<QString,int> &codes)
+{
+    QFile file(dataPath() + "/countryInfo.txt");
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qDebug() << __LINE__ << "Offline geocoding needs " + file.fileName();
+        return false;
+    }
+
+    // ISO, ISO3, ISO-Numeric, fips, Country, Capital, Area, Population, Continent, ...
+    while (!file.atEnd())
+    {
+        QString line = QString::fromUtf8(file.readLine()).trimmed();
+        if (line.isEmpty() || line.startsWith("#"))
+            continue;
+        QStringList fields = line.split('\t');
+        if (fields.size() < 9)
+            continue;
+        codes.insert(fields.at(0), countryCodes.size());
+        countryCodes.append(fields.at(0));
+        continents.append(fields.at(8));
+    }
+    return !countryCodes.isEmpty();
+}
+
+bool OfflineGeocoder::loadAreas(const QString &fileName, QHash<QString,int> &codes)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qDebug() << __LINE__ << "Offline geocoding will leave out the areas in " + fileName;
+        return false;
+    }
+
+    // code ("US.TN" or "US.TN.037"), name, ascii name, geonameid
+    while (!file.atEnd())
+    {
+        QStringList fields = QString::fromUtf8(file.readLine()).trimmed().split('\t');
+        if (fields.size() < 4)
+            continue;
+        Area area;
+        area.name = fields.at(1);
+        area.geonameID = fields.at(3);
+        codes.insert(fields.at(0), areas.size());
+        areas.append(area);
+    }
+    return true;
+}
+
+bool OfflineGeocoder::loadPlaces(const QString &fileName, const QHash<QString,int> &countryIndexes,
+                                 const QHash<QString,int> &admin1Codes, const QHash<QString,int> &admin2Codes)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    // geonameid, name, asciiname, alternatenames, latitude, longitude, feature class, feature code,
+    // country code, cc2, admin1 code, admin2 code, ...
+    while (!file.atEnd())
+    {
+        QStringList fields = QString::fromUtf8(file.readLine()).split('\t');
+        if (fields.size() < 12)
+            continue;
+
+        bool latOK, lonOK;
+        double lat = fields.at(4).toDouble(&latOK);
+        double lon = fields.at(5).toDouble(&lonOK);
+        if (!latOK || !lonOK)
+            continue;
+
+        QString country = fields.at(8);
+        QString admin1 = country + "." + fields.at(10);
+        QString admin2 = admin1 + "." + fields.at(11);
+
+        Place p;
+        toUnitVector(lat, lon, p.position);
+        p.name = placeNames.size();
+        p.country = countryIndexes.value(country, -1);
+        p.admin1 = fields.at(10).isEmpty() ? -1 : admin1Codes.value(admin1, -1);
+        p.admin2 = fields.at(11).isEmpty() ? -1 : admin2Codes.value(admin2, -1);
+        placeNames.append(fields.at(1));
+        places.append(p);
+    }
+    return !places.isEmpty();
+}
+
+void OfflineGeocoder::toUnitVector(double latitude, double longitude, float *position)
+{
+    // nearest by chord length on the unit sphere is nearest by great circle distance,
+    // without any special handling of the poles or the antimeridian
+    double lat = qDegreesToRadians(latitude);
+    double lon = qDegreesToRadians(longitude);
+    position[0] = float(cos(lat) * cos(lon));
+    position[1] = float(cos(lat) * sin(lon));
+    position[2] = float(sin(lat));
+}
+
+void OfflineGeocoder::build(int begin, int end, int depth)
+{
+    if (end - begin < 2)
+        return;
+    int axis = depth % 3;
+    int mid = (begin + end) / 2;
+    std::nth_element(places.begin() + begin, places.begin() + mid, places.begin() + end,
+                     [axis](const Place &a, const Place &b) { return a.position[axis] < b.position[axis]; });
+    build(begin, mid, depth + 1);
+    build(mid + 1, end, depth + 1);
+}
+
+void OfflineGeocoder::nearest(int begin, int end, int depth, const float *target, int &best, float &bestDistance) const
+{
+    if (begin >= end)
+        return;
+
+    int mid = (begin + end) / 2;
+    const Place &p = places.at(mid);
+    float dx = p.position[0] - target[0];
+    float dy = p.position[1] - target[1];
+    float dz = p.position[2] - target[2];
+    float distance = dx*dx + dy*dy + dz*dz;
+    if (distance < bestDistance)
+    {
+        bestDistance = distance;
+        best = mid;
+    }
+
+    // search the side of the split holding the target first, and the other side only if it could be closer
+    int axis = depth % 3;
+    float split = target[axis] - p.position[axis];
+    if (split < 0)
+    {
+        nearest(begin, mid, depth + 1, target, best, bestDistance);
+        if (split * split < bestDistance)
+            nearest(mid + 1, end, depth + 1, target, best, bestDistance);
+    }
+    else
+    {
+        nearest(mid + 1, end, depth + 1, target, best, bestDistance);
+        if (split * split < bestDistance)
+            nearest(begin, mid, depth + 1, target, best, bestDistance);
+    }
+}
+
+bool OfflineGeocoder::lookup(double latitude, double longitude, GeocodeResult &result) const
+{
+    if (places.isEmpty() || qAbs(latitude) > 90.0 || qAbs(longitude) > 180.0)
+        return false;
+
+    float target[3];
+    toUnitVector(latitude, longitude, target);
+    int best = -1;
+    float bestDistance = 5.0f;  // larger than any squared chord on the unit sphere
+    nearest(0, places.size(), 0, target, best, bestDistance);
+    if (best == -1)
+        return false;
+
+    const Place &p = places.at(best);
+    double chord = std::sqrt(double(bestDistance));
+    result.distance = 6371.0 * 2.0 * std::asin(qMin(1.0, chord / 2.0));
+
+    result.countryCode = p.country == -1 ? QString() : countryCodes.at(p.country);
+    result.continent = p.country == -1 ? QString() : continents.at(p.country);
+    result.stateProvince = p.admin1 == -1 ? QString() : areas.at(p.admin1).name;
+    result.county = p.admin2 == -1 ? QString() : areas.at(p.admin2).name;
+    result.geonamesAdmin = p.admin2 == -1 ? QString() : areas.at(p.admin2).geonameID;
+    result.locality = result.distance <= maxLocalityDistance ? placeNames.at(p.name) : QString();
+    return true;
+}
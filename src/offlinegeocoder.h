@@ -0,0 +1,92 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef OFFLINEGEOCODER_H
+#define OFFLINEGEOCODER_H
+
+#include <QtCore>
+
+struct GeocodeResult
+{
+    QString continent;
+    QString countryCode;
+    QString stateProvince;
+    QString county;
+    QString locality;
+    QString geonamesAdmin;
+    double distance;        // kilometers to the nearest populated place
+};
+
+// Reverse geocoder that works without a network connection. It reads the
+// GeoNames populated place, admin1, admin2 and country dumps from data/geonames
+// and keeps the places in a k-d tree over points on the unit sphere, so the
+// nearest place to a coordinate, and through it the country, state and county,
+// is found in O(log n).
+//
+// The files are the ones published at http://download.geonames.org/export/dump/:
+// one of cities500.txt, cities1000.txt, cities5000.txt or cities15000.txt, plus
+// admin1CodesASCII.txt, admin2Codes.txt and countryInfo.txt.
+class OfflineGeocoder
+{
+public:
+    static QSharedPointer<const OfflineGeocoder> shared();
+    static QString dataPath();
+
+    bool lookup(double latitude, double longitude, GeocodeResult &result) const;
+    int size() const;
+
+    static const int maxLocalityDistance = 25;  // kilometers; farther places only give the admin areas
+
+private:
+    OfflineGeocoder();
+
+    struct Area
+    {
+        QString name;
+        QString geonameID;
+    };
+    struct Place
+    {
+        float position[3];
+        int name;
+        int country;
+        int admin1;         // index into areas, or -1
+        int admin2;
+    };
+
+    bool load();
+    bool loadAreas(const QString &fileName, QHash<QString,int> &codes);
+    bool loadCountries(QHash<QString,int> &codes);
+    bool loadPlaces(const QString &fileName, const QHash<QString,int> &countryCodes,
+                    const QHash<QString,int> &admin1Codes, const QHash<QString,int> &admin2Codes);
+    void build(int begin, int end, int depth);
+    void nearest(int begin, int end, int depth, const float *target, int &best, float &bestDistance) const;
+    static void toUnitVector(double latitude, double longitude, float *position);
+
+    QVector<Place> places;        // in k-d tree order: the median of each range splits it
+    QVector<QString> placeNames;
+    QVector<Area> areas;
+    QVector<QString> countryCodes;
+    QVector<QString> continents;
+};
+
+#endif // OFFLINEGEOCODER_H
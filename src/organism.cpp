@@ -23,6 +23,8 @@
 #include <QDateTime>
 #include "organism.h"
 
+constexpr SchemaColumn<Organism> RowSchema<Organism>::columns[];
+
 Organism::Organism()
 {
     Initialize();
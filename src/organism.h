@@ -25,6 +25,8 @@
 
 #include <QtCore>
 
+#include "tableschema.h"
+
 class Organism
 {
 public:
@@ -49,4 +51,27 @@ public:
     QString suppress;
 };
 
+// the columns of the organism table, in table order
+template <>
+struct RowSchema<Organism>
+{
+    static constexpr SchemaColumn<Organism> columns[] = {
+        { "dcterms_identifier",      &Organism::identifier },
+        { "dwc_establishmentMeans",  &Organism::establishmentMeans },
+        { "dcterms_modified",        &Organism::lastModified },
+        { "dwc_organismRemarks",     &Organism::organismRemarks },
+        { "dwc_collectionCode",      &Organism::collectionCode },
+        { "dwc_catalogNumber",       &Organism::catalogNumber },
+        { "dwc_georeferenceRemarks", &Organism::georeferenceRemarks },
+        { "dwc_decimalLatitude",     &Organism::decimalLatitude },
+        { "dwc_decimalLongitude",    &Organism::decimalLongitude },
+        { "geo_alt",                 &Organism::altitudeInMeters },
+        { "dwc_organismName",        &Organism::organismName },
+        { "dwc_organismScope",       &Organism::organismScope },
+        { "cameo",                   &Organism::cameo },
+        { "notes",                   &Organism::notes },
+        { "suppress",                &Organism::suppress }
+    };
+};
+
 #endif // ORGANISM_H
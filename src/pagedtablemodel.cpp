@@ -0,0 +1,433 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <QtConcurrent>
+#include <QSqlQuery>
+#include <QSqlRecord>
+
+#include "pagedtablemodel.h"
+#include "preparedquery.h"
+#include "databaseconnections.h"
+
+PagedTableModel::PagedTableModel(const QString &table, QObject *parent) :
+    QAbstractTableModel(parent),
+    table(table),
+    sortColumn(-1),
+    sortOrder(Qt::AscendingOrder),
+    loaded(false),
+    generation(0)
+{
+    QSqlRecord record = QSqlDatabase::database().record(table);
+    for (int i = 0; i < record.count(); i++)
+        columns << record.fieldName(i);
+
+    // a column that leads an index can be sorted without reading the whole table
+    QSqlQuery indexQry;
+    indexQry.exec("PRAGMA index_list(" + table + ")");
+    while (indexQry.next())
+    {
+        QSqlQuery infoQry;
+        infoQry.exec("PRAGMA index_info(" + indexQry.value("name").toString() + ")");
+        while (infoQry.next())
+        {
+            if (infoQry.value("seqno").toInt() == 0)
+                indexedColumns.insert(infoQry.value("name").toString());
+        }
+    }
+}
+
+void PagedTableModel::prepareTables()
+{
+    // indexes for the columns the table editor sorts on by default that aren't already keys
+    QStringList statements;
+    statements << "CREATE INDEX IF NOT EXISTS images_geonamesOther ON images (geonamesOther)";
+    statements << "CREATE INDEX IF NOT EXISTS determinations_identified ON determinations (dsw_identified)";
+    for (auto statement : statements)
+    {
+        QSqlQuery qry;
+        if (!qry.exec(statement))
+            qDebug() << __LINE__ << "Problem creating sort index: " + qry.lastError().text();
+    }
+}
+
+void PagedTableModel::setFilter(const QString &filter)
+{
+    this->filter = filter;
+    if (loaded)
+        select();
+}
+
+bool PagedTableModel::select()
+{
+    beginResetModel();
+    generation++;
+    loaded = true;
+    rowids.clear();
+    pages.clear();
+    recentPages.clear();
+
+    // the first page is read here so there's something to show while the rest are found, unless
+    // sorting it would mean sorting the whole table; then nothing shows until the worker is done
+    QString where = filter.isEmpty() ? "" : " WHERE " + filter;
+    bool indexed = sortColumn < 0 || sortColumn >= columns.size() || indexedColumns.contains(columns.at(sortColumn));
+    bool ok = true;
+    if (indexed)
+    {
+        PreparedQuery query("SELECT rowid, " + columns.join(", ") + " FROM " + table + where + orderBy() +
+                            " LIMIT " + QString::number(pageSize));
+        ok = query.exec();
+        QVector<QVector<QVariant> > firstPage;
+        while (ok && query.next())
+        {
+            QVector<QVariant> values(columns.size());
+            for (int c = 0; c < columns.size(); c++)
+                values[c] = query.value(c + 1);
+            rowids << query.int64(0);
+            firstPage << values;
+        }
+        if (!firstPage.isEmpty())
+        {
+            pages.insert(0, firstPage);
+            recentPages << 0;
+        }
+        if (!ok)
+            error = query.lastError();
+    }
+    endResetModel();
+
+    if (!ok)
+        return false;
+
+    if (!indexed || rowids.size() == pageSize)
+    {
+        QFutureWatcher<PagedKeys> *watcher = new QFutureWatcher<PagedKeys>(this);
+        connect(watcher, SIGNAL(finished()), this, SLOT(keysLoaded()));
+        watcher->setFuture(QtConcurrent::run(&PagedTableModel::loadKeys,
+                                             "SELECT rowid FROM " + table + where + orderBy(), generation));
+    }
+    return true;
+}
+
+PagedKeys PagedTableModel::loadKeys(const QString &sql, int generation)
+{
+    PagedKeys keys;
+    keys.generation = generation;
+
+    QSqlQuery query(DatabaseConnections::connection());
+    query.setForwardOnly(true);
+    if (!query.exec(sql))
+    {
+        qDebug() << __LINE__ << "Problem finding rows:" << query.lastError().text();
+        return keys;
+    }
+    while (query.next())
+        keys.rowids << query.value(0).toLongLong();
+    return keys;
+}
+
+void PagedTableModel::keysLoaded()
+{
+    QFutureWatcher<PagedKeys> *watcher = static_cast<QFutureWatcher<PagedKeys>*>(sender());
+    PagedKeys keys = watcher->result();
+    watcher->deleteLater();
+
+    // a later select() has already replaced these rows
+    if (keys.generation != generation)
+        return;
+
+    int shown = rowids.size();
+    if (keys.rowids.size() > shown && keys.rowids.mid(0, shown) == rowids)
+    {
+        beginInsertRows(QModelIndex(), shown, keys.rowids.size() - 1);
+        rowids = keys.rowids;
+        endInsertRows();
+    }
+    else if (keys.rowids != rowids)
+    {
+        // the table was changed between reading the first page and the keys
+        beginResetModel();
+        rowids = keys.rowids;
+        pages.clear();
+        recentPages.clear();
+        endResetModel();
+    }
+}
+
+QString PagedTableModel::orderBy() const
+{
+    // rowid breaks ties, so the first page and the keys come back in the same order
+    if (sortColumn < 0 || sortColumn >= columns.size())
+        return " ORDER BY rowid";
+    return " ORDER BY " + columns.at(sortColumn) + (sortOrder == Qt::DescendingOrder ? " DESC" : "") + ", rowid";
+}
+
+QVariant PagedTableModel::stored(int row, int column) const
+{
+    int page = row / pageSize;
+    if (pages.contains(page))
+    {
+        if (recentPages.last() != page)
+        {
+            recentPages.removeOne(page);
+            recentPages << page;
+        }
+    }
+    else
+        loadPage(page);
+
+    return pages.value(page).value(row % pageSize).value(column);
+}
+
+void PagedTableModel::loadPage(int page) const
+{
+    int first = page * pageSize;
+    int count = rowids.size() - first;
+    if (count > pageSize)
+        count = pageSize;
+
+    QStringList placeholders;
+    QHash<qint64, int> position;
+    for (int i = 0; i < count; i++)
+    {
+        placeholders << "?";
+        position.insert(rowids.at(first + i), i);
+    }
+
+    // rows deleted since the keys were read stay blank
+    QVector<QVector<QVariant> > rows(count, QVector<QVariant>(columns.size()));
+    PreparedQuery query("SELECT rowid, " + columns.join(", ") + " FROM " + table +
+                        " WHERE rowid IN (" + placeholders.join(", ") + ")");
+    for (int i = 0; i < count; i++)
+        query.bind(rowids.at(first + i));
+    query.exec();
+    while (query.next())
+    {
+        int i = position.value(query.int64(0), -1);
+        if (i < 0)
+            continue;
+        for (int c = 0; c < columns.size(); c++)
+            rows[i][c] = query.value(c + 1);
+    }
+
+    pages.insert(page, rows);
+    recentPages << page;
+    while (recentPages.size() > maxPages)
+        pages.remove(recentPages.takeFirst());
+}
+
+bool PagedTableModel::isLoaded() const
+{
+    return loaded;
+}
+
+QString PagedTableModel::tableName() const
+{
+    return table;
+}
+
+int PagedTableModel::fieldIndex(const QString &name) const
+{
+    return columns.indexOf(name);
+}
+
+bool PagedTableModel::isDirty() const
+{
+    return !changes.isEmpty() || !removed.isEmpty();
+}
+
+bool PagedTableModel::isDirty(const QModelIndex &index) const
+{
+    if (!index.isValid() || index.row() >= rowids.size())
+        return false;
+
+    qint64 rowid = rowids.at(index.row());
+    return removed.contains(rowid) || changes.value(rowid).contains(index.column());
+}
+
+void PagedTableModel::stampDirtyRows(int column, const QVariant &value)
+{
+    if (column < 0 || column >= columns.size())
+        return;
+
+    for (auto edit = changes.begin(); edit != changes.end(); ++edit)
+    {
+        if (!removed.contains(edit.key()))
+            edit.value().insert(column, value);
+    }
+    if (!changes.isEmpty() && !rowids.isEmpty())
+        emit dataChanged(index(0, column), index(rowids.size() - 1, column));
+}
+
+bool PagedTableModel::submitAll()
+{
+    error = QSqlError();
+
+    for (auto edit = changes.constBegin(); edit != changes.constEnd(); ++edit)
+    {
+        if (removed.contains(edit.key()))
+            continue;
+
+        QStringList assignments;
+        QVariantList values;
+        for (auto column = edit.value().constBegin(); column != edit.value().constEnd(); ++column)
+        {
+            assignments << columns.at(column.key()) + " = (?)";
+            values << column.value();
+        }
+
+        PreparedQuery update("UPDATE " + table + " SET " + assignments.join(", ") + " WHERE rowid = (?)");
+        for (auto value : values)
+            update.bind(value);
+        update.bind(edit.key());
+        if (!update.exec())
+        {
+            error = update.lastError();
+            return false;
+        }
+    }
+
+    PreparedQuery remove("DELETE FROM " + table + " WHERE rowid = (?)");
+    for (auto rowid : removed)
+    {
+        remove.bind(rowid);
+        if (!remove.exec())
+        {
+            error = remove.lastError();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void PagedTableModel::clearChanges()
+{
+    changes.clear();
+    removed.clear();
+}
+
+void PagedTableModel::revertAll()
+{
+    if (!isDirty())
+        return;
+
+    changes.clear();
+    removed.clear();
+    if (!rowids.isEmpty())
+    {
+        emit dataChanged(index(0, 0), index(rowids.size() - 1, columns.size() - 1));
+        emit headerDataChanged(Qt::Vertical, 0, rowids.size() - 1);
+    }
+}
+
+QSqlError PagedTableModel::lastError() const
+{
+    return error;
+}
+
+QSqlDatabase PagedTableModel::database() const
+{
+    return QSqlDatabase::database();
+}
+
+int PagedTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : rowids.size();
+}
+
+int PagedTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : columns.size();
+}
+
+QVariant PagedTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowids.size())
+        return QVariant();
+    if (role != Qt::DisplayRole && role != Qt::EditRole)
+        return QVariant();
+
+    auto edit = changes.constFind(rowids.at(index.row()));
+    if (edit != changes.constEnd() && edit.value().contains(index.column()))
+        return edit.value().value(index.column());
+
+    return stored(index.row(), index.column());
+}
+
+bool PagedTableModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid() || index.row() >= rowids.size() || role != Qt::EditRole)
+        return false;
+
+    qint64 rowid = rowids.at(index.row());
+    if (value == stored(index.row(), index.column()))
+    {
+        // set back to what's in the database
+        changes[rowid].remove(index.column());
+        if (changes.value(rowid).isEmpty())
+            changes.remove(rowid);
+    }
+    else
+        changes[rowid].insert(index.column(), value);
+
+    emit dataChanged(index, index);
+    return true;
+}
+
+QVariant PagedTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role == Qt::DisplayRole)
+    {
+        if (orientation == Qt::Horizontal && section < columns.size())
+            return columns.at(section);
+        if (orientation == Qt::Vertical && section < rowids.size() && removed.contains(rowids.at(section)))
+            return "!";
+    }
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+Qt::ItemFlags PagedTableModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return Qt::NoItemFlags;
+    return QAbstractTableModel::flags(index) | Qt::ItemIsEditable;
+}
+
+bool PagedTableModel::removeRows(int row, int count, const QModelIndex &parent)
+{
+    if (parent.isValid() || row < 0 || count <= 0 || row + count > rowids.size())
+        return false;
+
+    // like OnManualSubmit, the rows are only marked until submitAll()
+    for (int r = row; r < row + count; r++)
+        removed.insert(rowids.at(r));
+    emit headerDataChanged(Qt::Vertical, row, row + count - 1);
+    return true;
+}
+
+void PagedTableModel::sort(int column, Qt::SortOrder order)
+{
+    sortColumn = column;
+    sortOrder = order;
+    if (loaded)
+        select();
+}
@@ -0,0 +1,111 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef PAGEDTABLEMODEL_H
+#define PAGEDTABLEMODEL_H
+
+#include <QtCore>
+#include <QAbstractTableModel>
+#include <QFutureWatcher>
+#include <QSqlDatabase>
+#include <QSqlError>
+
+struct PagedKeys
+{
+    int generation;
+    QVector<qint64> rowids;
+};
+
+// An editable view of one table that only reads the rows that are on screen.
+// select() reads the first page straight away, then finds the rowid of every
+// row in sort order on a worker thread; until that arrives only the first page
+// is shown. When the sort column leads no index, reading even the first page
+// would sort the whole table, so nothing is shown until the worker is done;
+// prepareTables() indexes the columns the table editor sorts on first. Rows
+// are read a page at a time by rowid as they're scrolled to, and only the most
+// recently used pages are kept. Sorting and the filter are done by SQLite in
+// the rowid query.
+//
+// Edits and removals are held, by rowid, as they're made, so saving only
+// touches the rows that changed. submitAll() writes them but keeps them until
+// clearChanges(), so the caller can roll its transaction back and save again.
+class PagedTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    explicit PagedTableModel(const QString &table, QObject *parent = 0);
+    static void prepareTables();
+
+    void setFilter(const QString &filter);
+    bool select();
+    bool isLoaded() const;
+    QString tableName() const;
+    int fieldIndex(const QString &name) const;
+
+    bool isDirty() const;
+    bool isDirty(const QModelIndex &index) const;
+    void stampDirtyRows(int column, const QVariant &value);
+    bool submitAll();
+    void clearChanges();
+    void revertAll();
+    QSqlError lastError() const;
+    QSqlDatabase database() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole);
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+    Qt::ItemFlags flags(const QModelIndex &index) const;
+    bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex());
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+
+private slots:
+    void keysLoaded();
+
+private:
+    static PagedKeys loadKeys(const QString &sql, int generation);
+    QString orderBy() const;
+    QVariant stored(int row, int column) const;
+    void loadPage(int page) const;
+
+    static const int pageSize = 256;
+    static const int maxPages = 64;
+
+    QString table;
+    QString filter;
+    QStringList columns;
+    QSet<QString> indexedColumns;                  // columns that lead an index
+    int sortColumn;
+    Qt::SortOrder sortOrder;
+    bool loaded;
+    int generation;
+    QSqlError error;
+
+    QVector<qint64> rowids;                        // every row, in sort order, once the keys are in
+    mutable QHash<int, QVector<QVector<QVariant> > > pages;
+    mutable QList<int> recentPages;                // least recently used first
+    QHash<qint64, QHash<int, QVariant> > changes;  // rowid -> column -> edited value
+    QSet<qint64> removed;
+};
+
+#endif // PAGEDTABLEMODEL_H
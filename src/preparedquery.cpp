@@ -0,0 +1,95 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "preparedquery.h"
+#include "databaseconnections.h"
+
+PreparedQuery::PreparedQuery(const QString &sql) :
+    sql(sql),
+    query(DatabaseConnections::statement(sql)),
+    bound(0),
+    nanoseconds(0)
+{
+}
+
+PreparedQuery::~PreparedQuery()
+{
+    DatabaseConnections::release(sql, query, nanoseconds);
+}
+
+PreparedQuery &PreparedQuery::bind(const QVariant &value)
+{
+    // bound by position, so values left from a use that never ran can't shift these
+    query->bindValue(bound++, value);
+    return *this;
+}
+
+bool PreparedQuery::exec()
+{
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = query->exec();
+    nanoseconds += timer.nsecsElapsed();
+    bound = 0;
+    if (!ok)
+        qDebug() << __LINE__ << "Problem running" << sql.simplified().left(120) << ":" << query->lastError().text();
+    return ok;
+}
+
+bool PreparedQuery::next()
+{
+    QElapsedTimer timer;
+    timer.start();
+    bool found = query->next();
+    nanoseconds += timer.nsecsElapsed();
+    return found;
+}
+
+QVariant PreparedQuery::value(int column) const
+{
+    return query->value(column);
+}
+
+QString PreparedQuery::string(int column) const
+{
+    return query->value(column).toString();
+}
+
+int PreparedQuery::integer(int column) const
+{
+    return query->value(column).toInt();
+}
+
+qint64 PreparedQuery::int64(int column) const
+{
+    return query->value(column).toLongLong();
+}
+
+bool PreparedQuery::boolean(int column) const
+{
+    return query->value(column).toBool();
+}
+
+QSqlError PreparedQuery::lastError() const
+{
+    return query->lastError();
+}
@@ -0,0 +1,61 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef PREPAREDQUERY_H
+#define PREPAREDQUERY_H
+
+#include <QtCore>
+#include <QSqlQuery>
+#include <QSqlError>
+
+// A statement from this thread's cache in DatabaseConnections, prepared the
+// first time its SQL is used. Values are bound in placeholder order with
+// bind() and columns are read back by type. The time spent in exec() and
+// next() is added to the statement's statistics, and the statement goes back
+// to the cache when this goes out of scope.
+class PreparedQuery
+{
+public:
+    explicit PreparedQuery(const QString &sql);
+    ~PreparedQuery();
+
+    PreparedQuery &bind(const QVariant &value);
+    bool exec();
+    bool next();
+
+    QVariant value(int column) const;
+    QString string(int column) const;
+    int integer(int column) const;
+    qint64 int64(int column) const;
+    bool boolean(int column) const;
+    QSqlError lastError() const;
+
+private:
+    Q_DISABLE_COPY(PreparedQuery)
+
+    QString sql;
+    QSqlQuery *query;
+    int bound;
+    qint64 nanoseconds;
+};
+
+#endif // PREPAREDQUERY_H
@@ -0,0 +1,198 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <QImageReader>
+#include <QtConcurrent>
+
+#include "previewloader.h"
+
+PreviewLoader::PreviewLoader(QObject *parent) :
+    QObject(parent)
+{
+    setMemoryBudget(256);
+
+    // leave the remaining cores for thumbnail generation and the GUI
+    decodePool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, 3));
+}
+
+PreviewLoader::~PreviewLoader()
+{
+    // make any queued decodes return immediately, then wait for the running ones
+    wantedMutex.lock();
+    wantedKeys.clear();
+    wantedMutex.unlock();
+    decodePool.waitForDone();
+}
+
+void PreviewLoader::setMemoryBudget(int megabytes)
+{
+    previewCache.setMaxCost(megabytes * 1024);
+}
+
+void PreviewLoader::clear()
+{
+    wantedMutex.lock();
+    wantedKeys.clear();
+    wantedMutex.unlock();
+    previewCache.clear();
+    displayKey = "";
+}
+
+QString PreviewLoader::cacheKey(const QString &fileName, const QSize &viewport) const
+{
+    return fileName + "|" + QString::number(viewport.width()) + "x" + QString::number(viewport.height());
+}
+
+QImage PreviewLoader::cached(const QString &fileName, const QSize &viewport)
+{
+    QImage *img = previewCache.object(cacheKey(fileName, viewport));
+    if (img == 0)
+        return QImage();
+    return *img;
+}
+
+bool PreviewLoader::isWanted(const QString &key)
+{
+    QMutexLocker locker(&wantedMutex);
+    return wantedKeys.contains(key);
+}
+
+void PreviewLoader::request(const QString &fileName, const QSize &viewport, const QStringList &neighbors)
+{
+    // anything queued for an earlier position that isn't wanted anymore is skipped by the decode threads
+    QSet<QString> wanted;
+    displayKey = cacheKey(fileName, viewport);
+    wanted.insert(displayKey);
+    for (auto neighbor : neighbors)
+        wanted.insert(cacheKey(neighbor, viewport));
+
+    wantedMutex.lock();
+    wantedKeys = wanted;
+    wantedMutex.unlock();
+
+    QImage *img = previewCache.object(displayKey);
+    if (img != 0)
+    {
+        displayKey = "";
+        emit previewReady(fileName, *img);
+    }
+    else
+        enqueue(displayKey, fileName, viewport);
+
+    for (auto neighbor : neighbors)
+    {
+        QString key = cacheKey(neighbor, viewport);
+        if (!previewCache.contains(key))
+            enqueue(key, neighbor, viewport);
+    }
+}
+
+void PreviewLoader::enqueue(const QString &key, const QString &fileName, const QSize &viewport)
+{
+    // a decode that is already queued or running for this key will be used when it finishes
+    if (pending.contains(key))
+        return;
+    pending.insert(key, viewport);
+
+    QFutureWatcher<PreviewResult> *watcher = new QFutureWatcher<PreviewResult>(this);
+    connect(watcher, SIGNAL(finished()), this, SLOT(decodeFinished()));
+    watcher->setFuture(QtConcurrent::run(&decodePool, this, &PreviewLoader::decode, key, fileName, viewport));
+}
+
+void PreviewLoader::decodeFinished()
+{
+    QFutureWatcher<PreviewResult> *watcher = static_cast<QFutureWatcher<PreviewResult>*>(sender());
+    PreviewResult result = watcher->result();
+    watcher->deleteLater();
+    QSize viewport = pending.take(result.key);
+
+    if (result.stale)
+    {
+        // it became wanted again after the decode thread had already skipped it
+        if (isWanted(result.key))
+            enqueue(result.key, result.fileName, viewport);
+        return;
+    }
+
+    if (!result.image.isNull())
+        previewCache.insert(result.key, new QImage(result.image), qMax(1, result.image.byteCount() / 1024));
+
+    // a null image for the displayed key means the file couldn't be read, so the caller should fall back
+    if (result.key == displayKey)
+    {
+        displayKey = "";
+        emit previewReady(result.fileName, result.image);
+    }
+}
+
+QSize PreviewLoader::fitToViewport(const QSize &imageSize, const QSize &viewport)
+{
+    int wid = imageSize.width();
+    int hei = imageSize.height();
+    int w = viewport.width();
+    int h = viewport.height();
+
+    if (wid <= 0 || hei <= 0)
+        return viewport;
+
+    if (w == h && wid == hei)
+        return QSize(w,h);
+    else if (float(wid)/hei > float(w)/h)
+        return QSize(w,(w*hei)/wid);
+    else
+        return QSize((h*wid)/hei,h);
+}
+
+PreviewResult PreviewLoader::decode(const QString &key, const QString &fileName, const QSize &viewport)
+{
+    PreviewResult result;
+    result.key = key;
+    result.fileName = fileName;
+    result.stale = !isWanted(key);
+    if (result.stale)
+        return result;
+
+    if (!QFileInfo(fileName).isFile())
+        return result;
+
+    QImageReader imageReader(fileName);
+    imageReader.setAutoTransform(true);
+    QSize fullSize = imageReader.size();
+    bool rotated = imageReader.transformation() & QImageIOHandler::TransformationRotate90;
+
+    // the width and height reported by QImageReader::size() depend upon image orientation
+    if (rotated)
+        fullSize.transpose();
+
+    // the scaled size is applied while decoding, before the orientation transform
+    QSize scaled = fitToViewport(fullSize, viewport);
+    if (rotated)
+        scaled.transpose();
+    imageReader.setScaledSize(scaled);
+
+    if (imageReader.canRead())
+        result.image = imageReader.read();
+    else
+        qDebug() << __LINE__ << "Could not load image from file: " + fileName;
+
+    return result;
+}
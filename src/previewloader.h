@@ -0,0 +1,79 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef PREVIEWLOADER_H
+#define PREVIEWLOADER_H
+
+#include <QObject>
+#include <QtCore>
+#include <QImage>
+#include <QCache>
+#include <QMutex>
+#include <QThreadPool>
+#include <QFutureWatcher>
+
+struct PreviewResult
+{
+    QString key;
+    QString fileName;
+    QImage image;
+    bool stale;
+};
+
+// Decodes viewport-sized previews of the full resolution images on worker threads
+// and keeps the most recently used ones in memory so that stepping through
+// the selected images doesn't have to wait on the JPEG decoder.
+class PreviewLoader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PreviewLoader(QObject *parent = 0);
+    ~PreviewLoader();
+
+    QImage cached(const QString &fileName, const QSize &viewport);
+    void request(const QString &fileName, const QSize &viewport, const QStringList &neighbors);
+    void setMemoryBudget(int megabytes);
+    void clear();
+
+    static QSize fitToViewport(const QSize &imageSize, const QSize &viewport);
+
+signals:
+    void previewReady(const QString &fileName, const QImage &image);
+
+private slots:
+    void decodeFinished();
+
+private:
+    PreviewResult decode(const QString &key, const QString &fileName, const QSize &viewport);
+    QString cacheKey(const QString &fileName, const QSize &viewport) const;
+    void enqueue(const QString &key, const QString &fileName, const QSize &viewport);
+    bool isWanted(const QString &key);
+
+    QCache<QString,QImage> previewCache; // cost is in kilobytes
+    QHash<QString,QSize> pending;        // cache key -> viewport of queued or running decodes
+    QString displayKey;
+    QSet<QString> wantedKeys;            // shared with the decode threads
+    QMutex wantedMutex;
+    QThreadPool decodePool;
+};
+
+#endif // PREVIEWLOADER_H
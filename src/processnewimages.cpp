@@ -31,10 +31,13 @@
 #include <QSqlQuery>
 #include <QSqlRecord>
 #include <QSqlError>
+#include <QtConcurrent>
 
 #include "newagentdialog.h"
 #include "startwindow.h"
 #include "processnewimages.h"
+#include "imageidentifiers.h"
+#include "contenthashes.h"
 #include "ui_processnewimages.h"
 
 ProcessNewImages::ProcessNewImages(QWidget *parent) :
@@ -43,6 +46,8 @@ ProcessNewImages::ProcessNewImages(QWidget *parent) :
 {
     ui->setupUi(this);
     screenPosLoaded = false;
+    hashingTrailingChars = 0;
+    connect(&hashWatcher, SIGNAL(finished()), this, SLOT(hashesFinished()));
     move(QApplication::desktop()->screen()->rect().center() - rect().center());
 
 #ifdef Q_OS_MAC
@@ -57,6 +62,7 @@ ProcessNewImages::ProcessNewImages(QWidget *parent) :
     ui->addnewAgentButton->setAutoDefault(true);
     ui->helpButton->setAutoDefault(true);
     ui->selectImagesButton->setAutoDefault(true);
+    ui->watchFolderButton->setAutoDefault(true);
     ui->clearButton->setAutoDefault(true);
     ui->backButton->setAutoDefault(true);
     ui->doneButton->setAutoDefault(true);
@@ -266,50 +272,29 @@ void ProcessNewImages::on_selectImagesButton_clicked()
         }
     }
 
-    QSqlQuery namespaceQuery;
-    namespaceQuery.prepare("SELECT fileName, dcterms_identifier FROM images");
-    namespaceQuery.exec();
-
-    while (namespaceQuery.next())
+    // one indexed join against the images already in this namespace
+    filenameCollisions = ImageIdentifiers::collisions(nameSpace, baseNames);
+    for (auto ff : filenameCollisions)
     {
-        QString ff = namespaceQuery.value(0).toString();
-        QString id = namespaceQuery.value(1).toString();
-        id.remove("http://bioimages.vanderbilt.edu/");
-        id.remove(QRegExp("/.*"));
-        if (id != nameSpace)
-            continue;
-        else if (baseNames.contains(ff))
-        {
-            filenameCollisions.append(ff);
-            baseNames.removeOne(ff);
-            fileNames.removeOne(baseToFileHash.value(ff));
-        }
+        baseNames.removeOne(ff);
+        fileNames.removeOne(baseToFileHash.value(ff));
     }
 
-
-    foreach(QString f, fileNames)
+    // files already catalogued under another name or folder are recognised by their content;
+    // hashing them all takes a while on large selections, so it runs on a worker thread and
+    // hashesFinished() adds the rest to the list
+    if (!fileNames.isEmpty())
     {
-        // if the file is already in the "to be added" list, don't add it again
-        if (ui->listWidget->findItems(f, Qt::MatchExactly).size() != 0)
-            continue;
-
-        QFileInfo fileInfo(f);
-        QString base = fileInfo.fileName();
-
-        ui->listWidget->addItem(f);
-        nameSpaceHash.insert(f,nameSpace);
-        photographerHash.insert(f,photographer);
-        trailingHash.insert(f,trailingChars);
-        Image newImage;
-        newImage.fileAndPath = f;
-        newImage.fileName = base;
-        // need to create a unique identifier for this image
-        //newImage.identifier = "http://bioimages.vanderbilt.edu/" + nameSpace + "/" + identifier;
-        newImage.photographerCode = photographer;
+        hashingNameSpace = nameSpace;
+        hashingPhotographer = photographer;
+        hashingTrailingChars = trailingChars;
+        ui->selectImagesButton->setEnabled(false);
+        ui->clearButton->setEnabled(false);
+        ui->doneButton->setEnabled(false);
+        ui->listWidget->setCursor(Qt::BusyCursor);
+        hashWatcher.setFuture(QtConcurrent::run(&ContentHashes::hashFiles, fileNames));
     }
 
-    setNumFiles();
-
     db.transaction();
 
     qry.prepare("INSERT OR REPLACE INTO settings (setting, value) VALUES (?, ?)");
@@ -343,11 +328,6 @@ void ProcessNewImages::on_selectImagesButton_clicked()
         db.rollback();
     }
 
-#ifndef Q_OS_MAC
-    if (!fileNames.isEmpty())
-        ui->doneButton->setFocus();
-#endif
-
 
     if (!filenameCollisions.isEmpty())
     {
@@ -379,12 +359,113 @@ void ProcessNewImages::on_selectImagesButton_clicked()
     }
 }
 
+void ProcessNewImages::hashesFinished()
+{
+    QStringList candidates = fileNames;
+    QHash<QString,QString> selectedHashes = hashWatcher.result();
+    ui->listWidget->unsetCursor();
+    ui->selectImagesButton->setEnabled(true);
+    ui->clearButton->setEnabled(true);
+    ui->doneButton->setEnabled(true);
+
+    QHash<QString,QString> cataloguedHashes = ContentHashes::catalogued(selectedHashes.values());
+    QStringList alreadyCatalogued;
+    QHashIterator<QString,QString> hashIt(selectedHashes);
+    while (hashIt.hasNext())
+    {
+        hashIt.next();
+        if (cataloguedHashes.contains(hashIt.value()))
+        {
+            alreadyCatalogued.append(hashIt.key() + "  (" + cataloguedHashes.value(hashIt.value()) + ")");
+            candidates.removeOne(hashIt.key());
+        }
+        else
+            contentHashHash.insert(hashIt.key(), hashIt.value());
+    }
+
+    foreach(QString f, candidates)
+    {
+        // if the file is already in the "to be added" list, don't add it again
+        if (ui->listWidget->findItems(f, Qt::MatchExactly).size() != 0)
+            continue;
+
+        ui->listWidget->addItem(f);
+        nameSpaceHash.insert(f,hashingNameSpace);
+        photographerHash.insert(f,hashingPhotographer);
+        trailingHash.insert(f,hashingTrailingChars);
+    }
+
+    setNumFiles();
+
+#ifndef Q_OS_MAC
+    if (!candidates.isEmpty())
+        ui->doneButton->setFocus();
+#endif
+
+    if (!alreadyCatalogued.isEmpty())
+    {
+        QMessageBox msgBox;
+        msgBox.setText("The following files are already in the Bioimages database, possibly\n"
+                       "under another filename. They were not added.\n");
+        msgBox.setDetailedText(alreadyCatalogued.join("\n"));
+        msgBox.exec();
+    }
+}
+
+void ProcessNewImages::on_watchFolderButton_clicked()
+{
+    if (ui->namespaceBox->currentText().isEmpty())
+    {
+        QMessageBox msgBox;
+        msgBox.setText("Please specify a namespace first.");
+        msgBox.exec();
+        return;
+    }
+
+    if (ui->photographerBox->currentText().isEmpty())
+    {
+        QMessageBox msgBox;
+        msgBox.setText("Please specify a photographer first.");
+        msgBox.exec();
+        return;
+    }
+
+    QString lastFolder = "";
+    QSqlQuery qry;
+    qry.prepare("SELECT value FROM settings WHERE setting = (?)");
+    qry.addBindValue("path.watchfolder");
+    qry.exec();
+    if (qry.next())
+        lastFolder = qry.value(0).toString();
+
+    QString folder = QFileDialog::getExistingDirectory(this, "Folder to watch for new images", lastFolder);
+    if (folder.isEmpty())
+        return;
+
+    watchFolder = folder;
+    ui->watchFolderButton->setText("Watching " + QDir(folder).dirName());
+    ui->watchFolderButton->setToolTip(folder);
+
+    qry.prepare("INSERT OR REPLACE INTO settings (setting, value) VALUES (?, ?)");
+    qry.addBindValue("path.watchfolder");
+    qry.addBindValue(folder);
+    qry.exec();
+
+#ifndef Q_OS_MAC
+    ui->doneButton->setFocus();
+#endif
+}
+
 void ProcessNewImages::on_clearButton_clicked()
 {
+    watchFolder = "";
+    ui->watchFolderButton->setText("Watch a folder");
+    ui->watchFolderButton->setToolTip("Keep adding new images from a folder, such as a card reader or tethered camera, while you enter data");
     ui->listWidget->clear();
     setNumFiles();
     nameSpaceHash.clear();
     photographerHash.clear();
+    contentHashHash.clear();
     images.clear();
 }
 
@@ -443,7 +524,7 @@ void ProcessNewImages::on_doneButton_clicked()
 {
     ui->selectImagesButton->setStyleSheet("border: 1px solid black; border-radius: 6px; min-width: 80px; background-color: qlineargradient(x1: 0, y1: 0, x2: 0, y2: 1, stop: 0 #f6f7fa, stop: 1 #dadbde)");
 
-    if (ui->listWidget->count() == 0)
+    if (ui->listWidget->count() == 0 && watchFolder.isEmpty())
     {
         ui->selectImagesButton->setStyleSheet("border: 2px solid red; border-radius: 6px; min-width: 80px; background-color: qlineargradient(x1: 0, y1: 0, x2: 0, y2: 1, stop: 0 #f6f7fa, stop: 1 #dadbde)");
 
@@ -523,8 +604,11 @@ void ProcessNewImages::on_doneButton_clicked()
             db.rollback();
         }
 
-        dataEntry = new DataEntry(imageFileNames,nameSpaceHash,photographerHash,trailingHash,agentHash);
+        dataEntry = new DataEntry(imageFileNames,nameSpaceHash,photographerHash,trailingHash,agentHash,contentHashHash);
         dataEntry->setAttribute(Qt::WA_DeleteOnClose);
+        if (!watchFolder.isEmpty())
+            dataEntry->watchFolder(watchFolder, ui->namespaceBox->currentText(), ui->photographerBox->currentText(),
+                                   ui->trailingCharacters->text().toInt());
         connect(dataEntry,SIGNAL(windowClosed()),this,SLOT(closeDataEntry()));
         this->hide();
         dataEntry->show();
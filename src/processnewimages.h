@@ -25,6 +25,7 @@
 
 #include <QWidget>
 #include <QProcess>
+#include <QFutureWatcher>
 #include <memory>
 #include "agent.h"
 #include "dataentry.h"
@@ -48,6 +49,7 @@ signals:
 private slots:
     void on_backButton_clicked();
     void on_selectImagesButton_clicked();
+    void on_watchFolderButton_clicked();
     void on_clearButton_clicked();
     void on_doneButton_clicked();
     void on_helpButton_clicked();
@@ -55,6 +57,7 @@ private slots:
     void on_agentBox_currentTextChanged(const QString &arg1);
     void on_namespaceBox_currentTextChanged(const QString &arg1);
     void closeDataEntry();
+    void hashesFinished();
 
 private:
     Ui::ProcessNewImages *ui;
@@ -69,6 +72,12 @@ private:
     QHash<QString,QString> agentHash;
     QHash<QString,QString> nameSpaceHash;
     QHash<QString,int> trailingHash;
+    QHash<QString,QString> contentHashHash;
+    QFutureWatcher<QHash<QString,QString> > hashWatcher;
+    QString hashingNameSpace;
+    QString hashingPhotographer;
+    int hashingTrailingChars;
+    QString watchFolder;
 
     void loadAgents();
     void setAgent(QString &agent, QString &nameSpace, QString &photographer);
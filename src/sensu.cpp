@@ -22,6 +22,8 @@
 
 #include "sensu.h"
 
+constexpr SchemaColumn<Sensu> RowSchema<Sensu>::columns[];
+
 Sensu::Sensu()
 {
     identifier = "";
@@ -25,6 +25,8 @@
 
 #include <QtCore>
 
+#include "tableschema.h"
+
 class Sensu
 {
 public:
@@ -42,4 +44,20 @@ public:
     QString lastModified;
 };
 
+// the columns of the sensu table, in table order
+template <>
+struct RowSchema<Sensu>
+{
+    static constexpr SchemaColumn<Sensu> columns[] = {
+        { "dcterms_identifier", &Sensu::identifier },
+        { "dc_creator",         &Sensu::creator },
+        { "tcsSignature",       &Sensu::tcsSignature },
+        { "dcterms_title",      &Sensu::title },
+        { "dc_publisher",       &Sensu::publisher },
+        { "dcterms_created",    &Sensu::dcterms_created },
+        { "iri",                &Sensu::iri },
+        { "dcterms_modified",   &Sensu::lastModified }
+    };
+};
+
 #endif // SENSU_H
@@ -33,6 +33,16 @@
 #include "ui_startwindow.h"
 #include "tableeditor.h"
 #include "importcsv.h"
+#include "taxonindex.h"
+#include "geocodecache.h"
+#include "updatedownloader.h"
+#include "deltaupdate.h"
+#include "exportlog.h"
+#include "imageidentifiers.h"
+#include "imagehashes.h"
+#include "contenthashes.h"
+#include "pagedtablemodel.h"
+#include "databaseconnections.h"
 
 StartWindow::StartWindow(QWidget *parent) :
     QWidget(parent),
@@ -98,6 +108,16 @@ StartWindow::StartWindow(QWidget *parent) :
         this->showMaximized();
     screenPosLoaded = true;
 
+    // use QStandardPaths::AppDataLocation for Windows or Mac, for *NIX use appPath
+#if defined(Q_OS_WIN) || defined(Q_OS_MAC)
+    QString dlPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/data/CSVs";
+#else
+    QString dlPath = QApplication::applicationDirPath() + "/data/CSVs";
+#endif
+    downloader = new UpdateDownloader(dlPath, this);
+    connect(downloader, SIGNAL(finished(QStringList,QStringList)), this, SLOT(downloadsFinished(QStringList,QStringList)));
+    fetchingCSVs = false;
+
     downloadingCanceled = false;
     QSqlQuery findLastCSVCheck;
     findLastCSVCheck.prepare("SELECT value FROM settings WHERE setting = (?)");
@@ -187,6 +207,8 @@ void StartWindow::cancelDownload()
 {
     qDebug() << "Downloading canceled.";
     downloadingCanceled = true;
+    fetchingCSVs = false;
+    downloader->cancel();
     ui->updatesAvailable->setEnabled(true);
 }
 
@@ -383,14 +405,13 @@ void StartWindow::setupDB()
         }
     }
 
-    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE");
-    db.setDatabaseName(localdbFile);
-    if (!db.open()) {
+    if (!DatabaseConnections::open(localdbFile)) {
         QMessageBox::critical(0, tr("Cannot open database"),
             tr("Unable to establish a database connection to data/local-bioimages.db."), QMessageBox::Cancel);
         return;
     }
 
+    QSqlDatabase db = QSqlDatabase::database();
     db.transaction();
     QSqlQuery versionQry;
     versionQry.prepare("SELECT value FROM settings WHERE setting = (?)");
@@ -411,6 +432,27 @@ void StartWindow::setupDB()
         db.rollback();
     }
 
+    // flag the saved taxon completion index whenever taxa changes
+    TaxonIndex::createTriggers();
+
+    // add the geohash column that geocode_cache lookups use
+    GeocodeCache::prepareTable();
+
+    // track changed rows for exports of only what changed since the last export
+    ExportLog::prepareTables();
+
+    // index image identifiers by namespace for collision checks
+    ImageIdentifiers::prepareTable();
+
+    // perceptual hashes of thumbnails for near-duplicate checks
+    ImageHashes::prepareTable();
+
+    // file content digests for recognising renamed or moved images
+    ContentHashes::prepareTable();
+
+    // indexes for the table editor's default sort columns
+    PagedTableModel::prepareTables();
+
     // if bioimages.db still exists we need to merge its contents with local-bioimages.db
     if (QFileInfo::exists(dbFile))
     {
@@ -463,8 +505,7 @@ void StartWindow::setupDB()
         detachQry.prepare("DETACH newDB");
         detachQry.exec();
 
-        db.close();
-        db.open();
+        DatabaseConnections::reopen();
 
         QFile dbf(dbFile);
         if (!dbf.remove())
@@ -527,43 +568,18 @@ void StartWindow::setupDB()
 
 void StartWindow::checkCSVUpdate()
 {
-    fetchList << QUrl("https://raw.githubusercontent.com/baskaufs/Bioimages/master/last-published.xml");
-    fetchThis();
-}
-
-void StartWindow::fetchThis()
-{
-    if (fetchList.isEmpty())
+    if (downloader->isRunning())
         return;
 
-    if (downloadingCanceled)
-    {
-        qDebug() << "Downloading canceled. Clearing fetchlist.";
-        fetchList.clear();
-        return;
-    }
-
-    QUrl fetchThis = fetchList.first();
-    fetchList.removeFirst();
-    qDebug() << "Making a request to: " + fetchThis.toString();
-    startRequest(fetchThis);
-}
-
-void StartWindow::startRequest(QUrl url)
-{
-    reply = qnam.get(QNetworkRequest(url));
-    connect( reply, SIGNAL(finished()), this, SLOT(httpFinished()) );
+    downloader->add(QUrl("https://raw.githubusercontent.com/baskaufs/Bioimages/master/last-published.xml"), "last-published.xml");
+    downloader->start();
 }
 
-void StartWindow::httpFinished()
+void StartWindow::downloadsFinished(const QStringList &changed, const QStringList &failed)
 {
     QCoreApplication::processEvents();
     if (downloadingCanceled)
-    {
-        reply->deleteLater();
-        reply = 0;
         return;
-    }
 
     // use QStandardPaths::AppDataLocation for Windows or Mac, for *NIX use appPath
 #if defined(Q_OS_WIN) || defined(Q_OS_MAC)
@@ -572,270 +588,191 @@ void StartWindow::httpFinished()
     QString dlPath = QApplication::applicationDirPath() + "/data/CSVs";
 #endif
 
-    QDir dir(dlPath);
-    if (!dir.exists())
-        dir.mkpath(dlPath);
+    qDebug() << "Downloaded: " + changed.join(", ");
+    if (failed.contains("last-published.xml"))
+        qDebug() << "Fetching latest CSVs from GitHub failed.";
+    else
+        checkPublishedVersion(dlPath);
 
-    QVariant redirectionTarget = reply->attribute(QNetworkRequest::RedirectionTargetAttribute);
-    if (reply->error())
-    {
-        qDebug() << "Fetching latest CSVs from GitHub failed: " + reply->errorString();
-    }
-    else if (!redirectionTarget.isNull()) {
-        QUrl newUrl = url.resolved(redirectionTarget.toUrl());
-        qDebug() << "Redirecting CSV download request to: " + newUrl.toString();
+    if (!fetchingCSVs)
+        return;
+    fetchingCSVs = false;
 
-        url = newUrl;
-        reply->deleteLater();
-        startRequest(url);
+    if (!failed.isEmpty())
+    {
+        downloadingMsg->close();
+        ui->updatesAvailable->setEnabled(true);
+        QMessageBox msgBox;
+        msgBox.setText("The metadata updates could not be downloaded (" + failed.join(", ") + "). Please try again later.");
+        msgBox.exec();
         return;
     }
-    else
-    {
-        // check reply->url().toString() to see which response we're dealing with
-        QString loc =  reply->url().toString();
-        QString responseFrom;
-        if (loc == "https://raw.githubusercontent.com/baskaufs/Bioimages/master/last-published.xml")
-        {
-            responseFrom = "GitHub version XML";
-            // there are 3 versions we want to know about:
-            // #1 - what version of CSVs is the database based on (see dbLastPublished)
-            // ---- this version should be stored in the database itself, not just dbLastPublished variable
-            // #2 - what's the latest version of CSVs on GitHub (download last-published.xml and find out)
-            // #3 - what's the latest version of CSVs stored in /AppDataLocation (there might not be any version)
-
-            // 1. make sure the version in last-published.xml is a new version (compare to local last-published.xml), otherwise abort
-            // 2. overwrite local last-published with the downloaded one
-            // 3. delete local CSVs
-            // 4. download latest CSVs
-            // 5. prompt to merge them into the database
-            QDomDocument xmlDoc;
-            QDomElement docElem;
-            QString xmlText = reply->readAll(); // we have #2, just parse it
-
-            xmlDoc.setContent(xmlText);
-            docElem = xmlDoc.documentElement();
 
-            QDomNode node = docElem.firstChild();
-            while (!node.isNull())
-            {
-                if (node.nodeName() == "dcterms:modified")
-                {
-                    lastPublished = node.toElement().text();
-                    break;
-                }
-                node = node.nextSibling();
-            }
-
-            QString now = QDateTime::currentDateTime().toString("yyyy-MM-dd'T'hh:mm");
-            QSqlQuery setLastCSVCheck;
-            setLastCSVCheck.prepare("INSERT OR REPLACE INTO settings (setting, value) VALUES (?, ?)");
-            setLastCSVCheck.addBindValue("metadata.lastcheck");
-            setLastCSVCheck.addBindValue(now);
-            setLastCSVCheck.exec();
-
-            ui->lastCheck->setText("Last check: " + now);
-
-            // now get the time of the local CSVs (if any)
-            QString downloadedVersion; // stores dcterms_modified of locally downloaded CSVs
-            QFile downloadedVersionFile(dlPath + "/last-downloaded.xml");
-            if (downloadedVersionFile.open(QIODevice::ReadOnly | QIODevice::Text))
-            {
-                xmlDoc.setContent(&downloadedVersionFile);
-                docElem = xmlDoc.documentElement();
-
-                QDomNode node = docElem.firstChild();
-                while (!node.isNull())
-                {
-                    if (node.nodeName() == "dcterms:modified")
-                    {
-                        downloadedVersion = node.toElement().text();
-                        break;
-                    }
-                    node = node.nextSibling();
-                }
-                downloadedVersionFile.close();
-            }
-            else
-            {
-                if (downloadedVersionFile.exists())
-                    qDebug() << "Could not open " + dlPath + "/last-downloaded.xml";
-            }
-
-            QStringList csvs;
-            csvs << "agents.csv" << "determinations.csv" << "images.csv" << "names.csv" << "organisms.csv" << "sensu.csv";
-            bool allCSVsPresent = true;
-            for (auto csv : csvs)
-            {
-                if (!QFile::exists(dlPath + "/" + csv))
-                {
-                    allCSVsPresent = false;
-                    break;
-                }
-            }
+    if (loadCSVs(dlPath))
+    {
+        // compare the tmp_ tables with the originals
+        // prompt user for their choices of which conflicting rows to keep
+        // cleanup by using "delete from" on all tmp_ tables IF the user didn't cancel
+        qDebug() << "Downloaded CSVs have been loaded into their tmp_ tables";
 
-            bool updatesAvailable = false;
-            if (lastPublished.isEmpty())
-            {
-                // there was a problem parsing the downloaded latest-modified.xml; handle that problem here
-                qDebug() << "Problem parsing latest-modified.xml from GitHub";
-            }
-            else if (lastPublished <= databaseVersion)
-            {
-                qDebug() << "Not fetching files from GitHub. Database is up to date.";
-            }
-            else if (lastPublished <= downloadedVersion && !downloadedVersion.isEmpty() && allCSVsPresent)
-            {
-                qDebug() << "Not fetching files from GitHub. Local CSVs are already up to date.";
-                ui->updatesAvailable->setVisible(true);
-                ui->updatesAvailable->setEnabled(true);
-                ui->checkUpdatesButton->setVisible(false);
-                ui->lastCheck->setVisible(false);
-                updatesAvailable = true;
-            }
-            else
-            {
-                if (downloadedVersionFile.open(QIODevice::WriteOnly | QIODevice::Text))
-                {
-                    QTextStream xmlOut(&downloadedVersionFile);
-                    xmlOut.setCodec("UTF-8");
-                    xmlOut << xmlText;
-                    downloadedVersionFile.close();
-                }
-                ui->updatesAvailable->setVisible(true);
-                ui->updatesAvailable->setEnabled(true);
-                ui->checkUpdatesButton->setVisible(false);
-                ui->lastCheck->setVisible(false);
-                updatesAvailable = true;
-            }
+        if (downloadingCanceled)
+            return;
 
-            QSqlQuery setAvailable;
-            setAvailable.prepare("INSERT OR REPLACE INTO settings (setting, value) VALUES (?, ?)");
-            setAvailable.addBindValue("metadata.updateavailable");
-            setAvailable.addBindValue(updatesAvailable);
-            setAvailable.exec();
-        }
-        else if (loc == "https://raw.githubusercontent.com/baskaufs/Bioimages/master/agents.csv")
+        // the pub_ tables hold the release the database was last updated to, so apply only
+        // what changed since then and leave the real conflicts in the tmp_ tables
+        DeltaUpdate delta(databaseVersion);
+        bool applied = false;
+        if (delta.hasSnapshot())
         {
-            responseFrom = "GitHub agents CSV";
-            QFile agentsCSV(dlPath + "/agents.csv");
-            if (agentsCSV.open(QIODevice::WriteOnly | QIODevice::Text))
-            {
-                agentsCSV.write(reply->readAll());
-                agentsCSV.close();
-            }
-        }
-        else if (loc == "https://raw.githubusercontent.com/baskaufs/Bioimages/master/determinations.csv")
-        {
-            responseFrom = "GitHub determinations CSV";
-            QFile determsCSV(dlPath + "/determinations.csv");
-            if (determsCSV.open(QIODevice::WriteOnly | QIODevice::Text))
-            {
-                determsCSV.write(reply->readAll());
-                determsCSV.close();
-            }
+            delta.compute();
+            applied = delta.apply(modifiedNow());
         }
-        else if (loc == "https://raw.githubusercontent.com/baskaufs/Bioimages/master/images.csv")
+        if (!applied)
+            DeltaUpdate::recordPublished();
+        else if (delta.conflictCount() == 0)
         {
-            responseFrom = "GitHub images CSV";
-            QFile imagesCSV(dlPath + "/images.csv");
-            if (imagesCSV.open(QIODevice::WriteOnly | QIODevice::Text))
-            {
-                imagesCSV.write(reply->readAll());
-                imagesCSV.close();
-            }
-        }
-        else if (loc == "https://raw.githubusercontent.com/baskaufs/Bioimages/master/names.csv")
-        {
-            responseFrom = "GitHub names CSV";
-            QFile namesCSV(dlPath + "/names.csv");
-            if (namesCSV.open(QIODevice::WriteOnly | QIODevice::Text))
-            {
-                namesCSV.write(reply->readAll());
-                namesCSV.close();
-            }
-        }
-        else if (loc == "https://raw.githubusercontent.com/baskaufs/Bioimages/master/organisms.csv")
-        {
-            responseFrom = "GitHub organisms CSV";
-            QFile organsCSV(dlPath + "/organisms.csv");
-            if (organsCSV.open(QIODevice::WriteOnly | QIODevice::Text))
-            {
-                organsCSV.write(reply->readAll());
-                organsCSV.close();
-            }
-        }
-        else if (loc == "https://raw.githubusercontent.com/baskaufs/Bioimages/master/plants-usda-ubio.csv")
-        {
-            responseFrom = "GitHub plants-usda-ubio CSV";
-            QFile organsCSV(dlPath + "/plants-usda-ubio.csv");
-            if (organsCSV.open(QIODevice::WriteOnly | QIODevice::Text))
-            {
-                organsCSV.write(reply->readAll());
-                organsCSV.close();
-            }
-        }
-        else if (loc == "https://raw.githubusercontent.com/baskaufs/Bioimages/master/sensu.csv")
-        {
-            responseFrom = "GitHub sensu CSV";
-            QFile sensuCSV(dlPath + "/sensu.csv");
-            if (sensuCSV.open(QIODevice::WriteOnly | QIODevice::Text))
-            {
-                sensuCSV.write(reply->readAll());
-                sensuCSV.close();
-            }
+            downloadingMsg->close();
+            cleanup();
+            QMessageBox msgBox;
+            msgBox.setText("Your local database is now up to date.");
+            msgBox.exec();
+            return;
         }
-        else
+
+        updatesTable = new MergeTables();
+        updatesTable->setDeltaUpdate(applied);
+        connect(updatesTable,SIGNAL(loaded()),downloadingMsg,SLOT(close()));
+        connect(updatesTable,SIGNAL(finished()),this,SLOT(cleanup()));
+        updatesTable->setAttribute(Qt::WA_DeleteOnClose);
+        QCoreApplication::processEvents();
+        updatesTable->displayChoices();
+    }
+}
+
+void StartWindow::checkPublishedVersion(const QString &dlPath)
+{
+    // there are 3 versions we want to know about:
+    // #1 - what version of CSVs is the database based on (see dbLastPublished)
+    // ---- this version should be stored in the database itself, not just dbLastPublished variable
+    // #2 - what's the latest version of CSVs on GitHub (download last-published.xml and find out)
+    // #3 - what's the latest version of CSVs stored in /AppDataLocation (there might not be any version)
+
+    // 1. make sure the version in last-published.xml is a new version (compare to local last-published.xml), otherwise abort
+    // 2. overwrite local last-published with the downloaded one
+    // 3. download the CSVs that have changed since the local copies
+    // 4. load them into the tmp_ tables
+    // 5. prompt to merge them into the database
+    QDomDocument xmlDoc;
+    QDomElement docElem;
+    QString xmlText; // we have #2, just parse it
+    QFile publishedFile(dlPath + "/last-published.xml");
+    if (publishedFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        xmlText = QString::fromUtf8(publishedFile.readAll());
+        publishedFile.close();
+    }
+
+    xmlDoc.setContent(xmlText);
+    docElem = xmlDoc.documentElement();
+
+    QDomNode node = docElem.firstChild();
+    while (!node.isNull())
+    {
+        if (node.nodeName() == "dcterms:modified")
         {
-            responseFrom = "Not handled: " + loc;
+            lastPublished = node.toElement().text();
+            break;
         }
+        node = node.nextSibling();
+    }
+
+    QString now = QDateTime::currentDateTime().toString("yyyy-MM-dd'T'hh:mm");
+    QSqlQuery setLastCSVCheck;
+    setLastCSVCheck.prepare("INSERT OR REPLACE INTO settings (setting, value) VALUES (?, ?)");
+    setLastCSVCheck.addBindValue("metadata.lastcheck");
+    setLastCSVCheck.addBindValue(now);
+    setLastCSVCheck.exec();
 
-        QString replyText = reply->readAll();
-        if (!replyText.isEmpty())
-            qDebug() << replyText;
+    ui->lastCheck->setText("Last check: " + now);
+
+    // now get the time of the local CSVs (if any)
+    QString downloadedVersion; // stores dcterms_modified of locally downloaded CSVs
+    QFile downloadedVersionFile(dlPath + "/last-downloaded.xml");
+    if (downloadedVersionFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        xmlDoc.setContent(&downloadedVersionFile);
+        docElem = xmlDoc.documentElement();
 
-        QStringList csvs;
-        csvs << "agents" << "determinations" << "images" << "names" << "organisms" << "sensu";
-        bool allCSVsPresent = true;
-        for (auto csv : csvs)
+        QDomNode node = docElem.firstChild();
+        while (!node.isNull())
         {
-            if (!QFile::exists(dlPath + "/" + csv + ".csv"))
+            if (node.nodeName() == "dcterms:modified")
             {
-                allCSVsPresent = false;
+                downloadedVersion = node.toElement().text();
                 break;
             }
+            node = node.nextSibling();
         }
+        downloadedVersionFile.close();
+    }
+    else
+    {
+        if (downloadedVersionFile.exists())
+            qDebug() << "Could not open " + dlPath + "/last-downloaded.xml";
+    }
 
-        if (allCSVsPresent)
+    QStringList csvs;
+    csvs << "agents.csv" << "determinations.csv" << "images.csv" << "names.csv" << "organisms.csv" << "sensu.csv";
+    bool allCSVsPresent = true;
+    for (auto csv : csvs)
+    {
+        if (!QFile::exists(dlPath + "/" + csv))
         {
             allCSVsPresent = false;
-            reply->deleteLater();
-            reply = 0;
+            break;
+        }
+    }
 
-            if (loadCSVs(dlPath))
-            {
-                // compare the tmp_ tables with the originals
-                // prompt user for their choices of which conflicting rows to keep
-                // cleanup by using "delete from" on all tmp_ tables IF the user didn't cancel
-                qDebug() << "Downloaded CSVs have been loaded into their tmp_ tables";
-
-                if (downloadingCanceled)
-                    return;
-
-                updatesTable = new MergeTables();
-                connect(updatesTable,SIGNAL(loaded()),downloadingMsg,SLOT(close()));
-                connect(updatesTable,SIGNAL(finished()),this,SLOT(cleanup()));
-                updatesTable->setAttribute(Qt::WA_DeleteOnClose);
-                QCoreApplication::processEvents();
-                updatesTable->displayChoices();
-            }
-            return;
+    bool updatesAvailable = false;
+    if (lastPublished.isEmpty())
+    {
+        // there was a problem parsing the downloaded latest-modified.xml; handle that problem here
+        qDebug() << "Problem parsing latest-modified.xml from GitHub";
+    }
+    else if (lastPublished <= databaseVersion)
+    {
+        qDebug() << "Not fetching files from GitHub. Database is up to date.";
+    }
+    else if (lastPublished <= downloadedVersion && !downloadedVersion.isEmpty() && allCSVsPresent)
+    {
+        qDebug() << "Not fetching files from GitHub. Local CSVs are already up to date.";
+        ui->updatesAvailable->setVisible(true);
+        ui->updatesAvailable->setEnabled(true);
+        ui->checkUpdatesButton->setVisible(false);
+        ui->lastCheck->setVisible(false);
+        updatesAvailable = true;
+    }
+    else
+    {
+        if (downloadedVersionFile.open(QIODevice::WriteOnly | QIODevice::Text))
+        {
+            QTextStream xmlOut(&downloadedVersionFile);
+            xmlOut.setCodec("UTF-8");
+            xmlOut << xmlText;
+            downloadedVersionFile.close();
         }
+        ui->updatesAvailable->setVisible(true);
+        ui->updatesAvailable->setEnabled(true);
+        ui->checkUpdatesButton->setVisible(false);
+        ui->lastCheck->setVisible(false);
+        updatesAvailable = true;
     }
 
-    reply->deleteLater();
-    reply = 0;
-    fetchThis();
+    QSqlQuery setAvailable;
+    setAvailable.prepare("INSERT OR REPLACE INTO settings (setting, value) VALUES (?, ?)");
+    setAvailable.addBindValue("metadata.updateavailable");
+    setAvailable.addBindValue(updatesAvailable);
+    setAvailable.exec();
 }
 
 bool StartWindow::loadCSVs(const QString folder)
@@ -875,13 +812,6 @@ bool StartWindow::loadCSVs(const QString folder)
             dropQry.prepare("DELETE FROM tmp_" + table);
             dropQry.exec();
         }
-        // also clear the "pub_" tables
-        if (db.tables().contains("pub_" + table))
-        {
-            QSqlQuery dropQry;
-            dropQry.prepare("DELETE FROM pub_" + table);
-            dropQry.exec();
-        }
         if (!db.commit())
         {
             qDebug() << __LINE__ << "Problem with database transaction: " << db.lastError();
@@ -906,10 +836,6 @@ bool StartWindow::loadCSVs(const QString folder)
             importCSV.extractSensu(folder + "/sensu.csv", "tmp_sensu");
 
         file.close();
-
-        QSqlQuery copyQry;
-        copyQry.prepare("INSERT INTO pub_" + table + " SELECT * FROM tmp_" + table);
-        copyQry.exec();
     }
 
     qDebug() << "Finished loading CSV data into tablebase.";
@@ -970,22 +896,17 @@ void StartWindow::on_updatesAvailable_clicked()
     QString dlPath = QApplication::applicationDirPath() + "/data/CSVs";
 #endif
 
-    // delete local CSVs before downloading new versions
-    QStringList csvs;
-    csvs << "agents.csv" << "determinations.csv" << "images.csv" << "names.csv" << "organisms.csv" << "sensu.csv";
-    for (auto csv : csvs)
-        QFile::remove(dlPath + "/" + csv);
-
-    QString agentsURL = "https://raw.githubusercontent.com/baskaufs/Bioimages/master/agents.csv";
-    QString determURL = "https://raw.githubusercontent.com/baskaufs/Bioimages/master/determinations.csv";
-    QString imagesURL = "https://raw.githubusercontent.com/baskaufs/Bioimages/master/images.csv";
-    QString namesURL  = "https://raw.githubusercontent.com/baskaufs/Bioimages/master/names.csv";
-    QString organsURL = "https://raw.githubusercontent.com/baskaufs/Bioimages/master/organisms.csv";
-    QString sensuURL  = "https://raw.githubusercontent.com/baskaufs/Bioimages/master/sensu.csv";
-
-    fetchList << QUrl("https://raw.githubusercontent.com/baskaufs/Bioimages/master/last-published.xml");
-    fetchList << agentsURL << determURL << imagesURL << namesURL << organsURL << sensuURL;
-    fetchThis();
+    // all of the files are fetched at once; any the server says haven't changed keep their local copy
+    if (downloader->isRunning())
+        downloader->cancel();
+    fetchingCSVs = true;
+
+    QString base = "https://raw.githubusercontent.com/baskaufs/Bioimages/master/";
+    QStringList files;
+    files << "last-published.xml" << "agents.csv" << "determinations.csv" << "images.csv" << "names.csv" << "organisms.csv" << "sensu.csv";
+    for (auto file : files)
+        downloader->add(QUrl(base + file), file);
+    downloader->start();
 }
 
 void StartWindow::cleanup()
@@ -1046,18 +967,7 @@ void StartWindow::cleanup()
     setCSVCheck.addBindValue(false);
     setCSVCheck.exec();
 
-    // remove CSVs and last-downloaded.xml
-    QStringList csvs;
-    csvs << "agents" << "determinations" << "images" << "names" << "organisms" << "sensu";
-    for (auto csv : csvs)
-    {
-        QString file = dlPath + "/" + csv + ".csv";
-        if (QFile::exists(file))
-        {
-            QFile::remove(file);
-        }
-    }
-
+    // remove last-downloaded.xml, but keep the CSVs so the next update only downloads the ones that changed
     QString xmlFile = dlPath + "/last-downloaded.xml";
     if (QFile::exists(xmlFile))
         QFile::remove(xmlFile);
@@ -37,6 +37,8 @@ namespace Ui {
 class StartWindow;
 }
 
+class UpdateDownloader;
+
 class StartWindow : public QWidget
 {
     Q_OBJECT
@@ -55,7 +57,7 @@ private slots:
     void resizeEvent(QResizeEvent *);
     void changeEvent(QEvent*event);
 
-    void httpFinished();
+    void downloadsFinished(const QStringList &changed, const QStringList &failed);
     bool loadCSVs(const QString folder);
 
     void resetEditExistingButton();
@@ -87,12 +89,9 @@ private:
 
     QString databaseVersion;
     void checkCSVUpdate();
-    void fetchThis();
-    void startRequest(QUrl url);
-    QList<QUrl> fetchList;
-    QUrl url;
-    QNetworkAccessManager qnam;
-    QNetworkReply *reply;
+    void checkPublishedVersion(const QString &dlPath);
+    UpdateDownloader *downloader;
+    bool fetchingCSVs;
     QString modifiedNow();
     QString lastPublished; // stores dcterms_modified from GitHub
     MergeTables *updatesTable;
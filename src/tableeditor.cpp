@@ -20,8 +20,11 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <algorithm>
 #include <QtSql>
 #include "tableeditor.h"
+#include "pagedtablemodel.h"
+#include "preparedquery.h"
 
 TableEditor::TableEditor(const QString &incTableFilter, QWidget *parent)
     : QWidget(parent)
@@ -38,144 +41,135 @@ TableEditor::TableEditor(QWidget *parent)
 
 void TableEditor::submit()
 {
-    QList<QSqlTableModel*> tableModels;
+    QList<PagedTableModel*> tableModels;
     tableModels << agentsModel << determinationsModel << imagesModel << taxaModel << organismsModel << sensuModel;
 
-    // update dcterms_modified first
+    // only the rows that were edited get a new dcterms_modified
+    QString now = modifiedNow();
     for (auto model : tableModels)
-    {
-        // make sure there were some changes first
-        if (model->isDirty())
-        {
-            // find which column holds the dcterms_modified value
-            int modifiedColumn = model->fieldIndex("dcterms_modified");
+        model->stampDirtyRows(model->fieldIndex("dcterms_modified"), now);
 
-            for (QModelIndex index = model->index(0,0);
-                 index.isValid();
-                 index = model->index(index.row()+1,0) )
-            {
-                for (QModelIndex cindex = model->index(index.row(),0);
-                     cindex.isValid();
-                     cindex = model->index(index.row(),cindex.column()+1) )
-                {
-                    if (model->isDirty(cindex))
-                    {
-                        QModelIndex timeIndex = model->index(index.row(),modifiedColumn);
-                        model->setData(timeIndex,modifiedNow());
-                        break;
-                    }
-                }
-            }
-        }
-    }
+    // every tab's edits, removals and reversions are saved together, or not at all
+    QSqlDatabase db = QSqlDatabase::database();
+    db.transaction();
 
     QString errors;
-
-    // save changes to each table
     for (auto model : tableModels)
     {
-        model->database().transaction();
-        if (model->submitAll())
-            model->database().commit();
-        else
+        if (model->isDirty() && !model->submitAll())
+            errors.append(model->tableName() + ": " + model->lastError().text() + "\n");
+    }
+
+    if (errors.isEmpty())
+    {
+        // removed rows that were published are put back to their published values
+        QStringList tables = db.tables();
+        for (auto table : reversions.keys())
         {
-            model->database().rollback();
-            errors.append(model->lastError().text() + "\n");
+            if (!tables.contains("pub_" + table))
+                continue;
+
+            QString sql = "INSERT OR REPLACE INTO " + table + " SELECT * FROM pub_" + table + " WHERE dcterms_identifier = (?) LIMIT 1";
+            if (table == "determinations")
+                sql = "INSERT OR REPLACE INTO determinations SELECT * FROM pub_determinations "
+                      "WHERE dsw_identified = (?) AND dwc_dateIdentified = (?) AND tsnID = (?) AND nameAccordingToID = (?) LIMIT 1";
+
+            PreparedQuery revertQry(sql);
+            for (auto key : reversions.value(table))
+            {
+                for (auto value : key)
+                    revertQry.bind(value);
+                if (!revertQry.exec())
+                    errors.append(table + ": " + revertQry.lastError().text() + "\n");
+            }
         }
     }
 
+    if (errors.isEmpty() && !db.commit())
+        errors = db.lastError().text();
+
     if (!errors.isEmpty())
     {
+        // the edits are still held, so they can be saved again
+        db.rollback();
         QString title = "Saving changes";
         QMessageBox::warning(this,title,errors);
+        return;
     }
 
-    QSqlDatabase db = QSqlDatabase::database();
-    db.transaction();
-
-    reversions.removeDuplicates();
-    for (auto r : reversions)
-    {
-        QSqlQuery revertQry(r);
-    }
-
+    reversions.clear();
     for (auto model : tableModels)
     {
-        model->select();
+        model->clearChanges();
+        if (model->isLoaded())
+            model->select();
     }
-
-    if (!db.commit())
-    {
-        qDebug() << "Problem committing changes to database in TableEditor::setupLayout()";
-        db.rollback();
-    }
-    reversions.clear();
 }
 
 void TableEditor::removeSelectedRows()
 {
     int currentTab = tabWidget->currentIndex();
     QTableView *tv = agentsTable;
-    QSqlTableModel *stm = agentsModel;
-    QString table = "agents";
-    int idColumn = 0;
+    PagedTableModel *stm = agentsModel;
     if (currentTab == 1)
     {
         tv = determinationsTable;
         stm = determinationsModel;
-        table = "determinations";
     }
     else if (currentTab == 2)
     {
         tv = imagesTable;
         stm = imagesModel;
-        table = "images";
-        idColumn = 20;
     }
     else if (currentTab == 3)
     {
         tv = taxaTable;
         stm = taxaModel;
-        table = "taxa";
-        idColumn = 1;
     }
     else if (currentTab == 4)
     {
         tv = organismsTable;
         stm = organismsModel;
-        table = "organisms";
     }
     else if (currentTab == 5)
     {
         tv = sensuTable;
         stm = sensuModel;
-        table = "sensu";
     }
-    QItemSelectionModel *selected = tv->selectionModel();
-    QModelIndexList rowList = selected->selectedIndexes();
+    QString table = stm->tableName();
+
+    // every selected cell is in the list, so each row is only taken once
+    QList<int> rows;
+    for (auto index : tv->selectionModel()->selectedIndexes())
+        rows << index.row();
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
 
-    for (int i = rowList.count()-1; i >= 0; i--)
+    QList<int> keyColumns;
+    if (table == "determinations")
     {
-        stm->removeRow(rowList.at(i).row(), rowList.at(i).parent());
-        QString identifier;
-        if (table == "determinations")
-        {
-            QString orgID = stm->data(stm->index(rowList.at(i).row(),0),Qt::DisplayRole).toString();
-            QString date = stm->data(stm->index(rowList.at(i).row(),2),Qt::DisplayRole).toString();
-            QString tsnID = stm->data(stm->index(rowList.at(i).row(),4),Qt::DisplayRole).toString();
-            QString source = stm->data(stm->index(rowList.at(i).row(),5),Qt::DisplayRole).toString();
-            reversions.append("INSERT OR REPLACE INTO determinations SELECT * FROM pub_determinations "
-                              "WHERE dsw_identified = '" + orgID + "' AND "
-                              "dwc_dateIdentified = '" + date + "' AND "
-                              "tsnID = '" + tsnID + "' AND "
-                              "nameAccordingToID = '" + source + "' LIMIT 1");
+        keyColumns << stm->fieldIndex("dsw_identified") << stm->fieldIndex("dwc_dateIdentified")
+                   << stm->fieldIndex("tsnID") << stm->fieldIndex("nameAccordingToID");
+    }
+    else
+        keyColumns << stm->fieldIndex("dcterms_identifier");
 
-        }
-        else
-        {
-            identifier = stm->data(stm->index(rowList.at(i).row(),idColumn),Qt::DisplayRole).toString();
-            reversions.append("INSERT OR REPLACE INTO " + table + " SELECT * FROM pub_" + table + " WHERE dcterms_identifier = '" + identifier + "' LIMIT 1");
-        }
+    for (auto row : rows)
+    {
+        QVariantList key;
+        for (auto column : keyColumns)
+            key << stm->data(stm->index(row, column), Qt::DisplayRole).toString();
+        reversions[table] << key;
+    }
+
+    // neighbouring rows are marked in one go
+    for (int i = 0; i < rows.size(); )
+    {
+        int count = 1;
+        while (i + count < rows.size() && rows.at(i + count) == rows.at(i) + count)
+            count++;
+        stm->removeRows(rows.at(i), count);
+        i += count;
     }
 }
 
@@ -192,15 +186,33 @@ void TableEditor::revertAll()
 
 void TableEditor::refreshAll()
 {
-    agentsModel->select();
-    determinationsModel->select();
-    imagesModel->select();
-    taxaModel->select();
-    organismsModel->select();
-    sensuModel->select();
+    QList<PagedTableModel*> tableModels;
+    tableModels << agentsModel << determinationsModel << imagesModel << taxaModel << organismsModel << sensuModel;
+
+    for (auto model : tableModels)
+    {
+        model->revertAll();
+        if (model->isLoaded())
+            model->select();
+    }
     reversions.clear();
 }
 
+void TableEditor::loadTab(int index)
+{
+    QTableView *view = qobject_cast<QTableView*>(tabWidget->widget(index));
+    if (!view)
+        return;
+
+    PagedTableModel *model = static_cast<PagedTableModel*>(view->model());
+    if (model->isLoaded())
+        return;
+
+    // the columns are sized to the first page, the only rows read so far
+    model->select();
+    view->resizeColumnsToContents();
+}
+
 QSize TableEditor::sizeHint() const
 {
     return QSize(640,240);
@@ -242,86 +254,62 @@ void TableEditor::changeEvent(QEvent* event)
 void TableEditor::setupLayout()
 {
     // set up agents tab
-    agentsModel = new QSqlTableModel(this);
-    agentsModel->setTable("agents");
+    agentsModel = new PagedTableModel("agents", this);
     if (!tableFilter.isEmpty())
         agentsModel->setFilter(tableFilter);
-    agentsModel->setEditStrategy(QSqlTableModel::OnManualSubmit);
-    agentsModel->select();
 
     agentsTable = new QTableView(this);
     agentsTable->setModel(agentsModel);
-    agentsTable->resizeColumnsToContents();
     agentsTable->sortByColumn(0,Qt::AscendingOrder);
     agentsTable->setSortingEnabled(true);
 
     // set up determinations tab
-    determinationsModel = new QSqlTableModel(this);
-    determinationsModel->setTable("determinations");
+    determinationsModel = new PagedTableModel("determinations", this);
     if (!tableFilter.isEmpty())
         determinationsModel->setFilter(tableFilter);
-    determinationsModel->setEditStrategy(QSqlTableModel::OnManualSubmit);
-    determinationsModel->select();
 
     determinationsTable = new QTableView(this);
     determinationsTable->setModel(determinationsModel);
-    determinationsTable->resizeColumnsToContents();
     determinationsTable->sortByColumn(0,Qt::AscendingOrder);
     determinationsTable->setSortingEnabled(true);
 
     // set up images tab
-    imagesModel = new QSqlTableModel(this);
-    imagesModel->setTable("images");
+    imagesModel = new PagedTableModel("images", this);
     if (!tableFilter.isEmpty())
         imagesModel->setFilter(tableFilter);
-    imagesModel->setEditStrategy(QSqlTableModel::OnManualSubmit);
-    imagesModel->select();
 
     imagesTable = new QTableView(this);
     imagesTable->setModel(imagesModel);
-    imagesTable->resizeColumnsToContents();
     imagesTable->sortByColumn(19,Qt::AscendingOrder);
     imagesTable->setSortingEnabled(true);
 
     // set up taxa tab
-    taxaModel = new QSqlTableModel(this);
-    taxaModel->setTable("taxa");
+    taxaModel = new PagedTableModel("taxa", this);
     if (!tableFilter.isEmpty())
         taxaModel->setFilter(tableFilter);
-    taxaModel->setEditStrategy(QSqlTableModel::OnManualSubmit);
-    taxaModel->select();
 
     taxaTable = new QTableView(this);
     taxaTable->setModel(taxaModel);
-    taxaTable->resizeColumnsToContents();
     taxaTable->sortByColumn(1,Qt::AscendingOrder);
     taxaTable->setSortingEnabled(true);
 
     // set up organisms tab
-    organismsModel = new QSqlTableModel(this);
-    organismsModel->setTable("organisms");
+    organismsModel = new PagedTableModel("organisms", this);
     if (!tableFilter.isEmpty())
         organismsModel->setFilter(tableFilter);
-    organismsModel->setEditStrategy(QSqlTableModel::OnManualSubmit);
-    organismsModel->select();
 
     organismsTable = new QTableView(this);
     organismsTable->setModel(organismsModel);
-    organismsTable->resizeColumnsToContents();
     organismsTable->sortByColumn(0,Qt::AscendingOrder);
     organismsTable->setSortingEnabled(true);
 
     // set up sensu tab
-    sensuModel = new QSqlTableModel(this);
-    sensuModel->setTable("sensu");
+    sensuModel = new PagedTableModel("sensu", this);
     if (!tableFilter.isEmpty())
         sensuModel->setFilter(tableFilter);
-    sensuModel->setEditStrategy(QSqlTableModel::OnManualSubmit);
-    sensuModel->select();
 
     sensuTable = new QTableView(this);
     sensuTable->setModel(sensuModel);
-    sensuTable->resizeColumnsToContents();
     sensuTable->sortByColumn(0,Qt::AscendingOrder);
     sensuTable->setSortingEnabled(true);
 
@@ -333,6 +321,10 @@ void TableEditor::setupLayout()
     tabWidget->addTab(organismsTable,"Organisms");
     tabWidget->addTab(sensuTable,"Sensu");
 
+    // each table is only read when its tab is first shown
+    connect(tabWidget, SIGNAL(currentChanged(int)), this, SLOT(loadTab(int)));
+    loadTab(tabWidget->currentIndex());
+
     submitButton = new QPushButton(tr("&Save changes"));
     submitButton->setDefault(true);
     refreshButton = new QPushButton(tr("&Revert unsaved changes\nand refresh database"));
@@ -413,7 +405,7 @@ QString TableEditor::modifiedNow()
 
 void TableEditor::confirmClose()
 {
-    QList<QSqlTableModel*> tableModels;
+    QList<PagedTableModel*> tableModels;
     tableModels << agentsModel << determinationsModel << imagesModel << taxaModel << organismsModel << sensuModel;
 
     QStringList modifiedTables;
@@ -29,9 +29,10 @@
 QT_BEGIN_NAMESPACE
 class QDialogButtonBox;
 class QPushButton;
-class QSqlTableModel;
 QT_END_NAMESPACE
 
+class PagedTableModel;
+
 class TableEditor : public QWidget
 {
     Q_OBJECT
@@ -46,6 +47,7 @@ private slots:
     void revertAll();
     void refreshAll();
     void confirmClose();
+    void loadTab(int index);
 
 private:
     QSize sizeHint() const;
@@ -55,24 +57,24 @@ private:
     void setupLayout();
     QString tableFilter;
     QString modifiedNow();
-    QStringList reversions;
+    QMap<QString, QList<QVariantList> > reversions;  // table -> key values of removed rows
 
     QPushButton *submitButton;
     QPushButton *refreshButton;
     QPushButton *deleteButton;
     QPushButton *quitButton;
     QDialogButtonBox *buttonBox;
-    QSqlTableModel *agentsModel;
+    PagedTableModel *agentsModel;
     QTableView *agentsTable;
-    QSqlTableModel *determinationsModel;
+    PagedTableModel *determinationsModel;
     QTableView *determinationsTable;
-    QSqlTableModel *imagesModel;
+    PagedTableModel *imagesModel;
     QTableView *imagesTable;
-    QSqlTableModel *taxaModel;
+    PagedTableModel *taxaModel;
     QTableView *taxaTable;
-    QSqlTableModel *organismsModel;
+    PagedTableModel *organismsModel;
     QTableView *organismsTable;
-    QSqlTableModel *sensuModel;
+    PagedTableModel *sensuModel;
     QTableView *sensuTable;
     QTabWidget *tabWidget;
 };
@@ -0,0 +1,137 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TABLESCHEMA_H
+#define TABLESCHEMA_H
+
+#include <QtCore>
+#include <QSqlQuery>
+
+#include "preparedquery.h"
+
+// One column of a table and the row member that holds it.
+template <typename Row>
+struct SchemaColumn
+{
+    const char *name;
+    QString Row::*field;
+};
+
+// Specialized next to each row class with its table's columns, in table order:
+//   template <> struct RowSchema<Image> { static constexpr SchemaColumn<Image> columns[] = { ... }; };
+template <typename Row>
+struct RowSchema;
+
+// Builds the SQL, binding, loading and CSV text for a row type from its
+// RowSchema, so the column list is written down once instead of at every query.
+template <typename Row>
+class TableSchema
+{
+public:
+    static constexpr int size = sizeof(RowSchema<Row>::columns) / sizeof(SchemaColumn<Row>);
+
+    static int index(const char *name)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            if (qstrcmp(RowSchema<Row>::columns[i].name, name) == 0)
+                return i;
+        }
+        return -1;
+    }
+
+    static QString columns(const QString &separator = ", ")
+    {
+        QString list;
+        for (int i = 0; i < size; i++)
+        {
+            if (i > 0)
+                list += separator;
+            list += QLatin1String(RowSchema<Row>::columns[i].name);
+        }
+        return list;
+    }
+
+    static QString select(const QString &table)
+    {
+        return "SELECT " + columns() + " FROM " + table;
+    }
+
+    // verb is "INSERT" or "INSERT OR REPLACE"
+    static QString insert(const QString &table, const QString &verb = "INSERT")
+    {
+        QStringList placeholders;
+        for (int i = 0; i < size; i++)
+            placeholders << "?";
+        return verb + " INTO " + table + " (" + columns() + ") VALUES (" + placeholders.join(", ") + ")";
+    }
+
+    static void bind(PreparedQuery &query, const Row &row)
+    {
+        for (int i = 0; i < size; i++)
+            query.bind(row.*RowSchema<Row>::columns[i].field);
+    }
+
+    static void bind(QSqlQuery &query, const Row &row)
+    {
+        for (int i = 0; i < size; i++)
+            query.addBindValue(row.*RowSchema<Row>::columns[i].field);
+    }
+
+    // reads the columns from first on, as selected by select(); each value is moved into place
+    static void load(Row &row, const QSqlQuery &query, int first = 0)
+    {
+        for (int i = 0; i < size; i++)
+            row.*RowSchema<Row>::columns[i].field = query.value(first + i).toString();
+    }
+
+    static void load(Row &row, const PreparedQuery &query, int first = 0)
+    {
+        for (int i = 0; i < size; i++)
+            row.*RowSchema<Row>::columns[i].field = query.string(first + i);
+    }
+
+    static void load(Row &row, const QStringList &fields, int first = 0)
+    {
+        for (int i = 0; i < size && first + i < fields.size(); i++)
+            row.*RowSchema<Row>::columns[i].field = fields.at(first + i);
+    }
+
+    static QString header(const QString &separator = "|")
+    {
+        return columns(separator);
+    }
+
+    static QStringList values(const Row &row)
+    {
+        QStringList fields;
+        fields.reserve(size);
+        for (int i = 0; i < size; i++)
+            fields << row.*RowSchema<Row>::columns[i].field;
+        return fields;
+    }
+};
+
+template <typename Row>
+constexpr int TableSchema<Row>::size;
+
+#endif // TABLESCHEMA_H
@@ -22,6 +22,8 @@
 
 #include "taxa.h"
 
+constexpr SchemaColumn<Taxa> RowSchema<Taxa>::columns[];
+
 Taxa::Taxa()
 {
     ubioID = "";
@@ -25,6 +25,8 @@
 
 #include <QtCore>
 
+#include "tableschema.h"
+
 class Taxa
 {
 public:
@@ -46,4 +48,25 @@ public:
     QString lastModified;
 };
 
+// the columns of the taxa table, in table order
+template <>
+struct RowSchema<Taxa>
+{
+    static constexpr SchemaColumn<Taxa> columns[] = {
+        { "ubioID",                       &Taxa::ubioID },
+        { "dcterms_identifier",           &Taxa::identifier },
+        { "dwc_kingdom",                  &Taxa::kingdom },
+        { "dwc_class",                    &Taxa::className },
+        { "dwc_order",                    &Taxa::order },
+        { "dwc_family",                   &Taxa::family },
+        { "dwc_genus",                    &Taxa::genus },
+        { "dwc_specificEpithet",          &Taxa::species },
+        { "dwc_infraspecificEpithet",     &Taxa::subspecies },
+        { "dwc_taxonRank",                &Taxa::taxonRank },
+        { "dwc_scientificNameAuthorship", &Taxa::authorship },
+        { "dwc_vernacularName",           &Taxa::vernacular },
+        { "dcterms_modified",             &Taxa::lastModified }
+    };
+};
+
 #endif // TAXA_H
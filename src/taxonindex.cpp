@@ -0,0 +1,547 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <QApplication>
+#include <QStandardPaths>
+#include <QDateTime>
+#include <QDir>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+
+#include "taxonindex.h"
+
+TaxonIndex::TaxonIndex()
+{
+    data = 0;
+    dataSize = 0;
+    header = 0;
+    pool = 0;
+}
+
+TaxonIndex::~TaxonIndex()
+{
+    if (file.isOpen())
+        file.close();
+}
+
+QString TaxonIndex::indexFolder()
+{
+    // use QStandardPaths::AppDataLocation for Windows or Mac, for *NIX use applicationDirPath
+#if defined(Q_OS_WIN) || defined(Q_OS_MAC)
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/data/";
+#else
+    return QApplication::applicationDirPath() + "/data/";
+#endif
+}
+
+void TaxonIndex::removeOldIndexes(const QString &current)
+{
+    // files still mapped by an open window can't be removed on Windows; they go after a later build
+    QDir folder(indexFolder());
+    for (auto name : folder.entryList(QStringList() << "taxonindex*.dat" << "taxonindex*.dat.tmp", QDir::Files))
+    {
+        if (name != current)
+            folder.remove(name);
+    }
+}
+
+void TaxonIndex::createTriggers()
+{
+    // any change to the names in taxa flags the saved index for rebuilding the next time it's needed
+    QStringList triggers;
+    triggers << "CREATE TRIGGER IF NOT EXISTS taxa_index_insert AFTER INSERT ON taxa BEGIN "
+                "UPDATE settings SET value = 'true' WHERE setting = 'taxa.indexdirty' AND value != 'true'; END";
+    triggers << "CREATE TRIGGER IF NOT EXISTS taxa_index_delete AFTER DELETE ON taxa BEGIN "
+                "UPDATE settings SET value = 'true' WHERE setting = 'taxa.indexdirty' AND value != 'true'; END";
+    triggers << "CREATE TRIGGER IF NOT EXISTS taxa_index_update AFTER UPDATE OF dcterms_identifier, dwc_family, "
+                "dwc_genus, dwc_specificEpithet, dwc_infraspecificEpithet, dwc_vernacularName ON taxa BEGIN "
+                "UPDATE settings SET value = 'true' WHERE setting = 'taxa.indexdirty' AND value != 'true'; END";
+    for (auto t : triggers)
+    {
+        QSqlQuery qry;
+        if (!qry.exec(t))
+            qDebug() << "Problem creating taxa index trigger: " + qry.lastError().text();
+    }
+}
+
+int TaxonIndex::taxaCount()
+{
+    QSqlQuery qry;
+    qry.exec("SELECT COUNT(*) FROM taxa");
+    if (qry.next())
+        return qry.value(0).toInt();
+    return 0;
+}
+
+QSharedPointer<const TaxonIndex> TaxonIndex::shared()
+{
+    static QSharedPointer<const TaxonIndex> instance;
+
+    // a missing setting means the index has never been built for this database
+    bool dirty = true;
+    QSqlQuery qry;
+    qry.prepare("SELECT value FROM settings WHERE setting = (?)");
+    qry.addBindValue("taxa.indexdirty");
+    qry.exec();
+    if (qry.next())
+        dirty = qry.value(0).toString() != "false";
+
+    QString fileName;
+    qry.prepare("SELECT value FROM settings WHERE setting = (?)");
+    qry.addBindValue("taxa.indexfile");
+    qry.exec();
+    if (qry.next())
+        fileName = qry.value(0).toString();
+    if (fileName.isEmpty())
+        dirty = true;
+
+    int count = taxaCount();
+    if (!dirty && !instance.isNull() && instance->header->taxaCount == quint32(count))
+        return instance;
+
+    if (!dirty)
+    {
+        TaxonIndex *mapped = new TaxonIndex;
+        if (mapped->map(indexFolder() + fileName, count))
+        {
+            instance = QSharedPointer<const TaxonIndex>(mapped);
+            return instance;
+        }
+        delete mapped;
+    }
+
+    // windows that still hold the previous instance keep using it until they close
+    instance = build(count);
+    return instance;
+}
+
+bool TaxonIndex::map(const QString &path, int expectedTaxaCount)
+{
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    qint64 size = file.size();
+    uchar *bytes = file.map(0, size);
+    if (bytes == 0 || size < qint64(sizeof(Header)))
+    {
+        file.close();
+        return false;
+    }
+
+    const Header *h = reinterpret_cast<const Header*>(bytes);
+    if (memcmp(h->magic, "BIOTAXIX", 8) != 0 || h->formatVersion != formatVersion ||
+            h->taxaCount != quint32(expectedTaxaCount) ||
+            qint64(h->poolOffset) + qint64(h->poolLength) * qint64(sizeof(QChar)) > size)
+    {
+        qDebug() << "Taxon index at " + path + " is out of date and will be rebuilt.";
+        file.close();
+        return false;
+    }
+
+    setData(bytes, size);
+    return true;
+}
+
+void TaxonIndex::setData(const uchar *bytes, qint64 size)
+{
+    data = bytes;
+    dataSize = size;
+    header = reinterpret_cast<const Header*>(data);
+    pool = reinterpret_cast<const QChar*>(data + header->poolOffset);
+}
+
+bool TaxonIndex::isSeparator(QChar c)
+{
+    return c.isSpace() || c == '(' || c == ')' || c == '-';
+}
+
+QString TaxonIndex::foldCase(const QString &text)
+{
+    // fold one UTF-16 unit at a time so that keys match compareFolded() exactly
+    QString folded = text;
+    for (int i = 0; i < folded.size(); i++)
+        folded[i] = folded.at(i).toCaseFolded();
+    return folded;
+}
+
+int TaxonIndex::compareFolded(const QChar *chars, int length, const QString &foldedKey)
+{
+    return compareFolded(chars, length, foldedKey.constData(), foldedKey.size());
+}
+
+int TaxonIndex::compareFolded(const QChar *a, int aLength, const QChar *b, int bLength)
+{
+    int n = qMin(aLength, bLength);
+    for (int i = 0; i < n; i++)
+    {
+        ushort ca = a[i].toCaseFolded().unicode();
+        ushort cb = b[i].toCaseFolded().unicode();
+        if (ca != cb)
+            return ca < cb ? -1 : 1;
+    }
+    if (aLength == bLength)
+        return 0;
+    return aLength < bLength ? -1 : 1;
+}
+
+QSharedPointer<const TaxonIndex> TaxonIndex::build(int taxaCount)
+{
+    qDebug() << "Building taxon index from " + QString::number(taxaCount) + " taxa.";
+
+    QString poolText;
+    QVector<Entry> fieldEntries[FieldCount];
+
+    QSqlQuery query;
+    query.setForwardOnly(true);
+    query.prepare("SELECT dcterms_identifier, dwc_family, dwc_genus, dwc_specificEpithet, dwc_infraspecificEpithet, dwc_vernacularName FROM taxa");
+    query.exec();
+    while (query.next())
+    {
+        QString tsnID = query.value(0).toString();
+        QString family = query.value(1).toString();
+        QString genus = query.value(2).toString();
+        QString species = query.value(3).toString();
+        QString infraspecific = query.value(4).toString();
+        QString commonName = query.value(5).toString();
+
+        if (tsnID.isEmpty())
+            continue;
+
+        // add the species and subspecies names in a genus search
+        if (!species.isEmpty())
+        {
+            genus.append(" " + species);
+
+            // only add the subspecies if there was a species name
+            if (!infraspecific.isEmpty())
+                genus.append(" " + infraspecific);
+        }
+
+        if (!infraspecific.isEmpty())
+            species.append(" " + infraspecific);
+
+        QString suffix = " (" + tsnID + ")";
+        QString names[FieldCount];
+        names[Genus] = genus;
+        names[Species] = species;
+        names[CommonName] = commonName;
+        names[Family] = family;
+
+        quint32 genusOffset = 0;
+        for (int f = 0; f < FieldCount; f++)
+        {
+            if (names[f].isEmpty())
+                continue;
+
+            QString display = names[f] + suffix;
+            Entry e;
+            e.displayLength = display.size();
+            if (f == Species && !names[Genus].isEmpty() && (names[Genus] + suffix).endsWith(display))
+            {
+                // "rubra (19408)" is the tail of "Quercus rubra (19408)", so share its characters
+                e.display = genusOffset + (names[Genus].size() + suffix.size()) - e.displayLength;
+            }
+            else
+            {
+                e.display = poolText.size();
+                poolText.append(display);
+            }
+            if (f == Genus)
+                genusOffset = e.display;
+            e.tsnID = e.display + e.displayLength - 1 - tsnID.size();
+            e.tsnIDLength = tsnID.size();
+            fieldEntries[f].append(e);
+        }
+    }
+
+    const QChar *chars = poolText.constData();
+    QVector<Word> fieldWords[FieldCount];
+    for (int f = 0; f < FieldCount; f++)
+    {
+        QVector<Entry> &list = fieldEntries[f];
+        std::sort(list.begin(), list.end(), [chars](const Entry &a, const Entry &b) {
+            return compareFolded(chars + a.display, a.displayLength, chars + b.display, b.displayLength) < 0;
+        });
+
+        // index every word of the name, but not the trailing "(tsnID)"
+        QVector<Word> &wordList = fieldWords[f];
+        for (int i = 0; i < list.size(); i++)
+        {
+            const QChar *name = chars + list.at(i).display;
+            int nameLength = list.at(i).displayLength - list.at(i).tsnIDLength - 3;
+            int start = -1;
+            for (int c = 0; c <= nameLength; c++)
+            {
+                bool separator = c == nameLength || isSeparator(name[c]);
+                if (!separator && start == -1)
+                    start = c;
+                else if (separator && start != -1)
+                {
+                    Word w;
+                    w.entry = i;
+                    w.offset = start;
+                    w.length = c - start;
+                    wordList.append(w);
+                    start = -1;
+                }
+            }
+        }
+        std::sort(wordList.begin(), wordList.end(), [chars, &list](const Word &a, const Word &b) {
+            return compareFolded(chars + list.at(a.entry).display + a.offset, a.length,
+                                 chars + list.at(b.entry).display + b.offset, b.length) < 0;
+        });
+    }
+
+    // lay out the header, each field's records and then the character pool in one block
+    Header h;
+    memset(&h, 0, sizeof(Header));
+    memcpy(h.magic, "BIOTAXIX", 8);
+    h.formatVersion = formatVersion;
+    h.taxaCount = taxaCount;
+    quint32 offset = sizeof(Header);
+    for (int f = 0; f < FieldCount; f++)
+    {
+        h.fields[f].entryCount = fieldEntries[f].size();
+        h.fields[f].entriesOffset = offset;
+        offset += fieldEntries[f].size() * sizeof(Entry);
+        h.fields[f].wordCount = fieldWords[f].size();
+        h.fields[f].wordsOffset = offset;
+        offset += fieldWords[f].size() * sizeof(Word);
+    }
+    h.poolOffset = offset;
+    h.poolLength = poolText.size();
+
+    QByteArray bytes;
+    bytes.reserve(offset + poolText.size() * sizeof(QChar));
+    bytes.append(reinterpret_cast<const char*>(&h), sizeof(Header));
+    for (int f = 0; f < FieldCount; f++)
+    {
+        bytes.append(reinterpret_cast<const char*>(fieldEntries[f].constData()), fieldEntries[f].size() * sizeof(Entry));
+        bytes.append(reinterpret_cast<const char*>(fieldWords[f].constData()), fieldWords[f].size() * sizeof(Word));
+    }
+    bytes.append(reinterpret_cast<const char*>(chars), poolText.size() * sizeof(QChar));
+
+    // save it, then map the saved file so the pages are shared with the OS file cache instead of the heap;
+    // each build gets a new file, since windows still using the previous index keep it mapped
+    QString fileName = "taxonindex-" + QString::number(QDateTime::currentMSecsSinceEpoch()) + ".dat";
+    QString path = indexFolder() + fileName;
+    QString tmpPath = path + ".tmp";
+    bool saved = false;
+    QFile out(tmpPath);
+    if (out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        saved = out.write(bytes) == bytes.size();
+        out.close();
+        if (saved)
+            saved = QFile::rename(tmpPath, path);
+    }
+    if (!saved)
+    {
+        qDebug() << "Could not save the taxon index to " + path;
+        QFile::remove(tmpPath);
+    }
+
+    TaxonIndex *index = new TaxonIndex;
+    if (!saved || !index->map(path, taxaCount))
+    {
+        index->buffer = bytes;
+        index->setData(reinterpret_cast<const uchar*>(index->buffer.constData()), index->buffer.size());
+    }
+
+    if (saved)
+    {
+        QSqlQuery qry;
+        qry.prepare("INSERT OR REPLACE INTO settings (setting, value) VALUES (?, ?)");
+        qry.addBindValue("taxa.indexfile");
+        qry.addBindValue(fileName);
+        qry.exec();
+
+        qry.prepare("INSERT OR REPLACE INTO settings (setting, value) VALUES (?, ?)");
+        qry.addBindValue("taxa.indexdirty");
+        qry.addBindValue("false");
+        qry.exec();
+
+        removeOldIndexes(fileName);
+    }
+
+    return QSharedPointer<const TaxonIndex>(index);
+}
+
+const TaxonIndex::Entry *TaxonIndex::entryAt(Field field, int i) const
+{
+    return reinterpret_cast<const Entry*>(data + header->fields[field].entriesOffset) + i;
+}
+
+const TaxonIndex::Word *TaxonIndex::wordAt(Field field, int i) const
+{
+    return reinterpret_cast<const Word*>(data + header->fields[field].wordsOffset) + i;
+}
+
+QString TaxonIndex::display(const Entry *e) const
+{
+    return QString(pool + e->display, e->displayLength);
+}
+
+int TaxonIndex::size(Field field) const
+{
+    return header->fields[field].entryCount;
+}
+
+QString TaxonIndex::tsnFromDisplay(const QString &display)
+{
+    // display strings end in " (tsnID)"
+    QString tsnID = display.split(" ").last();
+    tsnID.remove("(");
+    tsnID.remove(")");
+    return tsnID;
+}
+
+int TaxonIndex::lowerBoundEntry(Field field, const QString &foldedKey) const
+{
+    int lo = 0;
+    int hi = size(field);
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        const Entry *e = entryAt(field, mid);
+        if (compareFolded(pool + e->display, e->displayLength, foldedKey) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+int TaxonIndex::lowerBoundWord(Field field, const QString &foldedKey) const
+{
+    int lo = 0;
+    int hi = header->fields[field].wordCount;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        const Word *w = wordAt(field, mid);
+        if (compareFolded(pool + entryAt(field, w->entry)->display + w->offset, w->length, foldedKey) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+QString TaxonIndex::exactTSN(Field field, const QString &display) const
+{
+    QString key = foldCase(display);
+    int i = lowerBoundEntry(field, key);
+    if (i >= size(field))
+        return "";
+    const Entry *e = entryAt(field, i);
+    if (compareFolded(pool + e->display, e->displayLength, key) != 0)
+        return "";
+    return QString(pool + e->tsnID, e->tsnIDLength);
+}
+
+bool TaxonIndex::hasWordPrefix(const QString &name, const QString &prefix)
+{
+    int from = 0;
+    while ((from = name.indexOf(prefix, from, Qt::CaseInsensitive)) != -1)
+    {
+        if (from == 0 || isSeparator(name.at(from-1)))
+            return true;
+        from++;
+    }
+    return false;
+}
+
+QStringList TaxonIndex::matches(Field field, const QString &text, int limit, bool anywhere) const
+{
+    QStringList results;
+    QString query = foldCase(text.simplified());
+    if (query.isEmpty() || limit <= 0)
+        return results;
+
+    int count = size(field);
+    QSet<int> found;
+
+    // 1. names starting with the query
+    for (int i = lowerBoundEntry(field, query); i < count && results.size() < limit; i++)
+    {
+        const Entry *e = entryAt(field, i);
+        if (int(e->displayLength) < query.size() ||
+                compareFolded(pool + e->display, query.size(), query) != 0)
+            break;
+        found.insert(i);
+        results.append(display(e));
+    }
+    if (results.size() >= limit)
+        return results;
+
+    // 2. names with a word starting with each word of the query, driven by the most selective (longest) word
+    QStringList queryWords = query.split(" ", QString::SkipEmptyParts);
+    QString driver = queryWords.first();
+    for (auto w : queryWords)
+    {
+        if (w.length() > driver.length())
+            driver = w;
+    }
+
+    int wordCount = header->fields[field].wordCount;
+    for (int i = lowerBoundWord(field, driver); i < wordCount && results.size() < limit; i++)
+    {
+        const Word *w = wordAt(field, i);
+        const Entry *e = entryAt(field, w->entry);
+        if (w->length < driver.size() ||
+                compareFolded(pool + e->display + w->offset, driver.size(), driver) != 0)
+            break;
+        if (found.contains(w->entry))
+            continue;
+
+        QString name = QString::fromRawData(pool + e->display, e->displayLength);
+        bool all = true;
+        for (auto qw : queryWords)
+        {
+            if (qw != driver && !hasWordPrefix(name, qw))
+            {
+                all = false;
+                break;
+            }
+        }
+        if (!all)
+            continue;
+        found.insert(w->entry);
+        results.append(display(e));
+    }
+    if (results.size() >= limit || !anywhere || query.length() < 3)
+        return results;
+
+    // 3. anything else containing the query; this scans the whole list, so it only runs when asked for
+    for (int i = 0; i < count && results.size() < limit; i++)
+    {
+        const Entry *e = entryAt(field, i);
+        if (!found.contains(i) &&
+                QString::fromRawData(pool + e->display, e->displayLength).contains(query, Qt::CaseInsensitive))
+            results.append(display(e));
+    }
+    return results;
+}
@@ -0,0 +1,117 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TAXONINDEX_H
+#define TAXONINDEX_H
+
+#include <QtCore>
+
+// Search index over the names in the taxa table, used for the taxon completers.
+// Each field keeps its "name (tsnID)" display strings sorted without regard to case,
+// plus a sorted list of the words in them, so that prefix, word-prefix
+// ("red oak" finds "northern red oak") and exact lookups are binary searches.
+// Matching anywhere inside a name is a full scan, so matches() only falls back
+// to it when the caller asks.
+//
+// The index is built from the taxa table only when triggers on that table have
+// flagged it as changed. It is saved to data/taxonindex-<time>.dat in a flat
+// layout that is memory-mapped on the next start, and one read-only instance
+// is shared by every window that needs it. Each build writes a new file, named
+// in the taxa.indexfile setting, because windows holding the previous
+// instance still have its file mapped.
+class TaxonIndex
+{
+public:
+    enum Field { Genus, Species, CommonName, Family, FieldCount };
+
+    ~TaxonIndex();
+    static QSharedPointer<const TaxonIndex> shared();
+    static void createTriggers();
+
+    int size(Field field) const;
+    QString exactTSN(Field field, const QString &display) const;
+    QStringList matches(Field field, const QString &text, int limit, bool anywhere = false) const;
+
+    static QString tsnFromDisplay(const QString &display);
+
+private:
+    TaxonIndex();
+
+    struct FieldHeader
+    {
+        quint32 entryCount;
+        quint32 entriesOffset;   // byte offset of the Entry records
+        quint32 wordCount;
+        quint32 wordsOffset;     // byte offset of the Word records
+    };
+    struct Header
+    {
+        char magic[8];
+        quint32 formatVersion;
+        quint32 taxaCount;
+        quint32 poolOffset;      // byte offset of the QChar pool that all strings point into
+        quint32 poolLength;
+        FieldHeader fields[FieldCount];
+    };
+    struct Entry                 // string offsets and lengths are in QChars from the start of the pool
+    {
+        quint32 display;
+        quint32 displayLength;
+        quint32 tsnID;
+        quint32 tsnIDLength;
+    };
+    struct Word
+    {
+        quint32 entry;
+        quint16 offset;          // from the start of the entry's display name
+        quint16 length;
+    };
+
+    static QSharedPointer<const TaxonIndex> build(int taxaCount);
+    static QString indexFolder();
+    static void removeOldIndexes(const QString &current);
+    static int taxaCount();
+    bool map(const QString &path, int expectedTaxaCount);
+    void setData(const uchar *bytes, qint64 size);
+
+    const Entry *entryAt(Field field, int i) const;
+    const Word *wordAt(Field field, int i) const;
+    QString display(const Entry *e) const;
+    int lowerBoundEntry(Field field, const QString &foldedKey) const;
+    int lowerBoundWord(Field field, const QString &foldedKey) const;
+    static QString foldCase(const QString &text);
+    static int compareFolded(const QChar *chars, int length, const QString &foldedKey);
+    static int compareFolded(const QChar *a, int aLength, const QChar *b, int bLength);
+    static bool hasWordPrefix(const QString &name, const QString &prefix);
+    static bool isSeparator(QChar c);
+
+    QFile file;
+    QByteArray buffer;           // used instead of the file if it couldn't be written and mapped
+    const uchar *data;
+    qint64 dataSize;
+    const Header *header;
+    const QChar *pool;
+
+    static const quint32 formatVersion = 1;
+};
+
+#endif // TAXONINDEX_H
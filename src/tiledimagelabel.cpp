@@ -0,0 +1,278 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <QImageReader>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QtConcurrent>
+
+#include "tiledimagelabel.h"
+
+TiledImageLabel::TiledImageLabel(QWidget *parent) :
+    QLabel(parent)
+{
+    generation = 0;
+    orientation = QImageIOHandler::TransformationNone;
+    setMemoryBudget(128);
+    decodePool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+}
+
+TiledImageLabel::~TiledImageLabel()
+{
+    wantedMutex.lock();
+    wantedKeys.clear();
+    wantedMutex.unlock();
+    decodePool.waitForDone();
+}
+
+void TiledImageLabel::setMemoryBudget(int megabytes)
+{
+    tileCache.setMaxCost(megabytes * 1024);
+}
+
+void TiledImageLabel::setSourceFile(const QString &fileName)
+{
+    if (fileName == sourceFile)
+        return;
+
+    // tiles of the previous image that are still queued will be skipped and ignored
+    generation.fetchAndAddOrdered(1);
+    wantedMutex.lock();
+    wantedKeys.clear();
+    wantedMutex.unlock();
+    tileCache.clear();
+    pending.clear();
+
+    sourceFile = fileName;
+    fullSize = QSize();
+    orientation = QImageIOHandler::TransformationNone;
+    rawToOriented.reset();
+    if (sourceFile.isEmpty())
+        return;
+
+    QImageReader imageReader(sourceFile);
+    QSize rawSize = imageReader.size();
+    if (!rawSize.isValid())
+    {
+        sourceFile = "";
+        return;
+    }
+    orientation = imageReader.transformation();
+
+    // same order as QImageReader's auto transform: mirror and flip first, then rotate clockwise
+    int w = rawSize.width();
+    int h = rawSize.height();
+    if (orientation & QImageIOHandler::TransformationMirror)
+        rawToOriented = rawToOriented * QTransform(-1, 0, 0, 1, w, 0);
+    if (orientation & QImageIOHandler::TransformationFlip)
+        rawToOriented = rawToOriented * QTransform(1, 0, 0, -1, 0, h);
+    if (orientation & QImageIOHandler::TransformationRotate90)
+    {
+        rawToOriented = rawToOriented * QTransform(0, 1, -1, 0, h, 0);
+        rawSize.transpose();
+    }
+    fullSize = rawSize;
+}
+
+QString TiledImageLabel::tileKey(int level, int tx, int ty) const
+{
+    return QString::number(level) + "/" + QString::number(tx) + "/" + QString::number(ty);
+}
+
+QRect TiledImageLabel::orientedTileRect(int level, int tx, int ty) const
+{
+    // tiles are tileSize pixels at their level, which is downsampled by 2^level from the original
+    int span = tileSize << level;
+    return QRect(tx*span, ty*span, span, span).intersected(QRect(QPoint(0,0), fullSize));
+}
+
+QRect TiledImageLabel::displayRect(const QRect &orientedRect) const
+{
+    double displayScale = double(width()) / fullSize.width();
+    return QRectF(orientedRect.x() * displayScale, orientedRect.y() * displayScale,
+                  orientedRect.width() * displayScale, orientedRect.height() * displayScale).toAlignedRect();
+}
+
+void TiledImageLabel::paintEvent(QPaintEvent *event)
+{
+    QLabel::paintEvent(event);
+
+    if (sourceFile.isEmpty() || !fullSize.isValid() || pixmap() == 0)
+        return;
+
+    // nothing to add until the label is zoomed in past the resolution of its pixmap
+    if (width() <= pixmap()->width())
+        return;
+
+    double displayScale = double(width()) / fullSize.width();
+    int level = 0;
+    while ((2 << level) * displayScale <= 1.0)
+        level++;
+
+    // the wanted set covers everything in view, even when only part of it is being repainted
+    QRect visible = visibleRegion().boundingRect();
+    if (visible.isEmpty() || !visible.intersects(event->rect()))
+        return;
+
+    int span = tileSize << level;
+    int firstX = qMax(0, int(visible.left() / displayScale) / span);
+    int lastX = qMin((fullSize.width() - 1) / span, int(visible.right() / displayScale) / span);
+    int firstY = qMax(0, int(visible.top() / displayScale) / span);
+    int lastY = qMin((fullSize.height() - 1) / span, int(visible.bottom() / displayScale) / span);
+
+    QSet<QString> wanted;
+    for (int ty = firstY; ty <= lastY; ty++)
+        for (int tx = firstX; tx <= lastX; tx++)
+            wanted.insert(tileKey(level, tx, ty));
+    wantedMutex.lock();
+    wantedKeys = wanted;
+    wantedMutex.unlock();
+
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    for (int ty = firstY; ty <= lastY; ty++)
+    {
+        for (int tx = firstX; tx <= lastX; tx++)
+        {
+            if (!displayRect(orientedTileRect(level, tx, ty)).intersects(event->rect()))
+                continue;
+
+            QImage *tile = tileCache.object(tileKey(level, tx, ty));
+            if (tile != 0)
+            {
+                painter.drawImage(displayRect(orientedTileRect(level, tx, ty)), *tile);
+                continue;
+            }
+            drawCoarserTile(painter, level, tx, ty);
+            requestTile(level, tx, ty);
+        }
+    }
+}
+
+bool TiledImageLabel::drawCoarserTile(QPainter &painter, int level, int tx, int ty)
+{
+    QRect tileRect = orientedTileRect(level, tx, ty);
+    int maxLevel = 0;
+    while ((tileSize << maxLevel) < qMax(fullSize.width(), fullSize.height()))
+        maxLevel++;
+
+    for (int parent = level + 1; parent <= maxLevel; parent++)
+    {
+        int shift = parent - level;
+        QImage *tile = tileCache.object(tileKey(parent, tx >> shift, ty >> shift));
+        if (tile == 0)
+            continue;
+
+        QRect parentRect = orientedTileRect(parent, tx >> shift, ty >> shift);
+        double toParent = 1.0 / (1 << parent);
+        QRectF source((tileRect.x() - parentRect.x()) * toParent, (tileRect.y() - parentRect.y()) * toParent,
+                      tileRect.width() * toParent, tileRect.height() * toParent);
+        painter.drawImage(displayRect(tileRect), *tile, source);
+        return true;
+    }
+    return false;
+}
+
+void TiledImageLabel::requestTile(int level, int tx, int ty)
+{
+    TileRequest request;
+    request.key = tileKey(level, tx, ty);
+    if (pending.contains(request.key))
+        return;
+    pending.insert(request.key);
+
+    request.fileName = sourceFile;
+    request.generation = generation.load();
+    request.orientation = orientation;
+    request.rawRect = rawToOriented.inverted().mapRect(QRectF(orientedTileRect(level, tx, ty))).toAlignedRect();
+    int factor = 1 << level;
+    request.scaledSize = QSize((request.rawRect.width() + factor - 1) / factor,
+                               (request.rawRect.height() + factor - 1) / factor);
+
+    QFutureWatcher<TileResult> *watcher = new QFutureWatcher<TileResult>(this);
+    connect(watcher, SIGNAL(finished()), this, SLOT(decodeFinished()));
+    watcher->setFuture(QtConcurrent::run(&decodePool, this, &TiledImageLabel::decode, request));
+}
+
+void TiledImageLabel::decodeFinished()
+{
+    QFutureWatcher<TileResult> *watcher = static_cast<QFutureWatcher<TileResult>*>(sender());
+    TileResult result = watcher->result();
+    watcher->deleteLater();
+
+    if (result.request.generation != generation.load())
+        return;
+    pending.remove(result.request.key);
+
+    QStringList parts = result.request.key.split("/");
+    QRect tileRect = orientedTileRect(parts.at(0).toInt(), parts.at(1).toInt(), parts.at(2).toInt());
+
+    if (result.stale)
+    {
+        // it scrolled back into view after the decode thread had already skipped it
+        wantedMutex.lock();
+        bool wanted = wantedKeys.contains(result.request.key);
+        wantedMutex.unlock();
+        if (wanted)
+            update(displayRect(tileRect));
+        return;
+    }
+    if (result.image.isNull())
+        return;
+
+    tileCache.insert(result.request.key, new QImage(result.image), qMax(1, result.image.byteCount() / 1024));
+    update(displayRect(tileRect));
+}
+
+TileResult TiledImageLabel::decode(const TileRequest &request)
+{
+    TileResult result;
+    result.request = request;
+
+    wantedMutex.lock();
+    result.stale = !wantedKeys.contains(request.key);
+    wantedMutex.unlock();
+    if (result.stale)
+        return result;
+
+    // decode just this region of the original, downsampled by the decoder itself where it can
+    QImageReader imageReader(request.fileName);
+    imageReader.setAutoTransform(false);
+    imageReader.setClipRect(request.rawRect);
+    imageReader.setScaledSize(request.scaledSize);
+    QImage tile = imageReader.read();
+    if (tile.isNull())
+    {
+        qDebug() << __LINE__ << "Could not decode tile " + request.key + " from file: " + request.fileName;
+        return result;
+    }
+
+    QImageIOHandler::Transformations orientation = request.orientation;
+    if (orientation & (QImageIOHandler::TransformationMirror | QImageIOHandler::TransformationFlip))
+        tile = tile.mirrored(orientation & QImageIOHandler::TransformationMirror,
+                             orientation & QImageIOHandler::TransformationFlip);
+    if (orientation & QImageIOHandler::TransformationRotate90)
+        tile = tile.transformed(QTransform().rotate(90));
+
+    result.image = tile;
+    return result;
+}
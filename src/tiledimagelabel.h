@@ -0,0 +1,95 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TILEDIMAGELABEL_H
+#define TILEDIMAGELABEL_H
+
+#include <QLabel>
+#include <QtCore>
+#include <QImage>
+#include <QImageIOHandler>
+#include <QCache>
+#include <QMutex>
+#include <QThreadPool>
+#include <QFutureWatcher>
+
+struct TileRequest
+{
+    QString key;
+    QString fileName;
+    int generation;
+    QRect rawRect;      // in the coordinates of the file before its EXIF orientation is applied
+    QSize scaledSize;
+    QImageIOHandler::Transformations orientation;
+};
+
+struct TileResult
+{
+    TileRequest request;
+    QImage image;
+    bool stale;
+};
+
+// A QLabel that shows its (viewport-sized) pixmap as usual, but once it is
+// zoomed in past the pixmap's resolution it paints the visible area from
+// tiles decoded out of the original file at the resolution level needed.
+// Coarser tiles that are already cached stand in until the finer ones are ready.
+class TiledImageLabel : public QLabel
+{
+    Q_OBJECT
+public:
+    explicit TiledImageLabel(QWidget *parent = 0);
+    ~TiledImageLabel();
+
+    void setSourceFile(const QString &fileName);
+    void setMemoryBudget(int megabytes);
+
+protected:
+    void paintEvent(QPaintEvent *event);
+
+private slots:
+    void decodeFinished();
+
+private:
+    TileResult decode(const TileRequest &request);
+    QString tileKey(int level, int tx, int ty) const;
+    QRect displayRect(const QRect &orientedRect) const;
+    QRect orientedTileRect(int level, int tx, int ty) const;
+    bool drawCoarserTile(QPainter &painter, int level, int tx, int ty);
+    void requestTile(int level, int tx, int ty);
+
+    QString sourceFile;
+    QSize fullSize;                               // after the EXIF orientation is applied
+    QImageIOHandler::Transformations orientation;
+    QTransform rawToOriented;
+    QAtomicInt generation;
+
+    QCache<QString,QImage> tileCache;             // cost is in kilobytes
+    QSet<QString> pending;
+    QSet<QString> wantedKeys;                     // shared with the decode threads
+    QMutex wantedMutex;
+    QThreadPool decodePool;
+
+    static const int tileSize = 256;
+};
+
+#endif // TILEDIMAGELABEL_H
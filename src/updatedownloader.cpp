@@ -0,0 +1,271 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <QSqlQuery>
+
+#include "updatedownloader.h"
+
+UpdateDownloader::UpdateDownloader(const QString &folder, QObject *parent) :
+    QObject(parent),
+    folder(folder)
+{
+}
+
+UpdateDownloader::~UpdateDownloader()
+{
+    cancel();
+}
+
+void UpdateDownloader::add(const QUrl &url, const QString &fileName)
+{
+    Download *download = new Download;
+    download->url = url;
+    download->fileName = fileName;
+    download->file = 0;
+    download->received = 0;
+    download->redirects = 0;
+    waiting.append(download);
+    requested.append(fileName);
+}
+
+bool UpdateDownloader::isRunning() const
+{
+    return !active.isEmpty();
+}
+
+bool UpdateDownloader::contains(const QString &fileName) const
+{
+    return requested.contains(fileName);
+}
+
+void UpdateDownloader::start()
+{
+    QDir dir(folder);
+    if (!dir.exists())
+        dir.mkpath(folder);
+
+    // QNetworkAccessManager runs up to six requests per host at once, so send them all now
+    QList<Download*> toSend = waiting;
+    waiting.clear();
+    for (auto download : toSend)
+        send(download);
+
+    if (active.isEmpty())
+    {
+        QStringList done = changed;
+        QStringList notDone = failed;
+        changed.clear();
+        failed.clear();
+        requested.clear();
+        emit finished(done, notDone);
+    }
+}
+
+void UpdateDownloader::cancel()
+{
+    for (auto reply : active.keys())
+    {
+        Download *download = active.take(reply);
+        disconnect(reply, 0, this, 0);
+        reply->abort();
+        reply->deleteLater();
+        download->file->cancelWriting();
+        delete download->file;
+        delete download;
+    }
+    qDeleteAll(waiting);
+    waiting.clear();
+    changed.clear();
+    failed.clear();
+    requested.clear();
+}
+
+QString UpdateDownloader::setting(const QString &name) const
+{
+    QSqlQuery qry;
+    qry.prepare("SELECT value FROM settings WHERE setting = (?)");
+    qry.addBindValue(name);
+    qry.exec();
+    if (qry.next())
+        return qry.value(0).toString();
+    return "";
+}
+
+void UpdateDownloader::send(Download *download)
+{
+    QString path = folder + "/" + download->fileName;
+    QNetworkRequest request(download->url);
+
+    // only ask for changes if there's a local copy to fall back on
+    if (QFile::exists(path))
+    {
+        QString etag = setting("download.etag." + download->fileName);
+        QString lastModified = setting("download.lastmodified." + download->fileName);
+        if (!etag.isEmpty())
+            request.setRawHeader("If-None-Match", etag.toUtf8());
+        if (!lastModified.isEmpty())
+            request.setRawHeader("If-Modified-Since", lastModified.toUtf8());
+    }
+
+    // the body goes into a temporary file next to the destination that is renamed over it on commit()
+    download->file = new QSaveFile(path);
+    download->received = 0;
+    if (!download->file->open(QIODevice::WriteOnly))
+    {
+        qDebug() << "Could not write to " + path;
+        failed.append(download->fileName);
+        delete download->file;
+        delete download;
+        return;
+    }
+
+    qDebug() << "Making a request to: " + download->url.toString();
+    QNetworkReply *reply = manager.get(request);
+    active.insert(reply, download);
+    connect(reply, SIGNAL(readyRead()), this, SLOT(downloadReadyRead()));
+    connect(reply, SIGNAL(finished()), this, SLOT(downloadFinished()));
+}
+
+void UpdateDownloader::downloadReadyRead()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+    Download *download = active.value(reply);
+    if (!download)
+        return;
+
+    // redirects and "not modified" responses have no body worth keeping
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200)
+        return;
+
+    QByteArray chunk = reply->readAll();
+    download->received += chunk.size();
+    download->file->write(chunk);
+}
+
+void UpdateDownloader::downloadFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply || !active.contains(reply))
+        return;
+    Download *download = active.take(reply);
+    reply->deleteLater();
+
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    QVariant redirectionTarget = reply->attribute(QNetworkRequest::RedirectionTargetAttribute);
+
+    if (reply->error())
+    {
+        qDebug() << "Downloading " + download->fileName + " failed: " + reply->errorString();
+        download->file->cancelWriting();
+        finishDownload(download, false);
+    }
+    else if (!redirectionTarget.isNull())
+    {
+        download->file->cancelWriting();
+        delete download->file;
+        download->file = 0;
+        if (++download->redirects > maxRedirects)
+        {
+            qDebug() << "Too many redirects downloading " + download->fileName;
+            failed.append(download->fileName);
+            delete download;
+        }
+        else
+        {
+            download->url = download->url.resolved(redirectionTarget.toUrl());
+            qDebug() << "Redirecting download request to: " + download->url.toString();
+            send(download);
+        }
+        if (active.isEmpty())
+            finishDownload(0, false);
+    }
+    else if (status == 304)
+    {
+        qDebug() << download->fileName + " has not changed since it was last downloaded.";
+        download->file->cancelWriting();
+        finishDownload(download, true);
+    }
+    else
+    {
+        // check the body is complete before it replaces the local copy; a compressed body is
+        // inflated by QNetworkAccessManager, so its Content-Length doesn't apply
+        QByteArray rest = reply->readAll();
+        download->received += rest.size();
+        download->file->write(rest);
+
+        bool complete = download->received > 0;
+        QVariant length = reply->header(QNetworkRequest::ContentLengthHeader);
+        if (length.isValid() && reply->rawHeader("Content-Encoding").isEmpty())
+            complete = complete && length.toLongLong() == download->received;
+
+        if (complete && download->file->commit())
+        {
+            saveValidators(download->fileName, reply);
+            changed.append(download->fileName);
+            finishDownload(download, true);
+        }
+        else
+        {
+            qDebug() << "Download of " + download->fileName + " was incomplete: " + QString::number(download->received) + " bytes";
+            download->file->cancelWriting();
+            finishDownload(download, false);
+        }
+    }
+}
+
+void UpdateDownloader::finishDownload(Download *download, bool ok)
+{
+    if (download)
+    {
+        if (!ok)
+            failed.append(download->fileName);
+        delete download->file;
+        delete download;
+    }
+
+    if (!active.isEmpty())
+        return;
+
+    QStringList done = changed;
+    QStringList notDone = failed;
+    changed.clear();
+    failed.clear();
+    requested.clear();
+    emit finished(done, notDone);
+}
+
+void UpdateDownloader::saveValidators(const QString &fileName, QNetworkReply *reply)
+{
+    QStringList names;
+    names << "download.etag." + fileName << "download.lastmodified." + fileName;
+    QStringList values;
+    values << QString::fromUtf8(reply->rawHeader("ETag")) << QString::fromUtf8(reply->rawHeader("Last-Modified"));
+
+    for (int i = 0; i < names.size(); i++)
+    {
+        QSqlQuery qry;
+        qry.prepare("INSERT OR REPLACE INTO settings (setting, value) VALUES (?, ?)");
+        qry.addBindValue(names.at(i));
+        qry.addBindValue(values.at(i));
+        qry.exec();
+    }
+}
@@ -0,0 +1,86 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef UPDATEDOWNLOADER_H
+#define UPDATEDOWNLOADER_H
+
+#include <QObject>
+#include <QtCore>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QSaveFile>
+
+// Downloads a set of files into one folder, all at the same time. Each body is
+// written to a temporary file as it arrives and only replaces the local copy
+// once it has been checked against the Content-Length, so an interrupted
+// download never leaves a partial file behind. The ETag and Last-Modified of
+// every file are kept in the settings table, and a file that is already
+// present is requested with If-None-Match/If-Modified-Since so that it is only
+// transferred again when it has changed.
+class UpdateDownloader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit UpdateDownloader(const QString &folder, QObject *parent = 0);
+    ~UpdateDownloader();
+
+    void add(const QUrl &url, const QString &fileName);
+    void start();
+    void cancel();
+    bool isRunning() const;
+    bool contains(const QString &fileName) const;
+
+signals:
+    // changed lists the files that were downloaded, failed those that couldn't be
+    void finished(const QStringList &changed, const QStringList &failed);
+
+private slots:
+    void downloadReadyRead();
+    void downloadFinished();
+
+private:
+    struct Download
+    {
+        QUrl url;
+        QString fileName;
+        QSaveFile *file;
+        qint64 received;
+        int redirects;
+    };
+
+    void send(Download *download);
+    void finishDownload(Download *download, bool ok);
+    void saveValidators(const QString &fileName, QNetworkReply *reply);
+    QString setting(const QString &name) const;
+
+    QString folder;
+    QNetworkAccessManager manager;
+    QList<Download*> waiting;
+    QHash<QNetworkReply*,Download*> active;
+    QStringList changed;
+    QStringList failed;
+    QStringList requested;
+
+    static const int maxRedirects = 5;
+};
+
+#endif // UPDATEDOWNLOADER_H
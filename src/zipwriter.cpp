@@ -0,0 +1,281 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <QCryptographicHash>
+
+// Qt's own zlib is exported from QtCore on Windows and Mac; elsewhere Qt uses the system's
+#if defined(Q_OS_WIN) || defined(Q_OS_MAC)
+#include <QtZlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+#include "zipwriter.h"
+
+static const quint16 versionNeeded = 20;
+static const quint16 versionZip64 = 45;
+static const quint16 dataDescriptor = 0x0008;
+static const quint16 utf8Names = 0x0800;
+static const quint16 methodStored = 0;
+static const quint16 methodDeflated = 8;
+static const quint32 classicLimit = 0xFFFFFFFF;
+static const quint16 classicEntryLimit = 0xFFFF;
+
+// The device open() hands out. Everything written to it goes through the
+// checksums and, for deflated entries, a raw deflate stream into the archive.
+class ZipWriter::EntryDevice : public QIODevice
+{
+public:
+    EntryDevice(QIODevice *archive, bool deflate);
+    ~EntryDevice();
+
+    bool finishData();
+
+    quint32 crc;
+    quint64 size;
+    quint64 compressedSize;
+    QCryptographicHash sha;
+
+protected:
+    qint64 readData(char *, qint64) { return -1; }
+    qint64 writeData(const char *data, qint64 len);
+
+private:
+    bool deflateChunk(const char *data, uInt len, int flush);
+
+    QIODevice *archive;
+    bool deflating;
+    bool failed;
+    z_stream stream;
+    QByteArray buffer;
+};
+
+ZipWriter::EntryDevice::EntryDevice(QIODevice *archive, bool deflate) :
+    crc(::crc32(0, Z_NULL, 0)),
+    size(0),
+    compressedSize(0),
+    sha(QCryptographicHash::Sha256),
+    archive(archive),
+    deflating(deflate),
+    failed(false),
+    buffer(1 << 16, Qt::Uninitialized)
+{
+    if (deflating)
+    {
+        // negative window bits give the raw deflate stream zip wants, without the zlib header
+        memset(&stream, 0, sizeof(stream));
+        failed = deflateInit2(&stream, 6, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK;
+    }
+    QIODevice::open(QIODevice::WriteOnly);
+}
+
+ZipWriter::EntryDevice::~EntryDevice()
+{
+    if (deflating)
+        deflateEnd(&stream);
+}
+
+qint64 ZipWriter::EntryDevice::writeData(const char *data, qint64 len)
+{
+    // zlib and QCryptographicHash take int lengths, so large writes go in slices
+    const qint64 slice = 1 << 30;
+    for (qint64 offset = 0; offset < len && !failed; offset += slice)
+    {
+        uInt count = uInt(qMin(slice, len - offset));
+        const char *bytes = data + offset;
+        crc = ::crc32(crc, reinterpret_cast<const Bytef *>(bytes), count);
+        sha.addData(bytes, int(count));
+        size += count;
+        if (deflating)
+            deflateChunk(bytes, count, Z_NO_FLUSH);
+        else if (archive->write(bytes, count) != qint64(count))
+            failed = true;
+        else
+            compressedSize += count;
+    }
+    return failed ? -1 : len;
+}
+
+bool ZipWriter::EntryDevice::deflateChunk(const char *data, uInt len, int flush)
+{
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream.avail_in = len;
+    int result;
+    do
+    {
+        stream.next_out = reinterpret_cast<Bytef *>(buffer.data());
+        stream.avail_out = uInt(buffer.size());
+        result = deflate(&stream, flush);
+        if (result == Z_STREAM_ERROR)
+        {
+            failed = true;
+            return false;
+        }
+        qint64 have = buffer.size() - stream.avail_out;
+        if (have > 0 && archive->write(buffer.constData(), have) != have)
+        {
+            failed = true;
+            return false;
+        }
+        compressedSize += have;
+    } while (stream.avail_out == 0 || (flush == Z_FINISH && result != Z_STREAM_END));
+    return true;
+}
+
+bool ZipWriter::EntryDevice::finishData()
+{
+    if (deflating && !failed)
+        deflateChunk(0, 0, Z_FINISH);
+    QIODevice::close();
+    return !failed;
+}
+
+ZipWriter::ZipWriter(QIODevice *device) :
+    device(device),
+    entry(0)
+{
+    QDateTime now = QDateTime::currentDateTime();
+    dosTime = (now.time().hour() << 11) | (now.time().minute() << 5) | (now.time().second() / 2);
+    dosDate = ((now.date().year() - 1980) << 9) | (now.date().month() << 5) | now.date().day();
+}
+
+ZipWriter::~ZipWriter()
+{
+    delete entry;
+}
+
+QIODevice *ZipWriter::open(const QString &name, bool deflate)
+{
+    // the sizes and CRC aren't known yet, so the local header leaves them zero and
+    // sets the data descriptor flag
+    if (entry)
+        close();
+
+    current.name = name.toUtf8();
+    current.crc = 0;
+    current.compressedSize = 0;
+    current.size = 0;
+    current.offset = device->pos();
+    current.method = deflate ? methodDeflated : methodStored;
+
+    QDataStream out(device);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out << quint32(0x04034b50) << versionNeeded << quint16(utf8Names | dataDescriptor) << current.method
+        << dosTime << dosDate << quint32(0) << quint32(0) << quint32(0)
+        << quint16(current.name.size()) << quint16(0);
+    out.writeRawData(current.name.constData(), current.name.size());
+
+    entry = new EntryDevice(device, deflate);
+    return entry;
+}
+
+bool ZipWriter::close()
+{
+    if (!entry)
+        return false;
+
+    bool ok = entry->finishData();
+    current.crc = entry->crc;
+    current.size = entry->size;
+    current.compressedSize = entry->compressedSize;
+    lastSha256 = entry->sha.result().toHex();
+    delete entry;
+    entry = 0;
+
+    // sizes past the classic limit are written as 8 bytes, matching the zip64 extra field
+    // the central directory will have for this entry
+    QDataStream out(device);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out << quint32(0x08074b50) << current.crc;
+    if (current.size >= classicLimit || current.compressedSize >= classicLimit)
+        out << current.compressedSize << current.size;
+    else
+        out << quint32(current.compressedSize) << quint32(current.size);
+
+    records.append(current);
+    return ok && out.status() == QDataStream::Ok;
+}
+
+bool ZipWriter::add(const QString &name, const QByteArray &content, bool deflate)
+{
+    QIODevice *out = open(name, deflate);
+    bool written = out->write(content) == content.size();
+    return close() && written;
+}
+
+QByteArray ZipWriter::sha256() const
+{
+    // of the entry last closed
+    return lastSha256;
+}
+
+bool ZipWriter::finish()
+{
+    if (entry)
+        close();
+
+    quint64 directoryOffset = device->pos();
+
+    QDataStream out(device);
+    out.setByteOrder(QDataStream::LittleEndian);
+    for (auto record : records)
+    {
+        // each value too large for its classic field is saturated there and given in the zip64 extra field
+        QByteArray extra;
+        QDataStream extraOut(&extra, QIODevice::WriteOnly);
+        extraOut.setByteOrder(QDataStream::LittleEndian);
+        if (record.size >= classicLimit)
+            extraOut << record.size;
+        if (record.compressedSize >= classicLimit)
+            extraOut << record.compressedSize;
+        if (record.offset >= classicLimit)
+            extraOut << record.offset;
+        if (!extra.isEmpty())
+            extra.prepend(QByteArray("\x01\x00", 2) + char(extra.size()) + char(0));
+        quint16 version = extra.isEmpty() ? versionNeeded : versionZip64;
+
+        out << quint32(0x02014b50) << version << version << quint16(utf8Names | dataDescriptor) << record.method
+            << dosTime << dosDate << record.crc << quint32(qMin<quint64>(record.compressedSize, classicLimit))
+            << quint32(qMin<quint64>(record.size, classicLimit))
+            << quint16(record.name.size()) << quint16(extra.size()) << quint16(0) << quint16(0) << quint16(0)
+            << quint32(0) << quint32(qMin<quint64>(record.offset, classicLimit));
+        out.writeRawData(record.name.constData(), record.name.size());
+        out.writeRawData(extra.constData(), extra.size());
+    }
+    quint64 directorySize = device->pos() - directoryOffset;
+    quint64 count = records.size();
+
+    if (count >= classicEntryLimit || directorySize >= classicLimit || directoryOffset >= classicLimit)
+    {
+        // zip64 end of central directory record, then the locator that points back to it
+        quint64 zip64Offset = device->pos();
+        out << quint32(0x06064b50) << quint64(44) << versionZip64 << versionZip64 << quint32(0) << quint32(0)
+            << count << count << directorySize << directoryOffset;
+        out << quint32(0x07064b50) << quint32(0) << zip64Offset << quint32(1);
+    }
+
+    quint16 classicCount = quint16(qMin<quint64>(count, classicEntryLimit));
+    out << quint32(0x06054b50) << quint16(0) << quint16(0) << classicCount << classicCount
+        << quint32(qMin<quint64>(directorySize, classicLimit)) << quint32(qMin<quint64>(directoryOffset, classicLimit))
+        << quint16(0);
+    return out.status() == QDataStream::Ok;
+}
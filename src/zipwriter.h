@@ -0,0 +1,68 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2017 Ken Polzin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef ZIPWRITER_H
+#define ZIPWRITER_H
+
+#include <QtCore>
+
+// Writes a zip archive to a device in a single sequential pass. open() returns
+// a device that raw-deflates (or stores) whatever is written to it straight
+// into the archive, computing the entry's CRC-32 and SHA-256 on the way, so no
+// entry is ever held in memory; close() writes the sizes in a data descriptor
+// after the data. Zip64 records are added once an entry, the archive or the
+// number of entries outgrows the classic format.
+class ZipWriter
+{
+public:
+    explicit ZipWriter(QIODevice *device);
+    ~ZipWriter();
+
+    QIODevice *open(const QString &name, bool deflate);
+    bool close();
+    bool add(const QString &name, const QByteArray &content, bool deflate);
+    QByteArray sha256() const;
+    bool finish();
+
+private:
+    class EntryDevice;
+
+    struct Record
+    {
+        QByteArray name;
+        quint32 crc;
+        quint64 compressedSize;
+        quint64 size;
+        quint64 offset;
+        quint16 method;
+    };
+
+    QIODevice *device;
+    EntryDevice *entry;
+    Record current;
+    QList<Record> records;
+    QByteArray lastSha256;
+    quint16 dosTime;
+    quint16 dosDate;
+};
+
+#endif // ZIPWRITER_H